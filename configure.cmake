@@ -25,7 +25,8 @@ if(UNIX)
 	# show all warnings
 	# use c++0x features
 	# make throw() semantically equivalent to noexcept (std::exception uses throw() for instance)
-	set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS}\ -Wall -std=c++0x -fnothrow-opt")
+	# link the thread library for std::thread
+	set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS}\ -Wall -std=c++0x -fnothrow-opt -pthread")
 endif(UNIX)
 
 
@@ -49,12 +50,27 @@ add_library(gitpp STATIC
 			src/git/obj/object.cpp
 			src/git/obj/stream.cpp
 			src/git/obj/tree.cpp
+			src/git/obj/flat_tree.cpp
 			src/git/obj/commit.cpp
+			src/git/obj/actor_table.cpp
+			src/git/obj/commit_header.cpp
+			src/git/obj/serializer.cpp
+			src/git/obj/streaming_blob.cpp
+			src/git/obj/object_pool.cpp
 			src/git/obj/tag.cpp
 			src/git/obj/blob.cpp
 			src/git/obj/multiobj.cpp
 			src/git/db/odb_mem.cpp
 			src/git/db/odb_loose.cpp
+			src/git/db/odb_pack.cpp
+			src/git/db/pack_bitmap.cpp
+			src/git/db/fsck.cpp
+			src/git/db/commit_table.cpp
+			src/git/db/key_index.cpp
+			src/git/db/commit_graph.cpp
+			src/git/db/similarity.cpp
+			src/git/db/changed_paths.cpp
+			src/git/db/loose_gc.cpp
 			src/git/db/util.cpp
 			src/git/db/sha1_gen.cpp)
 
@@ -73,4 +89,6 @@ add_lib_test_executable(lib_sha1_performance_test lib_sha1_perf
 					test/git/db/sha1_performance_test.cpp)
 add_lib_test_executable(lib_looseodb_performance_test lib_looseodb_perf
 					test/git/db/looseodb_performance_test.cpp)
+add_lib_test_executable(lib_packodb_performance_test lib_packodb_perf
+					test/git/db/packodb_performance_test.cpp)
 
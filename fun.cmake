@@ -12,5 +12,6 @@ endfunction(add_model_test_executable)
 
 function(add_lib_test_executable name testname)
 	add_model_test_executable(${name} ${testname} ${ARGN})
-	target_link_libraries(${name} gitpp)
+	# gitpp depends on zlib, which has to follow it on the command line
+	target_link_libraries(${name} gitpp z.a)
 endfunction(add_lib_test_executable)
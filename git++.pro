@@ -40,8 +40,15 @@ HEADERS += \
     src/git/db/traits.hpp \
     src/git/obj/object.hpp \
     src/git/obj/tree.h \
+    src/git/obj/tree_view.h \
+    src/git/obj/flat_tree.h \
     src/git/obj/multiobj.h \
     src/git/obj/commit.h \
+    src/git/obj/actor_table.h \
+    src/git/obj/commit_header.h \
+    src/git/obj/serializer.h \
+    src/git/obj/streaming_blob.h \
+    src/git/obj/object_pool.h \
     src/git/obj/blob.h \
     src/git/obj/tag.h \
     src/gtl/db/generator_filter.hpp \
@@ -59,6 +66,33 @@ HEADERS += \
     src/gtl/db/odb_loose.hpp \
     src/git/db/odb_mem.h \
     src/git/db/odb_loose.h \
+    src/git/db/odb_pack.h \
+    src/gtl/db/odb_pack.hpp \
+    src/gtl/db/pack_file.hpp \
+    src/gtl/db/pack_writer.hpp \
+    src/gtl/db/odb_raw.hpp \
+    src/gtl/db/pack_midx.hpp \
+    src/gtl/db/ewah_bitmap.hpp \
+    src/gtl/db/pack_bitmap.hpp \
+    src/git/db/pack_bitmap.h \
+    src/gtl/db/odb_fsck.hpp \
+    src/gtl/thread_pool.hpp \
+    src/gtl/work_stealing_pool.hpp \
+    src/git/db/fsck.h \
+    src/git/db/commit_table.h \
+    src/git/db/key_index.h \
+    src/git/db/commit_graph.h \
+    src/git/db/rev_walk.h \
+    src/git/db/commit_cache.h \
+    src/git/db/merge_base.h \
+    src/git/db/tree_diff.h \
+    src/git/db/tree_walk.h \
+    src/git/db/similarity.h \
+    src/git/db/rename_detect.h \
+    src/git/db/changed_paths.h \
+    src/git/db/loose_gc.h \
+    src/git/db/connectivity.h \
+    src/git/db/reachability_cache.h \
     test/git/fixture.hpp
 
 SOURCES += \
@@ -73,7 +107,13 @@ SOURCES += \
     test/gtl/db/model_odb_test.cpp \
     src/git/obj/Tree.cpp \
     src/git/obj/tree.cpp \
+    src/git/obj/flat_tree.cpp \
     src/git/obj/commit.cpp \
+    src/git/obj/actor_table.cpp \
+    src/git/obj/commit_header.cpp \
+    src/git/obj/serializer.cpp \
+    src/git/obj/streaming_blob.cpp \
+    src/git/obj/object_pool.cpp \
     src/git/obj/blob.cpp \
     src/git/obj/tag.cpp \
     src/git/obj/object.cpp \
@@ -82,5 +122,15 @@ SOURCES += \
     src/git/db/util.cpp \
     src/git/db/odb_mem.cpp \
     src/git/db/odb_loose.cpp \
+    src/git/db/odb_pack.cpp \
+    src/git/db/pack_bitmap.cpp \
+    src/git/db/fsck.cpp \
+    src/git/db/commit_table.cpp \
+    src/git/db/key_index.cpp \
+    src/git/db/commit_graph.cpp \
+    src/git/db/similarity.cpp \
+    src/git/db/changed_paths.cpp \
+    src/git/db/loose_gc.cpp \
     src/git/obj/multiobj.cpp \
-    test/git/db/looseodb_performance_test.cpp
+    test/git/db/looseodb_performance_test.cpp \
+    test/git/db/packodb_performance_test.cpp
@@ -0,0 +1,133 @@
+#include <git/db/changed_paths.h>
+#include <git/config.h>		// for doxygen
+
+#include <algorithm>
+#include <cstring>
+
+GIT_NAMESPACE_BEGIN
+
+const uint32 BloomKey::num_hashes;
+const uint32 BloomFilter::bits_per_entry;
+const size_t ChangedPathFilters::max_changed_paths;
+
+namespace
+{
+	const uint32 seed0 = 0x293ae76f;
+	const uint32 seed1 = 0x7e646e2c;
+
+	inline uint32 rotate_left(uint32 v, int count)
+	{
+		return (v << count) | (v >> (32 - count));
+	}
+
+	//! \return byte at the given position, sign-extended as git's version 1 filters require
+	inline uint32 byte_at(const char* data, size_t pos)
+	{
+		return (uint32)(int32_t)(signed char)data[pos];
+	}
+}
+
+uint32 BloomKey::murmur3(uint32 seed, const char* data, size_t len)
+{
+	const uint32 c1 = 0xcc9e2d51;
+	const uint32 c2 = 0x1b873593;
+
+	const size_t len4 = len / 4;
+	for (size_t i = 0; i < len4; ++i) {
+		uint32 k = byte_at(data, i*4) | (byte_at(data, i*4 + 1) << 8) |
+		           (byte_at(data, i*4 + 2) << 16) | (byte_at(data, i*4 + 3) << 24);
+		k *= c1;
+		k = rotate_left(k, 15);
+		k *= c2;
+		seed ^= k;
+		seed = rotate_left(seed, 13) * 5 + 0xe6546b64;
+	}
+
+	const size_t tail = len4 * 4;
+	uint32 k = 0;
+	switch (len & 3) {
+	case 3: k ^= byte_at(data, tail + 2) << 16;	// fall through
+	case 2: k ^= byte_at(data, tail + 1) << 8;	// fall through
+	case 1: k ^= byte_at(data, tail);
+		k *= c1;
+		k = rotate_left(k, 15);
+		k *= c2;
+		seed ^= k;
+	}
+
+	seed ^= (uint32)len;
+	seed ^= seed >> 16;
+	seed *= 0x85ebca6b;
+	seed ^= seed >> 13;
+	seed *= 0xc2b2ae35;
+	seed ^= seed >> 16;
+	return seed;
+}
+
+BloomKey::BloomKey(const char* path, size_t len)
+{
+	const uint32 h0 = murmur3(seed0, path, len);
+	const uint32 h1 = murmur3(seed1, path, len);
+	for (uint32 i = 0; i < num_hashes; ++i) {
+		hashes[i] = h0 + i * h1;
+	}
+}
+
+BloomKey::BloomKey(const std::string& path)
+	: BloomKey(path.data(), path.size())
+{}
+
+void ChangedPathFilters::keys(const std::string& path, key_vector_type& out)
+{
+	out.clear();
+	for (size_t pos = path.find('/'); pos != std::string::npos; pos = path.find('/', pos + 1)) {
+		out.push_back(BloomKey(path.data(), pos));
+	}
+	out.push_back(BloomKey(path));
+}
+
+void ChangedPathFilters::push_back(const path_vector_type& changes)
+{
+	const size_t first = m_data.size();
+
+	// the same directory is a leading directory of many paths
+	m_paths.clear();
+	if (changes.size() <= max_changed_paths) {
+		for (auto i = changes.begin(); i != changes.end(); ++i) {
+			for (size_t pos = i->find('/'); pos != std::string::npos; pos = i->find('/', pos + 1)) {
+				m_paths.push_back(i->substr(0, pos));
+			}
+			m_paths.push_back(*i);
+		}
+		std::sort(m_paths.begin(), m_paths.end());
+		m_paths.erase(std::unique(m_paths.begin(), m_paths.end()), m_paths.end());
+	}
+
+	if (changes.size() > max_changed_paths || m_paths.size() > max_changed_paths) {
+		m_data.push_back(0xff);
+	} else {
+		const size_t size = std::max((m_paths.size() * BloomFilter::bits_per_entry + 7) / 8, (size_t)1);
+		m_data.resize(first + size, 0);
+		uchar* const filter = m_data.data() + first;
+		const uint64_t num_bits = (uint64_t)size * 8;
+		for (auto i = m_paths.begin(); i != m_paths.end(); ++i) {
+			const BloomKey key(*i);
+			for (uint32 h = 0; h < BloomKey::num_hashes; ++h) {
+				const uint64_t bit = key.hashes[h] % num_bits;
+				filter[bit / 8] |= (uchar)(1 << (bit % 8));
+			}
+		}
+	}
+	m_ends.push_back((uint32)m_data.size());
+}
+
+void ChangedPathFilters::append(const ChangedPathFilters& rhs)
+{
+	const uint32 ofs = (uint32)m_data.size();
+	m_data.insert(m_data.end(), rhs.m_data.begin(), rhs.m_data.end());
+	for (auto i = rhs.m_ends.begin(); i != rhs.m_ends.end(); ++i) {
+		m_ends.push_back(*i + ofs);
+	}
+}
+
+GIT_NAMESPACE_END
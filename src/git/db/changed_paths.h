@@ -0,0 +1,216 @@
+#ifndef GIT_CHANGED_PATHS_H
+#define GIT_CHANGED_PATHS_H
+
+#include <git/config.h>
+#include <git/db/commit_table.h>
+#include <git/db/tree_diff.h>
+#include <gtl/thread_pool.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+GIT_HEADER_BEGIN
+GIT_NAMESPACE_BEGIN
+
+/** \brief Hashes of a path, which determine the bits it sets in a changed path BloomFilter.
+  *
+  * Like git, the path is hashed using version 1 of git's murmur3 variant with two seeds, and all hashes are
+  * derived from these two by double hashing.
+  */
+struct BloomKey
+{
+	static const uint32 num_hashes = 7;
+
+	uint32		hashes[num_hashes];
+
+	//! Compute the hashes of the given path, which is separated by '/' and has no trailing separator
+	BloomKey(const char* path, size_t len);
+
+	explicit BloomKey(const std::string& path);
+
+	//! \return 32 bit murmur3 hash of the given data, where bytes are sign-extended like git does it
+	static uint32 murmur3(uint32 seed, const char* data, size_t len);
+};
+
+
+/** \brief Read-only view on the Bloom filter of the paths changed by a commit.
+  *
+  * A filter never misses a path it contains, but may claim to contain a path which wasn't added. An empty
+  * filter contains no information, and is assumed to contain every path.
+  */
+class BloomFilter
+{
+public:
+	//! amount of bits per path in a filter
+	static const uint32 bits_per_entry = 10;
+
+protected:
+	const uchar*	m_data;
+	size_t			m_size;
+
+public:
+	BloomFilter(const uchar* data = nullptr, size_t size = 0)
+		: m_data(data)
+		, m_size(size)
+	{}
+
+public:
+	const uchar* data() const {
+		return m_data;
+	}
+
+	//! \return size of the filter in bytes
+	size_t size() const {
+		return m_size;
+	}
+
+	//! \return false if the path of the given key was definitely not added to the filter
+	bool maybe_contains(const BloomKey& key) const {
+		if (!m_size) {
+			return true;
+		}
+		const uint64_t num_bits = (uint64_t)m_size * 8;
+		for (uint32 i = 0; i < BloomKey::num_hashes; ++i) {
+			const uint64_t bit = key.hashes[i] % num_bits;
+			if (!(m_data[bit / 8] & (1 << (bit % 8)))) {
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+
+/** \ingroup ODB
+  * \brief Bloom filters of the paths each commit changed compared to its first parent, as stored in a CommitGraph.
+  *
+  * The paths of a commit are the ones of all changed files and submodules, as well as all of their leading
+  * directories. Root commits are compared against the empty tree. Each filter uses BloomFilter::bits_per_entry
+  * bits per path and at least one byte. If a commit changed more than max_changed_paths paths, its filter has
+  * all bits set, which makes it contain every path. Filters are computed like git computes them, hence their
+  * contents are interchangeable.
+  *
+  * All filters are stored back to back in a single buffer, indexed like the CommitTable they were computed for.
+  */
+class ChangedPathFilters
+{
+public:
+	typedef std::vector<std::string>		path_vector_type;
+	typedef std::vector<BloomKey>			key_vector_type;
+
+	//! largest amount of paths stored per filter
+	static const size_t max_changed_paths = 512;
+
+protected:
+	std::vector<uint32>		m_ends;		//!< offset past the end of each filter in m_data
+	std::vector<uchar>		m_data;
+	path_vector_type		m_paths;	//!< temporary storage for push_back()
+
+	//! Append all filters of the given instance
+	void append(const ChangedPathFilters& rhs);
+
+public:
+	//! @{ \name Interface
+
+	//! \return amount of filters
+	size_t size() const {
+		return m_ends.size();
+	}
+
+	//! \return filter at the given index
+	BloomFilter filter(size_t index) const {
+		const uint32 first = index ? m_ends[index - 1] : 0;
+		return BloomFilter(m_data.data() + first, m_ends[index] - first);
+	}
+
+	//! \return offset past the end of the filter at the given index, relative to the first filter
+	uint32 end(size_t index) const {
+		return m_ends[index];
+	}
+
+	//! \return data of all filters
+	const std::vector<uchar>& data() const {
+		return m_data;
+	}
+
+	void clear() {
+		m_ends.clear();
+		m_data.clear();
+	}
+
+	/** Add the filter of a commit which changed the given paths
+	  * \param changes paths of all changed files and submodules, without their leading directories, which
+	  * are added automatically
+	  */
+	void push_back(const path_vector_type& changes);
+
+	//! @}
+
+	//! Replace out with the keys of the given path and all of its leading directories. A commit changed the
+	//! path only if its filter contains all of them
+	static void keys(const std::string& path, key_vector_type& out);
+
+	/** Compute the filters of all commits of the given table, replacing our previous contents
+	  * \param db database to read the trees of all commits from, which must support concurrent reads if
+	  * multiple threads are used
+	  * \param table finalized table, whose first parents are contained in it
+	  * \param num_threads amount of threads to diff the commits with
+	  * \throw ObjectError if a tree is no tree, gtl::odb_error if it doesn't exist
+	  */
+	template <class ObjectDatabase>
+	void compute(const ObjectDatabase& db, const CommitTable& table,
+	             size_t num_threads = gtl::thread_pool::default_concurrency()) {
+		typedef typename TreeDiff<ObjectDatabase>::change_vector_type change_vector_type;
+		static const size_t batch_size = 256;
+
+		clear();
+		const size_t num_batches = (table.size() + batch_size - 1) / batch_size;
+		std::vector<ChangedPathFilters> batches(num_batches);
+		std::unique_ptr<gtl::thread_pool> pool;
+		if (num_threads > 1 && num_batches > 1) {
+			pool.reset(new gtl::thread_pool(num_threads));
+		}
+
+		for (size_t b = 0; b < num_batches; ++b) {
+			auto task = [&db, &table, &batches, b]() {
+				TreeDiff<ObjectDatabase> diff(db, 1);
+				change_vector_type changes;
+				path_vector_type paths;
+				ChangedPathFilters& out = batches[b];
+				const CommitTable::index_type last = (CommitTable::index_type)std::min((b + 1) * batch_size, table.size());
+				for (CommitTable::index_type c = (CommitTable::index_type)(b * batch_size); c < last; ++c) {
+					const CommitTable::parent_range parents = table.parents(c);
+					const CommitTable::index_type parent = parents.size() ? parents.begin()[0] : CommitTable::npos;
+					diff.diff(parent == CommitTable::npos ? CommitTable::key_type::null : table.tree_key(parent),
+					          table.tree_key(c), changes);
+
+					paths.clear();
+					for (auto i = changes.begin(); i != changes.end() && paths.size() <= max_changed_paths; ++i) {
+						paths.push_back(i->path);
+					}
+					out.push_back(paths);
+				}
+			};
+			if (pool) {
+				pool->submit(task);
+			} else {
+				task();
+			}
+		}// for each batch
+		if (pool) {
+			pool->wait();
+		}
+
+		for (auto i = batches.begin(); i != batches.end(); ++i) {
+			append(*i);
+		}
+	}
+};
+
+GIT_NAMESPACE_END
+GIT_HEADER_END
+
+#endif // GIT_CHANGED_PATHS_H
@@ -0,0 +1,233 @@
+#ifndef GIT_COMMIT_CACHE_H
+#define GIT_COMMIT_CACHE_H
+
+#include <git/config.h>
+#include <git/db/key_index.h>
+#include <git/db/commit_graph.h>
+#include <git/obj/commit_header.h>
+
+#include <memory>
+#include <vector>
+
+GIT_HEADER_BEGIN
+GIT_NAMESPACE_BEGIN
+
+/** \brief Keeps the tree, time, generation and parents of commits once they were obtained from a database or commit graph.
+  *
+  * Each commit gets a dense id when it is first encountered, either as a parent or when it is looked up
+  * explicitly. Its data is only obtained once it is parsed, which reads it from the commit graph if it 
+  * contains the commit, or decodes its header from the database otherwise. All data is kept in vectors indexed
+  * by id, hence algorithms can store their own per-commit state in vectors of their own.
+  * \tparam ObjectDatabase any database providing accessors to objects by key
+  */
+template <class ObjectDatabase>
+class CommitCache
+{
+public:
+	typedef ObjectDatabase								db_type;
+	typedef git_object_traits_base::key_type			key_type;
+	typedef git_object_traits_base::char_type			char_type;
+	typedef KeyIndex::id_type							id_type;
+	
+	//! generation of commits which are not in a commit graph
+	static const uint32 infinite_generation = ~(uint32)0;
+	
+protected:
+	struct Node
+	{
+		key_type					tree;
+		time_t						time;
+		uint32						parents;		//!< offset of our first parent id in m_parents
+		uint32						num_parents;
+		uint32						generation;		//!< generation number, or infinite_generation if it is unknown
+		CommitGraph::position_type	graph_pos;		//!< position in the commit graph, or CommitGraph::npos
+		bool						parsed;
+		
+		Node()
+			: tree(key_type::null)
+			, time(0)
+			, parents(0)
+			, num_parents(0)
+			, generation(infinite_generation)
+			, graph_pos(CommitGraph::npos)
+			, parsed(false)
+		{}
+	};
+	
+	const db_type&							m_db;
+	const CommitGraph*						m_graph;		//!< graph to obtain commits from, or 0
+	KeyIndex								m_ids;
+	std::vector<Node>						m_nodes;		//!< nodes indexed by id
+	std::vector<id_type>					m_parents;		//!< parent ids of all parsed nodes
+	size_t									m_num_decoded;
+	
+	std::vector<CommitGraph::position_type>	m_graph_parents;
+	CommitHeader							m_header;
+	std::vector<char_type>					m_buf;
+	
+public:
+	//! Initialize the cache to read commits from the given database, which must remain valid while we exist
+	explicit CommitCache(const db_type& db)
+		: m_db(db)
+		, m_graph(nullptr)
+		, m_num_decoded(0)
+	{}
+	
+public:
+	//! Obtain commits from the given graph if they are contained in it. The graph must remain valid while we
+	//! use it, or 0 to read all commits from the database
+	void set_commit_graph(const CommitGraph* graph) {
+		m_graph = graph;
+	}
+	
+	const CommitGraph* commit_graph() const {
+		return m_graph;
+	}
+	
+	const db_type& db() const {
+		return m_db;
+	}
+	
+	//! \return id of the given key, which is assigned if the key is new
+	id_type id(const key_type& key) {
+		bool inserted;
+		const id_type id = m_ids.insert(key, inserted);
+		if (inserted) {
+			m_nodes.push_back(Node());
+		}
+		return id;
+	}
+	
+	//! \return id of the given key, or KeyIndex::npos if it was never encountered
+	id_type find(const key_type& key) const {
+		return m_ids.find(key);
+	}
+	
+	const key_type& key(id_type id) const {
+		return m_ids.key(id);
+	}
+	
+	//! \return amount of commits encountered, all ids are smaller than this value
+	size_t size() const {
+		return m_nodes.size();
+	}
+	
+	/** Obtain tree, time, generation and parents of the given commit from our commit graph, or decode its header from our 
+	  * database. Does nothing if the commit was parsed already.
+	  * \throw ObjectError if the object is no commit, gtl::odb_error if it doesn't exist
+	  */
+	void parse(id_type id) {
+		if (m_nodes[id].parsed) {
+			return;
+		}
+		
+		const key_type key(m_ids.key(id));
+		const CommitGraph::position_type pos = m_graph ? m_graph->lookup(key) : CommitGraph::npos;
+		if (pos != CommitGraph::npos) {
+			m_graph->parents(pos, m_graph_parents);
+			const uint32 first_parent = (uint32)m_parents.size();
+			for (auto p = m_graph_parents.begin(); p != m_graph_parents.end(); ++p) {
+				m_parents.push_back(this->id(m_graph->key(*p)));
+			}
+			Node& node = m_nodes[id];
+			node.tree = m_graph->tree_key(pos);
+			node.time = m_graph->time(pos);
+			node.parents = first_parent;
+			node.num_parents = (uint32)m_graph_parents.size();
+			node.generation = m_graph->generation(pos);
+			node.graph_pos = pos;
+			node.parsed = true;
+			return;
+		}
+		
+		auto acc = m_db.object(key);
+		if (acc->type() != Object::Type::Commit) {
+			ObjectError err;
+			err.stream() << "object " << key << " is no commit";
+			throw err;
+		}
+		const size_t size = (size_t)acc->size();
+		m_buf.resize(size);
+		{
+			std::unique_ptr<typename db_type::output_object_type::stream_type> stream(acc->new_stream());
+			stream->read(m_buf.data(), size);
+			if ((size_t)stream->gcount() != size) {
+				DeserializationError err;
+				err.stream() << "commit " << key << " ended after " << stream->gcount() << " of " << size << " bytes";
+				throw err;
+			}
+		}
+		m_header.parse(m_buf.data(), size);
+		
+		const uint32 first_parent = (uint32)m_parents.size();
+		for (auto p = m_header.parent_keys.begin(); p != m_header.parent_keys.end(); ++p) {
+			m_parents.push_back(this->id(*p));
+		}
+		Node& node = m_nodes[id];
+		node.tree = m_header.tree_key;
+		node.time = m_header.time;
+		node.parents = first_parent;
+		node.num_parents = (uint32)m_header.parent_keys.size();
+		node.parsed = true;
+		++m_num_decoded;
+	}
+	
+	//! @{ \name Commit Data
+	//! \note only valid once the commit was parsed
+	
+	bool is_parsed(id_type id) const {
+		return m_nodes[id].parsed;
+	}
+	
+	const key_type& tree_key(id_type id) const {
+		return m_nodes[id].tree;
+	}
+	
+	//! \return committer time in seconds since epoch
+	time_t time(id_type id) const {
+		return m_nodes[id].time;
+	}
+	
+	//! \return generation number, or infinite_generation if the commit is not in our commit graph
+	uint32 generation(id_type id) const {
+		return m_nodes[id].generation;
+	}
+	
+	//! \return position of the commit in our commit graph, or CommitGraph::npos if it was read from the database
+	CommitGraph::position_type graph_position(id_type id) const {
+		return m_nodes[id].graph_pos;
+	}
+	
+	uint32 num_parents(id_type id) const {
+		return m_nodes[id].num_parents;
+	}
+	
+	//! \return pointer to the ids of the parents of the given commit, which is valid until the next commit is parsed
+	const id_type* parents(id_type id) const {
+		return m_parents.data() + m_nodes[id].parents;
+	}
+	
+	//! @}
+	
+	//! \return amount of commits decoded from the database, which doesn't include commits obtained from the 
+	//! commit graph
+	size_t num_decoded() const {
+		return m_num_decoded;
+	}
+	
+	//! Forget all commits, keeping the allocated memory
+	void clear() {
+		m_ids.clear();
+		m_nodes.clear();
+		m_parents.clear();
+		m_num_decoded = 0;
+	}
+};
+
+template <class ObjectDatabase>
+const uint32 CommitCache<ObjectDatabase>::infinite_generation;
+
+GIT_NAMESPACE_END
+GIT_HEADER_END
+
+#endif // GIT_COMMIT_CACHE_H
@@ -0,0 +1,353 @@
+#include <git/db/commit_graph.h>
+#include <git/config.h>		// for doxygen
+#include <git/db/sha1_gen.h>
+#include <gtl/db/pack_file.hpp>
+
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+GIT_NAMESPACE_BEGIN
+
+const CommitGraph::position_type CommitGraph::npos;
+const uint32 CommitGraph::max_generation;
+
+namespace
+{
+	const uint32 parent_none = 0x70000000;		//!< parent slot is unused
+	const uint32 parent_edges = 0x80000000;		//!< parent slot refers to the edge list, or ends it
+	const uint32 bloom_version = 1;				//!< version of the hash function of changed path filters
+	const size_t bloom_header_len = 12;			//!< version, amount of hashes and bits per entry
+	
+	//! \return integer representation of the given 4 character chunk id
+	inline uint32 chunk_id(const char* id)
+	{
+		return gtl::ntoh32(reinterpret_cast<const uchar*>(id));
+	}
+	
+	//! Write data to the stream and update the hash
+	void write_hashed(std::ofstream& out, SHA1Generator& gen, const void* data, size_t len)
+	{
+		out.write(reinterpret_cast<const char*>(data), len);
+		gen.update(reinterpret_cast<const char*>(data), len);
+	}
+}
+
+CommitGraph::CommitGraph(const path_type& path)
+	: m_path(path)
+	, m_fanout(nullptr)
+	, m_keys(nullptr)
+	, m_data(nullptr)
+	, m_edges(nullptr)
+	, m_num_edges(0)
+	, m_num_commits(0)
+	, m_bloom_index(nullptr)
+	, m_bloom_data(nullptr)
+	, m_bloom_data_size(0)
+{
+	if (!boost::filesystem::is_regular_file(path)) {
+		throw_corrupt("file does not exist");
+	}
+	m_file.open(path.string());
+	
+	const uchar* d = reinterpret_cast<const uchar*>(m_file.data());
+	const size_t size = m_file.size();
+	if (size < 8 + 12 + key_type::hash_len || std::memcmp(d, "CGPH", 4) != 0) {
+		throw_corrupt("invalid signature");
+	}
+	if (d[4] != version || d[5] != hash_version || d[7] != 0) {
+		throw_corrupt("unsupported version");
+	}
+	const uint32 num_chunks = d[6];
+	if (8 + (num_chunks+1) * 12 > size) {
+		throw_corrupt("truncated chunk table");
+	}
+	
+	uint64_t data_size = 0;
+	uint64_t keys_size = 0;
+	uint64_t bloom_index_size = 0;
+	for (uint32 i = 0; i < num_chunks; ++i) {
+		const uchar* c = d + 8 + i*12;
+		const uint64_t ofs = gtl::ntoh64(c+4);
+		const uint64_t next_ofs = gtl::ntoh64(c+16);
+		if (ofs > next_ofs || next_ofs > size - key_type::hash_len) {
+			throw_corrupt("chunk out of bounds");
+		}
+		const uint32 id = gtl::ntoh32(c);
+		if (id == chunk_id("OIDF")) {
+			if (next_ofs - ofs != 256*4) {
+				throw_corrupt("invalid fanout size");
+			}
+			m_fanout = d + ofs;
+		} else if (id == chunk_id("OIDL")) {
+			m_keys = d + ofs;
+			keys_size = next_ofs - ofs;
+		} else if (id == chunk_id("CDAT")) {
+			m_data = d + ofs;
+			data_size = next_ofs - ofs;
+		} else if (id == chunk_id("EDGE")) {
+			m_edges = d + ofs;
+			m_num_edges = (next_ofs - ofs) / 4;
+		} else if (id == chunk_id("BIDX")) {
+			m_bloom_index = d + ofs;
+			bloom_index_size = next_ofs - ofs;
+		} else if (id == chunk_id("BDAT")) {
+			m_bloom_data = d + ofs;
+			m_bloom_data_size = next_ofs - ofs;
+		}
+	}// for each chunk
+	
+	if (!m_fanout || !m_keys || !m_data) {
+		throw_corrupt("missing required chunk");
+	}
+	if (!gtl::fanout_is_valid(m_fanout)) {
+		throw_corrupt("fanout table is not sorted");
+	}
+	m_num_commits = gtl::ntoh32(m_fanout + 255*4);
+	if (keys_size != (uint64_t)m_num_commits * key_type::hash_len) {
+		throw_corrupt("commit ids don't match the amount of commits");
+	}
+	if (data_size != (uint64_t)m_num_commits * (key_type::hash_len + 16)) {
+		throw_corrupt("commit data doesn't match the amount of commits");
+	}
+	
+	// filters computed differently than ours would yield wrong answers, hence we ignore them
+	if (m_bloom_index && m_bloom_data) {
+		if (bloom_index_size != (uint64_t)m_num_commits * 4 || m_bloom_data_size < bloom_header_len) {
+			throw_corrupt("invalid changed path filter chunks");
+		}
+		if (gtl::ntoh32(m_bloom_data) != bloom_version || gtl::ntoh32(m_bloom_data + 4) != BloomKey::num_hashes ||
+		    gtl::ntoh32(m_bloom_data + 8) != BloomFilter::bits_per_entry) {
+			m_bloom_index = nullptr;
+		}
+		m_bloom_data += bloom_header_len;
+		m_bloom_data_size -= bloom_header_len;
+	} else {
+		m_bloom_index = nullptr;
+	}
+}
+
+void CommitGraph::throw_corrupt(const char* msg) const
+{
+	CommitGraphError err;
+	err.stream() << "commit graph at " << m_path << ": " << msg;
+	throw err;
+}
+
+CommitGraph::position_type CommitGraph::lookup(const key_type& key) const
+{
+	const uint32 pos = gtl::fanout_lookup(m_fanout, m_keys, key_type::hash_len, reinterpret_cast<const uchar*>(key.bytes()));
+	return pos == m_num_commits ? npos : pos;
+}
+
+void CommitGraph::parents(position_type pos, std::vector<position_type>& out) const
+{
+	out.clear();
+	const uchar* r = record(pos) + key_type::hash_len;
+	const uint32 first = gtl::ntoh32(r);
+	if (first == parent_none) {
+		return;
+	}
+	out.push_back(checked_parent(first));
+	
+	const uint32 second = gtl::ntoh32(r + 4);
+	if (second == parent_none) {
+		return;
+	}
+	if (!(second & parent_edges)) {
+		out.push_back(checked_parent(second));
+		return;
+	}
+	
+	// octopus merge, the last edge has the high bit set
+	for (size_t e = second & ~parent_edges; ; ++e) {
+		if (e >= m_num_edges) {
+			throw_corrupt("edge list out of bounds");
+		}
+		const uint32 edge = gtl::ntoh32(m_edges + e*4);
+		out.push_back(checked_parent(edge & ~parent_edges));
+		if (edge & parent_edges) {
+			break;
+		}
+	}
+}
+
+BloomFilter CommitGraph::bloom_filter(position_type pos) const
+{
+	if (!m_bloom_index) {
+		return BloomFilter();
+	}
+	const uint32 first = pos ? gtl::ntoh32(m_bloom_index + ((size_t)pos - 1) * 4) : 0;
+	const uint32 last = gtl::ntoh32(m_bloom_index + (size_t)pos * 4);
+	if (first > last || last > m_bloom_data_size) {
+		throw_corrupt("changed path filter out of bounds");
+	}
+	return BloomFilter(m_bloom_data + first, last - first);
+}
+
+void CommitGraph::generations(const CommitTable& table, std::vector<uint32>& out)
+{
+	typedef CommitTable::index_type index_type;
+	out.assign(table.size(), 0);
+	
+	// iterative depth first search, a commit is done once all of its parents are
+	std::vector<index_type> stack;
+	for (index_type c = 0; c < table.size(); ++c) {
+		if (out[c]) {
+			continue;
+		}
+		stack.push_back(c);
+		while (!stack.empty()) {
+			const index_type cur = stack.back();
+			if (out[cur]) {
+				stack.pop_back();
+				continue;
+			}
+			
+			uint32 max_parent = 0;
+			bool parents_done = true;
+			const CommitTable::parent_range parents = table.parents(cur);
+			for (auto p = parents.begin(); p != parents.end(); ++p) {
+				if (*p == CommitTable::npos) {
+					continue;
+				}
+				if (!out[*p]) {
+					parents_done = false;
+					stack.push_back(*p);
+				} else {
+					max_parent = std::max(max_parent, out[*p]);
+				}
+			}
+			if (parents_done) {
+				out[cur] = std::min(max_parent + 1, max_generation);
+				stack.pop_back();
+			}
+		}// while there are commits to handle
+	}// for each commit
+}
+
+void CommitGraph::write(const path_type& path, const CommitTable& table, const ChangedPathFilters* filters)
+{
+	const size_t hl = key_type::hash_len;
+	const uint32 num_commits = (uint32)table.size();
+	if (table.size() >= parent_none) {
+		CommitGraphError err;
+		err.stream() << "cannot write commit graph with " << table.size() << " commits";
+		throw err;
+	}
+	if (filters && filters->size() != table.size()) {
+		CommitGraphError err;
+		err.stream() << "cannot write commit graph at " << path << " with " << filters->size() 
+		             << " changed path filters for " << table.size() << " commits";
+		throw err;
+	}
+	
+	std::vector<uint32> gens;
+	generations(table, gens);
+	
+	uchar fanout[256*4];
+	{
+		uint32 count = 0;
+		for (uint32 b = 0; b < 256; ++b) {
+			for (; count < num_commits && (uchar)table.key(count).bytes()[0] == b; ++count);
+			gtl::hton32(count, fanout + b*4);
+		}
+	}
+	
+	std::vector<uchar> cdat((size_t)num_commits * (hl + 16));
+	std::vector<uchar> edge;
+	for (uint32 c = 0; c < num_commits; ++c) {
+		uchar* r = &cdat[(size_t)c * (hl + 16)];
+		std::memcpy(r, table.tree_key(c).bytes(), hl);
+		
+		const CommitTable::parent_range parents = table.parents(c);
+		for (auto p = parents.begin(); p != parents.end(); ++p) {
+			if (*p == CommitTable::npos) {
+				CommitGraphError err;
+				err.stream() << "cannot write commit graph at " << path << " as a parent of commit " << table.key(c) 
+				             << " is missing";
+				throw err;
+			}
+		}
+		gtl::hton32(parents.size() > 0 ? parents.begin()[0] : parent_none, r + hl);
+		if (parents.size() > 2) {
+			gtl::hton32(parent_edges | (uint32)(edge.size() / 4), r + hl + 4);
+			for (auto p = parents.begin() + 1; p != parents.end(); ++p) {
+				edge.resize(edge.size() + 4);
+				gtl::hton32(*p | (p + 1 == parents.end() ? parent_edges : 0), &edge[edge.size() - 4]);
+			}
+		} else {
+			gtl::hton32(parents.size() > 1 ? parents.begin()[1] : parent_none, r + hl + 4);
+		}
+		
+		const uint64_t time = table.time(c) < 0 ? 0 : (uint64_t)table.time(c);
+		gtl::hton32((gens[c] << 2) | (uint32)((time >> 32) & 3), r + hl + 8);
+		gtl::hton32((uint32)time, r + hl + 12);
+	}// for each commit
+	
+	std::vector<uchar> bidx, bdat_header;
+	if (filters) {
+		bidx.resize((size_t)num_commits * 4);
+		for (uint32 c = 0; c < num_commits; ++c) {
+			gtl::hton32(filters->end(c), &bidx[(size_t)c * 4]);
+		}
+		bdat_header.resize(bloom_header_len);
+		gtl::hton32(bloom_version, &bdat_header[0]);
+		gtl::hton32(BloomKey::num_hashes, &bdat_header[4]);
+		gtl::hton32(BloomFilter::bits_per_entry, &bdat_header[8]);
+	}
+	
+	// id and size of each chunk, in the order they are written
+	std::vector<std::pair<const char*, uint64_t> > ids;
+	ids.push_back(std::make_pair("OIDF", (uint64_t)sizeof(fanout)));
+	ids.push_back(std::make_pair("OIDL", (uint64_t)num_commits * hl));
+	ids.push_back(std::make_pair("CDAT", (uint64_t)cdat.size()));
+	if (!edge.empty()) {
+		ids.push_back(std::make_pair("EDGE", (uint64_t)edge.size()));
+	}
+	if (filters) {
+		ids.push_back(std::make_pair("BIDX", (uint64_t)bidx.size()));
+		ids.push_back(std::make_pair("BDAT", (uint64_t)(bdat_header.size() + filters->data().size())));
+	}
+	const uchar num_chunks = (uchar)ids.size();
+	
+	uchar header[8] = {'C', 'G', 'P', 'H', version, hash_version, num_chunks, 0};
+	std::vector<uchar> chunks((num_chunks + 1) * 12);
+	uint64_t ofs = sizeof(header) + chunks.size();
+	for (uint32 c = 0; c <= num_chunks; ++c) {
+		if (c < num_chunks) {
+			std::memcpy(&chunks[c*12], ids[c].first, 4);
+		}
+		gtl::hton64(ofs, &chunks[c*12+4]);
+		if (c < num_chunks) {
+			ofs += ids[c].second;
+		}
+	}
+	
+	std::ofstream out;
+	out.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+	out.open(path.string().c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+	SHA1Generator gen;
+	write_hashed(out, gen, header, sizeof(header));
+	write_hashed(out, gen, chunks.data(), chunks.size());
+	write_hashed(out, gen, fanout, sizeof(fanout));
+	for (uint32 c = 0; c < num_commits; ++c) {
+		write_hashed(out, gen, table.key(c).bytes(), hl);
+	}
+	write_hashed(out, gen, cdat.data(), cdat.size());
+	if (!edge.empty()) {
+		write_hashed(out, gen, edge.data(), edge.size());
+	}
+	if (filters) {
+		write_hashed(out, gen, bidx.data(), bidx.size());
+		write_hashed(out, gen, bdat_header.data(), bdat_header.size());
+		write_hashed(out, gen, filters->data().data(), filters->data().size());
+	}
+	const key_type checksum(gen.hash());
+	out.write(checksum.bytes(), hl);
+	out.close();
+}
+
+GIT_NAMESPACE_END
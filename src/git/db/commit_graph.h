@@ -0,0 +1,165 @@
+#ifndef GIT_COMMIT_GRAPH_H
+#define GIT_COMMIT_GRAPH_H
+
+#include <git/config.h>
+#include <git/db/traits.hpp>
+#include <git/db/commit_table.h>
+#include <git/db/changed_paths.h>
+#include <gtl/db/odb.hpp>
+#include <gtl/util.hpp>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/filesystem/path.hpp>
+
+#include <vector>
+
+GIT_HEADER_BEGIN
+GIT_NAMESPACE_BEGIN
+
+/** \brief thrown if a commit graph file cannot be read or written
+  * \ingroup ODBException
+  */
+class CommitGraphError :	public gtl::odb_error,
+							public gtl::streaming_exception
+{
+public:
+	virtual const char* what() const throw() {
+		return streaming_exception::what();
+	}
+};
+
+
+/** \ingroup ODB
+  * \brief read-only access to a commit graph file, which stores the metadata of commits required to traverse history.
+  *
+  * Commits are stored sorted by key, and are identified by their position. For each commit, the file contains 
+  * its tree key, the positions of its parents, its committer time and its generation number. The generation
+  * number of a root commit is 1, and the one of any other commit is one more than the largest generation of its
+  * parents. Hence a commit can only be an ancestor of commits with a larger generation, which allows walks 
+  * to stop early.
+  *
+  * Optionally, the file contains a Bloom filter of the paths each commit changed, see ChangedPathFilters.
+  * Filters are only used if they were computed with the settings we use ourselves.
+  *
+  * The file format is compatible to version 1 of git's commit-graph file, and is memory mapped. Split 
+  * commit graph chains are not supported.
+  */
+class CommitGraph
+{
+public:
+	typedef git_object_traits_base::key_type		key_type;
+	typedef boost::filesystem::path					path_type;
+	typedef uint32									position_type;
+	
+	//! position of commits which are not contained
+	static const position_type npos = ~(position_type)0;
+	//! largest generation number that can be stored, larger ones are capped
+	static const uint32 max_generation = 0x3fffffff;
+	
+	static const uchar		version = 1;
+	static const uchar		hash_version = 1;		//!< identifies SHA1 keys
+	
+protected:
+	path_type								m_path;
+	boost::iostreams::mapped_file_source	m_file;
+	const uchar*							m_fanout;
+	const uchar*							m_keys;
+	const uchar*							m_data;		//!< per commit tree key, parent positions, generation and time
+	const uchar*							m_edges;	//!< additional parents of octopus merges, may be 0
+	size_t									m_num_edges;
+	uint32									m_num_commits;
+	const uchar*							m_bloom_index;	//!< end offset of each changed path filter, may be 0
+	const uchar*							m_bloom_data;	//!< data of all changed path filters, may be 0
+	uint64_t								m_bloom_data_size;
+	
+	void throw_corrupt(const char* msg) const;
+	
+	//! \return pointer to the data record of the commit at the given position
+	const uchar* record(position_type pos) const {
+		return m_data + (size_t)pos * (key_type::hash_len + 16);
+	}
+	
+	//! \return the given parent position
+	//! \throw CommitGraphError if it doesn't refer to a commit in the graph
+	position_type checked_parent(uint32 pos) const {
+		if (pos >= m_num_commits) {
+			throw_corrupt("parent position out of bounds");
+		}
+		return pos;
+	}
+	
+public:
+	//! Open the commit graph at the given path
+	//! \throw CommitGraphError if the file doesn't exist or is corrupted
+	explicit CommitGraph(const path_type& path);
+	
+public:
+	//! @{ \name Interface
+	
+	const path_type& path() const {
+		return m_path;
+	}
+	
+	//! \return amount of commits stored
+	uint32 num_commits() const {
+		return m_num_commits;
+	}
+	
+	//! \return position of the commit with the given key, or npos if it is not contained
+	position_type lookup(const key_type& key) const;
+	
+	//! \return key of the commit at the given position
+	key_type key(position_type pos) const {
+		return key_type(reinterpret_cast<const key_type::char_type*>(m_keys + (size_t)pos * key_type::hash_len));
+	}
+	
+	key_type tree_key(position_type pos) const {
+		return key_type(reinterpret_cast<const key_type::char_type*>(record(pos)));
+	}
+	
+	//! \return committer time in seconds since epoch
+	time_t time(position_type pos) const {
+		const uchar* r = record(pos) + key_type::hash_len + 8;
+		return (time_t)(((uint64_t)(gtl::ntoh32(r) & 3) << 32) | gtl::ntoh32(r + 4));
+	}
+	
+	//! \return generation number of the commit, which is at least 1
+	uint32 generation(position_type pos) const {
+		return gtl::ntoh32(record(pos) + key_type::hash_len + 8) >> 2;
+	}
+	
+	//! Replace the contents of out with the positions of the parents of the given commit, in the order they are stored
+	//! in the commit
+	//! \throw CommitGraphError if the octopus edges or a parent position are corrupted
+	void parents(position_type pos, std::vector<position_type>& out) const;
+	
+	//! \return true if the graph contains a changed path filter for each commit
+	bool has_bloom_filters() const {
+		return m_bloom_index != nullptr;
+	}
+	
+	//! \return filter of the paths changed by the given commit, which is empty if we have no filters
+	//! \throw CommitGraphError if the filter index is corrupted
+	BloomFilter bloom_filter(position_type pos) const;
+	
+	//! @}
+	
+public:
+	/** Write a commit graph containing all commits of the given table, replacing an existing file.
+	  * \param table finalized table, which must contain the parents of all of its commits
+	  * \param filters if set, changed path filters computed for the table, which are stored as well
+	  * \throw CommitGraphError if a parent is missing, or if the filters don't match the table
+	  * \throw std::ios_base::failure if the file could not be written
+	  */
+	static void write(const path_type& path, const CommitTable& table, const ChangedPathFilters* filters = nullptr);
+	
+	/** Compute the generation numbers of all commits of the given table
+	  * \param out receives the generation of each commit, indexed like the table. Missing parents are ignored
+	  */
+	static void generations(const CommitTable& table, std::vector<uint32>& out);
+};
+
+GIT_NAMESPACE_END
+GIT_HEADER_END
+
+#endif // GIT_COMMIT_GRAPH_H
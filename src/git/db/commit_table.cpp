@@ -0,0 +1,101 @@
+#include <git/db/commit_table.h>
+#include <git/config.h>		// for doxygen
+
+#include <algorithm>
+#include <cassert>
+
+GIT_NAMESPACE_BEGIN
+
+const CommitTable::index_type CommitTable::npos;
+
+CommitTable::CommitTable()
+	: m_parent_offsets(1, 0)
+	, m_actors(new ActorTable)
+	, m_finalized(false)
+{}
+
+void CommitTable::insert(const key_type& key, const char_type* data, size_t size)
+{
+	assert(!m_finalized);
+	m_header.parse(data, size, m_actors.get());
+	
+	m_keys.push_back(key);
+	m_tree_keys.push_back(m_header.tree_key);
+	m_times.push_back(m_header.time);
+	m_authors.push_back(m_header.author);
+	m_parent_keys.insert(m_parent_keys.end(), m_header.parent_keys.begin(), m_header.parent_keys.end());
+	m_parent_offsets.push_back((uint32)m_parent_keys.size());
+}
+
+void CommitTable::finalize()
+{
+	assert(!m_finalized);
+	
+	// order of insertion indices by key, dropping duplicates
+	std::vector<index_type> order(m_keys.size());
+	for (index_type i = 0; i < order.size(); ++i) {
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), [this](index_type l, index_type r) {
+		return m_keys[l] < m_keys[r];
+	});
+	order.erase(std::unique(order.begin(), order.end(), [this](index_type l, index_type r) {
+		return m_keys[l] == m_keys[r];
+	}), order.end());
+	
+	const size_t num_commits = order.size();
+	key_vector_type keys(num_commits);
+	key_vector_type tree_keys(num_commits);
+	std::vector<time_t> times(num_commits);
+	std::vector<ActorTable::handle_type> authors(num_commits);
+	std::vector<uint32> parent_offsets(num_commits + 1);
+	size_t num_parents = 0;
+	for (size_t i = 0; i < num_commits; ++i) {
+		const index_type from = order[i];
+		keys[i] = m_keys[from];
+		tree_keys[i] = m_tree_keys[from];
+		times[i] = m_times[from];
+		authors[i] = m_authors[from];
+		parent_offsets[i] = (uint32)num_parents;
+		num_parents += m_parent_offsets[from+1] - m_parent_offsets[from];
+	}
+	parent_offsets[num_commits] = (uint32)num_parents;
+	
+	m_keys.swap(keys);
+	m_tree_keys.swap(tree_keys);
+	m_times.swap(times);
+	m_authors.swap(authors);
+	
+	// resolve parents using the sorted keys
+	std::vector<index_type> parents;
+	parents.reserve(num_parents);
+	for (size_t i = 0; i < num_commits; ++i) {
+		const index_type from = order[i];
+		for (uint32 p = m_parent_offsets[from]; p < m_parent_offsets[from+1]; ++p) {
+			parents.push_back(lookup(m_parent_keys[p]));
+		}
+	}
+	m_parents.swap(parents);
+	m_parent_offsets.swap(parent_offsets);
+	key_vector_type().swap(m_parent_keys);
+	m_finalized = true;
+}
+
+CommitTable::index_type CommitTable::lookup(const key_type& key) const
+{
+	const auto it = std::lower_bound(m_keys.begin(), m_keys.end(), key);
+	return it != m_keys.end() && *it == key ? (index_type)(it - m_keys.begin()) : npos;
+}
+
+size_t CommitTable::memory_usage() const
+{
+	return m_keys.capacity() * sizeof(key_type)
+	     + m_tree_keys.capacity() * sizeof(key_type)
+	     + m_times.capacity() * sizeof(time_t)
+	     + m_authors.capacity() * sizeof(ActorTable::handle_type)
+	     + m_parent_offsets.capacity() * sizeof(uint32)
+	     + m_parents.capacity() * sizeof(index_type)
+	     + m_parent_keys.capacity() * sizeof(key_type);
+}
+
+GIT_NAMESPACE_END
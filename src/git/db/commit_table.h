@@ -0,0 +1,170 @@
+#ifndef GIT_COMMIT_TABLE_H
+#define GIT_COMMIT_TABLE_H
+
+#include <git/config.h>
+#include <git/db/traits.hpp>
+#include <git/obj/actor_table.h>
+#include <git/obj/commit_header.h>
+
+#include <memory>
+#include <vector>
+
+GIT_HEADER_BEGIN
+GIT_NAMESPACE_BEGIN
+
+/** \ingroup ODB
+  * \brief Compact in-memory representation of the commit graph of a database.
+  *
+  * Commits are identified by their index, which is their position when sorted by key. Each property is
+  * stored in its own contiguous array indexed by commit, and parents are stored as indices into the table.
+  * This makes graph algorithms cache friendly, and needs less than 80 bytes per commit, compared to hundreds of
+  * bytes when keeping Commit instances.
+  *
+  * The table is built by inserting commits in any order, followed by a call to finalize(), which sorts them and
+  * resolves parent keys to indices. Only then the table may be queried.
+  * \note parents which were not inserted are represented by npos
+  */
+class CommitTable
+{
+public:
+	typedef git_object_traits_base::key_type		key_type;
+	typedef git_object_traits_base::char_type		char_type;
+	typedef uint32									index_type;
+	typedef std::vector<key_type>					key_vector_type;
+	
+	//! index of commits which are not contained in the table
+	static const index_type npos = ~(index_type)0;
+	
+	/** Range of parent indices of a commit
+	  */
+	struct parent_range
+	{
+		const index_type*	first;
+		const index_type*	last;
+		
+		const index_type* begin() const {
+			return first;
+		}
+		
+		const index_type* end() const {
+			return last;
+		}
+		
+		size_t size() const {
+			return last - first;
+		}
+		
+		bool empty() const {
+			return first == last;
+		}
+	};
+	
+protected:
+	key_vector_type						m_keys;				//!< commit keys, sorted once we are finalized
+	key_vector_type						m_tree_keys;
+	std::vector<time_t>					m_times;			//!< committer time in seconds since epoch
+	std::vector<ActorTable::handle_type>	m_authors;
+	std::vector<uint32>					m_parent_offsets;	//!< offset of the first parent of each commit, plus the end offset
+	std::vector<index_type>				m_parents;			//!< parent indices of all commits
+	key_vector_type						m_parent_keys;		//!< parent keys of all commits, while we are not finalized
+	std::unique_ptr<ActorTable>			m_actors;
+	CommitHeader						m_header;			//!< reused to parse inserted commits
+	bool								m_finalized;
+	
+public:
+	CommitTable();
+	
+public:
+	//! @{ \name Construction
+	
+	/** Add the given serialized commit
+	  * \throw DeserializationError if the commit header is malformed
+	  * \note must not be called once we are finalized
+	  */
+	void insert(const key_type& key, const char_type* data, size_t size);
+	
+	/** Insert all commits of the given database
+	  * \tparam ObjectDatabase any database, whose iterators provide the key, type, size and a stream of each object
+	  * \throw DeserializationError if a commit is malformed
+	  */
+	template <class ObjectDatabase>
+	void insert_all(const ObjectDatabase& db) {
+		std::vector<char_type> buf;
+		const auto end = db.end();
+		for (auto it = db.begin(); it != end; ++it) {
+			if (it->type() != Object::Type::Commit) {
+				continue;
+			}
+			const size_t size = (size_t)it->size();
+			buf.resize(size);
+			std::unique_ptr<typename ObjectDatabase::output_object_type::stream_type> stream(it->new_stream());
+			stream->read(buf.data(), size);
+			if ((size_t)stream->gcount() != size) {
+				DeserializationError err;
+				err.stream() << "commit " << it.key() << " ended after " << stream->gcount() << " of " << size << " bytes";
+				throw err;
+			}
+			insert(it.key(), buf.data(), size);
+		}// for each object
+	}
+	
+	//! Sort all commits by key and resolve parent keys to indices. Commits inserted multiple times are kept once
+	void finalize();
+	
+	//! \return true if finalize() was called
+	bool is_finalized() const {
+		return m_finalized;
+	}
+	
+	//! @}
+	
+	//! @{ \name Queries
+	//! \note only valid once we are finalized
+	
+	//! \return amount of commits
+	size_t size() const {
+		return m_keys.size();
+	}
+	
+	//! \return index of the commit with the given key, or npos if it is not contained
+	index_type lookup(const key_type& key) const;
+	
+	const key_type& key(index_type index) const {
+		return m_keys[index];
+	}
+	
+	const key_type& tree_key(index_type index) const {
+		return m_tree_keys[index];
+	}
+	
+	//! \return committer time in seconds since epoch
+	time_t time(index_type index) const {
+		return m_times[index];
+	}
+	
+	//! \return handle of the author in our actor table
+	ActorTable::handle_type author(index_type index) const {
+		return m_authors[index];
+	}
+	
+	//! \return indices of the parents of the given commit, in the order stored in the commit
+	parent_range parents(index_type index) const {
+		const parent_range r = { m_parents.data() + m_parent_offsets[index], m_parents.data() + m_parent_offsets[index+1] };
+		return r;
+	}
+	
+	//! \return table holding all actors referred to by handle
+	const ActorTable& actors() const {
+		return *m_actors;
+	}
+	
+	//! \return amount of bytes used by our arrays, without the actor table
+	size_t memory_usage() const;
+	
+	//! @}
+};
+
+GIT_NAMESPACE_END
+GIT_HEADER_END
+
+#endif // GIT_COMMIT_TABLE_H
@@ -0,0 +1,197 @@
+#ifndef GIT_CONNECTIVITY_H
+#define GIT_CONNECTIVITY_H
+
+#include <git/config.h>
+#include <git/db/odb_mem.h>
+#include <git/db/fsck.h>
+#include <git/db/key_index.h>
+#include <gtl/thread_pool.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+GIT_HEADER_BEGIN
+GIT_NAMESPACE_BEGIN
+
+/** \ingroup ODB
+  * \brief Verifies that a batch of new objects, staged in memory, is complete before it is added to a database.
+  *
+  * Starting at the new objects, all staged objects they reach are parsed, and every object they refer to must
+  * either be staged as well or exist in the target database. The traversal stops at objects which are not
+  * staged, as the target database is assumed to be complete. Hence the cost of a check depends on the amount
+  * of new objects only, not on the size of the target database.
+  *
+  * References leaving the staged objects are collected first, and looked up in the target database in a
+  * single pass once the traversal is done. Each object is looked up only once, in sorted order, and in
+  * batches on multiple threads, which pays off for databases whose lookups hit the file system.
+  *
+  * Like for object_links(), submodule commits are not followed, and blobs are not parsed.
+  * \tparam ObjectDatabase database providing has_object(), which must support concurrent calls if multiple
+  * threads are used
+  */
+template <class ObjectDatabase>
+class ConnectivityCheck
+{
+public:
+	typedef ObjectDatabase								db_type;
+	typedef git_object_traits_base::key_type			key_type;
+	typedef std::vector<key_type>						key_vector_type;
+
+	//! amount of keys looked up per task
+	static const size_t batch_size = 512;
+
+protected:
+	const MemoryODB&		m_staging;
+	const db_type&			m_target;
+	size_t					m_num_threads;
+
+	KeyIndex				m_visited;		//!< keys of all objects seen during the current check
+	key_vector_type			m_queue;		//!< staged objects to parse
+	key_vector_type			m_external;		//!< keys of objects which are not staged
+	key_vector_type			m_links;		//!< temporary storage for object_links()
+	size_t					m_num_parsed;
+
+protected:
+	//! Queue the given object for parsing if it is staged, or record it for a lookup in the target database
+	void visit(const key_type& key) {
+		bool inserted;
+		m_visited.insert(key, inserted);
+		if (!inserted) {
+			return;
+		}
+		if (m_staging.has_object(key)) {
+			m_queue.push_back(key);
+		} else {
+			m_external.push_back(key);
+		}
+	}
+
+	//! Parse all queued objects, and everything they reach within the staged objects
+	void traverse() {
+		while (!m_queue.empty()) {
+			const key_type key(m_queue.back());
+			m_queue.pop_back();
+
+			const auto acc = m_staging.object(key);
+			if (acc->type() == Object::Type::Blob) {
+				continue;
+			}
+			m_links.clear();
+			object_links(acc->type(), acc->data().data(), acc->data().size(), m_links);
+			++m_num_parsed;
+			for (auto i = m_links.begin(); i != m_links.end(); ++i) {
+				visit(*i);
+			}
+		}// while there are staged objects to parse
+	}
+
+	//! Look up all external objects in the target database, and append the missing ones to the given vector
+	void lookup(key_vector_type& missing) {
+		std::sort(m_external.begin(), m_external.end());
+		std::vector<uchar> found(m_external.size(), 0);
+		const size_t num_batches = (m_external.size() + batch_size - 1) / batch_size;
+
+		std::unique_ptr<gtl::thread_pool> pool;
+		if (m_num_threads > 1 && num_batches > 1) {
+			pool.reset(new gtl::thread_pool(std::min(m_num_threads, num_batches)));
+		}
+		for (size_t b = 0; b < num_batches; ++b) {
+			auto task = [this, &found, b]() {
+				const size_t last = std::min((b + 1) * batch_size, m_external.size());
+				for (size_t i = b * batch_size; i < last; ++i) {
+					found[i] = m_target.has_object(m_external[i]);
+				}
+			};
+			if (pool) {
+				pool->submit(task);
+			} else {
+				task();
+			}
+		}// for each batch
+		if (pool) {
+			pool->wait();
+		}
+
+		for (size_t i = 0; i < m_external.size(); ++i) {
+			if (!found[i]) {
+				missing.push_back(m_external[i]);
+			}
+		}
+	}
+
+	template <class Iterator>
+	bool check(Iterator begin, Iterator end, key_vector_type& missing) {
+		m_visited.clear();
+		m_queue.clear();
+		m_external.clear();
+		m_num_parsed = 0;
+
+		for (; begin != end; ++begin) {
+			visit(*begin);
+			traverse();
+		}
+		const size_t num_missing = missing.size();
+		lookup(missing);
+		return missing.size() == num_missing;
+	}
+
+public:
+	//! Prepare checks of objects staged in the given database against the given target database. Both must
+	//! remain valid while we exist
+	//! \param num_threads amount of threads to look up objects in the target database with
+	ConnectivityCheck(const MemoryODB& staging, const db_type& target,
+	                  size_t num_threads = gtl::thread_pool::default_concurrency())
+		: m_staging(staging)
+		, m_target(target)
+		, m_num_threads(num_threads)
+		, m_num_parsed(0)
+	{}
+
+public:
+	/** Verify that everything reachable from the given roots exists, if the staged objects were added to the
+	  * target database. Staged objects which are not reachable from the roots are not verified.
+	  * \param roots keys of the new objects, like the new tips of branches, which may be staged or exist in
+	  * the target database
+	  * \param missing vector to append the keys of all missing objects to, in sorted order. This includes
+	  * roots which don't exist
+	  * \return true if no object is missing
+	  * \throw DeserializationError if a staged object is corrupted
+	  */
+	bool check(const key_vector_type& roots, key_vector_type& missing) {
+		return check(roots.begin(), roots.end(), missing);
+	}
+
+	//! Same as above, but verifies all staged objects
+	bool check(key_vector_type& missing) {
+		struct key_iterator : public MemoryODB::forward_iterator
+		{
+			key_iterator(const MemoryODB::forward_iterator& it)
+				: MemoryODB::forward_iterator(it)
+			{}
+
+			const key_type& operator*() const {
+				return this->key();
+			}
+		};
+		return check(key_iterator(m_staging.begin()), key_iterator(m_staging.end()), missing);
+	}
+
+	//! \return amount of staged objects parsed by the last check
+	size_t num_parsed() const {
+		return m_num_parsed;
+	}
+
+	//! \return amount of objects looked up in the target database by the last check
+	size_t num_lookups() const {
+		return m_external.size();
+	}
+};
+
+template <class ObjectDatabase>
+const size_t ConnectivityCheck<ObjectDatabase>::batch_size;
+
+GIT_NAMESPACE_END
+GIT_HEADER_END
+
+#endif // GIT_CONNECTIVITY_H
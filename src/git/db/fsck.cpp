@@ -0,0 +1,60 @@
+#include <git/db/fsck.h>
+#include <git/config.h>		// for doxygen
+#include <git/obj/multiobj.h>
+#include <git/obj/commit_header.h>
+
+#include <boost/iostreams/stream.hpp>
+#include <boost/iostreams/device/array.hpp>
+
+
+GIT_NAMESPACE_BEGIN
+
+void object_links(Object::Type type, const typename git_object_traits::char_type* data, size_t size,
+				  std::vector<typename git_object_traits::key_type>& out)
+{
+	typedef typename git_object_traits::char_type char_type;
+	boost::iostreams::stream<boost::iostreams::basic_array_source<char_type> > stream(data, size);
+	
+	switch(type)
+	{
+	case Object::Type::Blob:
+	{
+		break;
+	}
+	case Object::Type::Tree:
+	{
+		const TreeView view(data, size);
+		const auto end = view.end();
+		for (auto it = view.begin(); it != end; ++it) {
+			if (!it->is_commit()) {
+				out.push_back(it->key());
+			}
+		}
+		break;
+	}
+	case Object::Type::Commit:
+	{
+		CommitHeader header;
+		header.parse(data, size);
+		out.push_back(header.tree_key);
+		out.insert(out.end(), header.parent_keys.begin(), header.parent_keys.end());
+		break;
+	}
+	case Object::Type::Tag:
+	{
+		Tag tag;
+		stream >> tag;
+		out.push_back(tag.object_key());
+		break;
+	}
+	default:
+	{
+		DeserializationError err;
+		err.stream() << "cannot obtain links of object type " << type << std::flush;
+		throw err;
+	}
+	}// end type switch
+}
+
+
+GIT_NAMESPACE_END
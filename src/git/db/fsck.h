@@ -0,0 +1,67 @@
+#ifndef GIT_FSCK_H
+#define GIT_FSCK_H
+
+#include <git/config.h>
+#include <git/db/util.hpp>
+#include <git/db/odb_loose.h>
+#include <git/db/odb_pack.h>
+#include <gtl/db/odb_fsck.hpp>
+
+#include <vector>
+
+GIT_HEADER_BEGIN
+GIT_NAMESPACE_BEGIN
+
+//! Obtain the keys of all objects the given object refers to. These are the elements of trees, except for 
+//! submodule commits, the tree and parents of commits, and the object of tags.
+//! \param type type of the object
+//! \param data serialized object data
+//! \param size amount of bytes of data
+//! \param out vector to append keys to
+//! \throw DeserializationError if the data cannot be parsed
+void object_links(Object::Type type, const typename git_object_traits::char_type* data, size_t size,
+				  std::vector<typename git_object_traits::key_type>& out);
+
+
+/** \brief provides verification of git objects
+  * \ingroup ODBPolicy
+  */
+struct git_fsck_policy : public gtl::odb_fsck_policy
+{
+	template <class HashGeneratorType, class ObjectType, class SizeType>
+	void header_hash(HashGeneratorType& gen, const ObjectType type, const SizeType size)
+	{
+		typename git_object_policy_traits::char_type hdr[32];
+		ushort hdrlen = loose_object_header(hdr, type, size);
+		gen.update(hdr, hdrlen);
+	}
+	
+	template <class ObjectType, class CharType, class Functor>
+	void links(const ObjectType type, const CharType* data, size_t size, Functor f)
+	{
+		if (type == Object::Type::Blob) {
+			return;
+		}
+		std::vector<typename git_object_traits::key_type> keys;
+		object_links(type, data, size, keys);
+		for (auto i = keys.begin(); i != keys.end(); ++i) {
+			f(*i);
+		}
+	}
+};
+
+/** \ingroup ODB
+  * \brief verifies all objects of a loose object database
+  */
+typedef gtl::odb_fsck<LooseODB, git_fsck_policy> LooseFsck;
+
+/** \ingroup ODB
+  * \brief verifies all objects of a pack database
+  */
+typedef gtl::odb_fsck<PackODB, git_fsck_policy> PackFsck;
+
+
+GIT_NAMESPACE_END
+GIT_HEADER_END
+
+#endif // GIT_FSCK_H
@@ -0,0 +1,78 @@
+#include <git/db/key_index.h>
+#include <git/config.h>		// for doxygen
+
+#include <algorithm>
+#include <cstring>
+
+GIT_NAMESPACE_BEGIN
+
+const KeyIndex::id_type KeyIndex::npos;
+
+namespace
+{
+	inline size_t hash(const KeyIndex::key_type& key)
+	{
+		uint32 h;
+		std::memcpy(&h, key.bytes(), sizeof(h));
+		return h;
+	}
+}
+
+KeyIndex::KeyIndex()
+	: m_slots(16, npos)
+{}
+
+size_t KeyIndex::slot_of(const key_type& key) const
+{
+	const size_t mask = m_slots.size() - 1;
+	size_t slot = hash(key) & mask;
+	for (; m_slots[slot] != npos && m_keys[m_slots[slot]] != key; slot = (slot + 1) & mask);
+	return slot;
+}
+
+void KeyIndex::grow()
+{
+	m_slots.assign(m_slots.size() * 2, npos);
+	const size_t mask = m_slots.size() - 1;
+	for (id_type id = 0; id < m_keys.size(); ++id) {
+		size_t slot = hash(m_keys[id]) & mask;
+		for (; m_slots[slot] != npos; slot = (slot + 1) & mask);
+		m_slots[slot] = id;
+	}
+}
+
+KeyIndex::id_type KeyIndex::insert(const key_type& key, bool& inserted)
+{
+	const size_t slot = slot_of(key);
+	if (m_slots[slot] != npos) {
+		inserted = false;
+		return m_slots[slot];
+	}
+	
+	inserted = true;
+	const id_type id = (id_type)m_keys.size();
+	m_keys.push_back(key);
+	m_slots[slot] = id;
+	
+	// keep the load factor below one half
+	if (m_keys.size() * 2 > m_slots.size()) {
+		grow();
+	}
+	return id;
+}
+
+void KeyIndex::clear()
+{
+	m_keys.clear();
+	std::fill(m_slots.begin(), m_slots.end(), npos);
+}
+
+void KeyIndex::reserve(size_t num_keys)
+{
+	m_keys.reserve(num_keys);
+	while (num_keys * 2 > m_slots.size()) {
+		grow();
+	}
+}
+
+GIT_NAMESPACE_END
@@ -0,0 +1,82 @@
+#ifndef GIT_KEY_INDEX_H
+#define GIT_KEY_INDEX_H
+
+#include <git/config.h>
+#include <git/db/traits.hpp>
+
+#include <vector>
+
+GIT_HEADER_BEGIN
+GIT_NAMESPACE_BEGIN
+
+/** \brief Compact hash set of keys, which assigns a dense id to each key in the order of insertion.
+  *
+  * Ids can be used to index vectors holding per-key data like flags, which is much more compact than using 
+  * a std::map or std::set of keys. Keys are hashes already, hence the first bytes of a key are used as its hash.
+  * \note keys cannot be removed, use clear() to start over
+  */
+class KeyIndex
+{
+public:
+	typedef git_object_traits_base::key_type		key_type;
+	typedef uint32									id_type;
+	
+	//! id returned for keys which are not contained
+	static const id_type npos = ~(id_type)0;
+	
+protected:
+	std::vector<key_type>	m_keys;		//!< keys indexed by id
+	std::vector<id_type>	m_slots;	//!< open addressing table of ids, its size is a power of two
+	
+	//! \return slot of the given key, which is either empty or holds the key's id
+	size_t slot_of(const key_type& key) const;
+	
+	void grow();
+	
+public:
+	KeyIndex();
+	
+public:
+	/** Insert the given key if it doesn't exist yet
+	  * \param inserted set to true if the key was inserted, or to false if it existed already
+	  * \return id of the key
+	  */
+	id_type insert(const key_type& key, bool& inserted);
+	
+	//! Same as above, but doesn't tell whether the key was inserted
+	id_type insert(const key_type& key) {
+		bool inserted;
+		return insert(key, inserted);
+	}
+	
+	//! \return id of the given key, or npos if it doesn't exist
+	id_type find(const key_type& key) const {
+		return m_slots[slot_of(key)];
+	}
+	
+	//! \return true if the given key is contained
+	bool contains(const key_type& key) const {
+		return find(key) != npos;
+	}
+	
+	//! \return key with the given id
+	const key_type& key(id_type id) const {
+		return m_keys[id];
+	}
+	
+	//! \return amount of keys, all ids are smaller than this value
+	size_t size() const {
+		return m_keys.size();
+	}
+	
+	//! Remove all keys, keeping the allocated memory
+	void clear();
+	
+	//! Prepare the insertion of the given amount of keys
+	void reserve(size_t num_keys);
+};
+
+GIT_NAMESPACE_END
+GIT_HEADER_END
+
+#endif // GIT_KEY_INDEX_H
@@ -0,0 +1,237 @@
+#include <git/db/loose_gc.h>
+#include <git/config.h>		// for doxygen
+#include <git/db/fsck.h>
+#include <git/obj/commit_header.h>
+#include <git/obj/tree_view.h>
+
+#include <boost/filesystem.hpp>
+#include <algorithm>
+
+GIT_NAMESPACE_BEGIN
+
+const time_t LooseGC::default_grace_period;
+const size_t LooseGC::num_shards;
+
+namespace
+{
+	//! Read the given object into the given buffer
+	//! \return type of the object
+	//! \throw DeserializationError if it cannot be read completely
+	template <class ObjectDatabase>
+	Object::Type load(const ObjectDatabase& db, const LooseGC::key_type& key, std::vector<LooseGC::char_type>& buf)
+	{
+		auto acc = db.object(key);
+		const Object::Type type = acc->type();
+		const size_t size = (size_t)acc->size();
+		buf.resize(size);
+		std::unique_ptr<typename ObjectDatabase::output_object_type::stream_type> stream(acc->new_stream());
+		stream->read(buf.data(), size);
+		if ((size_t)stream->gcount() != size) {
+			DeserializationError err;
+			err.stream() << "object " << key << " ended after " << stream->gcount() << " of " << size << " bytes";
+			throw err;
+		}
+		return type;
+	}
+}
+
+LooseGC::LooseGC(LooseODB& db, size_t num_threads)
+	: m_db(db)
+	, m_alternate(nullptr)
+	, m_num_threads(num_threads)
+	, m_expiry(std::time(nullptr) - default_grace_period)
+	, m_dry_run(false)
+	, m_num_marked(0)
+{}
+
+size_t LooseGC::loose_index(const key_type& key) const
+{
+	LooseEntry entry;
+	entry.key = key;
+	const auto it = std::lower_bound(m_loose.begin(), m_loose.end(), entry);
+	return it != m_loose.end() && it->key == key ? it - m_loose.begin() : m_loose.size();
+}
+
+bool LooseGC::visit(const key_type& key, bool is_blob)
+{
+	const size_t index = loose_index(key);
+	if (index < m_loose.size()) {
+		const uint64_t bit = (uint64_t)1 << (index % 64);
+		if (m_marks[index / 64].fetch_or(bit) & bit) {
+			return false;
+		}
+		++m_num_marked;
+		return true;
+	}
+	if (is_blob) {
+		return false;
+	}
+
+	visited_shard& shard = m_visited[key.bytes()[key_type::hash_len - 1] % num_shards];
+	bool inserted;
+	{
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		shard.keys.insert(key, inserted);
+	}
+	if (inserted) {
+		++m_num_marked;
+	}
+	return inserted;
+}
+
+void LooseGC::submit(gtl::work_stealing_pool& pool, const key_type& key)
+{
+	if (!visit(key, false)) {
+		return;
+	}
+	gtl::work_stealing_pool* p = &pool;
+	pool.submit([this, p, key]() {
+		expand(*p, key);
+	});
+}
+
+void LooseGC::expand(gtl::work_stealing_pool& pool, const key_type& key)
+{
+	static thread_local std::vector<char_type> buf;
+	Object::Type type;
+	if (loose_index(key) < m_loose.size()) {
+		type = load(m_db, key, buf);
+	} else if (m_alternate) {
+		type = load(*m_alternate, key, buf);
+	} else {
+		throw LooseODB::hash_error_type(key);
+	}
+
+	switch (type)
+	{
+	case Object::Type::Tree:
+	{
+		const TreeView view(buf.data(), buf.size());
+		const auto end = view.end();
+		for (auto it = view.begin(); it != end; ++it) {
+			if (it->is_commit()) {
+				continue;
+			}
+			if (it->is_tree()) {
+				submit(pool, it->key());
+			} else {
+				visit(it->key(), true);
+			}
+		}// for each entry
+		break;
+	}
+	case Object::Type::Commit:
+	{
+		CommitHeader header;
+		header.parse(buf.data(), buf.size());
+		submit(pool, header.tree_key);
+		for (auto i = header.parent_keys.begin(); i != header.parent_keys.end(); ++i) {
+			submit(pool, *i);
+		}
+		break;
+	}
+	case Object::Type::Tag:
+	{
+		key_vector_type links;
+		object_links(type, buf.data(), buf.size(), links);
+		for (auto i = links.begin(); i != links.end(); ++i) {
+			submit(pool, *i);
+		}
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+void LooseGC::mark(const key_vector_type& roots)
+{
+	gtl::work_stealing_pool pool(m_num_threads);
+	for (auto i = roots.begin(); i != roots.end(); ++i) {
+		submit(pool, *i);
+	}
+	pool.wait();
+}
+
+void LooseGC::repack(const std::vector<size_t>& indices, LooseGCStats& stats)
+{
+	if (!m_dry_run) {
+		PackWriter writer(m_pack_dir);
+		LooseODB::raw_object_type raw;
+		for (auto i = indices.begin(); i != indices.end(); ++i) {
+			m_db.object(m_loose[*i].key)->raw(raw);
+			writer.insert_raw(raw);
+		}
+		stats.pack_path = writer.finish();
+
+		// only now the objects are safe to remove
+		for (auto i = indices.begin(); i != indices.end(); ++i) {
+			m_db.remove(m_loose[*i].key);
+		}
+	}
+	stats.num_packed = indices.size();
+}
+
+LooseGCStats LooseGC::collect(const key_vector_type& roots)
+{
+	LooseGCStats stats;
+	m_loose.clear();
+	const auto end = m_db.end();
+	for (auto it = m_db.begin(); it != end; ++it) {
+		const path_type& path = it->path();
+		LooseEntry entry;
+		entry.key = it.key();
+		entry.mtime = boost::filesystem::last_write_time(path);
+		entry.size = boost::filesystem::file_size(path);
+		m_loose.push_back(entry);
+	}
+	std::sort(m_loose.begin(), m_loose.end());
+	stats.num_loose = m_loose.size();
+
+	const size_t num_words = (m_loose.size() + 63) / 64;
+	m_marks.reset(new std::atomic<uint64_t>[num_words]);
+	for (size_t i = 0; i < num_words; ++i) {
+		m_marks[i] = 0;
+	}
+	m_visited.reset(new visited_shard[num_shards]);
+	m_num_marked = 0;
+
+	mark(roots);
+	std::vector<size_t> reachable;
+	key_vector_type recent;
+	for (size_t i = 0; i < m_loose.size(); ++i) {
+		if (is_marked(i)) {
+			reachable.push_back(i);
+		} else if (m_loose[i].mtime >= m_expiry) {
+			recent.push_back(m_loose[i].key);
+		}
+	}
+	stats.num_reachable = reachable.size();
+
+	// recent objects may be part of a history which isn't referenced yet, and must remain complete
+	mark(recent);
+
+	for (size_t i = 0; i < m_loose.size(); ++i) {
+		if (is_marked(i)) {
+			continue;
+		}
+		++stats.num_pruned;
+		stats.bytes_pruned += m_loose[i].size;
+		if (!m_dry_run) {
+			m_db.remove(m_loose[i].key);
+		}
+	}// for each loose object
+	stats.num_recent = stats.num_loose - stats.num_reachable - stats.num_pruned;
+
+	if (!m_pack_dir.empty() && !reachable.empty()) {
+		repack(reachable, stats);
+	}
+	stats.num_marked = m_num_marked;
+
+	m_loose = std::vector<LooseEntry>();
+	m_marks.reset();
+	m_visited.reset();
+	return stats;
+}
+
+GIT_NAMESPACE_END
@@ -0,0 +1,184 @@
+#ifndef GIT_LOOSE_GC_H
+#define GIT_LOOSE_GC_H
+
+#include <git/config.h>
+#include <git/db/odb_loose.h>
+#include <git/db/odb_pack.h>
+#include <git/db/key_index.h>
+#include <gtl/work_stealing_pool.hpp>
+
+#include <atomic>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+GIT_HEADER_BEGIN
+GIT_NAMESPACE_BEGIN
+
+/** \brief result of a garbage collection of a loose object database
+  */
+struct LooseGCStats
+{
+	typedef git_loose_odb_traits::path_type		path_type;
+
+	uint64_t		num_loose;			//!< amount of loose objects found
+	uint64_t		num_reachable;		//!< amount of loose objects reachable from the roots
+	uint64_t		num_recent;			//!< amount of unreachable loose objects kept as they or objects referring
+										//!< to them are not older than the expiry time
+	uint64_t		num_pruned;			//!< amount of unreachable loose objects removed
+	uint64_t		bytes_pruned;		//!< size of the files of all removed objects
+	uint64_t		num_packed;			//!< amount of reachable loose objects moved into a new pack
+	uint64_t		num_marked;			//!< amount of objects marked reachable, including ones which are not loose
+	path_type		pack_path;			//!< path to the new pack, empty if none was written
+
+	LooseGCStats()
+		: num_loose(0)
+		, num_reachable(0)
+		, num_recent(0)
+		, num_pruned(0)
+		, bytes_pruned(0)
+		, num_packed(0)
+		, num_marked(0)
+	{}
+};
+
+
+/** \ingroup ODB
+  * \brief Removes loose objects which are not reachable from a set of root objects.
+  *
+  * All objects reachable from the roots are marked using multiple threads: commits refer to their tree and
+  * parents, trees to their entries except for submodules, and tags to their object. Blobs are marked without
+  * reading them. Objects which are not stored loose are read from an alternate pack database if set, hence
+  * loose objects referred to by packed objects are kept as well.
+  *
+  * Like git, unreachable objects are only removed if their files were not modified after an expiry time, which
+  * defaults to two weeks ago. Objects which are still being written by others, and everything they refer to,
+  * are kept that way, as recent unreachable objects serve as additional roots.
+  *
+  * The mark set needs a single bit per loose object, as well as a key per tree, commit and tag outside of the
+  * loose database, to walk each of them only once. Blobs outside of the loose database are never recorded.
+  *
+  * Optionally, all loose objects reachable from the roots are moved into a new pack. In a dry run, nothing
+  * is written or removed, but all statistics are computed as if it was.
+  */
+class LooseGC
+{
+public:
+	typedef git_object_traits_base::key_type		key_type;
+	typedef git_object_traits_base::char_type		char_type;
+	typedef LooseODB::path_type						path_type;
+	typedef std::vector<key_type>					key_vector_type;
+
+	//! default amount of seconds unreachable objects are kept after they were written
+	static const time_t default_grace_period = 14 * 24 * 60 * 60;
+
+protected:
+	static const size_t num_shards = 64;
+
+	/** A loose object as found when enumerating the database
+	  */
+	struct LooseEntry
+	{
+		key_type		key;
+		time_t			mtime;
+		uint64_t		size;
+
+		bool operator < (const LooseEntry& rhs) const {
+			return key < rhs.key;
+		}
+	};
+
+	/** Part of the set of visited objects which are not loose, keys are assigned to shards by their last byte
+	  */
+	struct visited_shard
+	{
+		std::mutex		mutex;
+		KeyIndex		keys;
+	};
+
+	LooseODB&							m_db;
+	const PackODB*						m_alternate;
+	size_t								m_num_threads;
+	time_t								m_expiry;
+	bool								m_dry_run;
+	path_type							m_pack_dir;
+
+	// state of the current collection
+	std::vector<LooseEntry>						m_loose;		//!< all loose objects, sorted by key
+	std::unique_ptr<std::atomic<uint64_t>[]>	m_marks;		//!< one bit per entry of m_loose
+	std::unique_ptr<visited_shard[]>			m_visited;		//!< objects marked which are not loose
+	std::atomic<uint64_t>						m_num_marked;
+
+protected:
+	//! \return index of the given key in m_loose, or m_loose.size() if it is not loose
+	size_t loose_index(const key_type& key) const;
+
+	//! \return true if the loose object with the given index is marked
+	bool is_marked(size_t index) const {
+		return (m_marks[index / 64].load(std::memory_order_relaxed) & ((uint64_t)1 << (index % 64))) != 0;
+	}
+
+	//! Mark the given object
+	//! \param is_blob if true, the object is known to be a blob which doesn't need to be recorded unless it is loose
+	//! \return true if the object was not marked before, and needs to be expanded
+	bool visit(const key_type& key, bool is_blob);
+
+	//! Mark the given object and submit a task to expand it if it wasn't marked before
+	void submit(gtl::work_stealing_pool& pool, const key_type& key);
+
+	//! Read the given object and mark all objects it refers to
+	void expand(gtl::work_stealing_pool& pool, const key_type& key);
+
+	//! Mark everything reachable from the given objects
+	void mark(const key_vector_type& roots);
+
+	//! Move all loose objects with the given indices into a new pack
+	void repack(const std::vector<size_t>& indices, LooseGCStats& stats);
+
+public:
+	//! Prepare the collection of the given database, which must remain valid while we exist
+	//! \param num_threads amount of threads to mark objects with
+	explicit LooseGC(LooseODB& db, size_t num_threads = gtl::work_stealing_pool::default_concurrency());
+
+public:
+	//! @{ \name Configuration
+
+	//! Read objects which are not loose from the given database, which must remain valid while we use it,
+	//! or 0 to require all reachable objects to be loose
+	void set_alternate(const PackODB* alternate) {
+		m_alternate = alternate;
+	}
+
+	//! Only remove unreachable objects whose files were last modified before the given time, in seconds since epoch
+	void set_expiry(time_t expiry) {
+		m_expiry = expiry;
+	}
+
+	//! If enabled, nothing is written or removed
+	void set_dry_run(bool dry_run) {
+		m_dry_run = dry_run;
+	}
+
+	//! Move reachable loose objects into a new pack in the given directory, which must exist, or don't
+	//! repack if the path is empty
+	void set_repack(const path_type& pack_dir) {
+		m_pack_dir = pack_dir;
+	}
+
+	//! @}
+
+	/** Remove all loose objects not reachable from the given roots, which may be of any type.
+	  * \return statistics about the collection
+	  * \throw gtl::odb_error if a reachable commit, tree or tag doesn't exist or cannot be read, or
+	  * DeserializationError if it is corrupted, in which case nothing is removed. Blobs are not verified
+	  * \note objects must not be added to the database while it is collected, unless their files are newer than
+	  * the expiry time
+	  */
+	LooseGCStats collect(const key_vector_type& roots);
+};
+
+GIT_NAMESPACE_END
+GIT_HEADER_END
+
+#endif // GIT_LOOSE_GC_H
@@ -0,0 +1,352 @@
+#ifndef GIT_MERGE_BASE_H
+#define GIT_MERGE_BASE_H
+
+#include <git/config.h>
+#include <git/db/commit_cache.h>
+
+#include <algorithm>
+#include <queue>
+#include <utility>
+#include <vector>
+
+GIT_HEADER_BEGIN
+GIT_NAMESPACE_BEGIN
+
+/** \ingroup ODB
+  * \brief Answers ancestry queries between commits, like finding their merge bases.
+  *
+  * All queries paint the commits reachable from either side of the query, newest first, until only commits
+  * reachable from both sides are left to walk. If commits are contained in a commit graph, their generation
+  * numbers are used to walk in topological order, and to stop as soon as no remaining commit can reach the
+  * commits in question.
+  *
+  * Parsed commits are kept in a CommitCache between queries, hence running many queries on one instance
+  * only decodes each commit once. Per-query state is reset by visiting only the commits it touched.
+  * \tparam ObjectDatabase any database providing accessors to objects by key
+  */
+template <class ObjectDatabase>
+class MergeBase
+{
+public:
+	typedef ObjectDatabase								db_type;
+	typedef git_object_traits_base::key_type			key_type;
+	typedef CommitCache<db_type>						cache_type;
+	typedef typename cache_type::id_type				id_type;
+	typedef std::vector<key_type>						key_vector_type;
+	typedef std::pair<key_type, key_type>				key_pair_type;
+
+protected:
+	//! Flags stored per commit
+	enum Flags
+	{
+		Parent1 = 1,			//!< the commit is reachable from the first side
+		Parent2 = 2,			//!< the commit is reachable from the second side
+		Stale = 4,				//!< the commit is reachable from a common ancestor
+		Result = 8				//!< the commit was recorded as common ancestor
+	};
+
+	struct QueueEntry
+	{
+		uint32		generation;
+		time_t		time;
+		uint32		seq;			//!< order of insertion, to walk commits of equal generation and time stably
+		id_type		id;
+
+		//! largest generations, then newest and earliest inserted entries have the highest priority
+		bool operator < (const QueueEntry& rhs) const {
+			if (generation != rhs.generation) {
+				return generation < rhs.generation;
+			}
+			return time < rhs.time || (time == rhs.time && seq > rhs.seq);
+		}
+	};
+
+	typedef std::vector<id_type>						id_vector_type;
+
+	cache_type							m_commits;
+	std::vector<uchar>					m_flags;		//!< flags indexed by commit id
+	std::vector<uint32>					m_num_queued;	//!< amount of queue entries per commit id
+	id_vector_type						m_touched;		//!< ids of all commits with flags
+	std::priority_queue<QueueEntry>		m_queue;
+	size_t								m_num_nonstale;	//!< amount of queue entries of commits which are not stale
+	uint32								m_seq;
+
+	id_vector_type						m_others;		//!< temporary storage for remove_redundant()
+	id_vector_type						m_found;		//!< temporary storage for paint results
+
+protected:
+	//! Make our per-commit state cover all ids of the cache
+	void grow() {
+		m_flags.resize(m_commits.size(), 0);
+		m_num_queued.resize(m_commits.size(), 0);
+	}
+
+	//! \return id of the given key
+	id_type node_id(const key_type& key) {
+		const id_type id = m_commits.id(key);
+		grow();
+		return id;
+	}
+
+	void parse(id_type id) {
+		m_commits.parse(id);
+		grow();
+	}
+
+	void add_flags(id_type id, uchar flags) {
+		uchar& cur = m_flags[id];
+		if (!cur) {
+			m_touched.push_back(id);
+		}
+		if ((flags & Stale) && !(cur & Stale)) {
+			m_num_nonstale -= m_num_queued[id];
+		}
+		cur |= flags;
+	}
+
+	void enqueue(id_type id) {
+		parse(id);
+		const QueueEntry entry = { m_commits.generation(id), m_commits.time(id), m_seq++, id };
+		m_queue.push(entry);
+		m_num_queued[id] += 1;
+		if (!(m_flags[id] & Stale)) {
+			++m_num_nonstale;
+		}
+	}
+
+	//! Reset the state of the previous query
+	void clear_flags() {
+		for (auto i = m_touched.begin(); i != m_touched.end(); ++i) {
+			m_flags[*i] = 0;
+			m_num_queued[*i] = 0;
+		}
+		m_touched.clear();
+		m_queue = std::priority_queue<QueueEntry>();
+		m_num_nonstale = 0;
+		m_seq = 0;
+	}
+
+	/** Walk all commits reachable from one and twos until only common ancestors are left to walk.
+	  * Flags of the walked commits remain set until the next walk starts.
+	  * \param min_generation commits with a smaller generation are not walked, as they cannot reach the
+	  * commits of interest
+	  * \param result receives the common ancestors in the order they were found, which may include
+	  * ancestors of other results, marked Stale
+	  */
+	void paint_down_to_common(id_type one, const id_type* twos, size_t num_twos, uint32 min_generation,
+	                          id_vector_type& result) {
+		clear_flags();
+		result.clear();
+		add_flags(one, Parent1);
+		enqueue(one);
+		for (const id_type* two = twos; two < twos + num_twos; ++two) {
+			add_flags(*two, Parent2);
+			enqueue(*two);
+		}
+
+		while (m_num_nonstale) {
+			const QueueEntry top = m_queue.top();
+			m_queue.pop();
+			const id_type id = top.id;
+			m_num_queued[id] -= 1;
+			if (!(m_flags[id] & Stale)) {
+				--m_num_nonstale;
+			}
+			if (top.generation < min_generation) {
+				break;
+			}
+
+			uchar flags = m_flags[id] & (Parent1 | Parent2 | Stale);
+			if (flags == (Parent1 | Parent2)) {
+				if (!(m_flags[id] & Result)) {
+					add_flags(id, Result);
+					result.push_back(id);
+				}
+				// our ancestors are common as well, but cannot be merge bases
+				flags |= Stale;
+			}
+			for (uint32 i = 0; i < m_commits.num_parents(id); ++i) {
+				// parents may be reallocated while enqueuing
+				const id_type parent = m_commits.parents(id)[i];
+				if ((m_flags[parent] & flags) == flags) {
+					continue;
+				}
+				add_flags(parent, flags);
+				enqueue(parent);
+			}
+		}// while there are commits which are not known to be common
+	}
+
+	//! Remove all ids which are reachable from any other id. All ids must be parsed and unique
+	void remove_redundant(id_vector_type& ids) {
+		if (ids.size() < 2) {
+			return;
+		}
+
+		std::vector<bool> redundant(ids.size(), false);
+		std::vector<size_t> other_index;
+		for (size_t i = 0; i < ids.size(); ++i) {
+			if (redundant[i]) {
+				continue;
+			}
+			m_others.clear();
+			other_index.clear();
+			uint32 min_generation = m_commits.generation(ids[i]);
+			for (size_t j = 0; j < ids.size(); ++j) {
+				if (j == i || redundant[j]) {
+					continue;
+				}
+				m_others.push_back(ids[j]);
+				other_index.push_back(j);
+				min_generation = std::min(min_generation, m_commits.generation(ids[j]));
+			}
+
+			paint_down_to_common(ids[i], m_others.data(), m_others.size(), min_generation, m_found);
+			if (m_flags[ids[i]] & Parent2) {
+				redundant[i] = true;
+			}
+			for (size_t j = 0; j < m_others.size(); ++j) {
+				if (m_flags[m_others[j]] & Parent1) {
+					redundant[other_index[j]] = true;
+				}
+			}
+		}// for each id
+
+		size_t num_kept = 0;
+		for (size_t i = 0; i < ids.size(); ++i) {
+			if (!redundant[i]) {
+				ids[num_kept++] = ids[i];
+			}
+		}
+		ids.resize(num_kept);
+	}
+
+	//! Compute the merge bases of one and all twos, which are parsed and given as ids
+	void merge_bases(id_type one, const id_type* twos, size_t num_twos, key_vector_type& out) {
+		out.clear();
+		if (std::find(twos, twos + num_twos, one) != twos + num_twos) {
+			out.push_back(m_commits.key(one));
+			return;
+		}
+
+		id_vector_type candidates;
+		paint_down_to_common(one, twos, num_twos, 0, candidates);
+		candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [this](id_type id) {
+			return (m_flags[id] & Stale) != 0;
+		}), candidates.end());
+		remove_redundant(candidates);
+
+		for (auto i = candidates.begin(); i != candidates.end(); ++i) {
+			out.push_back(m_commits.key(*i));
+		}
+	}
+
+public:
+	//! Initialize the instance to read commits from the given database, which must remain valid while we exist
+	explicit MergeBase(const db_type& db)
+		: m_commits(db)
+		, m_num_nonstale(0)
+		, m_seq(0)
+	{}
+
+public:
+	//! Obtain commits from the given graph if they are contained in it. The graph must remain valid while we
+	//! use it, or 0 to read all commits from the database. All commits parsed so far are forgotten, as
+	//! generation numbers must be known for all commits in the graph
+	void set_commit_graph(const CommitGraph* graph) {
+		reset();
+		m_commits.set_commit_graph(graph);
+	}
+
+	//! Forget all parsed commits, keeping the allocated memory
+	void reset() {
+		clear_flags();
+		m_commits.clear();
+		m_flags.clear();
+		m_num_queued.clear();
+	}
+
+	//! @{ \name Queries
+	//! \throw ObjectError if any given key or any ancestor is no commit, gtl::odb_error if it doesn't exist
+
+	/** Compute the best common ancestors of one and any of the given commits, which are the common ancestors
+	  * not reachable from any other common ancestor
+	  * \param out receives the merge bases, newest first. It is empty if the commits have no common ancestor
+	  */
+	void merge_bases(const key_type& one, const key_vector_type& twos, key_vector_type& out) {
+		const id_type one_id = node_id(one);
+		id_vector_type two_ids;
+		two_ids.reserve(twos.size());
+		for (auto i = twos.begin(); i != twos.end(); ++i) {
+			two_ids.push_back(node_id(*i));
+		}
+		merge_bases(one_id, two_ids.data(), two_ids.size(), out);
+	}
+
+	//! Same as above, for exactly two commits
+	void merge_bases(const key_type& one, const key_type& two, key_vector_type& out) {
+		const id_type one_id = node_id(one);
+		const id_type two_id = node_id(two);
+		merge_bases(one_id, &two_id, 1, out);
+	}
+
+	//! Compute the merge bases of each of the given pairs of commits, sharing all parsed commits between queries
+	//! \param out receives the merge bases of each pair, in the order of the pairs
+	void merge_bases(const std::vector<key_pair_type>& pairs, std::vector<key_vector_type>& out) {
+		out.resize(pairs.size());
+		for (size_t i = 0; i < pairs.size(); ++i) {
+			merge_bases(pairs[i].first, pairs[i].second, out[i]);
+		}
+	}
+
+	//! \return true if ancestor is reachable from descendant, or if both are the same commit
+	bool is_ancestor(const key_type& ancestor, const key_type& descendant) {
+		const id_type aid = node_id(ancestor);
+		const id_type did = node_id(descendant);
+		if (aid == did) {
+			return true;
+		}
+		parse(aid);
+		parse(did);
+		const uint32 generation = m_commits.generation(aid);
+		if (m_commits.generation(did) < generation) {
+			return false;
+		}
+
+		paint_down_to_common(aid, &did, 1, generation, m_found);
+		return (m_flags[aid] & Parent2) != 0;
+	}
+
+	//! Compute the commits of the given ones which are not reachable from any other given commit
+	//! \param out receives the independent commits in the order they were given, without duplicates
+	void independent(const key_vector_type& keys, key_vector_type& out) {
+		id_vector_type ids;
+		ids.reserve(keys.size());
+		for (auto i = keys.begin(); i != keys.end(); ++i) {
+			const id_type id = node_id(*i);
+			if (std::find(ids.begin(), ids.end(), id) == ids.end()) {
+				parse(id);
+				ids.push_back(id);
+			}
+		}
+		remove_redundant(ids);
+
+		out.clear();
+		for (auto i = ids.begin(); i != ids.end(); ++i) {
+			out.push_back(m_commits.key(*i));
+		}
+	}
+
+	//! @}
+
+	//! \return amount of commits decoded from the database so far, which doesn't include commits obtained from
+	//! the commit graph
+	size_t num_parsed() const {
+		return m_commits.num_decoded();
+	}
+};
+
+GIT_NAMESPACE_END
+GIT_HEADER_END
+
+#endif // GIT_MERGE_BASE_H
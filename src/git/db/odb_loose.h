@@ -6,23 +6,19 @@
 #include <gtl/db/odb_loose.hpp>
 #include <git/db/util.hpp>
 
-#include <boost/iostreams/stream.hpp>
-#include <boost/iostreams/device/array.hpp>
-
 GIT_HEADER_BEGIN
 GIT_NAMESPACE_BEGIN
 
-/** \todo still to be implemented/defined
+/** \brief policy reading and writing headers of loose objects as used by git, which have the form "<type> <size>\\0"
   */
 struct git_loose_odb_policy : public gtl::odb_loose_policy
 {
+	//! \return length of the header including the terminating 0, or 0 if it is malformed, in which case
+	//! type is set to the null object type
 	template <class CharType, class ObjectType, class SizeType>
 	size_t parse_header(CharType* buf, size_t buflen, ObjectType& type, SizeType& size)
 	{
-		boost::iostreams::stream<boost::iostreams::basic_array_source<CharType> > stream(buf, buflen);
-		stream >> type;
-		stream >> size;
-		return (size_t)stream.tellg() + 1;	// includes terminating 0
+		return parse_loose_object_header(buf, buflen, type, size);
 	}
 	
 	template <class StreamType, class ObjectType, class SizeType>
@@ -0,0 +1,13 @@
+#include <git/db/odb_pack.h>
+#include <git/config.h>		// for doxygen
+
+
+GIT_NAMESPACE_BEGIN
+
+PackODB::PackODB(const path_type& root)
+	: odb_pack(root)
+{
+}
+
+
+GIT_NAMESPACE_END
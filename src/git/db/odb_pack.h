@@ -0,0 +1,91 @@
+#ifndef GIT_ODB_PACK_H
+#define GIT_ODB_PACK_H
+
+#include <git/config.h>
+#include <git/db/policy.hpp>
+#include <git/db/util.hpp>
+#include <gtl/db/odb_pack.hpp>
+#include <gtl/db/pack_writer.hpp>
+
+GIT_HEADER_BEGIN
+GIT_NAMESPACE_BEGIN
+
+/** \brief maps the entry type ids used in git packs to our object types and back
+  * \ingroup ODBPolicy
+  */
+struct git_pack_odb_policy : public gtl::odb_pack_policy
+{
+	template <class ObjectType>
+	void to_object_type(uchar pack_type, ObjectType& type)
+	{
+		switch(pack_type)
+		{
+			case 1: { type = Object::Type::Commit; break; }
+			case 2: { type = Object::Type::Tree; break; }
+			case 3: { type = Object::Type::Blob; break; }
+			case 4: { type = Object::Type::Tag; break; }
+			default:
+			{
+				gtl::pack_error err;
+				err.stream() << "invalid pack entry type: " << (int)pack_type << std::flush;
+				throw err;
+			}
+		}// end type switch
+	}
+	
+	template <class ObjectType>
+	uchar to_pack_type(const ObjectType type)
+	{
+		switch(type)
+		{
+			case Object::Type::Commit: return 1;
+			case Object::Type::Tree: return 2;
+			case Object::Type::Blob: return 3;
+			case Object::Type::Tag: return 4;
+			default:
+			{
+				gtl::pack_error err;
+				err.stream() << "cannot store object type in pack: " << (int)type << std::flush;
+				throw err;
+			}
+		}// end type switch
+	}
+	
+	template <class HashGeneratorType, class ObjectType, class SizeType>
+	void header_hash(HashGeneratorType& gen, const ObjectType type, const SizeType size)
+	{
+		typename git_object_policy_traits::char_type hdr[32];
+		ushort hdrlen = loose_object_header(hdr, type, size);
+		gen.update(hdr, hdrlen);
+	}
+};
+
+/** \brief configures the pack database to be conforming with a default git repository
+  */
+struct git_pack_odb_traits : public gtl::odb_pack_traits<git_object_traits>
+{
+	//! override default policy for our implementation
+	typedef git_pack_odb_policy policy_type;
+};
+
+/** \ingroup ODB
+  * \brief git-like implementation of the read-only pack database
+  */
+class PackODB : public gtl::odb_pack<git_object_traits, git_pack_odb_traits>
+{
+public:
+	typedef git_pack_odb_traits::path_type path_type;
+	
+public:
+	PackODB(const path_type& root);
+};
+
+/** \ingroup ODB
+  * \brief writer for new packs which are readable by the PackODB
+  */
+typedef gtl::pack_writer<git_object_traits, git_pack_odb_traits> PackWriter;
+
+
+GIT_NAMESPACE_END
+GIT_HEADER_END
+#endif // GIT_ODB_PACK_H
@@ -0,0 +1,199 @@
+#include <git/db/pack_bitmap.h>
+#include <git/config.h>		// for doxygen
+#include <git/obj/multiobj.h>
+#include <git/obj/commit_header.h>
+
+#include <boost/filesystem.hpp>
+#include <algorithm>
+
+
+GIT_NAMESPACE_BEGIN
+
+namespace
+{
+	typedef PackReachability::pack_type				pack_type;
+	typedef PackReachability::key_type				key_type;
+	typedef PackReachability::key_vector_type		key_vector_type;
+	typedef PackReachability::bitmap_type			bitmap_type;
+	
+	//! \return index entry of the given key
+	//! \throw gtl::pack_error if the key doesn't exist in the pack
+	uint32 entry_of(const pack_type& pack, const key_type& key)
+	{
+		const uint32 entry = pack.index().lookup(key);
+		if (entry == pack.num_entries()) {
+			gtl::pack_error err;
+			err.stream() << "reachable object " << key << " is not contained in pack " << pack.path();
+			throw err;
+		}
+		return entry;
+	}
+	
+	void deserialize(const pack_type& pack, uint32 entry, MultiObject& mobj)
+	{
+		PackODB::output_object_type(&pack, pack.index().offset(entry)).deserialize(mobj);
+	}
+	
+	/** Compute all objects reachable from tips.
+	  * \param bitmap functor taking an index entry and a bitmap. It returns true if the commit at the 
+	  * entry has a bitmap, which was placed into the given bitmap
+	  */
+	template <class BitmapLookup>
+	void reachable_objects(const pack_type& pack, const key_vector_type& tips, BitmapLookup bitmap, bitmap_type& out)
+	{
+		const std::vector<uint32>& order = pack.pack_order();
+		std::vector<bool> seen(pack.num_entries(), false);
+		std::vector<uint32> pending;		// objects of unknown type
+		std::vector<uint32> trees;			// trees to traverse
+		bitmap_type from_bitmaps;
+		bitmap_type bm;
+		pack_type::data_type data;
+		CommitHeader header;
+		
+		for (auto i = tips.begin(); i != tips.end(); ++i) {
+			pending.push_back(entry_of(pack, *i));
+		}
+		
+		// Walk commits and tags, stop at commits with bitmaps
+		while (!pending.empty()) {
+			const uint32 entry = pending.back();
+			pending.pop_back();
+			if (seen[entry]) {
+				continue;
+			}
+			
+			Object::Type type;
+			PackODB::output_object_type::size_type size;
+			pack.info(pack.index().offset(entry), type, size);
+			if (type == Object::Type::Tree) {
+				trees.push_back(entry);
+				continue;
+			}
+			seen[entry] = true;
+			
+			if (type == Object::Type::Commit) {
+				if (bitmap(entry, bm)) {
+					from_bitmaps |= bm;
+					continue;
+				}
+				pack.decompress(pack.index().offset(entry), type, data);
+				header.parse(data.data(), data.size());
+				trees.push_back(entry_of(pack, header.tree_key));
+				for (auto p = header.parent_keys.begin(); p != header.parent_keys.end(); ++p) {
+					pending.push_back(entry_of(pack, *p));
+				}
+			} else if (type == Object::Type::Tag) {
+				MultiObject mobj;
+				deserialize(pack, entry, mobj);
+				pending.push_back(entry_of(pack, mobj.tag.object_key()));
+			}
+		}// while there are commits to walk
+		
+		// Everything within a bitmap is closed under reachability, and doesn't need to be traversed
+		from_bitmaps.each([&seen, &order](uint64_t pos) {
+			seen[order[pos]] = true;
+		});
+		
+		while (!trees.empty()) {
+			const uint32 entry = trees.back();
+			trees.pop_back();
+			if (seen[entry]) {
+				continue;
+			}
+			seen[entry] = true;
+			
+			Object::Type type;
+			pack.decompress(pack.index().offset(entry), type, data);
+			const TreeView view(data.data(), data.size());
+			const auto end = view.end();
+			for (auto e = view.begin(); e != end; ++e) {
+				// submodule commits are not part of our pack
+				if (e->is_commit()) {
+					continue;
+				}
+				const uint32 element_entry = entry_of(pack, e->key());
+				if (e->is_tree()) {
+					trees.push_back(element_entry);
+				} else {
+					seen[element_entry] = true;
+				}
+			}// for each tree entry
+		}// while there are trees to traverse
+		
+		out.clear();
+		for (uint32 pos = 0; pos < order.size(); ++pos) {
+			if (seen[order[pos]]) {
+				out.set(pos);
+			}
+		}
+		out.resize(order.size());
+	}
+}
+
+
+PackReachability::PackReachability(const pack_type& pack)
+	: m_pack(pack)
+{
+	if (boost::filesystem::is_regular_file(bitmap_index_type::bitmap_path(pack))) {
+		m_index.reset(new bitmap_index_type(pack));
+	}
+}
+
+void PackReachability::reachable(const key_vector_type& tips, bitmap_type& out) const
+{
+	const bitmap_index_type* index = m_index.get();
+	reachable_objects(m_pack, tips, [index](uint32 entry, bitmap_type& bm) {
+		return index && index->bitmap(entry, bm);
+	}, out);
+}
+
+void PackReachability::difference(const key_vector_type& wants, const key_vector_type& haves, bitmap_type& out) const
+{
+	bitmap_type want_objects, have_objects;
+	reachable(wants, want_objects);
+	reachable(haves, have_objects);
+	out = want_objects.and_not(have_objects);
+}
+
+uint64_t PackReachability::count(const bitmap_type& objects, Object::Type type) const
+{
+	if (m_index) {
+		return (objects & m_index->type_bitmap(type)).count();
+	}
+	
+	uint64_t out = 0;
+	const std::vector<uint32>& order = m_pack.pack_order();
+	objects.each([this, &out, &order, type](uint64_t pos) {
+		Object::Type otype;
+		PackODB::output_object_type::size_type size;
+		m_pack.info(m_pack.index().offset(order[pos]), otype, size);
+		out += otype == type;
+	});
+	return out;
+}
+
+void PackReachability::write_bitmaps(const pack_type& pack, const key_vector_type& commits)
+{
+	std::vector<uint32> entries;
+	std::vector<bitmap_type> bitmaps;
+	entries.reserve(commits.size());
+	bitmaps.reserve(commits.size());
+	
+	for (auto i = commits.begin(); i != commits.end(); ++i) {
+		bitmaps.push_back(bitmap_type());
+		reachable_objects(pack, key_vector_type(1, *i), [&entries, &bitmaps](uint32 entry, bitmap_type& bm) {
+			auto it = std::find(entries.begin(), entries.end(), entry);
+			if (it == entries.end()) {
+				return false;
+			}
+			bm = bitmaps[it - entries.begin()];
+			return true;
+		}, bitmaps.back());
+		entries.push_back(entry_of(pack, *i));
+	}// for each commit
+	
+	bitmap_index_type::write(bitmap_index_type::bitmap_path(pack), pack, commits, bitmaps);
+}
+
+
+GIT_NAMESPACE_END
@@ -0,0 +1,84 @@
+#ifndef GIT_PACK_BITMAP_H
+#define GIT_PACK_BITMAP_H
+
+#include <git/config.h>
+#include <git/db/odb_pack.h>
+#include <gtl/db/pack_bitmap.hpp>
+
+#include <memory>
+#include <vector>
+
+GIT_HEADER_BEGIN
+GIT_NAMESPACE_BEGIN
+
+/** \ingroup ODB
+  * \brief Computes sets of objects reachable from commits of a pack, using reachability bitmaps.
+  * 
+  * Sets of objects are bitmaps indexed by pack position. If the pack has a bitmap index, the bitmaps of 
+  * all commits encountered are combined. Commits without a bitmap are walked until a commit with a bitmap
+  * or a root commit is reached, and trees are only traversed if they are not yet known to be reachable.
+  * Without a bitmap index, this degenerates into a full walk.
+  * \note all reachable objects must be contained in the pack
+  */
+class PackReachability
+{
+public:
+	typedef PackODB::pack_type									pack_type;
+	typedef PackODB::key_type									key_type;
+	typedef gtl::pack_bitmap_index<git_object_traits, git_pack_odb_traits>	bitmap_index_type;
+	typedef bitmap_index_type::bitmap_type						bitmap_type;
+	typedef std::vector<key_type>								key_vector_type;
+	
+protected:
+	const pack_type&					m_pack;
+	std::unique_ptr<bitmap_index_type>	m_index;	//!< bitmap index or 0 if there is none
+	
+public:
+	//! Initialize this instance to work on the given pack, loading its bitmap index if it exists.
+	//! The pack must remain valid while we exist.
+	//! \throw gtl::pack_error if the bitmap index is corrupted
+	PackReachability(const pack_type& pack);
+	
+public:
+	//! \return pack we operate on
+	const pack_type& pack() const {
+		return m_pack;
+	}
+	
+	//! \return bitmap index we use, or 0 if there is none
+	const bitmap_index_type* bitmap_index() const {
+		return m_index.get();
+	}
+	
+	//! \return key of the object at the given pack position
+	key_type key(uint32 pack_position) const {
+		return m_pack.index().key(m_pack.pack_order()[pack_position]);
+	}
+	
+	//! Compute the set of all objects reachable from the given objects, including them
+	//! \param tips keys of commits, tags, trees or blobs
+	//! \param out receives the set of reachable objects
+	//! \throw gtl::pack_error if a reachable object is not contained in the pack
+	void reachable(const key_vector_type& tips, bitmap_type& out) const;
+	
+	//! Compute the set of objects reachable from wants, but not from haves. This is the set of 
+	//! objects to send to a client which already has the haves.
+	void difference(const key_vector_type& wants, const key_vector_type& haves, bitmap_type& out) const;
+	
+	//! \return amount of objects of the given type within the given set
+	uint64_t count(const bitmap_type& objects, Object::Type type) const;
+	
+public:
+	/** Write a bitmap index for the given pack, replacing an existing one.
+	  * \param commits commits to store a bitmap for. Reachability is computed in the given order, reusing
+	  * the bitmaps computed so far, hence listing ancestors first is faster.
+	  * \throw gtl::pack_error if a reachable object is not contained in the pack
+	  */
+	static void write_bitmaps(const pack_type& pack, const key_vector_type& commits);
+};
+
+
+GIT_NAMESPACE_END
+GIT_HEADER_END
+
+#endif // GIT_PACK_BITMAP_H
@@ -4,6 +4,7 @@
 #include <git/config.h>
 #include <git/db/traits.hpp>
 #include <git/obj/multiobj.h>
+#include <git/obj/serializer.h>
 
 #include <memory>
 
@@ -57,6 +58,12 @@ struct git_object_policy : public gtl::odb_object_policy<TraitsType>
 		}// end type switch
 	}
 	
+	void serialize_buffer(const typename TraitsType::input_reference_type object, 
+						  std::vector<typename TraitsType::char_type>& buffer)
+	{
+		Serializer(buffer).serialize(object);
+	}
+	
 	template <class ODBObjectType>
 	void deserialize(typename TraitsType::output_reference_type out, const ODBObjectType& object)
 	{
@@ -0,0 +1,432 @@
+#ifndef GIT_REACHABILITY_CACHE_H
+#define GIT_REACHABILITY_CACHE_H
+
+#include <git/config.h>
+#include <git/db/commit_cache.h>
+#include <git/db/merge_base.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <iterator>
+#include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+GIT_HEADER_BEGIN
+GIT_NAMESPACE_BEGIN
+
+/** \ingroup ODB
+  * \brief Answers whether commits are reachable from a set of named tips, like branches, from many threads at once.
+  *
+  * For each tip, a bitmap of all commits reachable from it is kept, indexed by the ids of a CommitCache. Hence
+  * a query for a tip is a key lookup and a bit test. Tips pointing to the same commit share their bitmap.
+  *
+  * When a tip is set, commits are walked from its new commit, and the walk stops at the commits of all other
+  * tips and the previous commit of the tip itself, whose bitmaps are merged instead. Hence moving a tip forward
+  * only walks the new commits. A tip which doesn't descend from any tip is walked down to its root commits.
+  *
+  * Tips are changed by one writer at a time, which builds a new immutable snapshot of all tips and publishes
+  * it atomically. Queries go through a Reader, which works on the snapshot published when the query started,
+  * without taking any lock. Snapshots are only deleted once no reader can use them anymore.
+  * \tparam ObjectDatabase any database providing accessors to objects by key
+  * \note memory grows with the amount of commits ever encountered, as commit ids are never reused
+  */
+template <class ObjectDatabase>
+class ReachabilityCache
+{
+public:
+	typedef ObjectDatabase								db_type;
+	typedef git_object_traits_base::key_type			key_type;
+	typedef CommitCache<db_type>						cache_type;
+	typedef typename cache_type::id_type				id_type;
+
+	class Reader;
+
+protected:
+	typedef std::vector<uint64_t>						bitmap_type;
+	typedef std::shared_ptr<const bitmap_type>			bitmap_ptr;
+
+	//! A commit key and its id, to look up ids by key
+	struct KeyEntry
+	{
+		key_type	key;
+		id_type		id;
+
+		bool operator < (const KeyEntry& rhs) const {
+			return key < rhs.key;
+		}
+	};
+	typedef std::vector<KeyEntry>						key_table_type;
+	typedef std::shared_ptr<const key_table_type>		key_table_ptr;
+
+	struct Tip
+	{
+		std::string		name;
+		key_type		commit;
+		id_type			id;
+		bitmap_ptr		reachable;		//!< all commits reachable from the tip, including its commit
+	};
+
+	/** All tips at one point in time, which is never changed once it was published
+	  */
+	struct Snapshot
+	{
+		std::vector<Tip>									tips;		//!< sorted by name
+		std::vector<std::pair<key_type, const bitmap_type*> >	commits;	//!< bitmap of each tip commit, sorted by key
+		key_table_ptr										ids;		//!< all published ids, sorted by key
+		key_table_ptr										new_ids;	//!< recently published ids, sorted by key
+
+		static id_type find(const key_table_type& table, const key_type& key) {
+			KeyEntry entry;
+			entry.key = key;
+			const auto it = std::lower_bound(table.begin(), table.end(), entry);
+			return it != table.end() && it->key == key ? it->id : KeyIndex::npos;
+		}
+
+		//! \return id of the given commit, or KeyIndex::npos if it isn't reachable from any tip
+		id_type find(const key_type& key) const {
+			const id_type id = find(*new_ids, key);
+			return id != KeyIndex::npos ? id : find(*ids, key);
+		}
+
+		//! \return tip with the given name, or 0
+		const Tip* tip(const std::string& name) const {
+			const auto it = std::lower_bound(tips.begin(), tips.end(), name,
+			                                 [](const Tip& t, const std::string& n) { return t.name < n; });
+			return it != tips.end() && it->name == name ? &*it : nullptr;
+		}
+
+		//! \return bitmap of the tip pointing to the given commit, or 0 if there is none
+		const bitmap_type* reachable_from(const key_type& commit) const {
+			const auto it = std::lower_bound(commits.begin(), commits.end(), commit,
+			                                 [](const std::pair<key_type, const bitmap_type*>& c, const key_type& k) {
+				return c.first < k;
+			});
+			return it != commits.end() && it->first == commit ? it->second : nullptr;
+		}
+	};
+
+	typedef std::list<std::atomic<uint64_t> >			reader_list_type;
+
+	std::mutex							m_mutex;		//!< serializes writers and the registration of readers
+	cache_type							m_commits;
+	std::atomic<const Snapshot*>		m_current;
+	std::atomic<uint64_t>				m_epoch;		//!< incremented whenever a snapshot is replaced
+	reader_list_type					m_readers;		//!< epoch each reader started its current query in, or 0
+	std::vector<std::pair<const Snapshot*, uint64_t> >	m_retired;	//!< replaced snapshots and the epoch they were replaced in
+	size_t								m_num_published;	//!< amount of commit ids contained in the current snapshot
+	size_t								m_num_walked;
+	std::vector<id_type>				m_stack;
+
+protected:
+	static bool contains(const bitmap_type& bitmap, id_type id) {
+		return id / 64 < bitmap.size() && (bitmap[id / 64] & ((uint64_t)1 << (id % 64))) != 0;
+	}
+
+	//! \return bitmap of all commits reachable from the given one, reusing the bitmaps of the given tips
+	bitmap_ptr reachable(id_type id, const std::vector<Tip>& tips) {
+		std::vector<std::pair<id_type, const bitmap_type*> > donors;
+		for (auto t = tips.begin(); t != tips.end(); ++t) {
+			if (t->id == id) {
+				return t->reachable;
+			}
+			donors.push_back(std::make_pair(t->id, t->reachable.get()));
+		}
+		std::sort(donors.begin(), donors.end());
+
+		std::shared_ptr<bitmap_type> out(new bitmap_type);
+		bitmap_type& bits = *out;
+		// true if the commit was added and needs to be walked
+		auto add = [&bits, &donors](id_type c) {
+			if (contains(bits, c)) {
+				return false;
+			}
+			const auto d = std::lower_bound(donors.begin(), donors.end(), std::make_pair(c, (const bitmap_type*)nullptr));
+			if (d != donors.end() && d->first == c) {
+				const bitmap_type& donor = *d->second;
+				if (bits.size() < donor.size()) {
+					bits.resize(donor.size(), 0);
+				}
+				for (size_t i = 0; i < donor.size(); ++i) {
+					bits[i] |= donor[i];
+				}
+				return false;
+			}
+			if (c / 64 >= bits.size()) {
+				bits.resize(c / 64 + 1, 0);
+			}
+			bits[c / 64] |= (uint64_t)1 << (c % 64);
+			return true;
+		};
+
+		m_stack.clear();
+		add(id);
+		m_stack.push_back(id);
+		while (!m_stack.empty()) {
+			const id_type c = m_stack.back();
+			m_stack.pop_back();
+			m_commits.parse(c);
+			++m_num_walked;
+
+			const id_type* parents = m_commits.parents(c);
+			for (uint32 p = 0; p < m_commits.num_parents(c); ++p) {
+				if (add(parents[p])) {
+					m_stack.push_back(parents[p]);
+				}
+			}
+		}// while there are commits to walk
+		return out;
+	}
+
+	//! Make the given snapshot the current one, after completing its lookup tables
+	void publish(std::unique_ptr<Snapshot> next) {
+		const Snapshot& cur = *m_current.load();
+		for (auto t = next->tips.begin(); t != next->tips.end(); ++t) {
+			next->commits.push_back(std::make_pair(t->commit, t->reachable.get()));
+		}
+		std::sort(next->commits.begin(), next->commits.end());
+		next->commits.erase(std::unique(next->commits.begin(), next->commits.end()), next->commits.end());
+
+		// new ids are collected separately, and only merged into all ids once there are many of them
+		next->ids = cur.ids;
+		next->new_ids = cur.new_ids;
+		if (m_commits.size() > m_num_published) {
+			std::shared_ptr<key_table_type> added(new key_table_type(*cur.new_ids));
+			const size_t first = added->size();
+			for (size_t id = m_num_published; id < m_commits.size(); ++id) {
+				KeyEntry entry;
+				entry.key = m_commits.key((id_type)id);
+				entry.id = (id_type)id;
+				added->push_back(entry);
+			}
+			std::sort(added->begin() + first, added->end());
+			std::inplace_merge(added->begin(), added->begin() + first, added->end());
+
+			if (added->size() > cur.ids->size() / 8) {
+				std::shared_ptr<key_table_type> all(new key_table_type);
+				all->reserve(cur.ids->size() + added->size());
+				std::merge(cur.ids->begin(), cur.ids->end(), added->begin(), added->end(), std::back_inserter(*all));
+				next->ids = all;
+				next->new_ids = key_table_ptr(new key_table_type);
+			} else {
+				next->new_ids = added;
+			}
+			m_num_published = m_commits.size();
+		}
+
+		const Snapshot* old = m_current.exchange(next.release());
+		m_retired.push_back(std::make_pair(old, m_epoch.fetch_add(1)));
+		reclaim();
+	}
+
+	//! Delete all replaced snapshots no reader can use anymore
+	void reclaim() {
+		// a reader which started in an epoch later than the one a snapshot was replaced in never saw it
+		uint64_t first_epoch = std::numeric_limits<uint64_t>::max();
+		for (auto r = m_readers.begin(); r != m_readers.end(); ++r) {
+			const uint64_t epoch = r->load();
+			if (epoch && epoch < first_epoch) {
+				first_epoch = epoch;
+			}
+		}
+		auto keep = m_retired.begin();
+		for (auto i = m_retired.begin(); i != m_retired.end(); ++i) {
+			if (i->second < first_epoch) {
+				delete i->first;
+			} else {
+				*keep++ = *i;
+			}
+		}
+		m_retired.erase(keep, m_retired.end());
+	}
+
+public:
+	//! Initialize the cache to read commits from the given database, which must remain valid while we exist
+	explicit ReachabilityCache(const db_type& db)
+		: m_commits(db)
+		, m_epoch(1)
+		, m_num_published(0)
+		, m_num_walked(0)
+	{
+		Snapshot* s = new Snapshot;
+		s->ids = key_table_ptr(new key_table_type);
+		s->new_ids = s->ids;
+		m_current = s;
+	}
+
+	//! \note all readers must be destroyed before
+	~ReachabilityCache() {
+		assert(m_readers.empty());
+		delete m_current.load();
+		for (auto i = m_retired.begin(); i != m_retired.end(); ++i) {
+			delete i->first;
+		}
+	}
+
+	ReachabilityCache(const ReachabilityCache&) = delete;
+	ReachabilityCache& operator=(const ReachabilityCache&) = delete;
+
+public:
+	//! @{ \name Writer Interface
+	//! \note all methods may be called by any thread, while readers are querying
+
+	//! Obtain commits from the given graph if they are contained in it. The graph must remain valid while we
+	//! use it, or 0 to read all commits from the database.
+	//! \note must be called before the first tip is set and the first reader is created
+	void set_commit_graph(const CommitGraph* graph) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_commits.set_commit_graph(graph);
+	}
+
+	const CommitGraph* commit_graph() const {
+		return m_commits.commit_graph();
+	}
+
+	/** Make the tip with the given name point to the given commit, adding the tip if it doesn't exist yet
+	  * \throw ObjectError if the commit or any ancestor is no commit, gtl::odb_error if it doesn't exist, in
+	  * which case all tips remain unchanged
+	  */
+	void set_tip(const std::string& name, const key_type& commit) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		const Snapshot& cur = *m_current.load();
+		const id_type id = m_commits.id(commit);
+
+		std::unique_ptr<Snapshot> next(new Snapshot);
+		next->tips = cur.tips;
+		auto it = std::lower_bound(next->tips.begin(), next->tips.end(), name,
+		                           [](const Tip& t, const std::string& n) { return t.name < n; });
+		if (it != next->tips.end() && it->name == name) {
+			if (it->id == id) {
+				return;
+			}
+		} else {
+			it = next->tips.insert(it, Tip());
+			it->name = name;
+		}
+		it->reachable = reachable(id, cur.tips);
+		it->commit = commit;
+		it->id = id;
+		publish(std::move(next));
+	}
+
+	//! Remove the tip with the given name
+	//! \return true if it existed
+	bool remove_tip(const std::string& name) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		const Snapshot& cur = *m_current.load();
+		if (!cur.tip(name)) {
+			return false;
+		}
+		std::unique_ptr<Snapshot> next(new Snapshot);
+		for (auto t = cur.tips.begin(); t != cur.tips.end(); ++t) {
+			if (t->name != name) {
+				next->tips.push_back(*t);
+			}
+		}
+		publish(std::move(next));
+		return true;
+	}
+
+	//! \return amount of commits walked by all calls to set_tip()
+	size_t num_walked() const {
+		return m_num_walked;
+	}
+
+	//! @}
+};
+
+
+/** \brief Answers queries of one thread on the tips of a ReachabilityCache, without locking.
+  *
+  * Each query works on the tips set when it started. Queries for commits which aren't the commit of any tip
+  * are answered by walking the history with a MergeBase instance owned by the reader, which requires the
+  * database to support concurrent reads.
+  */
+template <class ObjectDatabase>
+class ReachabilityCache<ObjectDatabase>::Reader
+{
+protected:
+	ReachabilityCache&							m_cache;
+	typename reader_list_type::iterator			m_slot;
+	MergeBase<db_type>							m_fallback;
+	size_t										m_num_fallbacks;
+
+	//! \return snapshot which remains valid until leave() is called
+	const Snapshot* enter() {
+		m_slot->store(m_cache.m_epoch.load());
+		return m_cache.m_current.load();
+	}
+
+	void leave() {
+		m_slot->store(0);
+	}
+
+public:
+	//! Register a reader of the given cache, which must remain valid while we exist
+	explicit Reader(ReachabilityCache& cache)
+		: m_cache(cache)
+		, m_fallback(cache.m_commits.db())
+		, m_num_fallbacks(0)
+	{
+		std::lock_guard<std::mutex> lock(cache.m_mutex);
+		m_slot = cache.m_readers.emplace(cache.m_readers.end(), 0);
+		m_fallback.set_commit_graph(cache.commit_graph());
+	}
+
+	~Reader() {
+		std::lock_guard<std::mutex> lock(m_cache.m_mutex);
+		m_cache.m_readers.erase(m_slot);
+	}
+
+	Reader(const Reader&) = delete;
+	Reader& operator=(const Reader&) = delete;
+
+public:
+	//! \return true if the given commit is reachable from the tip with the given name, which is false if there
+	//! is no such tip
+	bool is_reachable(const key_type& commit, const std::string& tip) {
+		const Snapshot* s = enter();
+		const Tip* t = s->tip(tip);
+		bool result = false;
+		if (t) {
+			const id_type id = s->find(commit);
+			result = id != KeyIndex::npos && contains(*t->reachable, id);
+		}
+		leave();
+		return result;
+	}
+
+	/** \return true if ancestor is reachable from descendant, or if both are the same commit
+	  * \throw ObjectError if descendant isn't the commit of a tip and either commit or any ancestor is no commit,
+	  * gtl::odb_error if it doesn't exist
+	  */
+	bool is_ancestor(const key_type& ancestor, const key_type& descendant) {
+		const Snapshot* s = enter();
+		const bitmap_type* bitmap = s->reachable_from(descendant);
+		if (bitmap) {
+			const id_type id = s->find(ancestor);
+			const bool result = id != KeyIndex::npos && contains(*bitmap, id);
+			leave();
+			return result;
+		}
+		leave();
+
+		++m_num_fallbacks;
+		return m_fallback.is_ancestor(ancestor, descendant);
+	}
+
+	//! \return amount of queries which had to walk the history, as their descendant wasn't the commit of a tip
+	size_t num_fallbacks() const {
+		return m_num_fallbacks;
+	}
+};
+
+GIT_NAMESPACE_END
+GIT_HEADER_END
+
+#endif // GIT_REACHABILITY_CACHE_H
@@ -0,0 +1,381 @@
+#ifndef GIT_RENAME_DETECT_H
+#define GIT_RENAME_DETECT_H
+
+#include <git/config.h>
+#include <git/db/key_index.h>
+#include <git/db/similarity.h>
+#include <git/db/tree_diff.h>
+#include <gtl/thread_pool.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+GIT_HEADER_BEGIN
+GIT_NAMESPACE_BEGIN
+
+/** \ingroup ODB
+  * \brief Turns pairs of deleted and added files of a TreeDiff into renames, and optionally added files into copies.
+  *
+  * Files with equal keys are paired first, which doesn't require reading any blob. The remaining files are
+  * compared using SimilaritySignatures, which are computed on a thread pool, as is the matrix of scores of
+  * all pairs of sources and destinations. Pairs are assigned greedily, highest score first. The matrix is
+  * only computed if its amount of pairs doesn't exceed a limit, as its cost is quadratic.
+  *
+  * Sources of renames are deleted files. If copies are detected, the old versions of modified files are
+  * sources as well, and deleted files may be the source of multiple destinations, the first of which is
+  * a rename. Files are only paired with files of the same kind, like regular files or symbolic links.
+  * The database must support concurrent reads if multiple threads are used.
+  * \tparam ObjectDatabase any database providing accessors to objects by key
+  */
+template <class ObjectDatabase>
+class RenameDetector
+{
+public:
+	typedef ObjectDatabase								db_type;
+	typedef git_object_traits_base::key_type			key_type;
+	typedef git_object_traits_base::char_type			char_type;
+	typedef TreeView::mode_type							mode_type;
+	typedef std::vector<TreeChange>						change_vector_type;
+
+protected:
+	//! A possible pairing of a source and a destination
+	struct Candidate
+	{
+		uint32		score;
+		uint32		dst;		//!< index into the destinations
+		uint32		src;		//!< index into the sources
+
+		//! highest scores first, then in order of destinations and sources
+		bool operator < (const Candidate& rhs) const {
+			if (score != rhs.score) {
+				return score > rhs.score;
+			}
+			return dst < rhs.dst || (dst == rhs.dst && src < rhs.src);
+		}
+	};
+
+	typedef std::vector<size_t>							index_vector_type;
+	typedef std::vector<SimilaritySignature>			signature_vector_type;
+
+	const db_type&		m_db;
+	size_t				m_num_threads;
+	uint32				m_min_score;
+	bool				m_copies;
+	size_t				m_max_candidates;
+
+	size_t				m_num_exact;
+	size_t				m_num_inexact;
+	bool				m_limit_exceeded;
+
+	//! \return true if the given change has a file on the given side, which excludes trees and submodules
+	static bool is_file(mode_type mode) {
+		const mode_type kind = mode & TreeView::mode_mask;
+		return mode != 0 && kind != TreeView::mode_tree && kind != TreeView::mode_commit;
+	}
+
+	//! \return true if files of the given modes can be paired
+	static bool same_kind(mode_type lhs, mode_type rhs) {
+		return (lhs & TreeView::mode_mask) == (rhs & TreeView::mode_mask);
+	}
+
+	//! Read the given blob into the given buffer
+	//! \throw ObjectError if it is no blob, DeserializationError if it cannot be read
+	void load(const key_type& key, std::vector<char_type>& buf) const {
+		auto acc = m_db.object(key);
+		if (acc->type() != Object::Type::Blob) {
+			ObjectError err;
+			err.stream() << "object " << key << " is no blob";
+			throw err;
+		}
+		const size_t size = (size_t)acc->size();
+		buf.resize(size);
+		std::unique_ptr<typename db_type::output_object_type::stream_type> stream(acc->new_stream());
+		stream->read(buf.data(), size);
+		if ((size_t)stream->gcount() != size) {
+			DeserializationError err;
+			err.stream() << "blob " << key << " ended after " << stream->gcount() << " of " << size << " bytes";
+			throw err;
+		}
+	}
+
+	//! Compute the signatures of the given keys, using pool if it is set
+	void compute_signatures(gtl::thread_pool* pool, const std::vector<key_type>& keys, signature_vector_type& out) const {
+		out.resize(keys.size());
+		static const size_t batch_size = 64;
+		for (size_t first = 0; first < keys.size(); first += batch_size) {
+			const size_t last = std::min(first + batch_size, keys.size());
+			auto task = [this, &keys, &out, first, last]() {
+				std::vector<char_type> buf;
+				for (size_t i = first; i < last; ++i) {
+					load(keys[i], buf);
+					out[i].assign(buf.data(), buf.size());
+				}
+			};
+			if (pool) {
+				pool->submit(task);
+			} else {
+				task();
+			}
+		}// for each batch
+	}
+
+	//! Turn the destination with the given index into a rename or copy of the given source
+	void pair(change_vector_type& changes, size_t dst, size_t src, TreeChange::Kind kind, uint32 score) const {
+		const TreeChange& source = changes[src];
+		TreeChange& change = changes[dst];
+		change.kind = kind;
+		change.old_path = source.path;
+		change.old_mode = source.old_mode;
+		change.old_key = source.old_key;
+		change.score = score;
+	}
+
+public:
+	//! Initialize the detector to read blobs from the given database, which must remain valid while we exist
+	//! \param num_threads amount of threads to compare blobs with
+	explicit RenameDetector(const db_type& db, size_t num_threads = gtl::thread_pool::default_concurrency())
+		: m_db(db)
+		, m_num_threads(num_threads)
+		, m_min_score(50)
+		, m_copies(false)
+		, m_max_candidates(1000 * 1000)
+		, m_num_exact(0)
+		, m_num_inexact(0)
+		, m_limit_exceeded(false)
+	{}
+
+public:
+	//! @{ \name Configuration
+
+	//! Only pair files with at least the given similarity in percent
+	void set_min_score(uint32 min_score) {
+		m_min_score = std::min(min_score, SimilaritySignature::max_score);
+	}
+
+	//! If enabled, added files are also paired with modified files, and with deleted files which are renamed already
+	void set_copies(bool copies) {
+		m_copies = copies;
+	}
+
+	//! Only compare files by similarity if there are at most the given amount of pairs of sources and destinations.
+	//! Files with equal keys are always paired
+	void set_max_candidates(size_t max_candidates) {
+		m_max_candidates = max_candidates;
+	}
+
+	//! @}
+
+	/** Detect renames and copies in the given changes, as produced by TreeDiff
+	  * Paired deleted files are removed, and paired added files become Renamed or Copied changes. The
+	  * changes remain ordered by path.
+	  * \throw gtl::odb_error if a blob doesn't exist, or ObjectError if it is no blob
+	  */
+	void detect(change_vector_type& changes) {
+		m_num_exact = 0;
+		m_num_inexact = 0;
+		m_limit_exceeded = false;
+
+		// sources are deleted files first, then modified ones
+		index_vector_type sources, dsts;
+		for (size_t i = 0; i < changes.size(); ++i) {
+			const TreeChange& change = changes[i];
+			if (change.kind == TreeChange::Kind::Deleted && is_file(change.old_mode)) {
+				sources.push_back(i);
+			} else if (change.kind == TreeChange::Kind::Added && is_file(change.new_mode)) {
+				dsts.push_back(i);
+			}
+		}
+		const size_t num_deleted = sources.size();
+		if (m_copies) {
+			for (size_t i = 0; i < changes.size(); ++i) {
+				if (changes[i].kind == TreeChange::Kind::Modified && is_file(changes[i].old_mode)) {
+					sources.push_back(i);
+				}
+			}
+		}
+		if (sources.empty() || dsts.empty()) {
+			return;
+		}
+
+		std::vector<bool> src_used(sources.size(), false);
+		std::vector<bool> dst_paired(dsts.size(), false);
+		auto assign = [&](size_t d, size_t s, uint32 score) -> bool {
+			if (s < num_deleted && !src_used[s]) {
+				pair(changes, dsts[d], sources[s], TreeChange::Kind::Renamed, score);
+			} else if (m_copies) {
+				pair(changes, dsts[d], sources[s], TreeChange::Kind::Copied, score);
+			} else {
+				return false;
+			}
+			src_used[s] = true;
+			dst_paired[d] = true;
+			return true;
+		};
+
+		// exact matches, preferring sources which were not used yet
+		KeyIndex src_keys;
+		std::vector<std::vector<uint32> > sources_of_key;
+		for (size_t s = 0; s < sources.size(); ++s) {
+			bool inserted;
+			const KeyIndex::id_type id = src_keys.insert(changes[sources[s]].old_key, inserted);
+			if (inserted) {
+				sources_of_key.push_back(std::vector<uint32>());
+			}
+			sources_of_key[id].push_back((uint32)s);
+		}
+		for (size_t d = 0; d < dsts.size(); ++d) {
+			const TreeChange& dst = changes[dsts[d]];
+			const KeyIndex::id_type id = src_keys.find(dst.new_key);
+			if (id == KeyIndex::npos) {
+				continue;
+			}
+			const std::vector<uint32>& candidates = sources_of_key[id];
+			size_t best = candidates.size();
+			for (size_t c = 0; c < candidates.size(); ++c) {
+				const size_t s = candidates[c];
+				if (!same_kind(changes[sources[s]].old_mode, dst.new_mode)) {
+					continue;
+				}
+				if (best == candidates.size() || (src_used[candidates[best]] && !src_used[s])) {
+					best = c;
+				}
+			}
+			if (best != candidates.size() && assign(d, candidates[best], SimilaritySignature::max_score)) {
+				++m_num_exact;
+			}
+		}// for each destination
+
+		// similar files
+		index_vector_type rem_sources, rem_dsts;
+		for (size_t s = 0; s < sources.size(); ++s) {
+			if (m_copies || !src_used[s]) {
+				rem_sources.push_back(s);
+			}
+		}
+		for (size_t d = 0; d < dsts.size(); ++d) {
+			if (!dst_paired[d]) {
+				rem_dsts.push_back(d);
+			}
+		}
+		if (!rem_sources.empty() && !rem_dsts.empty()) {
+			if (rem_sources.size() * rem_dsts.size() > m_max_candidates) {
+				m_limit_exceeded = true;
+			} else {
+				detect_similar(changes, sources, dsts, rem_sources, rem_dsts, assign);
+			}
+		}
+
+		// remove the sources of renames
+		std::vector<bool> renamed(changes.size(), false);
+		for (size_t s = 0; s < num_deleted; ++s) {
+			renamed[sources[s]] = src_used[s];
+		}
+		size_t num_kept = 0;
+		for (size_t i = 0; i < changes.size(); ++i) {
+			if (!renamed[i]) {
+				if (num_kept != i) {
+					changes[num_kept] = std::move(changes[i]);
+				}
+				++num_kept;
+			}
+		}
+		changes.resize(num_kept);
+	}
+
+protected:
+	//! Pair the remaining sources and destinations by similarity
+	template <class AssignFunctor>
+	void detect_similar(const change_vector_type& changes, const index_vector_type& sources,
+	                    const index_vector_type& dsts, const index_vector_type& rem_sources,
+	                    const index_vector_type& rem_dsts, AssignFunctor& assign) {
+		std::unique_ptr<gtl::thread_pool> pool;
+		if (m_num_threads > 1) {
+			pool.reset(new gtl::thread_pool(m_num_threads));
+		}
+
+		std::vector<key_type> src_keys, dst_keys;
+		for (auto i = rem_sources.begin(); i != rem_sources.end(); ++i) {
+			src_keys.push_back(changes[sources[*i]].old_key);
+		}
+		for (auto i = rem_dsts.begin(); i != rem_dsts.end(); ++i) {
+			dst_keys.push_back(changes[dsts[*i]].new_key);
+		}
+		signature_vector_type src_sigs, dst_sigs;
+		compute_signatures(pool.get(), src_keys, src_sigs);
+		compute_signatures(pool.get(), dst_keys, dst_sigs);
+		if (pool) {
+			pool->wait();
+		}
+
+		// score all pairs, one row of destinations per task
+		std::mutex mutex;
+		std::vector<Candidate> candidates;
+		for (size_t d = 0; d < rem_dsts.size(); ++d) {
+			auto task = [&, d]() {
+				std::vector<Candidate> row;
+				const mode_type dst_mode = changes[dsts[rem_dsts[d]]].new_mode;
+				const SimilaritySignature& dst_sig = dst_sigs[d];
+				for (size_t s = 0; s < rem_sources.size(); ++s) {
+					const SimilaritySignature& src_sig = src_sigs[s];
+					if (!same_kind(changes[sources[rem_sources[s]]].old_mode, dst_mode) ||
+					    SimilaritySignature::max_score_of(src_sig.size(), dst_sig.size()) < m_min_score) {
+						continue;
+					}
+					const uint32 score = SimilaritySignature::score(src_sig, dst_sig);
+					if (score >= m_min_score) {
+						const Candidate c = { score, (uint32)rem_dsts[d], (uint32)rem_sources[s] };
+						row.push_back(c);
+					}
+				}
+				if (!row.empty()) {
+					std::lock_guard<std::mutex> lock(mutex);
+					candidates.insert(candidates.end(), row.begin(), row.end());
+				}
+			};
+			if (pool) {
+				pool->submit(task);
+			} else {
+				task();
+			}
+		}// for each destination
+		if (pool) {
+			pool->wait();
+		}
+
+		std::sort(candidates.begin(), candidates.end());
+		std::vector<bool> dst_done(dsts.size(), false);
+		for (auto c = candidates.begin(); c != candidates.end(); ++c) {
+			if (!dst_done[c->dst] && assign(c->dst, c->src, c->score)) {
+				dst_done[c->dst] = true;
+				++m_num_inexact;
+			}
+		}
+	}
+
+public:
+	//! @{ \name Statistics of the last detection
+
+	//! \return amount of files paired by key
+	size_t num_exact() const {
+		return m_num_exact;
+	}
+
+	//! \return amount of files paired by similarity
+	size_t num_inexact() const {
+		return m_num_inexact;
+	}
+
+	//! \return true if files were not compared by similarity, as there were more pairs than allowed
+	bool limit_exceeded() const {
+		return m_limit_exceeded;
+	}
+
+	//! @}
+};
+
+GIT_NAMESPACE_END
+GIT_HEADER_END
+
+#endif // GIT_RENAME_DETECT_H
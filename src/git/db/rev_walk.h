@@ -0,0 +1,548 @@
+#ifndef GIT_REV_WALK_H
+#define GIT_REV_WALK_H
+
+#include <git/config.h>
+#include <git/db/commit_cache.h>
+#include <git/db/tree_diff.h>
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+GIT_HEADER_BEGIN
+GIT_NAMESPACE_BEGIN
+
+/** \ingroup ODB
+  * \brief Lists commits reachable from a set of included tips, but not from a set of excluded tips.
+  *
+  * Only the headers of commits are decoded, and all state is kept in arrays indexed by the id each commit 
+  * obtains in our CommitCache. Commits are output newest first, in order of their committer time. If no tips
+  * are excluded, the commits are streamed as the walk progresses. Otherwise the walk has to proceed until
+  * all commits still to be walked are excluded, before the first commit can be output. Topological order
+  * additionally guarantees that no parent is output before all of its children, which requires all commits 
+  * to be walked first.
+  *
+  * If a commit graph is set, commits contained in it are not read from the database at all.
+  *
+  * The output can be limited to commits which changed given paths compared to their first parent. If the 
+  * commit graph contains changed path filters, commits whose filter excludes all paths are skipped without
+  * reading any tree. Unlike git, history is not simplified: all commits are walked, and merges are only 
+  * compared to their first parent.
+  *
+  * Like git, excluded commits are assumed to be found in time, that is, commit times are assumed to 
+  * be roughly monotonic along each line of history. A few extra commits are walked to allow for small skews.
+  * \tparam ObjectDatabase any database providing accessors to objects by key
+  */
+template <class ObjectDatabase>
+class RevWalk
+{
+public:
+	typedef ObjectDatabase								db_type;
+	typedef git_object_traits_base::key_type			key_type;
+	typedef git_object_traits_base::char_type			char_type;
+	typedef CommitCache<db_type>						cache_type;
+	typedef typename cache_type::id_type				id_type;
+	typedef std::vector<std::string>					path_vector_type;
+	
+	//! Orders in which commits can be output
+	enum class Sort : uchar
+	{
+		Date,			//!< newest committer time first
+		Topological		//!< like Date, but children are always output before their parents
+	};
+	
+	/** Input iterator yielding the keys of the walked commits. Incrementing it advances the walk.
+	  */
+	class const_iterator : public std::iterator<std::input_iterator_tag, const key_type>
+	{
+		RevWalk*	m_walk;		//!< walk to advance, or 0 if we are at the end
+		key_type	m_key;
+		
+	public:
+		explicit const_iterator(RevWalk* walk = nullptr)
+			: m_walk(walk)
+		{
+			++*this;
+		}
+		
+		bool operator == (const const_iterator& rhs) const {
+			return m_walk == rhs.m_walk;
+		}
+		
+		bool operator != (const const_iterator& rhs) const {
+			return m_walk != rhs.m_walk;
+		}
+		
+		const key_type& operator*() const {
+			return m_key;
+		}
+		
+		const key_type* operator->() const {
+			return &m_key;
+		}
+		
+		const_iterator& operator++() {
+			if (m_walk && !m_walk->next(m_key)) {
+				m_walk = nullptr;
+			}
+			return *this;
+		}
+	};
+	
+protected:
+	//! Flags stored per commit
+	enum Flags
+	{
+		Seen = 1,				//!< the commit was added to the queue once
+		Uninteresting = 2,		//!< the commit is reachable from an excluded tip
+		Queued = 4,				//!< the commit is in the queue
+		Listed = 8				//!< the commit is in the list of commits to output
+	};
+	
+	struct QueueEntry
+	{
+		time_t		time;
+		uint32		seq;			//!< order of insertion, to output commits of equal time in a stable order
+		id_type		id;
+		
+		//! newest and earliest inserted entries have the highest priority
+		bool operator < (const QueueEntry& rhs) const {
+			return time < rhs.time || (time == rhs.time && seq > rhs.seq);
+		}
+	};
+	
+	/** Priority queue which allows inspecting all of its entries
+	  */
+	struct Queue : public std::priority_queue<QueueEntry>
+	{
+		const typename std::priority_queue<QueueEntry>::container_type& entries() const {
+			return this->c;
+		}
+	};
+	
+	cache_type							m_commits;
+	std::vector<uchar>					m_flags;		//!< flags indexed by commit id
+	Queue								m_queue;
+	std::vector<id_type>				m_list;			//!< commits to output, if the walk is limited
+	size_t								m_list_pos;		//!< next commit of m_list to output
+	size_t								m_num_interesting_queued;
+	uint32								m_seq;
+	size_t								m_num_output;
+	bool								m_has_hidden;
+	bool								m_started;
+	
+	Sort								m_sort;
+	bool								m_first_parent;
+	size_t								m_max_count;
+	time_t								m_min_time;
+	
+	path_vector_type					m_paths;
+	std::vector<ChangedPathFilters::key_vector_type>	m_path_keys;	//!< keys of each path and its directories
+	std::unique_ptr<TreeDiff<db_type> >	m_diff;			//!< created once the first commit is compared
+	typename TreeDiff<db_type>::change_vector_type	m_changes;
+	size_t								m_num_diffs;
+	size_t								m_num_bloom_skipped;
+	
+protected:
+	//! \return id of the given key, creating its flags if needed
+	id_type node_id(const key_type& key) {
+		const id_type id = m_commits.id(key);
+		m_flags.resize(m_commits.size(), 0);
+		return id;
+	}
+	
+	//! Parse the given commit, making sure all of its parents have flags
+	void parse(id_type id) {
+		m_commits.parse(id);
+		m_flags.resize(m_commits.size(), 0);
+	}
+	
+	void enqueue(id_type id) {
+		parse(id);
+		m_flags[id] |= Seen | Queued;
+		if (!(m_flags[id] & Uninteresting)) {
+			++m_num_interesting_queued;
+		}
+		const QueueEntry entry = { m_commits.time(id), m_seq++, id };
+		m_queue.push(entry);
+	}
+	
+	id_type dequeue() {
+		const id_type id = m_queue.top().id;
+		m_queue.pop();
+		m_flags[id] &= ~Queued;
+		if (!(m_flags[id] & Uninteresting)) {
+			--m_num_interesting_queued;
+		}
+		return id;
+	}
+	
+	//! Mark the given commit and all of its known ancestors uninteresting
+	void mark_uninteresting(id_type id) {
+		std::vector<id_type> stack(1, id);
+		while (!stack.empty()) {
+			const id_type cur = stack.back();
+			stack.pop_back();
+			uchar& flags = m_flags[cur];
+			if (flags & Uninteresting) {
+				continue;
+			}
+			flags |= Uninteresting;
+			if (flags & Queued) {
+				--m_num_interesting_queued;
+			}
+			if (m_commits.is_parsed(cur)) {
+				const id_type* parents = m_commits.parents(cur);
+				stack.insert(stack.end(), parents, parents + m_commits.num_parents(cur));
+			}
+		}// while there are commits to mark
+	}
+	
+	//! \return amount of parents to follow of the given commit
+	uint32 num_followed_parents(id_type id) const {
+		const uint32 num_parents = m_commits.num_parents(id);
+		return m_first_parent ? std::min(num_parents, (uint32)1) : num_parents;
+	}
+	
+	//! Handle the given commit, which was just taken off the queue, and queue its parents
+	//! \return true if the commit should be output
+	bool process(id_type id) {
+		if (m_flags[id] & Uninteresting) {
+			for (uint32 i = 0; i < m_commits.num_parents(id); ++i) {
+				const id_type parent = m_commits.parents(id)[i];
+				mark_uninteresting(parent);
+				if (!(m_flags[parent] & Seen)) {
+					enqueue(parent);
+				}
+			}
+			return false;
+		}
+		
+		if (m_commits.time(id) < m_min_time) {
+			return false;
+		}
+		const uint32 num_parents = num_followed_parents(id);
+		for (uint32 i = 0; i < num_parents; ++i) {
+			// parents may be reallocated while enqueuing
+			const id_type parent = m_commits.parents(id)[i];
+			if (!(m_flags[parent] & Seen)) {
+				enqueue(parent);
+			}
+		}
+		return true;
+	}
+	
+	//! \return true if the given commit changed any of our paths compared to its first parent, or if we have
+	//! no paths
+	bool touches_paths(id_type id) {
+		if (m_paths.empty()) {
+			return true;
+		}
+		
+		const CommitGraph* graph = m_commits.commit_graph();
+		const CommitGraph::position_type pos = m_commits.graph_position(id);
+		if (pos != CommitGraph::npos && graph->has_bloom_filters()) {
+			const BloomFilter filter(graph->bloom_filter(pos));
+			bool maybe_changed = false;
+			for (auto k = m_path_keys.begin(); k != m_path_keys.end() && !maybe_changed; ++k) {
+				maybe_changed = std::all_of(k->begin(), k->end(), [&filter](const BloomKey& key) {
+					return filter.maybe_contains(key);
+				});
+			}
+			if (!maybe_changed) {
+				++m_num_bloom_skipped;
+				return false;
+			}
+		}
+		
+		key_type parent_tree(key_type::null);
+		if (m_commits.num_parents(id)) {
+			const id_type parent = m_commits.parents(id)[0];
+			parse(parent);
+			parent_tree = m_commits.tree_key(parent);
+		}
+		if (!m_diff) {
+			m_diff.reset(new TreeDiff<db_type>(m_commits.db(), 1));
+			m_diff->set_paths(m_paths);
+		}
+		++m_num_diffs;
+		m_diff->diff(parent_tree, m_commits.tree_key(id), m_changes);
+		return !m_changes.empty();
+	}
+	
+	//! \return largest generation of all queued commits
+	uint32 max_queued_generation() const {
+		uint32 gen = 0;
+		const auto& entries = m_queue.entries();
+		for (auto i = entries.begin(); i != entries.end(); ++i) {
+			gen = std::max(gen, m_commits.generation(i->id));
+		}
+		return gen;
+	}
+	
+	//! Walk until all commits to output are known, and put them into m_list
+	void limit() {
+		static const int max_slop = 5;
+		int slop = max_slop;
+		uint32 min_listed_generation = cache_type::infinite_generation;
+		while (!m_queue.empty()) {
+			const id_type id = dequeue();
+			if (process(id)) {
+				m_list.push_back(id);
+				min_listed_generation = std::min(min_listed_generation, m_commits.generation(id));
+			}
+			if (m_num_interesting_queued) {
+				slop = max_slop;
+				continue;
+			}
+			
+			// Only excluded commits are left. If all generations are known, those not larger than the ones of all 
+			// listed commits cannot reach any of them. Otherwise, rely on commit times to be roughly monotonic.
+			const uint32 max_gen = max_queued_generation();
+			if (max_gen != cache_type::infinite_generation && min_listed_generation != cache_type::infinite_generation) {
+				if (max_gen <= min_listed_generation) {
+					break;
+				}
+			} else if (--slop == 0) {
+				break;
+			}
+		}// while there are commits to walk
+		
+		// commits may have been marked uninteresting after they were listed
+		m_list.erase(std::remove_if(m_list.begin(), m_list.end(), [this](id_type id) {
+			return (m_flags[id] & Uninteresting) != 0;
+		}), m_list.end());
+		
+		if (m_sort == Sort::Topological) {
+			sort_topologically();
+		}
+		
+		// dropping commits keeps children before their ancestors
+		if (!m_paths.empty()) {
+			m_list.erase(std::remove_if(m_list.begin(), m_list.end(), [this](id_type id) {
+				return !touches_paths(id);
+			}), m_list.end());
+		}
+	}
+	
+	//! Reorder m_list so that children come before their parents, and newer commits come first otherwise
+	void sort_topologically() {
+		std::vector<uint32> num_children(m_commits.size(), 0);
+		for (auto i = m_list.begin(); i != m_list.end(); ++i) {
+			m_flags[*i] |= Listed;
+		}
+		for (auto i = m_list.begin(); i != m_list.end(); ++i) {
+			const uint32 num_parents = num_followed_parents(*i);
+			for (uint32 p = 0; p < num_parents; ++p) {
+				num_children[m_commits.parents(*i)[p]] += 1;
+			}
+		}
+		
+		std::priority_queue<QueueEntry> ready;
+		uint32 seq = 0;
+		for (auto i = m_list.begin(); i != m_list.end(); ++i) {
+			if (num_children[*i] == 0) {
+				const QueueEntry entry = { m_commits.time(*i), seq++, *i };
+				ready.push(entry);
+			}
+		}
+		
+		std::vector<id_type> sorted;
+		sorted.reserve(m_list.size());
+		while (!ready.empty()) {
+			const id_type id = ready.top().id;
+			ready.pop();
+			sorted.push_back(id);
+			const uint32 num_parents = num_followed_parents(id);
+			for (uint32 p = 0; p < num_parents; ++p) {
+				const id_type parent = m_commits.parents(id)[p];
+				if ((m_flags[parent] & Listed) && --num_children[parent] == 0) {
+					const QueueEntry entry = { m_commits.time(parent), seq++, parent };
+					ready.push(entry);
+				}
+			}
+		}// while there are commits whose children were all output
+		m_list.swap(sorted);
+	}
+	
+	//! \return true if the walk must complete before commits can be output
+	bool is_limited() const {
+		return m_has_hidden || m_sort == Sort::Topological;
+	}
+	
+public:
+	//! Initialize the walk to read commits from the given database, which must remain valid while we exist
+	explicit RevWalk(const db_type& db)
+		: m_commits(db)
+		, m_sort(Sort::Date)
+		, m_first_parent(false)
+		, m_max_count(~(size_t)0)
+		, m_min_time(0)
+		, m_num_diffs(0)
+		, m_num_bloom_skipped(0)
+	{
+		reset();
+	}
+	
+public:
+	//! @{ \name Configuration
+	//! \note configuration must be done before the walk starts
+	
+	void set_sort(Sort sort) {
+		m_sort = sort;
+	}
+	
+	//! If enabled, only the first parent of each commit is followed
+	void set_first_parent(bool first_parent) {
+		m_first_parent = first_parent;
+	}
+	
+	//! Stop after the given amount of commits was output
+	void set_max_count(size_t max_count) {
+		m_max_count = max_count;
+	}
+	
+	//! Neither output nor traverse commits whose committer time is older than the given one
+	void set_min_time(time_t min_time) {
+		m_min_time = min_time;
+	}
+	
+	/** Only output commits which changed any of the given paths, or anything below them, compared to their
+	  * first parent. Root commits are compared to the empty tree. Paths are separated by '/', an empty list 
+	  * outputs all commits
+	  */
+	void set_paths(const path_vector_type& paths) {
+		m_paths.clear();
+		m_path_keys.clear();
+		for (auto i = paths.begin(); i != paths.end(); ++i) {
+			std::string path(*i);
+			while (!path.empty() && path[path.size() - 1] == '/') {
+				path.resize(path.size() - 1);
+			}
+			if (path.empty()) {
+				continue;
+			}
+			m_paths.push_back(path);
+			m_path_keys.push_back(ChangedPathFilters::key_vector_type());
+			ChangedPathFilters::keys(path, m_path_keys.back());
+		}
+		m_diff.reset();
+	}
+	
+	//! Obtain commits from the given graph if they are contained in it. The graph must remain valid while we
+	//! use it, or 0 to read all commits from the database. Its changed path filters are used if set_paths() 
+	//! was called
+	void set_commit_graph(const CommitGraph* graph) {
+		m_commits.set_commit_graph(graph);
+	}
+	
+	//! Include the given commit and its ancestors
+	//! \throw ObjectError if it is no commit, gtl::odb_error if it doesn't exist
+	void push(const key_type& key) {
+		const id_type id = node_id(key);
+		if (!(m_flags[id] & Seen)) {
+			enqueue(id);
+		}
+	}
+	
+	//! Exclude the given commit and its ancestors
+	//! \throw ObjectError if it is no commit, gtl::odb_error if it doesn't exist
+	void hide(const key_type& key) {
+		const id_type id = node_id(key);
+		m_has_hidden = true;
+		mark_uninteresting(id);
+		if (!(m_flags[id] & Seen)) {
+			enqueue(id);
+		}
+	}
+	
+	//! Forget all tips and walked commits, keeping our configuration
+	void reset() {
+		m_commits.clear();
+		m_flags.clear();
+		m_queue = Queue();
+		m_list.clear();
+		m_list_pos = 0;
+		m_num_interesting_queued = 0;
+		m_seq = 0;
+		m_num_output = 0;
+		m_has_hidden = false;
+		m_started = false;
+		m_num_diffs = 0;
+		m_num_bloom_skipped = 0;
+	}
+	
+	//! @}
+	
+	//! @{ \name Walking
+	
+	/** Obtain the next commit of the walk
+	  * \param key set to the key of the commit
+	  * \return true if there was a commit, false if the walk is done
+	  * \throw ObjectError or gtl::odb_error if a commit cannot be read
+	  */
+	bool next(key_type& key) {
+		if (m_num_output >= m_max_count) {
+			return false;
+		}
+		
+		if (is_limited()) {
+			if (!m_started) {
+				m_started = true;
+				limit();
+			}
+			if (m_list_pos == m_list.size()) {
+				return false;
+			}
+			key = m_commits.key(m_list[m_list_pos++]);
+			++m_num_output;
+			return true;
+		}
+		
+		m_started = true;
+		while (!m_queue.empty()) {
+			const id_type id = dequeue();
+			if (process(id) && touches_paths(id)) {
+				key = m_commits.key(id);
+				++m_num_output;
+				return true;
+			}
+		}
+		return false;
+	}
+	
+	//! \return iterator advancing the walk, which may only be used once
+	const_iterator begin() {
+		return const_iterator(this);
+	}
+	
+	const_iterator end() {
+		return const_iterator();
+	}
+	
+	//! \return amount of commits decoded from the database so far, which doesn't include commits obtained from
+	//! the commit graph
+	size_t num_parsed() const {
+		return m_commits.num_decoded();
+	}
+	
+	//! \return amount of commits whose trees were compared to the ones of their first parents
+	size_t num_diffs() const {
+		return m_num_diffs;
+	}
+	
+	//! \return amount of commits which were skipped as their changed path filter excluded all of our paths
+	size_t num_bloom_skipped() const {
+		return m_num_bloom_skipped;
+	}
+	
+	//! @}
+};
+
+GIT_NAMESPACE_END
+GIT_HEADER_END
+
+#endif // GIT_REV_WALK_H
@@ -0,0 +1,95 @@
+#include <git/db/similarity.h>
+#include <git/config.h>		// for doxygen
+
+#include <algorithm>
+
+GIT_NAMESPACE_BEGIN
+
+const uint32 SimilaritySignature::max_score;
+
+namespace
+{
+	const size_t max_chunk_len = 64;
+}
+
+SimilaritySignature::SimilaritySignature()
+	: m_size(0)
+{}
+
+SimilaritySignature::SimilaritySignature(const char* data, size_t size)
+	: m_size(0)
+{
+	assign(data, size);
+}
+
+void SimilaritySignature::assign(const char* data, size_t size)
+{
+	m_chunks.clear();
+	m_size = size;
+	
+	const char* const end = data + size;
+	while (data < end) {
+		// fnv-1a
+		uint32 hash = 2166136261u;
+		const char* const chunk_end = data + std::min(max_chunk_len, (size_t)(end - data));
+		const char* p = data;
+		while (p < chunk_end) {
+			const char c = *p++;
+			hash = (hash ^ (uchar)c) * 16777619u;
+			if (c == '\n') {
+				break;
+			}
+		}
+		const Chunk chunk = { hash, (uint32)(p - data) };
+		m_chunks.push_back(chunk);
+		data = p;
+	}// for each chunk
+	
+	std::sort(m_chunks.begin(), m_chunks.end());
+	
+	// merge chunks of equal hash
+	size_t num_chunks = 0;
+	for (size_t i = 0; i < m_chunks.size(); ++i) {
+		if (num_chunks && m_chunks[num_chunks - 1].hash == m_chunks[i].hash) {
+			m_chunks[num_chunks - 1].bytes += m_chunks[i].bytes;
+		} else {
+			m_chunks[num_chunks++] = m_chunks[i];
+		}
+	}
+	m_chunks.resize(num_chunks);
+	m_chunks.shrink_to_fit();
+}
+
+uint32 SimilaritySignature::score(const SimilaritySignature& lhs, const SimilaritySignature& rhs)
+{
+	const uint64_t max_size = std::max(lhs.m_size, rhs.m_size);
+	if (max_size == 0) {
+		return max_score;
+	}
+	
+	uint64_t common = 0;
+	auto l = lhs.m_chunks.begin();
+	auto r = rhs.m_chunks.begin();
+	const auto lend = lhs.m_chunks.end();
+	const auto rend = rhs.m_chunks.end();
+	while (l != lend && r != rend) {
+		if (l->hash < r->hash) {
+			++l;
+		} else if (r->hash < l->hash) {
+			++r;
+		} else {
+			common += std::min(l->bytes, r->bytes);
+			++l;
+			++r;
+		}
+	}// while both have chunks
+	return (uint32)(common * max_score / max_size);
+}
+
+uint32 SimilaritySignature::max_score_of(uint64_t lsize, uint64_t rsize)
+{
+	const uint64_t max_size = std::max(lsize, rsize);
+	return max_size ? (uint32)(std::min(lsize, rsize) * max_score / max_size) : max_score;
+}
+
+GIT_NAMESPACE_END
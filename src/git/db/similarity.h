@@ -0,0 +1,70 @@
+#ifndef GIT_SIMILARITY_H
+#define GIT_SIMILARITY_H
+
+#include <git/config.h>
+
+#include <cstddef>
+#include <vector>
+
+GIT_HEADER_BEGIN
+GIT_NAMESPACE_BEGIN
+
+/** \brief Compact summary of the contents of a blob, used to estimate how similar two blobs are.
+  *
+  * The data is split into chunks which end at a newline, or after 64 bytes at most. Each distinct chunk is 
+  * represented by its hash and the total amount of bytes of all of its occurrences, in an array sorted by hash. 
+  * Two signatures are compared by merging their arrays, counting the bytes they have in common, which is the 
+  * approach git uses to detect renames.
+  */
+class SimilaritySignature
+{
+public:
+	//! Highest possible score, returned for blobs with equal chunks
+	static const uint32 max_score = 100;
+
+protected:
+	struct Chunk
+	{
+		uint32		hash;
+		uint32		bytes;		//!< amount of bytes of all chunks with our hash
+		
+		bool operator < (const Chunk& rhs) const {
+			return hash < rhs.hash;
+		}
+	};
+	
+	std::vector<Chunk>	m_chunks;		//!< chunks sorted by hash
+	uint64_t			m_size;			//!< size of the summarized data in bytes
+
+public:
+	SimilaritySignature();
+
+	//! Initialize the signature from the given data
+	SimilaritySignature(const char* data, size_t size);
+
+public:
+	//! Summarize the given data, replacing our previous contents
+	void assign(const char* data, size_t size);
+
+	//! \return size of the summarized data in bytes
+	uint64_t size() const {
+		return m_size;
+	}
+
+	//! \return amount of distinct chunks
+	size_t num_chunks() const {
+		return m_chunks.size();
+	}
+
+	//! \return similarity of the summarized blobs between 0 and max_score, which is the amount of bytes both
+	//! have in common, relative to the size of the larger one. Two empty blobs are considered equal
+	static uint32 score(const SimilaritySignature& lhs, const SimilaritySignature& rhs);
+
+	//! \return highest score blobs of the given sizes can possibly reach, which is cheap to compute
+	static uint32 max_score_of(uint64_t lsize, uint64_t rsize);
+};
+
+GIT_NAMESPACE_END
+GIT_HEADER_END
+
+#endif // GIT_SIMILARITY_H
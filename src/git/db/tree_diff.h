@@ -0,0 +1,336 @@
+#ifndef GIT_TREE_DIFF_H
+#define GIT_TREE_DIFF_H
+
+#include <git/config.h>
+#include <git/obj/flat_tree.h>
+#include <git/obj/tree_view.h>
+#include <gtl/thread_pool.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+GIT_HEADER_BEGIN
+GIT_NAMESPACE_BEGIN
+
+/** \brief A single difference between two trees
+  */
+struct TreeChange
+{
+	typedef git_object_traits_base::key_type		key_type;
+	typedef TreeView::mode_type						mode_type;
+
+	enum class Kind : uchar
+	{
+		Added,
+		Deleted,
+		Modified,
+		Renamed,		//!< the entry was moved from old_path, see RenameDetector
+		Copied			//!< the entry was copied from old_path, which still exists
+	};
+
+	Kind			kind;
+	std::string		path;			//!< path relative to the compared trees, separated by '/'
+	std::string		old_path;		//!< path of the source of a rename or copy, empty otherwise
+	uint32			score;			//!< similarity to the source of a rename or copy in percent, 0 otherwise
+	mode_type		old_mode;		//!< mode in the old tree, 0 if the entry was added
+	mode_type		new_mode;		//!< mode in the new tree, 0 if the entry was deleted
+	key_type		old_key;		//!< key in the old tree, null if the entry was added
+	key_type		new_key;		//!< key in the new tree, null if the entry was deleted
+
+	bool operator < (const TreeChange& rhs) const {
+		return path < rhs.path;
+	}
+};
+
+
+/** \ingroup ODB
+  * \brief Computes the differences between two trees and all of their subtrees.
+  *
+  * Both trees are iterated in lockstep, directly on their serialized data. Subtrees with equal keys are
+  * skipped without reading them, hence the cost of a diff depends on the amount of changed directories, not on
+  * the size of the trees. Only files and submodules are reported, each tree which was added or deleted entirely
+  * is reported in terms of all the files it contains. Changes are ordered by path, which is git's tree order.
+  *
+  * Changed subtrees at the configured depth are compared on a thread pool, while all levels above it are
+  * compared by the calling thread. The pool is only started once such a subtree is found, hence small diffs
+  * don't pay for it. The database must support concurrent reads if multiple threads are used.
+  * \tparam ObjectDatabase any database providing accessors to objects by key
+  */
+template <class ObjectDatabase>
+class TreeDiff
+{
+public:
+	typedef ObjectDatabase								db_type;
+	typedef git_object_traits_base::key_type			key_type;
+	typedef git_object_traits_base::char_type			char_type;
+	typedef TreeView::mode_type							mode_type;
+	typedef std::vector<TreeChange>						change_vector_type;
+	typedef std::vector<std::string>					path_vector_type;
+
+protected:
+	//! Result of matching a path against our pathspec
+	enum class Match : uchar
+	{
+		None,			//!< neither the path nor anything below it matches
+		Partial,		//!< the path is a directory containing matching paths
+		Full			//!< the path and everything below it matches
+	};
+
+	/** State shared by all tasks of one diff
+	  */
+	struct shared_state
+	{
+		std::mutex							mutex;
+		change_vector_type					changes;
+		size_t								num_trees_read;
+		std::unique_ptr<gtl::thread_pool>	pool;		//!< created once the first subtree is handed out
+		
+		shared_state()
+			: num_trees_read(0)
+		{}
+	};
+
+	/** Performs a diff of one pair of trees, and keeps the buffers needed to do so
+	  */
+	struct Worker
+	{
+		const TreeDiff&						diff;
+		shared_state*						state;			//!< state to hand out subtrees with, or 0
+		std::deque<std::vector<char_type> >	bufs;			//!< one buffer per side and depth
+		change_vector_type					changes;
+		size_t								num_trees_read;
+
+		Worker(const TreeDiff& diff, shared_state* state)
+			: diff(diff)
+			, state(state)
+			, num_trees_read(0)
+		{}
+
+		//! \return view on the tree with the given key, which is empty if the key is null
+		TreeView load(const key_type& key, size_t buf_index) {
+			if (key == key_type::null) {
+				return TreeView(nullptr, 0);
+			}
+			while (bufs.size() <= buf_index) {
+				bufs.push_back(std::vector<char_type>());
+			}
+			std::vector<char_type>& buf = bufs[buf_index];
+
+			auto acc = diff.m_db.object(key);
+			if (acc->type() != Object::Type::Tree) {
+				ObjectError err;
+				err.stream() << "object " << key << " is no tree";
+				throw err;
+			}
+			const size_t size = (size_t)acc->size();
+			buf.resize(size);
+			std::unique_ptr<typename db_type::output_object_type::stream_type> stream(acc->new_stream());
+			stream->read(buf.data(), size);
+			if ((size_t)stream->gcount() != size) {
+				DeserializationError err;
+				err.stream() << "tree " << key << " ended after " << stream->gcount() << " of " << size << " bytes";
+				throw err;
+			}
+			++num_trees_read;
+			return TreeView(buf.data(), size);
+		}
+
+		void emit(TreeChange::Kind kind, const std::string& path, mode_type old_mode, const key_type& old_key,
+		          mode_type new_mode, const key_type& new_key) {
+			changes.push_back(TreeChange());
+			TreeChange& change = changes.back();
+			change.kind = kind;
+			change.path = path;
+			change.old_mode = old_mode;
+			change.new_mode = new_mode;
+			change.old_key = old_key;
+			change.new_key = new_key;
+		}
+
+		/** Compare the trees with the given keys, either of which may be null, below the given path
+		  * \param path prefix of all paths, which is restored once we return
+		  * \param full if true, the path fully matches our pathspec
+		  */
+		void diff_trees(const key_type& old_key, const key_type& new_key, std::string& path, uint32 depth, bool full) {
+			if (state && depth == diff.m_parallel_depth) {
+				submit(old_key, new_key, path, depth, full);
+				return;
+			}
+
+			const TreeView old_view(load(old_key, depth * 2));
+			const TreeView new_view(load(new_key, depth * 2 + 1));
+			const size_t path_len = path.size();
+
+			auto o = old_view.begin();
+			auto n = new_view.begin();
+			const auto old_end = old_view.end();
+			const auto new_end = new_view.end();
+			while (o != old_end || n != new_end) {
+				int cmp;
+				if (o == old_end) {
+					cmp = 1;
+				} else if (n == new_end) {
+					cmp = -1;
+				} else {
+					cmp = FlatTree::compare(o->name, o->name_len, o->is_tree(), n->name, n->name_len, n->is_tree());
+					if (cmp == 0 && o->mode == n->mode &&
+					    std::memcmp(o->key_bytes, n->key_bytes, key_type::hash_len) == 0) {
+						++o;
+						++n;
+						continue;
+					}
+				}
+
+				const TreeView::Entry& entry = cmp > 0 ? *n : *o;
+				if (path_len) {
+					path += '/';
+				}
+				path.append(entry.name, entry.name_len);
+				const Match match = full ? Match::Full : diff.match(path, entry.is_tree());
+
+				if (match != Match::None) {
+					if (cmp < 0) {
+						if (entry.is_tree()) {
+							diff_trees(o->key(), key_type::null, path, depth + 1, match == Match::Full);
+						} else {
+							emit(TreeChange::Kind::Deleted, path, o->mode, o->key(), 0, key_type::null);
+						}
+					} else if (cmp > 0) {
+						if (entry.is_tree()) {
+							diff_trees(key_type::null, n->key(), path, depth + 1, match == Match::Full);
+						} else {
+							emit(TreeChange::Kind::Added, path, 0, key_type::null, n->mode, n->key());
+						}
+					} else if (entry.is_tree()) {
+						diff_trees(o->key(), n->key(), path, depth + 1, match == Match::Full);
+					} else {
+						emit(TreeChange::Kind::Modified, path, o->mode, o->key(), n->mode, n->key());
+					}
+				}
+				path.resize(path_len);
+
+				if (cmp <= 0) {
+					++o;
+				}
+				if (cmp >= 0) {
+					++n;
+				}
+			}// while there are entries on either side
+		}
+
+		//! Compare the given trees on our pool, using a worker of its own
+		void submit(const key_type& old_key, const key_type& new_key, const std::string& path, uint32 depth, bool full) {
+			if (!state->pool) {
+				state->pool.reset(new gtl::thread_pool(diff.m_num_threads));
+			}
+			const TreeDiff* d = &diff;
+			shared_state* s = state;
+			state->pool->submit([d, s, old_key, new_key, path, depth, full]() {
+				Worker worker(*d, nullptr);
+				std::string wpath(path);
+				worker.diff_trees(old_key, new_key, wpath, depth, full);
+
+				std::lock_guard<std::mutex> lock(s->mutex);
+				s->changes.insert(s->changes.end(), worker.changes.begin(), worker.changes.end());
+				s->num_trees_read += worker.num_trees_read;
+			});
+		}
+	};
+
+protected:
+	const db_type&		m_db;
+	size_t				m_num_threads;
+	uint32				m_parallel_depth;
+	path_vector_type	m_paths;
+	size_t				m_num_trees_read;
+
+	//! \return how the given path matches our pathspec
+	Match match(const std::string& path, bool is_tree) const {
+		if (m_paths.empty()) {
+			return Match::Full;
+		}
+		Match res = Match::None;
+		for (auto i = m_paths.begin(); i != m_paths.end(); ++i) {
+			const std::string& spec = *i;
+			if (path.size() >= spec.size()) {
+				if (path.compare(0, spec.size(), spec) == 0 && (path.size() == spec.size() || path[spec.size()] == '/')) {
+					return Match::Full;
+				}
+			} else if (is_tree && spec[path.size()] == '/' && spec.compare(0, path.size(), path) == 0) {
+				res = Match::Partial;
+			}
+		}
+		return res;
+	}
+
+public:
+	//! Initialize the diff to read trees from the given database, which must remain valid while we exist
+	//! \param num_threads amount of threads to compare subtrees with, 1 compares them in the calling thread
+	explicit TreeDiff(const db_type& db, size_t num_threads = gtl::thread_pool::default_concurrency())
+		: m_db(db)
+		, m_num_threads(num_threads)
+		, m_parallel_depth(2)
+		, m_num_trees_read(0)
+	{}
+
+public:
+	//! @{ \name Configuration
+
+	//! Only report changes of the given paths, and below the given directories. Paths are relative to the
+	//! compared trees, separated by '/' and without trailing separator. An empty list reports all changes
+	void set_paths(const path_vector_type& paths) {
+		m_paths = paths;
+	}
+
+	//! Compare subtrees of the given depth on a thread pool, where 1 hands out each changed entry of the
+	//! compared trees
+	void set_parallel_depth(uint32 depth) {
+		m_parallel_depth = depth ? depth : 1;
+	}
+
+	//! @}
+
+	/** Compute the changes from one tree to another
+	  * \param old_tree key of the tree to compare against, or null to compare against an empty tree
+	  * \param new_tree key of the changed tree, or null to compare against an empty tree
+	  * \param out receives all changes, ordered by path
+	  * \throw ObjectError if a key doesn't refer to a tree, gtl::odb_error if it doesn't exist, or
+	  * DeserializationError if a tree is corrupted
+	  */
+	void diff(const key_type& old_tree, const key_type& new_tree, change_vector_type& out) {
+		out.clear();
+		m_num_trees_read = 0;
+		if (old_tree == new_tree) {
+			return;
+		}
+		
+		shared_state state;
+		Worker worker(*this, m_num_threads > 1 ? &state : nullptr);
+		std::string path;
+		worker.diff_trees(old_tree, new_tree, path, 0, m_paths.empty());
+		out.swap(worker.changes);
+		m_num_trees_read = worker.num_trees_read;
+		
+		if (state.pool) {
+			state.pool->wait();
+			out.insert(out.end(), state.changes.begin(), state.changes.end());
+			std::sort(out.begin(), out.end());
+			m_num_trees_read += state.num_trees_read;
+		}
+	}
+
+	//! \return amount of trees read by the last diff
+	size_t num_trees_read() const {
+		return m_num_trees_read;
+	}
+};
+
+GIT_NAMESPACE_END
+GIT_HEADER_END
+
+#endif // GIT_TREE_DIFF_H
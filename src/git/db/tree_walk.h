@@ -0,0 +1,210 @@
+#ifndef GIT_TREE_WALK_H
+#define GIT_TREE_WALK_H
+
+#include <git/config.h>
+#include <git/db/key_index.h>
+#include <git/obj/tree_view.h>
+#include <gtl/work_stealing_pool.hpp>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+GIT_HEADER_BEGIN
+GIT_NAMESPACE_BEGIN
+
+/** \ingroup ODB
+  * \brief Enumerates all entries of trees and their subtrees using multiple threads.
+  *
+  * Each tree is loaded by a task of a gtl::work_stealing_pool, which submits one task per subtree. Workers
+  * descend depth-first into the subtrees they found themselves, while idle workers steal subtrees close to
+  * the roots, hence all threads are kept busy even if the trees are very unbalanced.
+  *
+  * By default, each distinct tree is only expanded once, even if it is reachable from multiple roots or
+  * paths, which is what enumerating the objects of many snapshots requires. To obtain every path of a snapshot
+  * instead, disable unique trees.
+  *
+  * The database must support concurrent reads.
+  * \tparam ObjectDatabase any database providing accessors to objects by key
+  */
+template <class ObjectDatabase>
+class TreeWalker
+{
+public:
+	typedef ObjectDatabase								db_type;
+	typedef git_object_traits_base::key_type			key_type;
+	typedef git_object_traits_base::char_type			char_type;
+	typedef TreeView::mode_type							mode_type;
+	typedef std::vector<key_type>						key_vector_type;
+
+	/** Called with the path, mode and key of each entry. The path is relative to the root and separated
+	  * by '/'. It is called concurrently by all workers, and must be thread-safe
+	  */
+	typedef std::function<void(const std::string&, mode_type, const key_type&)>	callback_type;
+
+protected:
+	static const size_t num_shards = 64;
+
+	/** Part of the set of visited trees, keys are assigned to shards by their last byte
+	  */
+	struct visited_shard
+	{
+		std::mutex		mutex;
+		KeyIndex		keys;
+	};
+
+	/** State of one walk
+	  */
+	struct walk_state
+	{
+		const callback_type&		callback;
+		visited_shard				visited[num_shards];
+		std::atomic<size_t>			num_trees_read;
+		std::atomic<size_t>			num_entries;
+
+		explicit walk_state(const callback_type& callback)
+			: callback(callback)
+			, num_trees_read(0)
+			, num_entries(0)
+		{}
+	};
+
+protected:
+	const db_type&		m_db;
+	size_t				m_num_threads;
+	bool				m_unique_trees;
+	size_t				m_num_trees_read;
+	size_t				m_num_entries;
+
+	//! \return true if the given tree should be expanded, marking it visited
+	bool visit(walk_state& state, const key_type& key) const {
+		if (!m_unique_trees) {
+			return true;
+		}
+		visited_shard& shard = state.visited[key.bytes()[key_type::hash_len - 1] % num_shards];
+		bool inserted;
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		shard.keys.insert(key, inserted);
+		return inserted;
+	}
+
+	//! Read the given tree into the given buffer
+	//! \throw ObjectError if it is no tree, DeserializationError if it cannot be read
+	void load(const key_type& key, std::vector<char_type>& buf) const {
+		auto acc = m_db.object(key);
+		if (acc->type() != Object::Type::Tree) {
+			ObjectError err;
+			err.stream() << "object " << key << " is no tree";
+			throw err;
+		}
+		const size_t size = (size_t)acc->size();
+		buf.resize(size);
+		std::unique_ptr<typename db_type::output_object_type::stream_type> stream(acc->new_stream());
+		stream->read(buf.data(), size);
+		if ((size_t)stream->gcount() != size) {
+			DeserializationError err;
+			err.stream() << "tree " << key << " ended after " << stream->gcount() << " of " << size << " bytes";
+			throw err;
+		}
+	}
+
+	//! Emit all entries of the given tree, and submit a task for each subtree to expand
+	void walk_tree(gtl::work_stealing_pool& pool, walk_state& state, const key_type& key, const std::string& path) const {
+		static thread_local std::vector<char_type> buf;
+		load(key, buf);
+		++state.num_trees_read;
+
+		std::string entry_path(path);
+		if (!path.empty()) {
+			entry_path += '/';
+		}
+		const size_t prefix_len = entry_path.size();
+		size_t num_entries = 0;
+
+		const TreeView view(buf.data(), buf.size());
+		const auto end = view.end();
+		for (auto it = view.begin(); it != end; ++it, ++num_entries) {
+			entry_path.resize(prefix_len);
+			entry_path.append(it->name, it->name_len);
+			const key_type entry_key(it->key());
+			state.callback(entry_path, it->mode, entry_key);
+
+			if (it->is_tree() && visit(state, entry_key)) {
+				submit(pool, state, entry_key, entry_path);
+			}
+		}// for each entry
+		state.num_entries += num_entries;
+	}
+
+	void submit(gtl::work_stealing_pool& pool, walk_state& state, const key_type& key, const std::string& path) const {
+		gtl::work_stealing_pool* p = &pool;
+		walk_state* s = &state;
+		pool.submit([this, p, s, key, path]() {
+			walk_tree(*p, *s, key, path);
+		});
+	}
+
+public:
+	//! Initialize the walker to read trees from the given database, which must remain valid while we exist
+	//! \param num_threads amount of threads to load trees with
+	explicit TreeWalker(const db_type& db, size_t num_threads = gtl::work_stealing_pool::default_concurrency())
+		: m_db(db)
+		, m_num_threads(num_threads)
+		, m_unique_trees(true)
+		, m_num_trees_read(0)
+		, m_num_entries(0)
+	{}
+
+public:
+	//! If enabled, each distinct tree is expanded only once per walk, otherwise every path is enumerated
+	void set_unique_trees(bool unique_trees) {
+		m_unique_trees = unique_trees;
+	}
+
+	/** Call the given function for all entries of the given trees and of all of their subtrees, in no
+	  * particular order. Submodule commits are reported, but not followed.
+	  * \throw ObjectError if a key doesn't refer to a tree, gtl::odb_error if it doesn't exist, or
+	  * DeserializationError if a tree is corrupted, once all other trees were walked
+	  */
+	void walk(const key_vector_type& roots, const callback_type& callback) {
+		walk_state state(callback);
+		{
+			gtl::work_stealing_pool pool(m_num_threads);
+			const std::string path;
+			for (auto i = roots.begin(); i != roots.end(); ++i) {
+				if (visit(state, *i)) {
+					submit(pool, state, *i, path);
+				}
+			}
+			pool.wait();
+		}
+		m_num_trees_read = state.num_trees_read;
+		m_num_entries = state.num_entries;
+	}
+
+	//! Same as above, for a single tree
+	void walk(const key_type& root, const callback_type& callback) {
+		walk(key_vector_type(1, root), callback);
+	}
+
+	//! \return amount of trees read by the last walk
+	size_t num_trees_read() const {
+		return m_num_trees_read;
+	}
+
+	//! \return amount of entries reported by the last walk
+	size_t num_entries() const {
+		return m_num_entries;
+	}
+};
+
+template <class ObjectDatabase>
+const size_t TreeWalker<ObjectDatabase>::num_shards;
+
+GIT_NAMESPACE_END
+GIT_HEADER_END
+
+#endif // GIT_TREE_WALK_H
@@ -1,18 +1,122 @@
 #include <git/db/util.hpp>
-#include <git/obj/stream.h>
+
+#include <cstring>
 
 GIT_NAMESPACE_BEGIN
 
-namespace io = boost::iostreams;
+namespace
+{
+	struct TypeToken
+	{
+		const char*		token;
+		uchar			len;
+	};
+	
+	//! tokens indexed by object type
+	const TypeToken type_tokens[] = {
+		{ "none", 4 },
+		{ "blob", 4 },
+		{ "tree", 4 },
+		{ "commit", 6 },
+		{ "tag", 3 }
+	};
+	const size_t num_type_tokens = sizeof(type_tokens) / sizeof(type_tokens[0]);
+	const TypeToken unknown_type_token = { "unknown_object_type", 19 };
+	
+	inline const TypeToken& token_of(typename git_object_policy_traits::object_type type)
+	{
+		return (size_t)type < num_type_tokens ? type_tokens[(size_t)type] : unknown_type_token;
+	}
+}
+
+const char* type_token(typename git_object_policy_traits::object_type type)
+{
+	return token_of(type).token;
+}
+
+uchar type_token_len(typename git_object_policy_traits::object_type type)
+{
+	return token_of(type).len;
+}
+
+typename git_object_policy_traits::object_type parse_type_token(const typename git_object_policy_traits::char_type* token, 
+																size_t len)
+{
+	// the length and first character are enough to single out the only candidate
+	for (size_t i = 0; i < num_type_tokens; ++i) {
+		const TypeToken& t = type_tokens[i];
+		if (t.len == len && t.token[0] == token[0] && std::memcmp(t.token + 1, token + 1, len - 1) == 0) {
+			return (typename git_object_policy_traits::object_type)i;
+		}
+	}
+	return git_object_policy_traits::null_object_type;
+}
 
 uchar loose_object_header(	typename git_object_policy_traits::char_type* hdr, 
 							typename git_object_policy_traits::object_type type, 
 							typename git_object_policy_traits::size_type size)
 {
-	io::stream<io::basic_array_sink<typename git_object_policy_traits::char_type> > stream(hdr, hdr+32);
-	stream << type << ' ' << size << '\0';
+	const TypeToken& t = token_of(type);
+	std::memcpy(hdr, t.token, t.len);
+	uchar len = t.len;
+	hdr[len++] = ' ';
+	
+	// write digits in reverse order, then put them in place
+	char digits[20];
+	uchar num_digits = 0;
+	do {
+		digits[num_digits++] = (char)('0' + size % 10);
+		size /= 10;
+	} while (size);
+	while (num_digits) {
+		hdr[len++] = digits[--num_digits];
+	}
+	hdr[len++] = '\0';
+	
+	return len;
+}
+
+size_t parse_loose_object_header(	const typename git_object_policy_traits::char_type* hdr, size_t len,
+									typename git_object_policy_traits::object_type& type, 
+									typename git_object_policy_traits::size_type& size)
+{
+	typedef typename git_object_policy_traits::size_type size_type;
+	type = git_object_policy_traits::null_object_type;
+	
+	// empty files may pass a null header
+	if (!len) {
+		return 0;
+	}
+	const char* sep = static_cast<const char*>(std::memchr(hdr, ' ', len));
+	if (!sep) {
+		return 0;
+	}
+	const typename git_object_policy_traits::object_type parsed_type = parse_type_token(hdr, sep - hdr);
+	if (parsed_type == git_object_policy_traits::null_object_type) {
+		return 0;
+	}
+	
+	// decimal size without leading zeros, which must fit into size_type
+	const char* p = sep + 1;
+	const char* const end = hdr + len;
+	if (p == end || (uchar)(*p - '0') > 9 || (*p == '0' && p + 1 != end && p[1] != '\0')) {
+		return 0;
+	}
+	size_type parsed_size = 0;
+	for (; p != end && (uchar)(*p - '0') < 10; ++p) {
+		const size_type digit = *p - '0';
+		if (parsed_size > (~(size_type)0 - digit) / 10) {
+			return 0;
+		}
+		parsed_size = parsed_size * 10 + digit;
+	}
+	if (p == end || *p != '\0') {
+		return 0;
+	}
 	
-	return (uchar)stream.tellp();
+	type = parsed_type;
+	size = parsed_size;
+	return (p + 1) - hdr;
 }
 		
 GIT_NAMESPACE_END
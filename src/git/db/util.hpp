@@ -14,6 +14,23 @@ typedef std::basic_ostream<typename git_object_policy_traits::char_type> git_bas
 typedef std::basic_istream<typename git_object_policy_traits::char_type> git_basic_istream;
 //! @}
 
+//! @{ \name Object Type Tokens
+//! Conversion of object types from and to the names used in loose object headers and tags
+
+//! \return null-terminated name of the given type, like "blob", or "unknown_object_type" if the type is invalid
+const char* type_token(typename git_object_policy_traits::object_type type);
+
+//! \return amount of characters in the name of the given type, without the terminating \0
+uchar type_token_len(typename git_object_policy_traits::object_type type);
+
+//! \return type named by the given token, or the null object type if the token names no type
+//! \param token characters of the name, not required to be null-terminated
+//! \param len amount of characters in token
+typename git_object_policy_traits::object_type parse_type_token(const typename git_object_policy_traits::char_type* token, 
+																size_t len);
+
+//! @}
+
 //! Write a loose object header into the given memory pointer
 //! \param hdr character pointer with 32 bytes of allocated memory
 //! \param type the type of the object
@@ -23,6 +40,17 @@ uchar loose_object_header(	typename git_object_policy_traits::char_type* hdr,
 							typename git_object_policy_traits::object_type type, 
 							typename git_object_policy_traits::size_type size);
 
+//! Parse a loose object header as written by loose_object_header(), without allocating memory
+//! \param hdr buffer with the first bytes of the object
+//! \param len amount of bytes in hdr, which may contain more than just the header
+//! \param type set to the parsed type, or the null object type if the header is malformed
+//! \param size set to the parsed uncompressed object size
+//! \return amount of bytes belonging to the header, which includes the terminating \0, or 0 if the header
+//! is malformed or incomplete
+size_t parse_loose_object_header(	const typename git_object_policy_traits::char_type* hdr, size_t len,
+									typename git_object_policy_traits::object_type& type, 
+									typename git_object_policy_traits::size_type& size);
+
 GIT_NAMESPACE_END
 GIT_HEADER_END
 
@@ -0,0 +1,98 @@
+#include <git/obj/actor_table.h>
+#include <git/config.h>			// for doxygen
+#include <git/obj/stream.h>
+
+#include <cstring>
+
+GIT_NAMESPACE_BEGIN
+
+const ActorTable::handle_type ActorTable::null_handle;
+
+ActorTable::ActorTable()
+	: m_slots(64, null_handle)
+{}
+
+uint32 ActorTable::hash(const char_type* name, size_t name_len, const char_type* email, size_t email_len)
+{
+	// FNV-1a, with a separator to distinguish the name and email boundary
+	uint32 h = 2166136261u;
+	for (const char_type* end = name + name_len; name < end; ++name) {
+		h = (h ^ (uchar)*name) * 16777619u;
+	}
+	h = (h ^ (uchar)'<') * 16777619u;
+	for (const char_type* end = email + email_len; email < end; ++email) {
+		h = (h ^ (uchar)*email) * 16777619u;
+	}
+	return h;
+}
+
+void ActorTable::grow()
+{
+	m_slots.assign(m_slots.size() * 2, null_handle);
+	const size_t mask = m_slots.size() - 1;
+	for (handle_type handle = 0; handle < m_hashes.size(); ++handle) {
+		size_t slot = m_hashes[handle] & mask;
+		while (m_slots[slot] != null_handle) {
+			slot = (slot + 1) & mask;
+		}
+		m_slots[slot] = handle;
+	}
+}
+
+ActorTable::handle_type ActorTable::intern(const char_type* name, size_t name_len, const char_type* email, size_t email_len)
+{
+	const uint32 h = hash(name, name_len, email, email_len);
+	
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const size_t mask = m_slots.size() - 1;
+	size_t slot = h & mask;
+	for (; m_slots[slot] != null_handle; slot = (slot + 1) & mask) {
+		const handle_type handle = m_slots[slot];
+		if (m_hashes[handle] != h) {
+			continue;
+		}
+		const Actor& actor = m_actors[handle];
+		if (actor.name.size() == name_len && actor.email.size() == email_len &&
+			std::memcmp(actor.name.data(), name, name_len) == 0 &&
+			std::memcmp(actor.email.data(), email, email_len) == 0) 
+		{
+			return handle;
+		}
+	}// for each occupied slot
+	
+	const handle_type handle = (handle_type)m_actors.size();
+	m_actors.push_back(Actor());
+	m_actors.back().name.assign(name, name_len);
+	m_actors.back().email.assign(email, email_len);
+	m_hashes.push_back(h);
+	m_slots[slot] = handle;
+	
+	// keep the load factor below one half
+	if (m_actors.size() * 2 > m_slots.size()) {
+		grow();
+	}
+	return handle;
+}
+
+
+ActorDate InternedActorDate::resolve(const ActorTable& table) const
+{
+	ActorDate out;
+	static_cast<Actor&>(out) = table.actor(actor);
+	out.time = time;
+	out.tz_offset = tz_offset;
+	return out;
+}
+
+
+void parse_actor_date(const ActorTable::char_type* begin, const ActorTable::char_type* end, 
+                      ActorTable& table, InternedActorDate& inst)
+{
+	size_t name_len, email_len;
+	const ActorTable::char_type* email;
+	const ActorTable::char_type* email_end = parse_actor_identity(begin, end, name_len, email, email_len);
+	inst.actor = table.intern(begin, name_len, email, email_len);
+	parse_actor_time(email_end, end, inst.time, inst.tz_offset);
+}
+
+GIT_NAMESPACE_END
@@ -0,0 +1,111 @@
+#ifndef GIT_OBJ_ACTOR_TABLE_H
+#define GIT_OBJ_ACTOR_TABLE_H
+
+#include <git/config.h>
+#include <git/obj/object.hpp>
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+GIT_HEADER_BEGIN
+GIT_NAMESPACE_BEGIN
+
+/** \brief Table storing each distinct actor, that is each pair of name and email, exactly once.
+  *
+  * Actors are referred to by a small handle, which is assigned in the order in which actors are first
+  * interned. Two handles of the same table are equal exactly if the actors are equal, which makes comparisons
+  * as cheap as comparing integers. Interning an actor which is already known doesn't allocate any memory.
+  *
+  * All methods may be called concurrently, which allows sharing one table among multiple parsing threads.
+  * \note actors are never removed, hence the table grows with the amount of distinct identities, which
+  * is usually tiny compared to the amount of commits and tags referring to them.
+  */
+class ActorTable
+{
+public:
+	typedef git_object_traits_base::char_type		char_type;
+	typedef uint32									handle_type;
+	
+	//! handle which refers to no actor
+	static const handle_type null_handle = ~(handle_type)0;
+	
+protected:
+	mutable std::mutex			m_mutex;
+	std::deque<Actor>			m_actors;	//!< actors indexed by handle, elements never move
+	std::vector<uint32>			m_hashes;	//!< hash of each actor, indexed by handle
+	std::vector<handle_type>	m_slots;	//!< open addressing table of handles, its size is a power of two
+	
+	//! \return hash of the given identity
+	static uint32 hash(const char_type* name, size_t name_len, const char_type* email, size_t email_len);
+	
+	//! Double the amount of slots and reinsert all handles
+	void grow();
+	
+public:
+	ActorTable();
+	
+	ActorTable(const ActorTable&) = delete;
+	ActorTable& operator = (const ActorTable&) = delete;
+	
+public:
+	/** Intern the actor with the given name and email
+	  * \return handle of the actor, which is the same for all calls with equal name and email
+	  * \note the strings are not required to be null-terminated
+	  */
+	handle_type intern(const char_type* name, size_t name_len, const char_type* email, size_t email_len);
+	
+	//! Same as above, but takes an actor
+	handle_type intern(const Actor& actor) {
+		return intern(actor.name.data(), actor.name.size(), actor.email.data(), actor.email.size());
+	}
+	
+	//! \return actor with the given handle, which must have been returned by intern(). The reference remains valid
+	//! as long as we exist
+	const Actor& actor(handle_type handle) const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_actors[handle];
+	}
+	
+	//! \return amount of distinct actors
+	size_t size() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_actors.size();
+	}
+};
+
+
+/** \brief An ActorDate whose actor is stored in an ActorTable
+  */
+struct InternedActorDate
+{
+	ActorTable::handle_type		actor;			//!< handle of the actor in its table
+	time_t						time;			//!< seconds since epoch
+	TimezoneOffset				tz_offset;
+	
+	InternedActorDate()
+		: actor(ActorTable::null_handle)
+		, time(0)
+		, tz_offset(0)
+	{}
+	
+	//! \return true if both are equal, which is only meaningful if both refer to the same table
+	bool operator == (const InternedActorDate& rhs) const {
+		return actor == rhs.actor && time == rhs.time && tz_offset == rhs.tz_offset;
+	}
+	
+	//! \return copy of ourselves with the actor resolved from the given table
+	ActorDate resolve(const ActorTable& table) const;
+};
+
+
+/** Parse an actor line like parse_actor_date(), but intern its actor into the given table
+  * \throw DeserializationError if the line is malformed
+  */
+void parse_actor_date(const ActorTable::char_type* begin, const ActorTable::char_type* end, 
+                      ActorTable& table, InternedActorDate& inst);
+
+GIT_NAMESPACE_END
+GIT_HEADER_END
+
+#endif // GIT_OBJ_ACTOR_TABLE_H
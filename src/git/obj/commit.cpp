@@ -1,15 +1,12 @@
 #include "git/obj/commit.h"
 #include <git/config.h>			// for doxygen
+#include <git/obj/serializer.h>
 
-#include <boost/iostreams/device/back_inserter.hpp>
-#include <boost/iostreams/stream.hpp>
-#include <boost/iostreams/copy.hpp>
+#include <cstring>
 
 
 GIT_NAMESPACE_BEGIN
 		
-namespace io = boost::iostreams;
-
 const string Commit::default_encoding("UTF-8");
 		
 //! \cond
@@ -34,100 +31,121 @@ bool Commit::operator == (const Commit& rhs) const
 			m_parent_keys == rhs.m_parent_keys && 
 			m_committer == rhs.committer() &&
 			m_author == rhs.author() && 
-			m_message == rhs.message();
+			m_message == rhs.message() &&
+			m_extra_headers == rhs.extra_headers();
 }
-		
-git_basic_ostream& operator << (git_basic_ostream& stream, const Commit& inst) 
+
+static void throw_bad_header(const char* msg, const Commit::char_type* line, const Commit::char_type* line_end)
 {
-	// yes, all shas are written in hex
-	auto parent_end = inst.parent_keys().end();
-	
-	stream << t_tree << ' ' << inst.tree_key() << std::endl;
-	for (auto i = inst.parent_keys().begin(); i < parent_end; ++i) {
-		stream << t_parent << ' ' << *i << std::endl;
-	}
-	stream << t_author << ' ' << inst.author() << std::endl;
-	stream << t_committer << ' ' << inst.committer() << std::endl;
-	
-	if (inst.encoding() != Commit::default_encoding) {
-		stream << t_encoding << ' ' << inst.encoding() << std::endl;
+	DeserializationError err;
+	err.stream() << msg << ": " << string(line, line_end);
+	throw err;
+}
+
+static void parse_key(const Commit::char_type* line, const Commit::char_type* value, const Commit::char_type* line_end, 
+                      Commit::key_type& key)
+{
+	if (line_end - value != Commit::key_type::hash_len * 2 ||
+	    !gtl::decode_hex(value, Commit::key_type::hash_len, key.bytes())) {
+		throw_bad_header("invalid key", line, line_end);
 	}
-	
-	// single newline as message separator
-	stream << std::endl << inst.message();
-	
-	return stream;
 }
 
-git_basic_istream& operator >> (git_basic_istream& stream, Commit& inst) 
+void Commit::parse(const char_type* data, size_t size)
 {
-	string tmp;
-	tmp.reserve(32);
-	// used to skip single character - could use seek, but lets try to only use 
-	// simple gets as our own streams might not implement seeking
-	char c;
+	const char_type* p = data;
+	const char_type* const end = data + size;
+	bool has_tree = false;
+	bool has_author = false;
+	bool has_committer = false;
 	
-	// tree key
-	stream >> tmp;
-	if (tmp != t_tree) {
-		DeserializationError err;
-		err.stream() << "expected " << t_tree << ", got " << tmp;
-		throw err;
-	}
-	stream.get(c);			// space
-	stream >> inst.tree_key();
+	size_t num_extra_headers = 0;		// headers are overwritten to reuse their memory
 	
-	// parents
-	for (stream >> tmp; tmp == t_parent; stream >> tmp) {
-		Commit::key_type key;
-		stream.get(c);		// space
-		stream >> key;
-		inst.parent_keys().push_back(std::move(key));
-	}
+	m_parent_keys.clear();
+	m_encoding = default_encoding;
 	
-	// author
-	if (tmp != t_author) {
+	// headers, until the empty line separating the message
+	while (p < end && *p != '\n') {
+		const char_type* line_end = static_cast<const char_type*>(std::memchr(p, '\n', end - p));
+		if (!line_end) {
+			line_end = end;
+		}
+		const char_type* name_end = static_cast<const char_type*>(std::memchr(p, ' ', line_end - p));
+		if (!name_end) {
+			throw_bad_header("header without value", p, line_end);
+		}
+		const char_type* value = name_end + 1;
+		const size_t name_len = name_end - p;
+		
+		if (name_len == 6 && std::memcmp(p, "parent", 6) == 0) {
+			m_parent_keys.push_back(key_type());
+			parse_key(p, value, line_end, m_parent_keys.back());
+		} else if (name_len == 4 && std::memcmp(p, "tree", 4) == 0) {
+			parse_key(p, value, line_end, m_tree_key);
+			has_tree = true;
+		} else if (name_len == 6 && std::memcmp(p, "author", 6) == 0) {
+			parse_actor_date(value, line_end, m_author);
+			has_author = true;
+		} else if (name_len == 9 && std::memcmp(p, "committer", 9) == 0) {
+			parse_actor_date(value, line_end, m_committer);
+			has_committer = true;
+		} else if (name_len == 8 && std::memcmp(p, "encoding", 8) == 0) {
+			m_encoding.assign(value, line_end);
+		} else {
+			if (num_extra_headers == m_extra_headers.size()) {
+				m_extra_headers.push_back(Header());
+			}
+			Header& header = m_extra_headers[num_extra_headers++];
+			header.name.assign(p, name_end);
+			header.value.assign(value, line_end);
+			
+			// lines starting with a space continue the previous value
+			while (end - line_end > 1 && line_end[1] == ' ') {
+				value = line_end + 2;
+				line_end = static_cast<const char_type*>(std::memchr(value, '\n', end - value));
+				if (!line_end) {
+					line_end = end;
+				}
+				header.value += '\n';
+				header.value.append(value, line_end);
+			}
+		}
+		
+		p = line_end + (line_end < end);
+	}// for each header line
+	m_extra_headers.resize(num_extra_headers);
+	
+	if (!has_tree) {
 		DeserializationError err;
-		err.stream() << "expected " << t_author << ", got " << tmp;
+		err.stream() << "expected " << t_tree << " header";
 		throw err;
 	}
-	
-	// space
-	stream.get(c);
-	stream >> inst.author();
-	
-	// committer
-	stream >> tmp;
-	if (tmp != t_committer) {
+	if (!has_author || !has_committer) {
 		DeserializationError err;
-		err.stream() << "expected " << t_committer << ", got " << tmp;
+		err.stream() << "expected " << (has_author ? t_committer : t_author) << " header";
 		throw err;
 	}
 	
-	stream.get(c);				// space
-	stream >>inst.committer();
-	stream.get(c);				// newline
-	
-	// encoding
-	stream.get(c);				// indicator
-	if (c == 'e') {
-		stream >> tmp;
-		stream >> inst.encoding();
-		stream.get(c);			// newline after encoding
-		stream.get(c);			// newline to separate message
-	} else {
-		if (c != '\n') {
-			DeserializationError err;
-			err.stream() << "expected newline, got '" << c << "'";
-			throw err;
-		}
+	// skip the newline separating the message
+	if (p < end) {
+		++p;
 	}
-	
-	// message
-	// read until eof
-	io::stream<io::back_insert_device<string> > dest(inst.message());	
-	io::copy(stream, dest);
-	
+	m_message.assign(p, end);
+}
+		
+git_basic_ostream& operator << (git_basic_ostream& stream, const Commit& inst) 
+{
+	Serializer::buffer_type buf;
+	Serializer(buf).serialize(inst);
+	stream.write(buf.data(), buf.size());
+	return stream;
+}
+
+git_basic_istream& operator >> (git_basic_istream& stream, Commit& inst) 
+{
+	std::basic_string<Commit::char_type> buf;
+	read_remainder(stream, buf);
+	inst.parse(buf.data(), buf.size());
 	return stream;
 }
 
@@ -20,8 +20,22 @@ class Commit : public Object
 {
 public:
 	typedef typename git_object_traits_base::key_type		key_type;
+	typedef typename git_object_traits_base::char_type		char_type;
 	typedef std::vector<key_type>							key_vector_type;	//!< vector of keys
 	
+	/** A header which is kept, but not interpreted, like mergetag or gpgsig
+	  */
+	struct Header
+	{
+		string name;
+		string value;		//!< value without the indentation of continuation lines, which are separated by newlines
+		
+		bool operator == (const Header& rhs) const {
+			return name == rhs.name && value == rhs.value;
+		}
+	};
+	typedef std::vector<Header>								header_vector_type;
+	
 	static const string			default_encoding;	//!< encoding used if nothing else is specified
 	
 private:
@@ -31,6 +45,7 @@ private:
 	string						m_message;		//!< commit message
 	key_vector_type				m_parent_keys;	//!< zero or more parent keys
 	string						m_encoding;		//!< encoding used for the message and author data, defaults to utf8
+	header_vector_type			m_extra_headers;//!< headers written after all other headers
 	
 public:
     Commit();
@@ -40,6 +55,13 @@ public:
 	
 	bool operator == (const Commit&) const;
 	
+public:
+	/** Initialize this instance from the given serialized commit, replacing our previous contents.
+	  * The data is parsed in a single pass, without intermediate copies.
+	  * \throw DeserializationError if required headers are missing or malformed
+	  */
+	void parse(const char_type* data, size_t size);
+	
 public:
 	//! \return read-only key of the commit's tree
 	const key_type& tree_key() const {
@@ -100,6 +122,16 @@ public:
 	string& encoding() {
 		return m_encoding;
 	}
+	
+	//! \return read-only headers which have no dedicated accessor, in order of occurrence
+	const header_vector_type& extra_headers() const {
+		return m_extra_headers;
+	}
+	
+	//! \return modifyable headers which have no dedicated accessor
+	header_vector_type& extra_headers() {
+		return m_extra_headers;
+	}
 };
 
 git_basic_ostream& operator << (git_basic_ostream& stream, const Commit& inst);
@@ -0,0 +1,119 @@
+#include <git/obj/commit_header.h>
+#include <git/config.h>			// for doxygen
+
+#include <cstring>
+
+GIT_NAMESPACE_BEGIN
+
+//! \cond
+namespace
+{
+	typedef CommitHeader::char_type		char_type;
+	typedef CommitHeader::key_type		key_type;
+	
+	const size_t hex_len = key_type::hash_len * 2;
+	
+	void throw_missing(const char* name)
+	{
+		DeserializationError err;
+		err.stream() << "expected valid " << name << " header";
+		throw err;
+	}
+	
+	//! \return true if the line at p has the given header name, whose length is name_len and which includes the space
+	inline bool has_header(const char_type* p, const char_type* end, const char* name, size_t name_len)
+	{
+		return (size_t)(end - p) >= name_len && std::memcmp(p, name, name_len) == 0;
+	}
+	
+	//! Parse a key header at p, whose name has the given length including the space
+	//! \return start of the next line
+	const char_type* parse_key_line(const char_type* p, const char_type* end, size_t name_len, const char* name, key_type& key)
+	{
+		p += name_len;
+		if ((size_t)(end - p) < hex_len + 1 || p[hex_len] != '\n' || !gtl::decode_hex(p, key_type::hash_len, key.bytes())) {
+			throw_missing(name);
+		}
+		return p + hex_len + 1;
+	}
+}
+//! \endcond
+
+CommitHeader::CommitHeader()
+	: tree_key(key_type::null)
+	, time(0)
+	, tz_offset(0)
+	, author(ActorTable::null_handle)
+	, committer(ActorTable::null_handle)
+{}
+
+size_t CommitHeader::parse(const char_type* data, size_t size, ActorTable* actors)
+{
+	const char_type* p = data;
+	const char_type* const end = data + size;
+	
+	parent_keys.clear();
+	if (!has_header(p, end, "tree ", 5)) {
+		throw_missing("tree");
+	}
+	p = parse_key_line(p, end, 5, "tree", tree_key);
+	while (has_header(p, end, "parent ", 7)) {
+		parent_keys.push_back(key_type());
+		p = parse_key_line(p, end, 7, "parent", parent_keys.back());
+	}
+	
+	// skip the author, unless we intern it
+	if (!has_header(p, end, "author ", 7)) {
+		throw_missing("author");
+	}
+	const char_type* author_line = p + 7;
+	p = static_cast<const char_type*>(std::memchr(p, '\n', end - p));
+	if (!p) {
+		throw_missing("committer");
+	}
+	InternedActorDate actor;
+	if (actors) {
+		parse_actor_date(author_line, p, *actors, actor);
+	}
+	author = actor.actor;
+	
+	++p;
+	if (!has_header(p, end, "committer ", 10)) {
+		throw_missing("committer");
+	}
+	const char_type* line_end = static_cast<const char_type*>(std::memchr(p, '\n', end - p));
+	if (!line_end) {
+		line_end = end;
+	}
+	if (actors) {
+		parse_actor_date(p + 10, line_end, *actors, actor);
+		committer = actor.actor;
+		time = actor.time;
+		tz_offset = actor.tz_offset;
+	} else {
+		committer = ActorTable::null_handle;
+		parse_actor_time(p + 10, line_end, time, tz_offset);
+	}
+	
+	return line_end - data + (line_end < end);
+}
+
+
+LazyCommit::LazyCommit(const char_type* data, size_t size)
+	: m_data(data)
+	, m_size(size)
+{
+	m_header.parse(data, size);
+}
+
+const Commit& LazyCommit::commit() const
+{
+	if (!m_commit) {
+		std::unique_ptr<Commit> commit(new Commit);
+		commit->parse(m_data, m_size);
+		m_commit = std::move(commit);
+	}
+	return *m_commit;
+}
+
+GIT_NAMESPACE_END
@@ -0,0 +1,99 @@
+#ifndef GIT_OBJ_COMMIT_HEADER_H
+#define GIT_OBJ_COMMIT_HEADER_H
+
+#include <git/config.h>
+#include <git/obj/commit.h>
+#include <git/obj/actor_table.h>
+
+#include <memory>
+
+GIT_HEADER_BEGIN
+GIT_NAMESPACE_BEGIN
+
+/** \brief The parts of a commit required to traverse history.
+  *
+  * Parsing stops right after the committer line, hence the message and additional headers are skipped. Actors
+  * are only decoded if an ActorTable is given to intern them into.
+  * When reusing a single instance for many commits, no memory is allocated once the parent key vector
+  * has sufficient capacity.
+  */
+struct CommitHeader
+{
+	typedef Commit::key_type			key_type;
+	typedef Commit::key_vector_type		key_vector_type;
+	typedef Commit::char_type			char_type;
+	
+	key_type			tree_key;		//!< key of the commit's tree
+	key_vector_type		parent_keys;	//!< zero or more parent keys
+	time_t				time;			//!< time at which the commit was committed (seconds since epoch)
+	TimezoneOffset		tz_offset;		//!< timezone of the committer
+	ActorTable::handle_type		author;		//!< interned author, or null_handle if actors were not interned
+	ActorTable::handle_type		committer;	//!< interned committer, or null_handle if actors were not interned
+	
+	CommitHeader();
+	
+	/** Initialize our fields from the given serialized commit. The headers are expected in the order git 
+	  * writes them, that is tree, parents, author and committer.
+	  * \param actors if not null, author and committer are interned into the table
+	  * \return amount of bytes parsed, which is the offset of the line after the committer line
+	  * \throw DeserializationError if one of the parsed headers is missing or malformed
+	  */
+	size_t parse(const char_type* data, size_t size, ActorTable* actors = nullptr);
+};
+
+
+/** \brief A commit whose header is decoded right away, but whose remaining data is only decoded on demand.
+  *
+  * The serialized commit is not copied, and must remain valid and unchanged while the instance exists.
+  */
+class LazyCommit
+{
+public:
+	typedef CommitHeader::key_type			key_type;
+	typedef CommitHeader::key_vector_type	key_vector_type;
+	typedef CommitHeader::char_type			char_type;
+	
+protected:
+	const char_type*					m_data;
+	size_t								m_size;
+	CommitHeader						m_header;
+	mutable std::unique_ptr<Commit>		m_commit;	//!< fully decoded commit, if it was requested
+	
+public:
+	//! Decode the header of the given serialized commit
+	//! \throw DeserializationError if the header is malformed
+	LazyCommit(const char_type* data, size_t size);
+	
+public:
+	//! \return our decoded header
+	const CommitHeader& header() const {
+		return m_header;
+	}
+	
+	const key_type& tree_key() const {
+		return m_header.tree_key;
+	}
+	
+	const key_vector_type& parent_keys() const {
+		return m_header.parent_keys;
+	}
+	
+	//! \return committer time in seconds since epoch
+	time_t time() const {
+		return m_header.time;
+	}
+	
+	//! \return true if the full commit was decoded already
+	bool is_decoded() const {
+		return m_commit.get() != nullptr;
+	}
+	
+	//! \return fully decoded commit, which is decoded on the first call
+	//! \throw DeserializationError if the commit is malformed
+	const Commit& commit() const;
+};
+
+GIT_NAMESPACE_END
+GIT_HEADER_END
+
+#endif // GIT_OBJ_COMMIT_HEADER_H
@@ -0,0 +1,267 @@
+#include "git/obj/flat_tree.h"
+#include <git/config.h>		// for doxygen
+#include <git/obj/serializer.h>
+
+#include <algorithm>
+#include <vector>
+#include <cstring>
+
+GIT_NAMESPACE_BEGIN
+
+typedef FlatTree::char_type char_type;
+typedef FlatTree::mode_type mode_type;
+
+namespace
+{
+	//! \return amount of characters required to write the mode as octal number, without leading zeros
+	uint mode_digits(mode_type mode)
+	{
+		uint n = 1;
+		for (mode >>= 3; mode; mode >>= 3) {
+			++n;
+		}
+		return n;
+	}
+}
+
+FlatTree::FlatTree()
+	: Object(Object::Type::Tree)
+{}
+
+FlatTree::FlatTree(const TreeView& view)
+	: Object(Object::Type::Tree)
+{
+	assign(view);
+}
+
+void FlatTree::assign(const TreeView& view)
+{
+	clear();
+	// the names take less space than the whole tree, which allows to reserve memory for them upfront
+	m_names.reserve(view.size());
+	const auto end = view.end();
+	for (auto it = view.begin(); it != end; ++it) {
+		push_back(it->mode, it->name, it->name_len, it->key());
+	}
+	sort();
+}
+
+FlatTree::FlatTree(const Tree& tree)
+	: Object(Object::Type::Tree)
+{
+	size_t name_bytes = 0;
+	const auto end = tree.elements().end();
+	for (auto it = tree.elements().begin(); it != end; ++it) {
+		name_bytes += it->first.size();
+	}
+	reserve(tree.elements().size(), name_bytes);
+	for (auto it = tree.elements().begin(); it != end; ++it) {
+		push_back(it->second.mode, it->first.data(), it->first.size(), it->second.key);
+	}
+	sort();
+}
+
+bool FlatTree::operator == (const FlatTree& rhs) const
+{
+	if (m_entries.size() != rhs.m_entries.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < m_entries.size(); ++i) {
+		const Entry& l = m_entries[i];
+		const Entry& r = rhs.m_entries[i];
+		if (l.mode != r.mode || l.key != r.key || l.name_len != r.name_len || 
+			std::memcmp(name(l), rhs.name(r), l.name_len) != 0) 
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+int FlatTree::compare(const char_type* lname, size_t llen, bool ltree, const char_type* rname, size_t rlen, bool rtree)
+{
+	const size_t len = std::min(llen, rlen);
+	const int res = std::memcmp(lname, rname, len);
+	if (res != 0) {
+		return res;
+	}
+	// the first differing character, where the end of a tree's name counts as '/'
+	const uchar lc = llen > len ? (uchar)lname[len] : (ltree ? '/' : '\0');
+	const uchar rc = rlen > len ? (uchar)rname[len] : (rtree ? '/' : '\0');
+	if (lc == rc && llen == rlen) {
+		return 0;
+	}
+	// names which are equal up to the implicit slash differ by length
+	return lc != rc ? (int)lc - (int)rc : (llen < rlen ? -1 : 1);
+}
+
+size_t FlatTree::lower_bound(const char_type* name, size_t name_len, bool is_tree) const
+{
+	auto it = std::lower_bound(m_entries.begin(), m_entries.end(), 0, [this, name, name_len, is_tree](const Entry& e, int) {
+		return compare(this->name(e), e.name_len, e.is_tree(), name, name_len, is_tree) < 0;
+	});
+	return it - m_entries.begin();
+}
+
+FlatTree::const_iterator FlatTree::find(const char_type* name, size_t name_len) const
+{
+	// the entry sorts differently depending on whether it is a tree
+	for (uint t = 0; t < 2; ++t) {
+		const size_t i = lower_bound(name, name_len, t == 1);
+		if (i < m_entries.size() && m_entries[i].name_len == name_len && (m_entries[i].is_tree() == (t == 1)) &&
+			std::memcmp(this->name(m_entries[i]), name, name_len) == 0) 
+		{
+			return m_entries.begin() + i;
+		}
+	}
+	return m_entries.end();
+}
+
+Object::size_type FlatTree::size(git_basic_ostream* /*pstream*/) const
+{
+	size_type size = 0;
+	for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+		size += mode_digits(it->mode) + 1 + it->name_len + 1 + key_type::hash_len;
+	}
+	return size;
+}
+
+void FlatTree::reserve(size_t num_entries, size_t name_bytes)
+{
+	m_entries.reserve(m_entries.size() + num_entries);
+	m_names.reserve(m_names.size() + name_bytes);
+}
+
+void FlatTree::push_back(mode_type mode, const char_type* name, size_t name_len, const key_type& key)
+{
+	Entry e;
+	e.mode = mode;
+	e.name_offset = (uint32)m_names.size();
+	e.name_len = (uint32)name_len;
+	e.key = key;
+	m_names.append(name, name_len);
+	m_entries.push_back(e);
+}
+
+bool FlatTree::is_sorted() const
+{
+	// a file and a directory of the same name don't compare equal, and may be separated by entries whose
+	// names extend the file's name by characters sorting before '/'. Files which may still clash with a
+	// later directory are kept on a stack, each being a prefix of the ones above it, hence every entry is
+	// pushed and popped at most once
+	std::vector<const Entry*> files;
+	for (size_t i = 0; i < m_entries.size(); ++i) {
+		const Entry& r = m_entries[i];
+		if (i) {
+			const Entry& l = m_entries[i-1];
+			if (compare(name(l), l.name_len, l.is_tree(), name(r), r.name_len, r.is_tree()) >= 0) {
+				return false;
+			}
+		}
+		while (!files.empty()) {
+			const Entry& f = *files.back();
+			if (r.name_len >= f.name_len && std::memcmp(name(f), name(r), f.name_len) == 0) {
+				if (r.name_len == f.name_len) {
+					return false;
+				}
+				if ((uchar)name(r)[f.name_len] < '/') {
+					break;
+				}
+			}
+			files.pop_back();
+		}
+		if (!r.is_tree()) {
+			files.push_back(&r);
+		}
+	}
+	return true;
+}
+
+void FlatTree::sort()
+{
+	// serialized trees are usually in order already
+	if (is_sorted()) {
+		return;
+	}
+	
+	// drop duplicate names first, keeping the last one added. This requires plain name order, as 
+	// names differing in whether they are a tree sort differently in tree order
+	std::stable_sort(m_entries.begin(), m_entries.end(), [this](const Entry& l, const Entry& r) {
+		const int res = std::memcmp(name(l), name(r), std::min(l.name_len, r.name_len));
+		return res < 0 || (res == 0 && l.name_len < r.name_len);
+	});
+	auto last = std::unique(m_entries.rbegin(), m_entries.rend(), [this](const Entry& l, const Entry& r) {
+		return l.name_len == r.name_len && std::memcmp(name(l), name(r), l.name_len) == 0;
+	});
+	m_entries.erase(m_entries.begin(), m_entries.begin() + (m_entries.rend() - last));
+	
+	std::stable_sort(m_entries.begin(), m_entries.end(), [this](const Entry& l, const Entry& r) {
+		return compare(name(l), l.name_len, l.is_tree(), name(r), r.name_len, r.is_tree()) < 0;
+	});
+}
+
+void FlatTree::insert(mode_type mode, const std::string& name, const key_type& key)
+{
+	const bool is_tree = (mode & TreeView::mode_mask) == TreeView::mode_tree;
+	Entry e;
+	e.mode = mode;
+	e.name_len = (uint32)name.size();
+	e.key = key;
+	
+	const const_iterator it = find(name);
+	if (it != m_entries.end()) {
+		// reuse the existing name, and keep the position unless the entry changes its kind
+		e.name_offset = it->name_offset;
+		const size_t i = it - m_entries.begin();
+		if (it->is_tree() == is_tree) {
+			m_entries[i] = e;
+			return;
+		}
+		m_entries.erase(m_entries.begin() + i);
+	} else {
+		e.name_offset = (uint32)m_names.size();
+		m_names.append(name);
+	}
+	m_entries.insert(m_entries.begin() + lower_bound(name.data(), name.size(), is_tree), e);
+}
+
+bool FlatTree::erase(const std::string& name)
+{
+	const const_iterator it = find(name);
+	if (it == m_entries.end()) {
+		return false;
+	}
+	m_entries.erase(m_entries.begin() + (it - m_entries.begin()));
+	return true;
+}
+
+void FlatTree::clear()
+{
+	m_entries.clear();
+	m_names.clear();
+}
+
+git_basic_ostream& operator << (git_basic_ostream& stream, const FlatTree& inst)
+{
+	Serializer::buffer_type buf;
+	Serializer(buf).serialize(inst);
+	stream.write(buf.data(), buf.size());
+	return stream;
+}
+
+git_basic_istream& operator >> (git_basic_istream& stream, FlatTree& inst)
+{
+	std::basic_string<char_type> buf;
+	read_remainder(stream, buf);
+	
+	inst.assign(TreeView(buf.data(), buf.size()));
+	if (inst.empty()) {
+		DeserializationError err;
+		err.stream() << "Couldn't deserialize any tree element";
+		throw err;
+	}
+	return stream;
+}
+
+
+GIT_NAMESPACE_END
@@ -0,0 +1,163 @@
+#ifndef GIT_OBJ_FLAT_TREE_H
+#define GIT_OBJ_FLAT_TREE_H
+
+#include <git/obj/object.hpp>
+#include <git/obj/stream.h>
+#include <git/obj/tree.h>
+#include <git/obj/tree_view.h>
+
+#include <string>
+#include <vector>
+
+GIT_HEADER_BEGIN
+GIT_NAMESPACE_BEGIN
+
+/** \brief Represents the contents of a directory, using a compact representation.
+  *
+  * Entries are kept in a vector, sorted in git's tree order, which compares names bytewise as if the names
+  * of trees had a trailing '/'. All names are stored in one shared buffer. Lookups use binary search.
+  *
+  * Trees can be built in bulk by appending entries in any order using push_back(), followed by a call to sort().
+  * Serialization writes the entries in one pass, in the order git requires.
+  * \note compared to a Tree, this type uses a fraction of the memory per entry, but modifications other than
+  * appending are linear in the amount of entries.
+  */
+class FlatTree : public Object
+{
+public:
+	typedef TreeView::key_type					key_type;
+	typedef TreeView::char_type					char_type;
+	typedef TreeView::mode_type					mode_type;
+
+	/** A single entry of the tree
+	  */
+	struct Entry
+	{
+		mode_type	mode;			//!< stat compatible mode
+		uint32		name_offset;	//!< offset of our name in the name buffer of our tree
+		uint32		name_len;		//!< amount of characters in our name
+		key_type	key;			//!< key identifying the corresponding database object
+
+		//! \return true if the entry is a tree
+		bool is_tree() const {
+			return (mode & TreeView::mode_mask) == TreeView::mode_tree;
+		}
+	};
+
+	typedef std::vector<Entry>					entry_vector_type;
+	typedef entry_vector_type::const_iterator	const_iterator;
+
+protected:
+	entry_vector_type	m_entries;		//!< entries in tree order, unless we are being built
+	std::string			m_names;		//!< names of all entries, without separator
+
+	//! \return index of the entry with the given name and kind, or the amount of entries
+	size_t lower_bound(const char_type* name, size_t name_len, bool is_tree) const;
+	
+	//! \return true if our entries are in tree order, without duplicates
+	bool is_sorted() const;
+
+public:
+	FlatTree();
+
+	//! Initialize our entries from the given view, which is expected to be in tree order
+	//! \throw DeserializationError if the view is corrupted
+	explicit FlatTree(const TreeView& view);
+
+	//! Initialize our entries from the given tree
+	explicit FlatTree(const Tree& tree);
+
+	//! \return true if both trees have equal entries
+	bool operator == (const FlatTree& rhs) const;
+
+public:
+	/** Compare names using git's tree order
+	  * \return value smaller than, equal to or larger than 0 if the left name sorts before, equal to
+	  * or after the right one
+	  */
+	static int compare(const char_type* lname, size_t llen, bool ltree,
+					   const char_type* rname, size_t rlen, bool rtree);
+
+public:
+	//! @{ \name Access
+
+	//! \return amount of entries
+	size_t num_entries() const {
+		return m_entries.size();
+	}
+
+	//! \return true if there are no entries
+	bool empty() const {
+		return m_entries.empty();
+	}
+
+	const_iterator begin() const {
+		return m_entries.begin();
+	}
+
+	const_iterator end() const {
+		return m_entries.end();
+	}
+
+	//! \return pointer to the first character of the name of the given entry, it is not null-terminated
+	const char_type* name(const Entry& entry) const {
+		return m_names.data() + entry.name_offset;
+	}
+
+	//! \return copy of the name of the given entry
+	std::string name_string(const Entry& entry) const {
+		return std::string(name(entry), entry.name_len);
+	}
+
+	//! \return entry with the given name, or end() if there is none
+	const_iterator find(const char_type* name, size_t name_len) const;
+
+	//! Same as above, but takes a string
+	const_iterator find(const std::string& name) const {
+		return find(name.data(), name.size());
+	}
+
+	//! \return size of our serialized version in bytes, which is computed without serializing
+	//! \param pstream ignored, exists for compatibility with Object::size()
+	size_type size(git_basic_ostream* pstream = nullptr) const;
+
+	//! @}
+
+	//! @{ \name Modification
+
+	//! Prepare the addition of the given amount of entries, with the given total amount of name characters
+	void reserve(size_t num_entries, size_t name_bytes);
+
+	//! Append an entry, without maintaining the tree order. Call sort() once all entries were added
+	void push_back(mode_type mode, const char_type* name, size_t name_len, const key_type& key);
+
+	//! Restore tree order after entries were appended with push_back(). If multiple entries have the same
+	//! name, the one added last is kept
+	void sort();
+
+	//! Insert the given entry at its position, or replace the mode and key of an existing entry of the same name.
+	//! Replacing an entry reuses its name, hence it doesn't grow the name buffer
+	void insert(mode_type mode, const std::string& name, const key_type& key);
+
+	//! Remove the entry with the given name. Its name remains in the name buffer until clear() is called
+	//! \return true if it existed
+	bool erase(const std::string& name);
+
+	//! Remove all entries. The memory is kept to be reused by subsequent additions
+	void clear();
+	
+	//! Replace our entries with the ones of the given view, reusing our memory
+	//! \throw DeserializationError if the view is corrupted
+	void assign(const TreeView& view);
+
+	//! @}
+};
+
+
+git_basic_ostream& operator << (git_basic_ostream& stream, const FlatTree& inst);
+git_basic_istream& operator >> (git_basic_istream& stream, FlatTree& inst);
+
+GIT_NAMESPACE_END
+GIT_HEADER_END
+
+#endif // GIT_OBJ_FLAT_TREE_H
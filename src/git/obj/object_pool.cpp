@@ -0,0 +1,63 @@
+#include <git/obj/object_pool.h>
+#include <git/config.h>			// for doxygen
+
+GIT_NAMESPACE_BEGIN
+
+ObjectPool::ObjectPool()
+{}
+
+void ObjectPool::read(std::istream& stream, size_t size)
+{
+	m_data.resize(size);
+	std::streamsize nread = 0;
+	try {
+		stream.read(m_data.data(), size);
+		nread = stream.gcount();
+	} catch (std::ios_base::failure&) {
+		// It depends on the configuration whether reaching the end throws
+		nread = stream.gcount();
+	}
+	
+	if ((size_t)nread != size) {
+		DeserializationError err;
+		err.stream() << "object stream ended after " << nread << " of " << size << " bytes";
+		throw err;
+	}
+}
+
+Object::Type ObjectPool::deserialize(Object::Type type, const char_type* data, size_t size)
+{
+	switch(type)
+	{
+	case Object::Type::Blob:
+	{
+		m_blob.data().assign(data, data + size);
+		break;
+	}
+	case Object::Type::Commit:
+	{
+		m_commit.parse(data, size);
+		break;
+	}
+	case Object::Type::Tree:
+	{
+		m_tree.assign(TreeView(data, size));
+		break;
+	}
+	case Object::Type::Tag:
+	{
+		m_tag.parse(data, size);
+		break;
+	}
+	default:
+	{
+		DeserializationError err;
+		err.stream() << "invalid object type given for deserialization: " << type;
+		throw err;
+	}
+	}// end type switch
+	
+	return type;
+}
+
+GIT_NAMESPACE_END
@@ -0,0 +1,94 @@
+#ifndef GIT_OBJ_OBJECT_POOL_H
+#define GIT_OBJ_OBJECT_POOL_H
+
+#include <git/config.h>
+#include <git/obj/blob.h>
+#include <git/obj/commit.h>
+#include <git/obj/flat_tree.h>
+#include <git/obj/tag.h>
+
+#include <memory>
+#include <vector>
+
+GIT_HEADER_BEGIN
+GIT_NAMESPACE_BEGIN
+
+/** \brief Reusable context to deserialize many objects in a row, keeping all memory between calls.
+  *
+  * There is one object per type, which is overwritten by each deserialization of an object of that type. As
+  * the objects reuse their strings and vectors, deserializing objects of similar sizes reaches a steady state
+  * in which no memory is allocated. In contrast, deserializing into a MultiObject allocates everything anew.
+  *
+  * Trees are deserialized into a FlatTree, as the nodes of the map of a Tree cannot be reused.
+  * \note objects returned by reference remain valid until the next object of the same type is deserialized
+  */
+class ObjectPool
+{
+public:
+	typedef git_object_traits_base::char_type		char_type;
+	typedef std::vector<char_type>					buffer_type;
+	
+protected:
+	buffer_type		m_data;		//!< serialized data of the last object read from a stream
+	Blob			m_blob;
+	Commit			m_commit;
+	FlatTree		m_tree;
+	Tag				m_tag;
+	
+	//! Read all data of the given stream into m_data
+	//! \throw DeserializationError if the stream doesn't provide size bytes
+	void read(std::istream& stream, size_t size);
+	
+public:
+	ObjectPool();
+	
+public:
+	/** Deserialize the given serialized object into the object of its type
+	  * \return type of the deserialized object, whose instance can be obtained with the respective accessor
+	  * \throw DeserializationError
+	  */
+	Object::Type deserialize(Object::Type type, const char_type* data, size_t size);
+	
+	/** Same as above, but reads the data of an output object of a database.
+	  * \note the stream of the object is allocated by the database, use the overload taking data 
+	  * along with buffer() to avoid that, like with data decompressed from packs.
+	  */
+	template <class OutputObject>
+	Object::Type deserialize(const OutputObject& object) {
+		const Object::Type type = object.type();
+		const size_t size = (size_t)object.size();
+		std::unique_ptr<typename OutputObject::stream_type> stream(object.new_stream());
+		read(*stream, size);
+		return deserialize(type, m_data.data(), size);
+	}
+	
+	//! \return buffer which may be used to hold serialized data before it is deserialized
+	buffer_type& buffer() {
+		return m_data;
+	}
+	
+	//! @{ \name Objects
+	
+	const Blob& blob() const {
+		return m_blob;
+	}
+	
+	const Commit& commit() const {
+		return m_commit;
+	}
+	
+	const FlatTree& tree() const {
+		return m_tree;
+	}
+	
+	const Tag& tag() const {
+		return m_tag;
+	}
+	
+	//! @}
+};
+
+GIT_NAMESPACE_END
+GIT_HEADER_END
+
+#endif // GIT_OBJ_OBJECT_POOL_H
@@ -0,0 +1,211 @@
+#include <git/obj/serializer.h>
+#include <git/config.h>			// for doxygen
+
+#include <git/obj/blob.h>
+#include <git/obj/commit.h>
+#include <git/obj/tag.h>
+#include <git/obj/tree.h>
+#include <git/obj/flat_tree.h>
+
+GIT_NAMESPACE_BEGIN
+
+void Serializer::write_hex(const key_type& key)
+{
+	static const char digits[] = "0123456789abcdef";
+	const size_t ofs = m_buf.size();
+	m_buf.resize(ofs + key_type::hash_len * 2);
+	char_type* out = &m_buf[ofs];
+	for (const char_type* b = key.bytes(), *end = b + key_type::hash_len; b < end; ++b) {
+		*out++ = digits[((uchar)*b) >> 4];
+		*out++ = digits[((uchar)*b) & 0x0F];
+	}
+}
+
+void Serializer::write_uint(uint64_t value)
+{
+	char_type buf[20];
+	char_type* p = buf + sizeof(buf);
+	do {
+		*--p = (char_type)('0' + value % 10);
+		value /= 10;
+	} while (value);
+	write(p, buf + sizeof(buf) - p);
+}
+
+void Serializer::write_mode(uint32 mode)
+{
+	char_type buf[11];
+	char_type* p = buf + sizeof(buf);
+	do {
+		*--p = (char_type)('0' + (mode & 7));
+		mode >>= 3;
+	} while (mode);
+	write(p, buf + sizeof(buf) - p);
+}
+
+void Serializer::serialize(const Actor& actor)
+{
+	if (actor.name.size() == 0){
+		DeserializationError err;
+		err.stream() << "Actor's name was not set";
+		throw err;
+	}
+	write(actor.name);
+	put(' ');
+	put('<');
+	write(actor.email);
+	put('>');
+}
+
+void Serializer::serialize(const TimezoneOffset& offset)
+{
+	int value = offset.utz_offset;
+	put(value < 0 ? '-' : '+');
+	if (value < 0) {
+		value = -value;
+	}
+	
+	// at least 4 digits, padded with zeros
+	char_type buf[8];
+	char_type* p = buf + sizeof(buf);
+	for (int n = 0; n < 4 || value; ++n) {
+		*--p = (char_type)('0' + value % 10);
+		value /= 10;
+	}
+	write(p, buf + sizeof(buf) - p);
+}
+
+void Serializer::serialize(const ActorDate& actor)
+{
+	serialize(static_cast<const Actor&>(actor));
+	put(' ');
+	if (actor.time < 0) {
+		put('-');
+	}
+	write_uint(actor.time < 0 ? -(uint64_t)actor.time : (uint64_t)actor.time);
+	put(' ');
+	serialize(actor.tz_offset);
+}
+
+void Serializer::serialize(const Blob& blob)
+{
+	write(blob.data().data(), blob.data().size());
+}
+
+void Serializer::serialize(const Commit& commit)
+{
+	static const char t_tree[] = "tree ";
+	static const char t_parent[] = "parent ";
+	static const char t_author[] = "author ";
+	static const char t_committer[] = "committer ";
+	static const char t_encoding[] = "encoding ";
+	
+	write(t_tree, sizeof(t_tree) - 1);
+	write_hex(commit.tree_key());
+	put('\n');
+	for (auto i = commit.parent_keys().begin(); i != commit.parent_keys().end(); ++i) {
+		write(t_parent, sizeof(t_parent) - 1);
+		write_hex(*i);
+		put('\n');
+	}
+	write(t_author, sizeof(t_author) - 1);
+	serialize(commit.author());
+	put('\n');
+	write(t_committer, sizeof(t_committer) - 1);
+	serialize(commit.committer());
+	put('\n');
+	
+	if (commit.encoding() != Commit::default_encoding) {
+		write(t_encoding, sizeof(t_encoding) - 1);
+		write(commit.encoding());
+		put('\n');
+	}
+	
+	// continuation lines are indented by a single space
+	for (auto i = commit.extra_headers().begin(); i != commit.extra_headers().end(); ++i) {
+		write(i->name);
+		put(' ');
+		for (auto c = i->value.begin(); c != i->value.end(); ++c) {
+			put(*c);
+			if (*c == '\n') {
+				put(' ');
+			}
+		}
+		put('\n');
+	}
+	
+	// single newline as message separator
+	put('\n');
+	write(commit.message());
+}
+
+void Serializer::serialize(const Tag& tag)
+{
+	static const char t_object[] = "object ";
+	static const char t_type[] = "type ";
+	static const char t_tag[] = "tag ";
+	static const char t_tagger[] = "tagger ";
+	
+	write(t_object, sizeof(t_object) - 1);
+	write_hex(tag.object_key());
+	put('\n');
+	write(t_type, sizeof(t_type) - 1);
+	write(type_token(tag.object_type()), type_token_len(tag.object_type()));
+	put('\n');
+	write(t_tag, sizeof(t_tag) - 1);
+	write(tag.name());
+	put('\n');
+	write(t_tagger, sizeof(t_tagger) - 1);
+	serialize(tag.actor());
+	put('\n');
+	
+	// empty line only given if we have a message
+	if (tag.message().size()) {
+		put('\n');
+		write(tag.message());
+	}
+}
+
+void Serializer::serialize(const Tree& tree)
+{
+	const auto end = tree.elements().end();
+	for (auto i = tree.elements().begin(); i != end; ++i) {
+		write_mode(i->second.mode);
+		put(' ');
+		write(i->first);
+		put('\0');
+		write(i->second.key.bytes(), key_type::hash_len);
+	}
+}
+
+void Serializer::serialize(const FlatTree& tree)
+{
+	m_buf.reserve(m_buf.size() + tree.size());
+	const auto end = tree.end();
+	for (auto it = tree.begin(); it != end; ++it) {
+		write_mode(it->mode);
+		put(' ');
+		write(tree.name(*it), it->name_len);
+		put('\0');
+		write(it->key.bytes(), key_type::hash_len);
+	}
+}
+
+void Serializer::serialize(const Object& object)
+{
+	switch(object.type())
+	{
+		case Object::Type::Blob: { serialize(static_cast<const Blob&>(object)); break; }
+		case Object::Type::Commit: { serialize(static_cast<const Commit&>(object)); break; }
+		case Object::Type::Tree: { serialize(static_cast<const Tree&>(object)); break; }
+		case Object::Type::Tag: { serialize(static_cast<const Tag&>(object)); break; }
+		default:
+		{
+			SerializationError err;
+			err.stream() << "invalid object type given for serialization: " << object.type();
+			throw err;
+		}
+	}// end type switch
+}
+
+GIT_NAMESPACE_END
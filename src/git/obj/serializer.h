@@ -0,0 +1,87 @@
+#ifndef GIT_OBJ_SERIALIZER_H
+#define GIT_OBJ_SERIALIZER_H
+
+#include <git/config.h>
+#include <git/obj/object.hpp>
+
+#include <string>
+#include <vector>
+
+GIT_HEADER_BEGIN
+GIT_NAMESPACE_BEGIN
+
+class Blob;
+class Commit;
+class Tag;
+class Tree;
+class FlatTree;
+
+/** \brief Serializes objects by appending them to a growable byte buffer, without using iostreams.
+  *
+  * The output is identical to the one of the respective stream operators, but each token is written directly
+  * into the buffer, and integers are formatted without printf.
+  */
+class Serializer
+{
+public:
+	typedef git_object_policy_traits::char_type		char_type;
+	typedef git_object_traits_base::key_type		key_type;
+	typedef std::vector<char_type>					buffer_type;
+	
+protected:
+	buffer_type&	m_buf;
+	
+public:
+	//! Initialize the instance to append to the given buffer, which must remain valid while we exist
+	explicit Serializer(buffer_type& buf)
+		: m_buf(buf)
+	{}
+	
+public:
+	//! @{ \name Primitives
+	
+	void put(char_type c) {
+		m_buf.push_back(c);
+	}
+	
+	void write(const char_type* data, size_t len) {
+		m_buf.insert(m_buf.end(), data, data + len);
+	}
+	
+	void write(const std::string& str) {
+		write(str.data(), str.size());
+	}
+	
+	//! Write the lower case hexadecimal representation of the given key
+	void write_hex(const key_type& key);
+	
+	//! Write the given value as decimal number
+	void write_uint(uint64_t value);
+	
+	//! Write the given mode as octal number, without leading zeros
+	void write_mode(uint32 mode);
+	
+	//! @}
+	
+	//! @{ \name Objects
+	
+	void serialize(const Actor& actor);
+	void serialize(const TimezoneOffset& offset);
+	void serialize(const ActorDate& actor);
+	void serialize(const Blob& blob);
+	void serialize(const Commit& commit);
+	void serialize(const Tag& tag);
+	void serialize(const Tree& tree);
+	void serialize(const FlatTree& tree);
+	
+	//! Serialize the given object according to its type, which must not be None
+	//! \throw SerializationError if the type is unknown
+	void serialize(const Object& object);
+	
+	//! @}
+};
+
+GIT_NAMESPACE_END
+GIT_HEADER_END
+
+#endif // GIT_OBJ_SERIALIZER_H
@@ -1,7 +1,9 @@
 #include <git/obj/stream.h>
 #include <git/config.h>
+#include <git/obj/serializer.h>
 
-#include <cstdio>
+#include <cstring>
+#include <locale>
 #include <assert.h>
 #include <string>
 
@@ -9,74 +11,45 @@ GIT_NAMESPACE_BEGIN
 
 git_basic_istream& operator >> (git_basic_istream& stream, Object::Type& type) 
 {
-	std::string s;
-	stream >> s;
-	if (s.size() < 3) {
-		type = Object::Type::None;
-		return stream;
-	}
-	
-	if (s == "none") {
-		type = Object::Type::None;
-	} else if (s == "blob") {
-		type = Object::Type::Blob;
-	} else if(s == "tree") {
-		type = Object::Type::Tree;
-	} else if(s == "commit") {
-		type = Object::Type::Commit;
-	} else if(s == "tag") {
-		type = Object::Type::Tag;
-	}
-	return stream;
-}
-
-git_basic_ostream& operator << (git_basic_ostream& stream, Object::Type type) 
-{
-	switch(type)
-	{
-		case Object::Type::None:
-			{
-				stream << "none";
+	// read the whitespace separated token, only keeping as many characters as the longest type name has
+	git_basic_istream::char_type token[8];
+	size_t len = 0;
+	const git_basic_istream::sentry ok(stream);
+	if (ok) {
+		typedef git_basic_istream::traits_type traits_type;
+		auto* buf = stream.rdbuf();
+		for (auto c = buf->sgetc(); ; c = buf->snextc()) {
+			if (traits_type::eq_int_type(c, traits_type::eof())) {
+				stream.setstate(std::ios_base::eofbit);
 				break;
 			}
-		case Object::Type::Blob:
-			{
-				stream << "blob";
+			if (std::isspace(traits_type::to_char_type(c), stream.getloc())) {
 				break;
 			}
-		case Object::Type::Tree:
-			{
-				stream << "tree";
-				break;
-			}
-		case Object::Type::Commit:
-			{
-				stream << "commit";
-				break;
-			}
-		case Object::Type::Tag:
-			{
-				stream << "tag";
-				break;
-			}
-		default:
-			{
-				stream << "unknown_object_type";
-				break;
+			if (len < sizeof(token)) {
+				token[len] = traits_type::to_char_type(c);
 			}
-	}// end type switch
+			++len;
+		}
+	}
+	if (len == 0) {
+		stream.setstate(std::ios_base::failbit);
+	}
 	
+	type = len <= sizeof(token) ? parse_type_token(token, len) : Object::Type::None;
 	return stream;
 }
 
+git_basic_ostream& operator << (git_basic_ostream& stream, Object::Type type) 
+{
+	return stream.write(type_token(type), type_token_len(type));
+}
+
 git_basic_ostream& operator << (git_basic_ostream& stream, const Actor& inst)
 {
-	if (inst.name.size() == 0){
-		DeserializationError err;
-		err.stream() << "Actor's name was not set";
-		throw err;
-	}
-	stream << inst.name << " <" << inst.email << '>';
+	Serializer::buffer_type buf;
+	Serializer(buf).serialize(inst);
+	stream.write(buf.data(), buf.size());
 	return stream;
 }
 
@@ -100,8 +73,10 @@ git_basic_istream& operator >> (git_basic_istream& stream, Actor& inst)
 
 git_basic_ostream& operator << (git_basic_ostream& stream, const ActorDate& inst)
 {
-	stream << static_cast<const Actor&>(inst);
-	return stream << ' ' << inst.time << ' ' << inst.tz_offset;
+	Serializer::buffer_type buf;
+	Serializer(buf).serialize(inst);
+	stream.write(buf.data(), buf.size());
+	return stream;
 }
 
 git_basic_istream& operator >> (git_basic_istream& stream, ActorDate& inst)
@@ -112,15 +87,10 @@ git_basic_istream& operator >> (git_basic_istream& stream, ActorDate& inst)
 
 git_basic_ostream& operator << (git_basic_ostream& stream, const TimezoneOffset& inst)
 {
-	char buf[17];
-	std::sprintf(buf, "%04i", std::abs((int)inst.utz_offset));
-	if (inst.utz_offset < 0){
-		stream << '-';
-	} else {
-		stream << '+';
-	}
-	
-	return stream << buf;
+	Serializer::buffer_type buf;
+	Serializer(buf).serialize(inst);
+	stream.write(buf.data(), buf.size());
+	return stream;
 }
 
 git_basic_istream& operator >> (git_basic_istream& stream, TimezoneOffset& inst)
@@ -134,5 +104,101 @@ git_basic_istream& operator >> (git_basic_istream& stream, TimezoneOffset& inst)
 	return stream;
 }
 
+void read_remainder(git_basic_istream& stream, std::basic_string<git_object_policy_traits::char_type>& buf)
+{
+	git_object_policy_traits::char_type chunk[4096];
+	try {
+		while (stream.read(chunk, sizeof(chunk)), stream.gcount() > 0) {
+			buf.append(chunk, stream.gcount());
+		}
+	} catch (std::ios_base::failure&) {
+		// It depends on the configuration whether reaching the end throws
+		buf.append(chunk, stream.gcount());
+	}
+}
+
+//! \cond
+static void throw_bad_actor(const char* msg, const char* begin, const char* end)
+{
+	DeserializationError err;
+	err.stream() << msg << " in actor line: " << std::string(begin, end);
+	throw err;
+}
+//! \endcond
+
+void parse_actor_time(const git_object_policy_traits::char_type* begin, const git_object_policy_traits::char_type* end, 
+                      time_t& time, TimezoneOffset& tz_offset)
+{
+	typedef git_object_policy_traits::char_type char_type;
+	
+	const char_type* p = static_cast<const char_type*>(std::memchr(begin, '>', end - begin));
+	if (!p) {
+		throw_bad_actor("Unterminated email", begin, end);
+	}
+	
+	// time, which is negative for dates before the epoch
+	for (++p; p < end && *p == ' '; ++p);
+	const bool negative_time = p < end && *p == '-';
+	if (negative_time) {
+		++p;
+	}
+	if (p == end || (uchar)(*p - '0') > 9) {
+		throw_bad_actor("Missing time", begin, end);
+	}
+	time_t t = 0;
+	for (; p < end && (uchar)(*p - '0') <= 9; ++p) {
+		t = t * 10 + (*p - '0');
+	}
+	time = negative_time ? -t : t;
+	
+	// timezone offset, stored as decimal representation of its hhmm form
+	for (; p < end && *p == ' '; ++p);
+	if (p == end || (*p != '+' && *p != '-')) {
+		throw_bad_actor("Missing timezone offset", begin, end);
+	}
+	const bool negative = *p++ == '-';
+	int offset = 0;
+	for (; p < end && (uchar)(*p - '0') <= 9; ++p) {
+		offset = offset * 10 + (*p - '0');
+	}
+	tz_offset = (short)(negative ? -offset : offset);
+}
+
+const git_object_policy_traits::char_type* parse_actor_identity(const git_object_policy_traits::char_type* begin, 
+                                                                const git_object_policy_traits::char_type* end, 
+                                                                size_t& name_len, 
+                                                                const git_object_policy_traits::char_type*& email, 
+                                                                size_t& email_len)
+{
+	typedef git_object_policy_traits::char_type char_type;
+	
+	const char_type* email_start = static_cast<const char_type*>(std::memchr(begin, '<', end - begin));
+	if (!email_start) {
+		throw_bad_actor("Didn't find email portion", begin, end);
+	}
+	const char_type* email_end = static_cast<const char_type*>(std::memchr(email_start, '>', end - email_start));
+	if (!email_end) {
+		throw_bad_actor("Unterminated email", begin, end);
+	}
+	
+	// skip the space separating name and email, if there is one
+	name_len = email_start - begin - (email_start > begin && email_start[-1] == ' ' ? 1 : 0);
+	email = email_start + 1;
+	email_len = email_end - email;
+	return email_end;
+}
+
+void parse_actor_date(const git_object_policy_traits::char_type* begin, const git_object_policy_traits::char_type* end, ActorDate& inst)
+{
+	typedef git_object_policy_traits::char_type char_type;
+	
+	size_t name_len, email_len;
+	const char_type* email;
+	const char_type* email_end = parse_actor_identity(begin, end, name_len, email, email_len);
+	inst.name.assign(begin, name_len);
+	inst.email.assign(email, email_len);
+	parse_actor_time(email_end, end, inst.time, inst.tz_offset);
+}
+
 GIT_NAMESPACE_END
 
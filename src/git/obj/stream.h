@@ -41,6 +41,45 @@ git_basic_ostream& operator << (git_basic_ostream& stream, Object::Type type);
 
 //! @}
 
+//! @{ \name Buffer Parsing
+//! Facilities to deserialize objects from memory, which is much faster than using formatted stream extraction
+
+//! Append all remaining characters of the given stream to buf
+void read_remainder(git_basic_istream& stream, std::basic_string<git_object_policy_traits::char_type>& buf);
+
+/** Parse an actor line as written by operator << (git_basic_ostream&, const ActorDate&), like
+  * "name <email> 1234567890 +0100".
+  * \param begin first character of the line
+  * \param end one past the last character of the line, excluding the newline
+  * \throw DeserializationError if the line is malformed
+  */
+void parse_actor_date(const git_object_policy_traits::char_type* begin, const git_object_policy_traits::char_type* end, ActorDate& inst);
+
+/** Locate name and email of an actor line without copying them
+  * \param name_len set to the amount of characters of the name, which starts at begin
+  * \param email set to the first character of the email
+  * \param email_len set to the amount of characters of the email
+  * \return pointer to the '>' terminating the email
+  * \throw DeserializationError if the email is missing
+  */
+const git_object_policy_traits::char_type* parse_actor_identity(const git_object_policy_traits::char_type* begin, 
+                                                                const git_object_policy_traits::char_type* end, 
+                                                                size_t& name_len, 
+                                                                const git_object_policy_traits::char_type*& email, 
+                                                                size_t& email_len);
+
+/** Parse time and timezone offset of an actor line, without allocating any memory
+  * \param begin first character of the line, or the '>' terminating the email as returned by parse_actor_identity()
+  * \param end one past the last character of the line, excluding the newline
+  * \param time set to the time in seconds since epoch, which may be negative
+  * \param tz_offset set to the timezone offset
+  * \throw DeserializationError if the email is unterminated, or time or timezone offset are missing
+  */
+void parse_actor_time(const git_object_policy_traits::char_type* begin, const git_object_policy_traits::char_type* end, 
+                      time_t& time, TimezoneOffset& tz_offset);
+
+//! @}
+
 GIT_NAMESPACE_END
 GIT_HEADER_END
 
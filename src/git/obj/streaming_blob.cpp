@@ -0,0 +1,45 @@
+#include <git/obj/streaming_blob.h>
+#include <git/config.h>			// for doxygen
+
+GIT_NAMESPACE_BEGIN
+
+StreamingBlob::StreamingBlob(std::unique_ptr<stream_type> stream, size_type size)
+	: m_stream(std::move(stream))
+	, m_size(size)
+	, m_offset(0)
+	, m_key(key_type::null)
+	, m_has_key(false)
+{}
+
+void StreamingBlob::throw_not_a_blob(Object::Type type)
+{
+	ObjectError err;
+	err.stream() << "expected a blob, got object of type " << type;
+	throw err;
+}
+
+size_t StreamingBlob::read(char_type* buf, size_t len)
+{
+	if (len > m_size - m_offset) {
+		len = (size_t)(m_size - m_offset);
+	}
+	
+	size_t nread = 0;
+	try {
+		m_stream->read(buf, len);
+		nread = (size_t)m_stream->gcount();
+	} catch (std::ios_base::failure&) {
+		// It depends on the configuration whether reaching the end throws
+		nread = (size_t)m_stream->gcount();
+	}
+	m_offset += nread;
+	
+	if (nread != len) {
+		DeserializationError err;
+		err.stream() << "blob data ended after " << m_offset << " of " << m_size << " bytes";
+		throw err;
+	}
+	return nread;
+}
+
+GIT_NAMESPACE_END
@@ -0,0 +1,110 @@
+#ifndef GIT_OBJ_STREAMING_BLOB_H
+#define GIT_OBJ_STREAMING_BLOB_H
+
+#include <git/config.h>
+#include <git/obj/object.hpp>
+#include <git/obj/stream.h>
+#include <gtl/db/odb_object.hpp>
+
+#include <memory>
+#include <utility>
+
+GIT_HEADER_BEGIN
+GIT_NAMESPACE_BEGIN
+
+/** \brief Handle to the data of a blob, which is read in chunks from a stream instead of being loaded into memory.
+  *
+  * Database streams decompress data incrementally, hence blobs of any size can be processed in constant memory,
+  * unless they are stored as delta. The data can be read only once, either using read(), or by inserting it into
+  * another database. Use a Blob if the data should be modified.
+  */
+class StreamingBlob
+{
+public:
+	typedef git_object_traits_base::char_type			char_type;
+	typedef git_object_traits_base::size_type			size_type;
+	typedef git_object_traits_base::key_type			key_type;
+	typedef git_basic_istream							stream_type;
+	typedef gtl::odb_ref_input_object<git_object_traits_base, stream_type>	input_object_type;
+	
+protected:
+	std::unique_ptr<stream_type>	m_stream;
+	size_type						m_size;
+	size_type						m_offset;		//!< amount of bytes read so far
+	key_type						m_key;
+	bool							m_has_key;
+	
+	static void throw_not_a_blob(Object::Type type);
+	
+public:
+	/** Initialize the instance from the output object of a database.
+	  * \param key if not null, the key of the object, which prevents hashing it again when inserting it
+	  * \throw ObjectError if the object is no blob
+	  */
+	template <class OutputObject>
+	explicit StreamingBlob(const OutputObject& object, const key_type* key = nullptr)
+		: m_size(object.size())
+		, m_offset(0)
+		, m_key(key ? *key : key_type::null)
+		, m_has_key(key != nullptr)
+	{
+		if (object.type() != Object::Type::Blob) {
+			throw_not_a_blob(object.type());
+		}
+		m_stream.reset(object.new_stream());
+	}
+	
+	//! Initialize the instance from a stream providing the given amount of bytes, like a file
+	StreamingBlob(std::unique_ptr<stream_type> stream, size_type size);
+	
+	StreamingBlob(StreamingBlob&&) = default;
+	
+public:
+	//! \return size of the blob's data in bytes
+	size_type size() const {
+		return m_size;
+	}
+	
+	//! \return amount of bytes read so far
+	size_type offset() const {
+		return m_offset;
+	}
+	
+	//! \return true if all data was read
+	bool eof() const {
+		return m_offset == m_size;
+	}
+	
+	//! \return pointer to our key, or null if it is unknown
+	const key_type* key_pointer() const {
+		return m_has_key ? &m_key : nullptr;
+	}
+	
+	/** Read the next chunk of data
+	  * \return amount of bytes read, which is only smaller than len if the end of the data was reached
+	  * \throw DeserializationError if the stream ends prematurely
+	  */
+	size_t read(char_type* buf, size_t len);
+	
+	/** Insert our data into the given database, without loading it into memory.
+	  * \param odb database or pack writer to insert the data into
+	  * \return the result of the database's insert() method
+	  * \throw ObjectError if data was read already
+	  */
+	template <class ObjectDatabase>
+	auto insert_into(ObjectDatabase& odb) -> decltype(odb.insert(std::declval<input_object_type&>())) {
+		if (m_offset) {
+			ObjectError err;
+			err.stream() << "cannot insert a blob whose data was read already";
+			throw err;
+		}
+		input_object_type obj(Object::Type::Blob, m_size, *m_stream, key_pointer());
+		m_offset = m_size;
+		return odb.insert(obj);
+	}
+};
+
+GIT_NAMESPACE_END
+GIT_HEADER_END
+
+#endif // GIT_OBJ_STREAMING_BLOB_H
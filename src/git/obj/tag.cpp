@@ -1,8 +1,8 @@
 #include "git/obj/tag.h"
 #include <git/config.h>
-#include <boost/iostreams/device/back_inserter.hpp>
-#include <boost/iostreams/copy.hpp>
+#include <git/obj/serializer.h>
 #include <string>
+#include <cstring>
 
 GIT_NAMESPACE_BEGIN
 		
@@ -22,79 +22,75 @@ const string t_tagger("tagger");
 
 git_basic_ostream& operator << (git_basic_ostream& stream, const git::Tag& tag)
 {
-	stream << t_object << ' ' << tag.object_key() << std::endl;
-	stream << t_type << ' ' <<  tag.object_type() << std::endl;
-	stream << t_tag << ' ' << tag.name() << std::endl;
-	stream << t_tagger << ' ' << tag.actor() << std::endl;
-	// empty line only given if we have a message
-	if (tag.message().size()) {
-		stream << std::endl << tag.message();
-	}
+	Serializer::buffer_type buf;
+	Serializer(buf).serialize(tag);
+	stream.write(buf.data(), buf.size());
 	return stream;
 }
 
-git_basic_istream& operator >> (git_basic_istream& stream, git::Tag& tag) 
+//! Parse the header line at p, which must have the given name. p may be end if the input is truncated
+//! \return start of the value, with line_end set to its end
+//! \throw TagDeserializationError if there is no such header
+static const Tag::char_type* parse_header(const Tag::char_type* p, const Tag::char_type* end, const string& name, 
+                                          const Tag::char_type*& line_end)
 {
-	std::string tmp;
-	char c;
-	
-	stream >> tmp;
+	if (p >= end || (size_t)(end - p) <= name.size() || std::memcmp(p, name.data(), name.size()) != 0 || p[name.size()] != ' ') {
+		TagDeserializationError err;
+		err.stream() << "expected " << name << " header";
+		throw err;
+	}
+	p += name.size() + 1;
+	line_end = static_cast<const Tag::char_type*>(std::memchr(p, '\n', end - p));
+	if (!line_end) {
+		line_end = end;
+	}
+	return p;
+}
+
+void Tag::parse(const char_type* data, size_t size)
+{
+	const char_type* p = data;
+	const char_type* const end = data + size;
+	const char_type* line_end;
 	
 	// OBJECT
-	if (tmp != t_object) {
-		throw git::TagDeserializationError();
+	p = parse_header(p, end, t_object, line_end);
+	if (line_end - p != key_type::hash_len * 2 || !gtl::decode_hex(p, key_type::hash_len, m_obj_hash.bytes())) {
+		TagDeserializationError err;
+		err.stream() << "invalid object key: " << string(p, line_end);
+		throw err;
 	}
 	
-	stream.get(c);				// space
-	stream >> tag.object_key();
-	
 	// OBJECT TYPE
-	stream >> tmp;
-	if (tmp != t_type) {
-		throw git::TagDeserializationError();
-	}
-	stream >> tag.object_type();
-	if (tag.object_type() == git::Object::Type::None && tag.object_key() != git::Tag::key_type::null) {
-		throw git::TagDeserializationError();
+	p = parse_header(line_end + (line_end < end), end, t_type, line_end);
+	m_obj_type = parse_type_token(p, line_end - p);
+	if (m_obj_type == Object::Type::None && m_obj_hash != key_type::null) {
+		TagDeserializationError err;
+		err.stream() << "invalid object type: " << string(p, line_end);
+		throw err;
 	}
 	
-	// TAG NAME 
-	stream >> tmp;
-	if (tmp != t_tag) {
-		throw git::TagDeserializationError();
-	}
-	
-	stream.get(c);			// space
-	std::getline(stream, tag.name(), '\n');
+	// TAG NAME
+	p = parse_header(line_end + (line_end < end), end, t_tag, line_end);
+	m_name.assign(p, line_end);
 	
 	// TAGGER
-	stream >> tmp;
-	if (tmp != t_tagger){
-		throw git::TagDeserializationError();
-	}
-	stream.get(c);			// space
-	stream >> tag.actor();
-
-	// read \n at end of tagger line
-	stream.get(c);
-	
-	// MESSAGE
-	try {
-		// read newline between tagger and message
-		stream.get(c);
-	} catch(std::ios_base::failure&) {
-		// ignore failures possibly based on exceptions thrown by the stream
-		// This really depends on its configuration
-	}
+	p = parse_header(line_end + (line_end < end), end, t_tagger, line_end);
+	parse_actor_date(p, line_end, m_actor);
 	
-	if (stream.good()) {
-		tag.message().clear();
-		boost::iostreams::back_insert_device<std::string> msgstream(tag.message());
-		boost::iostreams::copy(stream, msgstream);
-	} else {
-		tag.message().clear();
+	// MESSAGE, separated by an empty line
+	p = line_end + (line_end < end);
+	if (p < end && *p == '\n') {
+		++p;
 	}
-	
+	m_message.assign(p, end);
+}
+
+git_basic_istream& operator >> (git_basic_istream& stream, git::Tag& tag) 
+{
+	std::basic_string<Tag::char_type> buf;
+	read_remainder(stream, buf);
+	tag.parse(buf.data(), buf.size());
 	return stream;	
 }
 
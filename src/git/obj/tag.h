@@ -22,6 +22,7 @@ class Tag : public Object
 {
 public:
 	typedef typename git_object_traits_base::key_type key_type;
+	typedef typename git_object_traits_base::char_type char_type;
 	
 private:
 	Object::Type	m_obj_type;		//! Type id of the object
@@ -36,11 +37,17 @@ public:
 	Tag(Tag&&) = default;
 	
 public:
-	bool operator == (const Tag& rhs) {
+	bool operator == (const Tag& rhs) const {
 		return (m_name == rhs.name() && m_actor == rhs.actor() 
 				&& m_message == rhs.message() && m_obj_type == rhs.object_type() && m_obj_hash == rhs.object_key());
 	}
 	
+	/** Initialize this instance from the given serialized tag, replacing our previous contents and reusing 
+	  * their memory.
+	  * \throw TagDeserializationError if headers are missing or malformed, or DeserializationError for a malformed tagger
+	  */
+	void parse(const char_type* data, size_t size);
+	
 	//! \return the type of the object we refer to
 	Object::Type object_type() const {
 		return m_obj_type;
@@ -1,5 +1,6 @@
 #include "git/obj/tree.h"
 #include <git/config.h>		// for doxygen
+#include <git/obj/serializer.h>
 
 GIT_NAMESPACE_BEGIN
 
@@ -10,68 +11,34 @@ Tree::Tree()
 	: Object(Object::Type::Tree) 
 {}
 
+Tree::Tree(const TreeView& view)
+	: Object(Object::Type::Tree)
+{
+	const auto end = view.end();
+	for (auto it = view.begin(); it != end; ++it) {
+		m_cache.insert(m_cache.end(), map_type::value_type(it->name_string(), Element(it->mode, it->key())));
+	}
+}
+
 git_basic_ostream& operator << (git_basic_ostream& stream, const Tree& inst) 
 {
-	const size_t mbuflen = 6;						
-	char_type mbuf[mbuflen];						// buffer for 6 mode literals
-	const mode_type mask = 7;						// 3 bits
-	
-	auto end = inst.elements().end();
-	for (auto i = inst.elements().begin(); i != end; ++i)
-	{
-		// serialize mode as octal string
-		const mode_type mode = i->second.mode;
-		// if the first mode character would be 0, it gets truncated. This is reflected by an offset
-		const uint ofs = (mode >> ((mbuflen-1)*3) & mask) == 0 ? 1 : 0;
-		for (uint m = 0; m < mbuflen-ofs; ++m) {
-			mbuf[mbuflen-(m+1+ofs)] = (char_type)(((mode >> (m*3)) & mask) + '0');
-		}
-		
-		stream.write(mbuf, mbuflen-ofs);
-		stream << ' ' << i->first << '\0';
-		stream.write(i->second.key.bytes(), Tree::key_type::hash_len);
-		
-	}// for each tree element to write
+	Serializer::buffer_type buf;
+	Serializer(buf).serialize(inst);
+	stream.write(buf.data(), buf.size());
 	return stream;
 }
 
 git_basic_istream& operator >> (git_basic_istream& stream, Tree& inst)
 {
-	char_type c;
-	string name;		// reuse possibly reserved memory
-	name.reserve(64);	// optimize allocation
+	// parse the remainder of the stream at once, instead of character by character
+	std::basic_string<char_type> buf;
+	read_remainder(stream, buf);
 	
-	while (stream.good())
-	{
-		// parse mode
-		try {
-			stream.get(c);
-			// see whether the stream is depleted (case if we don't throw exceptions)
-			if (!stream.good()) {
-				break;
-			}
-		} catch (std::ios_base::failure&) {
-			// if we are at the end, abort this
-			// It depends on the configuration whether this throws
-			break;
-		}
-		
-		name.clear();
-		Tree::Element elm;	// we will move the element in
-		elm.mode = 0;
-
-		for (; c != ' '; stream.get(c)) {
-			elm.mode = (elm.mode << 3) + (c - '0');
-		}
-		// parse name
-		std::getline(stream, name, '\0');
-		
-		// parse hash
-		stream.read(elm.key.bytes(), Tree::key_type::hash_len);
-		
-		// add new element
-		inst.elements().insert(Tree::map_type::value_type(name, std::move(elm)));
-	}// while stream is available
+	const TreeView view(buf.data(), buf.size());
+	const auto end = view.end();
+	for (auto it = view.begin(); it != end; ++it) {
+		inst.elements().insert(Tree::map_type::value_type(it->name_string(), Tree::Element(it->mode, it->key())));
+	}
 	
 	if (inst.elements().size() == 0) {
 		DeserializationError err;
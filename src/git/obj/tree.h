@@ -3,6 +3,7 @@
 
 #include <git/obj/object.hpp>
 #include <git/obj/stream.h>
+#include <git/obj/tree_view.h>
 
 #include <string>
 #include <map>
@@ -19,6 +20,7 @@ using std::string;
   * 
   * Elements can be obtained using the elements() method, and manipulated using the std::map which
   * maps names to Element instances.
+  * \note use a TreeView to iterate serialized trees without copying their elements
   */
 class Tree : public Object
 {
@@ -55,6 +57,10 @@ private:
 public:
     Tree();
 	
+	//! Initialize our elements from the entries of the given view
+	//! \throw DeserializationError if the view is corrupted
+	explicit Tree(const TreeView& view);
+	
 	bool operator == (const Tree& rhs) const {
 		return m_cache == rhs.elements();
 	}
@@ -0,0 +1,215 @@
+#ifndef GIT_OBJ_TREE_VIEW_H
+#define GIT_OBJ_TREE_VIEW_H
+
+#include <git/config.h>
+#include <git/db/traits.hpp>
+#include <git/obj/stream.h>
+
+#include <iterator>
+#include <string>
+#include <cstring>
+
+GIT_HEADER_BEGIN
+GIT_NAMESPACE_BEGIN
+
+/** \brief Read-only view on the serialized entries of a tree.
+  *
+  * Entries are parsed on the fly while iterating, directly from the buffer, which must remain valid and unchanged
+  * while the view or any of its iterators are used. Names and keys point into the buffer, hence no memory is
+  * allocated. Use a Tree if the entries should be modified.
+  */
+class TreeView
+{
+public:
+	typedef typename git_object_traits_base::key_type		key_type;
+	typedef typename git_object_traits_base::char_type		char_type;
+	typedef uint32_t										mode_type;
+
+	static const mode_type	mode_mask = 0170000;		//!< bits identifying the kind of entry
+	static const mode_type	mode_tree = 0040000;		//!< entry is a tree
+	static const mode_type	mode_commit = 0160000;		//!< entry is a commit of a submodule
+
+	/** A single entry of the tree
+	  */
+	struct Entry
+	{
+		mode_type			mode;		//!< stat compatible mode
+		const char_type*	name;		//!< name of the entry, not null-terminated
+		size_t				name_len;	//!< amount of characters in name
+		const char_type*	key_bytes;	//!< raw bytes of the key
+
+		//! \return copy of our name
+		std::string name_string() const {
+			return std::string(name, name_len);
+		}
+
+		//! \return copy of our key
+		key_type key() const {
+			return key_type(key_bytes);
+		}
+
+		//! \return true if the entry is a tree
+		bool is_tree() const {
+			return (mode & mode_mask) == mode_tree;
+		}
+
+		//! \return true if the entry is a submodule commit, which is not contained in our database
+		bool is_commit() const {
+			return (mode & mode_mask) == mode_commit;
+		}
+	};
+
+	/** Forward iterator parsing entries as it advances
+	  */
+	class const_iterator : public std::iterator<std::forward_iterator_tag, const Entry>
+	{
+		const char_type*	m_cur;		//!< start of the current entry
+		const char_type*	m_next;		//!< start of the next entry
+		const char_type*	m_end;
+		Entry				m_entry;
+
+		//! parse the entry at m_cur
+		//! \throw DeserializationError if the entry is truncated or malformed
+		void parse() {
+			if (m_cur == m_end) {
+				m_next = m_end;
+				return;
+			}
+
+			const char_type* p = m_cur;
+			mode_type mode = 0;
+			for (; p != m_end && *p != ' '; ++p) {
+				if (*p < '0' || *p > '7') {
+					throw_corrupt("invalid mode");
+				}
+				mode = (mode << 3) | (*p - '0');
+			}
+			if (p == m_cur || p == m_end) {
+				throw_corrupt("missing mode");
+			}
+
+			const char_type* name = ++p;
+			const char_type* name_end = static_cast<const char_type*>(std::memchr(name, '\0', m_end - name));
+			if (!name_end || name_end == name) {
+				throw_corrupt("missing name");
+			}
+			if ((size_t)(m_end - name_end) <= key_type::hash_len) {
+				throw_corrupt("truncated key");
+			}
+
+			m_entry.mode = mode;
+			m_entry.name = name;
+			m_entry.name_len = name_end - name;
+			m_entry.key_bytes = name_end + 1;
+			m_next = m_entry.key_bytes + key_type::hash_len;
+		}
+
+		void throw_corrupt(const char* msg) const {
+			DeserializationError err;
+			err.stream() << "corrupted tree entry: " << msg;
+			throw err;
+		}
+
+	public:
+		const_iterator()
+			: m_cur(nullptr)
+			, m_next(nullptr)
+			, m_end(nullptr)
+		{}
+
+		const_iterator(const char_type* cur, const char_type* end)
+			: m_cur(cur)
+			, m_next(cur)
+			, m_end(end)
+		{
+			parse();
+		}
+
+		bool operator == (const const_iterator& rhs) const {
+			return m_cur == rhs.m_cur;
+		}
+
+		bool operator != (const const_iterator& rhs) const {
+			return m_cur != rhs.m_cur;
+		}
+
+		const Entry& operator*() const {
+			return m_entry;
+		}
+
+		const Entry* operator->() const {
+			return &m_entry;
+		}
+
+		const_iterator& operator++() {
+			m_cur = m_next;
+			parse();
+			return *this;
+		}
+
+		const_iterator operator++(int) {
+			const_iterator tmp(*this);
+			++*this;
+			return tmp;
+		}
+	};
+
+protected:
+	const char_type*	m_data;
+	size_t				m_size;
+
+public:
+	//! Initialize the view on the serialized tree in the given buffer
+	TreeView(const char_type* data, size_t size)
+		: m_data(data)
+		, m_size(size)
+	{}
+
+public:
+	//! \return iterator to the first entry
+	//! \throw DeserializationError if the first entry is corrupted, which also applies when incrementing iterators
+	const_iterator begin() const {
+		return const_iterator(m_data, m_data + m_size);
+	}
+
+	const_iterator end() const {
+		return const_iterator(m_data + m_size, m_data + m_size);
+	}
+
+	//! \return true if there are no entries
+	bool empty() const {
+		return m_size == 0;
+	}
+
+	//! \return serialized tree data we view
+	const char_type* data() const {
+		return m_data;
+	}
+
+	//! \return amount of bytes of serialized data
+	size_t size() const {
+		return m_size;
+	}
+
+	//! \return iterator to the entry with the given name, or end() if there is none
+	const_iterator find(const char_type* name, size_t name_len) const {
+		const const_iterator last = end();
+		for (const_iterator it = begin(); it != last; ++it) {
+			if (it->name_len == name_len && std::memcmp(it->name, name, name_len) == 0) {
+				return it;
+			}
+		}
+		return last;
+	}
+
+	//! Same as above, but takes a string
+	const_iterator find(const std::string& name) const {
+		return find(name.data(), name.size());
+	}
+};
+
+
+GIT_NAMESPACE_END
+GIT_HEADER_END
+
+#endif // GIT_OBJ_TREE_VIEW_H
@@ -0,0 +1,441 @@
+#ifndef GTL_EWAH_BITMAP_HPP
+#define GTL_EWAH_BITMAP_HPP
+
+#include <gtl/config.h>
+#include <gtl/db/pack_file.hpp>
+#include <gtl/util.hpp>
+
+#include <vector>
+#include <ostream>
+#include <limits>
+#include <algorithm>
+#include <cassert>
+
+GTL_HEADER_BEGIN
+GTL_NAMESPACE_BEGIN
+
+/** \brief compressed bitmap using the enhanced word-aligned hybrid (EWAH) encoding.
+  *
+  * The bitmap is a sequence of 64 bit words. Each marker word describes a run of words which are all zero or
+  * all one, followed by a number of literal words which are stored verbatim. Large areas of equal bits hence cost
+  * a single word, and binary operations process runs at once instead of bit by bit.
+  *
+  * Bits can only be appended, i.e. set() requires the bit to be at or after the last bit set so far.
+  * The serialized form is compatible to the one used in git's reachability bitmaps.
+  * \ingroup ODBUtil
+  */
+class ewah_bitmap
+{
+public:
+	typedef uint64_t					word_type;
+	typedef std::vector<word_type>		word_vector_type;
+
+	static const uint32		word_bits = 64;
+
+protected:
+	static const uint32		running_bits = 32;
+	static const uint64_t	max_run = 0xffffffffULL;		//!< maximum words in a run
+	static const uint64_t	max_literals = 0x7fffffffULL;	//!< maximum literal words following a marker
+
+	word_vector_type	m_words;		//!< marker and literal words
+	size_t				m_rlw;			//!< index of the last marker word
+	uint64_t			m_bit_size;		//!< amount of bits represented by this bitmap
+
+	//! @{ \name Marker Word Handling
+	static bool run_bit(word_type w) {
+		return w & 1;
+	}
+	static uint64_t run_length(word_type w) {
+		return (w >> 1) & max_run;
+	}
+	static uint64_t literal_words(word_type w) {
+		return w >> (running_bits + 1);
+	}
+	static void set_run_bit(word_type& w, bool b) {
+		w = b ? (w | 1) : (w & ~(word_type)1);
+	}
+	static void set_run_length(word_type& w, uint64_t l) {
+		w = (w & ~(max_run << 1)) | (l << 1);
+	}
+	static void set_literal_words(word_type& w, uint64_t l) {
+		w = (w & ((word_type(1) << (running_bits + 1)) - 1)) | (l << (running_bits + 1));
+	}
+	//! @}
+
+	//! \return amount of words required to store the given amount of bits
+	static uint64_t words_for(uint64_t bits) {
+		return (bits + word_bits - 1) / word_bits;
+	}
+
+	void add_literal(word_type w) {
+		word_type& rlw = m_words[m_rlw];
+		const uint64_t nl = literal_words(rlw);
+		if (nl == max_literals) {
+			m_rlw = m_words.size();
+			m_words.push_back(0);
+			set_literal_words(m_words.back(), 1);
+		} else {
+			set_literal_words(rlw, nl + 1);
+		}
+		m_words.push_back(w);
+	}
+
+	void add_fill(bool bit, uint64_t n) {
+		while (n) {
+			word_type& rlw = m_words[m_rlw];
+			const uint64_t rl = run_length(rlw);
+			if (literal_words(rlw) == 0 && (rl == 0 || run_bit(rlw) == bit) && rl < max_run) {
+				const uint64_t add = std::min(n, max_run - rl);
+				set_run_bit(rlw, bit);
+				set_run_length(rlw, rl + add);
+				n -= add;
+			} else {
+				m_rlw = m_words.size();
+				m_words.push_back(0);
+			}
+		}
+	}
+
+	//! append a single word, which becomes part of a run if possible
+	void add_word(word_type w) {
+		if (w == 0) {
+			add_fill(false, 1);
+		} else if (w == ~word_type(0)) {
+			add_fill(true, 1);
+		} else {
+			add_literal(w);
+		}
+	}
+
+public:
+	/** \brief sequential reader of the uncompressed words of a bitmap.
+	  * Once all words were read, the cursor behaves as if it was followed by an infinite run of zeros.
+	  */
+	class cursor
+	{
+		const word_type*	m_cur;		//!< next word to read
+		const word_type*	m_end;
+		uint64_t			m_run;		//!< words left in the current run
+		uint64_t			m_lit;		//!< literal words left after the run
+		bool				m_bit;		//!< fill value of the current run
+
+		void settle() {
+			while (m_run == 0 && m_lit == 0 && m_cur < m_end) {
+				const word_type rlw = *m_cur++;
+				m_bit = run_bit(rlw);
+				m_run = run_length(rlw);
+				m_lit = std::min<uint64_t>(literal_words(rlw), m_end - m_cur);
+			}
+		}
+
+	public:
+		explicit cursor(const ewah_bitmap& b)
+			: m_cur(b.m_words.data())
+			, m_end(b.m_words.data() + b.m_words.size())
+			, m_run(0)
+			, m_lit(0)
+			, m_bit(false)
+		{
+			settle();
+		}
+
+		//! \return true if the next word is part of a run
+		bool in_run() const {
+			return m_run != 0 || m_lit == 0;
+		}
+
+		//! \return fill word of the current run
+		word_type fill() const {
+			return (m_run && m_bit) ? ~word_type(0) : word_type(0);
+		}
+
+		//! \return amount of words left in the current run
+		uint64_t run() const {
+			return m_run || m_lit ? m_run : std::numeric_limits<uint64_t>::max();
+		}
+
+		//! skip n words of the current run, n must not exceed run()
+		void skip(uint64_t n) {
+			if (m_run || m_lit) {
+				m_run -= n;
+				settle();
+			}
+		}
+
+		//! \return the next word, which may be part of a run or a literal
+		word_type next() {
+			word_type w;
+			if (in_run()) {
+				w = fill();
+				skip(1);
+			} else {
+				w = *m_cur++;
+				--m_lit;
+				settle();
+			}
+			return w;
+		}
+	};
+
+protected:
+	/** Combine two bitmaps word by word.
+	  * Runs present in both bitmaps are processed at once, everything else is combined one word at a time.
+	  * \param op binary functor combining two words
+	  */
+	template <class Operation>
+	static void combine(const ewah_bitmap& lhs, const ewah_bitmap& rhs, ewah_bitmap& out, Operation op) {
+		out.clear();
+		const uint64_t bit_size = std::max(lhs.m_bit_size, rhs.m_bit_size);
+		const uint64_t num_words = words_for(bit_size);
+		cursor l(lhs), r(rhs);
+		for (uint64_t pos = 0; pos < num_words;) {
+			if (l.in_run() && r.in_run()) {
+				const uint64_t n = std::min(std::min(l.run(), r.run()), num_words - pos);
+				out.add_fill(op(l.fill(), r.fill()) != 0, n);
+				l.skip(n);
+				r.skip(n);
+				pos += n;
+			} else {
+				out.add_word(op(l.next(), r.next()));
+				++pos;
+			}
+		}
+		out.m_bit_size = bit_size;
+	}
+
+public:
+	ewah_bitmap()
+		: m_words(1, 0)
+		, m_rlw(0)
+		, m_bit_size(0)
+	{}
+
+	//! Reset the bitmap to its empty state
+	void clear() {
+		m_words.assign(1, 0);
+		m_rlw = 0;
+		m_bit_size = 0;
+	}
+
+	//! \return amount of bits represented by this bitmap, which is one more than the last bit set
+	uint64_t size() const {
+		return m_bit_size;
+	}
+
+	//! \return amount of words we use in compressed form
+	size_t compressed_words() const {
+		return m_words.size();
+	}
+
+	//! Set the given bit to 1
+	//! \note bit must not be smaller than the last bit set
+	void set(uint64_t bit) {
+		const uint64_t have_words = words_for(m_bit_size);
+		const uint64_t need_words = bit / word_bits + 1;
+		const word_type mask = word_type(1) << (bit % word_bits);
+
+		if (need_words > have_words) {
+			add_fill(false, need_words - have_words - 1);
+			add_literal(mask);
+		} else {
+			assert(need_words == have_words);
+			word_type& rlw = m_words[m_rlw];
+			if (literal_words(rlw)) {
+				m_words.back() |= mask;
+			} else if (!run_bit(rlw)) {
+				// the last word is part of a run of zeros, move it to a literal
+				set_run_length(rlw, run_length(rlw) - 1);
+				add_literal(mask);
+			}
+		}
+		m_bit_size = std::max(m_bit_size, bit + 1);
+	}
+
+	//! Extend the bitmap to the given amount of bits, without setting any bits
+	void resize(uint64_t bits) {
+		if (bits > m_bit_size) {
+			add_fill(false, words_for(bits) - words_for(m_bit_size));
+			m_bit_size = bits;
+		}
+	}
+
+	//! \return true if the given bit is set. This requires a linear scan
+	bool test(uint64_t bit) const {
+		if (bit >= m_bit_size) {
+			return false;
+		}
+		cursor c(*this);
+		for (uint64_t pos = bit / word_bits; pos;) {
+			if (c.in_run()) {
+				const uint64_t n = std::min(c.run(), pos);
+				c.skip(n);
+				pos -= n;
+			} else {
+				c.next();
+				--pos;
+			}
+		}
+		return (c.next() >> (bit % word_bits)) & 1;
+	}
+
+	//! \return amount of bits set
+	uint64_t count() const {
+		uint64_t out = 0;
+		const uint64_t num_words = words_for(m_bit_size);
+		cursor c(*this);
+		for (uint64_t pos = 0; pos < num_words;) {
+			if (c.in_run()) {
+				const uint64_t n = std::min(c.run(), num_words - pos);
+				if (c.fill()) {
+					out += std::min((pos + n) * word_bits, m_bit_size) - pos * word_bits;
+				}
+				c.skip(n);
+				pos += n;
+			} else {
+				word_type w = c.next();
+				if (++pos == num_words && m_bit_size % word_bits) {
+					w &= (word_type(1) << (m_bit_size % word_bits)) - 1;
+				}
+				out += __builtin_popcountll(w);
+			}
+		}
+		return out;
+	}
+
+	//! Call the given functor with the index of each set bit, in ascending order
+	template <class Functor>
+	void each(Functor f) const {
+		const uint64_t num_words = words_for(m_bit_size);
+		cursor c(*this);
+		for (uint64_t pos = 0; pos < num_words;) {
+			if (c.in_run()) {
+				const uint64_t n = std::min(c.run(), num_words - pos);
+				if (c.fill()) {
+					const uint64_t end = std::min((pos + n) * word_bits, m_bit_size);
+					for (uint64_t b = pos * word_bits; b < end; ++b) {
+						f(b);
+					}
+				}
+				c.skip(n);
+				pos += n;
+			} else {
+				for (word_type w = c.next(); w; w &= w - 1) {
+					f(pos * word_bits + __builtin_ctzll(w));
+				}
+				++pos;
+			}
+		}
+	}
+
+	//! @{ \name Binary Operations
+	//! The result has the size of the larger operand
+
+	ewah_bitmap operator | (const ewah_bitmap& rhs) const {
+		ewah_bitmap out;
+		combine(*this, rhs, out, [](word_type l, word_type r) { return l | r; });
+		return out;
+	}
+
+	ewah_bitmap operator & (const ewah_bitmap& rhs) const {
+		ewah_bitmap out;
+		combine(*this, rhs, out, [](word_type l, word_type r) { return l & r; });
+		return out;
+	}
+
+	ewah_bitmap operator ^ (const ewah_bitmap& rhs) const {
+		ewah_bitmap out;
+		combine(*this, rhs, out, [](word_type l, word_type r) { return l ^ r; });
+		return out;
+	}
+
+	//! \return bitmap with all bits set in this instance, but not in rhs
+	ewah_bitmap and_not(const ewah_bitmap& rhs) const {
+		ewah_bitmap out;
+		combine(*this, rhs, out, [](word_type l, word_type r) { return l & ~r; });
+		return out;
+	}
+
+	ewah_bitmap& operator |= (const ewah_bitmap& rhs) {
+		ewah_bitmap out(*this | rhs);
+		swap(out);
+		return *this;
+	}
+
+	//! \return true if both bitmaps have the same bits set, independent of their size
+	bool operator == (const ewah_bitmap& rhs) const {
+		return (*this ^ rhs).count() == 0;
+	}
+
+	bool operator != (const ewah_bitmap& rhs) const {
+		return !(*this == rhs);
+	}
+
+	//! @}
+
+	void swap(ewah_bitmap& rhs) {
+		m_words.swap(rhs.m_words);
+		std::swap(m_rlw, rhs.m_rlw);
+		std::swap(m_bit_size, rhs.m_bit_size);
+	}
+
+public:
+	//! @{ \name Serialization
+
+	//! \return amount of bytes written by write()
+	size_t serialized_size() const {
+		return 4 + 4 + m_words.size() * 8 + 4;
+	}
+
+	//! Write the bitmap in its serialized form, which uses network byte order
+	void write(std::ostream& out) const {
+		std::vector<uchar> buf(serialized_size());
+		uchar* p = buf.data();
+		hton32((uint32)m_bit_size, p);
+		hton32((uint32)m_words.size(), p+4);
+		p += 8;
+		for (auto i = m_words.begin(); i != m_words.end(); ++i, p += 8) {
+			hton64(*i, p);
+		}
+		hton32((uint32)m_rlw, p);
+		out.write(reinterpret_cast<const char*>(buf.data()), buf.size());
+	}
+
+	//! Read a bitmap from its serialized form, as produced by write()
+	//! \return amount of bytes read
+	//! \throw pack_error if the data is truncated or corrupted
+	size_t read(const uchar* data, size_t len) {
+		pack_error err;
+		if (len < 12) {
+			err.stream() << "truncated ewah bitmap";
+			throw err;
+		}
+		const uint64_t bit_size = ntoh32(data);
+		const size_t num_words = ntoh32(data+4);
+		const size_t total = 12 + num_words * 8;
+		if (len < total || num_words == 0) {
+			err.stream() << "truncated ewah bitmap with " << num_words << " words";
+			throw err;
+		}
+		const size_t rlw = ntoh32(data + 8 + num_words * 8);
+		if (rlw >= num_words) {
+			err.stream() << "invalid marker word position in ewah bitmap";
+			throw err;
+		}
+
+		m_words.resize(num_words);
+		const uchar* p = data + 8;
+		for (auto i = m_words.begin(); i != m_words.end(); ++i, p += 8) {
+			*i = ntoh64(p);
+		}
+		m_rlw = rlw;
+		m_bit_size = bit_size;
+		return total;
+	}
+
+	//! @}
+};
+
+GTL_NAMESPACE_END
+GTL_HEADER_END
+
+#endif // GTL_EWAH_BITMAP_HPP
@@ -0,0 +1,264 @@
+#ifndef GTL_ODB_FSCK_HPP
+#define GTL_ODB_FSCK_HPP
+
+#include <gtl/config.h>
+#include <gtl/db/odb.hpp>
+#include <gtl/thread_pool.hpp>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+GTL_HEADER_BEGIN
+GTL_NAMESPACE_BEGIN
+
+/** \brief kinds of problems detected when verifying a database
+  */
+enum class fsck_problem_kind : uchar
+{
+	corrupt,			//!< the object could not be read
+	hash_mismatch,		//!< the object's data doesn't hash to its key
+	missing_link		//!< the object refers to an object which doesn't exist
+};
+
+
+/** \brief a single problem found when verifying a database
+  */
+template <class KeyType>
+struct odb_fsck_problem
+{
+	typedef KeyType			key_type;
+
+	fsck_problem_kind	kind;
+	key_type			key;		//!< key of the affected object
+	key_type			link;		//!< key of the missing object, only valid for missing links
+	std::string			message;	//!< human readable description, empty for missing links
+};
+
+
+/** \brief result of the verification of a database
+  */
+template <class KeyType>
+struct odb_fsck_report
+{
+	typedef KeyType								key_type;
+	typedef odb_fsck_problem<key_type>			problem_type;
+	typedef std::vector<problem_type>			problem_vector_type;
+
+	uint64_t				num_objects;	//!< amount of objects verified
+	uint64_t				num_links;		//!< amount of links checked
+	problem_vector_type		problems;		//!< problems in no particular order
+
+	odb_fsck_report()
+		: num_objects(0)
+		, num_links(0)
+	{}
+
+	//! \return true if no problem was found
+	bool ok() const {
+		return problems.empty();
+	}
+
+	//! \return amount of problems of the given kind
+	size_t count(fsck_problem_kind kind) const {
+		size_t n = 0;
+		for (auto i = problems.begin(); i != problems.end(); ++i) {
+			n += i->kind == kind;
+		}
+		return n;
+	}
+};
+
+
+/** \brief policy providing the object format specific parts of the verification
+  * \note this struct just defines the interface, the actual implementation needs
+  * to be provided by the derived type.
+  * \ingroup ODBPolicy
+  */
+struct odb_fsck_policy
+{
+	//! Update the hash generator with the header which is hashed along with object data to obtain its key
+	template <class HashGeneratorType, class ObjectType, class SizeType>
+	void header_hash(HashGeneratorType& gen, const ObjectType type, const SizeType size);
+
+	//! Call f(key) for each object referred to by the given object data
+	//! \throw odb_error if the data cannot be parsed
+	template <class ObjectType, class CharType, class Functor>
+	void links(const ObjectType type, const CharType* data, size_t size, Functor f);
+};
+
+
+/** \brief verifies the integrity of all objects of a database using multiple threads.
+  *
+  * Each object is read, and its data is hashed to verify it matches its key. Objects referred to by the
+  * object must exist, either in the database itself or according to a custom link lookup, to allow
+  * verifying a database whose objects refer to objects in other databases.
+  *
+  * The calling thread iterates the database and hands out batches of keys to a thread pool, hence the database
+  * must support concurrent reads.
+  * \tparam ObjectDatabase database type to verify
+  * \tparam Policy odb_fsck_policy compatible type
+  * \ingroup ODB
+  */
+template <class ObjectDatabase, class Policy>
+class odb_fsck
+{
+public:
+	typedef ObjectDatabase										db_type;
+	typedef Policy												policy_type;
+	typedef typename db_type::traits_type						traits_type;
+	typedef typename traits_type::key_type						key_type;
+	typedef typename traits_type::char_type						char_type;
+	typedef typename traits_type::hash_generator_type			hash_generator_type;
+	typedef odb_fsck_report<key_type>							report_type;
+	typedef typename report_type::problem_type					problem_type;
+	typedef std::vector<key_type>								key_vector_type;
+
+	//! Called with the amount of verified objects and the total amount of objects
+	typedef std::function<void(uint64_t, uint64_t)>				progress_type;
+	//! \return true if the object with the given key exists
+	typedef std::function<bool(const key_type&)>				link_lookup_type;
+
+protected:
+	const db_type&		m_db;
+	size_t				m_num_threads;
+	size_t				m_batch_size;
+	progress_type		m_progress;
+	link_lookup_type	m_link_lookup;
+
+	/** State shared between all workers of one verification
+	  */
+	struct shared_state
+	{
+		std::mutex		mutex;
+		report_type		report;
+		uint64_t		total;
+	};
+
+	void add_problem(report_type& report, fsck_problem_kind kind, const key_type& key, const std::string& msg) const {
+		problem_type p;
+		p.kind = kind;
+		p.key = key;
+		p.link = key_type::null;
+		p.message = msg;
+		report.problems.push_back(p);
+	}
+
+	void verify_object(const key_type& key, std::vector<char_type>& buf, report_type& report) const {
+		auto acc = m_db.object(key);
+		const auto type = acc->type();
+		const auto size = acc->size();
+		{
+			std::unique_ptr<typename db_type::output_object_type::stream_type> stream(acc->new_stream());
+			buf.resize(size + 1);
+			stream->read(buf.data(), buf.size());
+			if ((uint64_t)stream->gcount() != size) {
+				add_problem(report, fsck_problem_kind::corrupt, key, "object data doesn't match the object's size");
+				return;
+			}
+		}
+
+		policy_type policy;
+		hash_generator_type gen;
+		policy.header_hash(gen, type, size);
+		gen.update(buf.data(), size);
+		if (key_type(gen.hash()) != key) {
+			add_problem(report, fsck_problem_kind::hash_mismatch, key, "object data doesn't hash to the object's key");
+			return;
+		}
+
+		policy.links(type, buf.data(), size, [this, &key, &report](const key_type& link) {
+			++report.num_links;
+			if (m_link_lookup ? !m_link_lookup(link) : !m_db.has_object(link)) {
+				problem_type p;
+				p.kind = fsck_problem_kind::missing_link;
+				p.key = key;
+				p.link = link;
+				report.problems.push_back(p);
+			}
+		});
+	}
+
+	void verify_batch(const key_vector_type& keys, shared_state& state) const {
+		report_type report;
+		std::vector<char_type> buf;
+		for (auto i = keys.begin(); i != keys.end(); ++i) {
+			try {
+				verify_object(*i, buf, report);
+			} catch (const std::exception& e) {
+				add_problem(report, fsck_problem_kind::corrupt, *i, e.what());
+			}
+		}// for each key
+
+		std::lock_guard<std::mutex> lock(state.mutex);
+		state.report.num_objects += keys.size();
+		state.report.num_links += report.num_links;
+		state.report.problems.insert(state.report.problems.end(), report.problems.begin(), report.problems.end());
+		if (m_progress) {
+			m_progress(state.report.num_objects, state.total);
+		}
+	}
+
+public:
+	//! Prepare verification of the given database, which must remain valid while we exist
+	//! \param num_threads amount of threads to verify objects with
+	explicit odb_fsck(const db_type& db, size_t num_threads = thread_pool::default_concurrency())
+		: m_db(db)
+		, m_num_threads(num_threads)
+		, m_batch_size(256)
+	{}
+
+public:
+	//! @{ \name Configuration
+
+	//! Set a function to call after each batch of objects was verified. It is called by the worker threads,
+	//! but never concurrently
+	void set_progress(const progress_type& progress) {
+		m_progress = progress;
+	}
+
+	//! Set a function to determine whether objects referred to exist. By default, they must exist in our database
+	void set_link_lookup(const link_lookup_type& lookup) {
+		m_link_lookup = lookup;
+	}
+
+	//! Set the amount of objects handed to a worker at once
+	void set_batch_size(size_t batch_size) {
+		m_batch_size = batch_size ? batch_size : 1;
+	}
+
+	//! @}
+
+	//! Verify all objects of our database
+	//! \return report listing all problems found
+	report_type verify() const {
+		std::shared_ptr<shared_state> state(new shared_state);
+		state->total = m_db.count();
+
+		thread_pool pool(m_num_threads);
+		std::shared_ptr<key_vector_type> batch(new key_vector_type);
+		batch->reserve(m_batch_size);
+		const auto end = m_db.end();
+		for (auto it = m_db.begin(); it != end; ++it) {
+			batch->push_back(it.key());
+			if (batch->size() == m_batch_size) {
+				pool.submit([this, batch, state]() { verify_batch(*batch, *state); });
+				batch.reset(new key_vector_type);
+				batch->reserve(m_batch_size);
+			}
+		}// for each object
+		if (!batch->empty()) {
+			pool.submit([this, batch, state]() { verify_batch(*batch, *state); });
+		}
+		pool.wait();
+
+		return state->report;
+	}
+};
+
+GTL_NAMESPACE_END
+GTL_HEADER_END
+
+#endif // GTL_ODB_FSCK_HPP
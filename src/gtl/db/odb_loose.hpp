@@ -4,6 +4,7 @@
 #include <gtl/config.h>
 #include <gtl/db/odb.hpp>
 #include <gtl/db/odb_object.hpp>
+#include <gtl/db/odb_raw.hpp>
 #include <gtl/util.hpp>
 #include <gtl/db/hash_generator_filter.hpp>
 #include <boost/iostreams/filter/zlib.hpp>
@@ -12,11 +13,14 @@
 #include <boost/iostreams/copy.hpp>
 #include <boost/iostreams/filter/zlib.hpp>
 #include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/device/array.hpp>
 #include <boost/type_traits/is_same.hpp>
 #include <boost/filesystem.hpp>
 #include <assert.h>
 #include <string>
 #include <cstring>
+#include <fstream>
+#include <sstream>
 
 GTL_HEADER_BEGIN
 GTL_NAMESPACE_BEGIN
@@ -24,6 +28,18 @@ GTL_NAMESPACE_BEGIN
 namespace io = boost::iostreams;
 namespace fs = boost::filesystem;
 
+/** \brief thrown if a loose object file cannot be read
+  * \ingroup ODBException
+  */
+class loose_object_error :	public odb_error,
+							public streaming_exception
+{
+public:
+	virtual const char* what() const throw() {
+		return streaming_exception::what();
+	}
+};
+
 
 /** \brief filter which automatically parses the header of a stream and makes the type and size 
   * information available after the first read operation.
@@ -123,7 +139,7 @@ public:
 		// We require this to happen in one step as we do not cache pre-read header data
 		assert(n >= this->optimal_buffer_size());
 		static_assert(BufLen < 1024*4, "putpack doesn't work if we cannot buffer the whole buflen");
-		std::streamsize bytes_handled = -1;
+		std::streamsize bytes_handled = 0;
 		if (needs_update()) {
 			char_type buf[BufLen];
 			char_type* bstart(buf);
@@ -136,8 +152,10 @@ public:
 		}
 		
 		const std::streamsize bytes_read = boost::iostreams::read(src, s, n);
-		if (bytes_read > -1){		// handle eof
+		if (bytes_read > -1){
 			bytes_handled += bytes_read;
+		} else if (bytes_handled == 0) {
+			return -1;		// eof
 		}
 		
 		return bytes_handled;
@@ -300,6 +318,7 @@ public:
 	//! Set the path we should operate on. This interface allows 
 	//! set and change the path on demand, which results in an opened file.
 	//! \param path empty or non-empty path
+	//! \throw loose_object_error if the header of the object cannot be read
 	void set_path(const path_type& path) {
 		if (!path.empty()) {
 			// rebuild ourselves, chain elements cannot be reused
@@ -318,7 +337,11 @@ public:
 			this->read(&buf[0], 1);
 			this->unget();	// operates on our internal buffer
 			
-			assert(this->type() != traits_type::null_object_type);
+			if (this->type() == traits_type::null_object_type) {
+				loose_object_error err;
+				err.stream() << "failed to read header of loose object at " << path;
+				throw err;
+			}
 		}
 	}
 	
@@ -426,6 +449,8 @@ public:
 	typedef typename db_traits_type::path_type	path_type;
 	typedef typename traits_type::size_type		size_type;
 	typedef typename traits_type::object_type	object_type;
+	typedef typename traits_type::key_type		key_type;
+	typedef odb_raw_object<traits_type>			raw_object_type;
 	typedef odb_loose_output_object				this_type;
 	
 private:
@@ -507,6 +532,59 @@ public:
 	
 	//! @{ Interface
 	
+	//! \return key matching our path
+	//! \note this generates the key instance from our object's path
+	//! \todo implementation could be more efficient by manually parsing the path's buffer - if we 
+	//! make plenty of assumptions, this would be easy to write too.
+	key_type key() const {
+		// convert path to temporary key
+		typedef typename path_type::string_type string_type;
+		assert(!m_path.empty());
+		
+		string_type filename = m_path.filename();
+		string_type parent_dir = m_path.parent_path().filename();
+		assert(filename.size()/2 == key_type::hash_len - db_traits_type::num_prefix_characters);
+		assert(parent_dir.size()/2 == db_traits_type::num_prefix_characters);
+		
+		// try to be more efficient regarding allocation by reserving the pre-determined
+		// mount of bytes. Could be static buffer.
+		string_type tmp;
+		tmp.reserve(key_type::hash_len*2);
+		tmp.insert(tmp.end(), parent_dir.begin(), parent_dir.end());
+		tmp.insert(tmp.end(), filename.begin(), filename.end());
+		
+		return key_type(tmp);
+	}
+	
+	//! Obtain the compressed bytes of our file without inflating more than the header.
+	//! The data is owned by the raw object's buffer.
+	//! \note only supported if the header is compressed along with the data
+	void raw(raw_object_type& out) const {
+		static_assert(boost::is_same<typename db_traits_type::header_tag, compressed_header_tag>::value,
+					  "raw access requires the header to be compressed with the data");
+		typedef typename raw_object_type::buffer_type buffer_type;
+		
+		std::ifstream file;
+		file.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+		file.open(m_path.string().c_str(), std::ios_base::in | std::ios_base::binary);
+		std::shared_ptr<buffer_type> buf(new buffer_type(fs::file_size(m_path)));
+		file.read(buf->data(), buf->size());
+		
+		std::ostringstream header(std::ios_base::out | std::ios_base::binary);
+		typename db_traits_type::policy_type().write_header(header, type(), size());
+		
+		out.key = key();
+		out.type = type();
+		out.size = size();
+		out.format = raw_format::loose;
+		out.inflated_size = header.str().size() + out.size;
+		out.is_delta = false;
+		out.data = buf->data();
+		out.data_size = buf->size();
+		out.crc = raw_crc32(out.data, out.data_size);
+		out.buffer = buf;
+	}
+	
 	//! read-only version of our internal path
 	const path_type& path() const {
 		return m_path;
@@ -581,28 +659,8 @@ public:
 	
 public:
 	//! \return key matching our path
-	//! \note this generates the key instance from our object's path
-	//! \todo implementation could be more efficient by manually parsing the path's buffer - if we 
-	//! make plenty of assumptions, this would be easy to write too.
 	key_type key() const {
-		// convert path to temporary key
-		typedef typename path_type::string_type::value_type char_type;
-		typedef typename path_type::string_type string_type;
-		assert(!m_obj.path().empty());
-		
-		string_type filename = m_obj.path().filename();
-		string_type parent_dir = m_obj.path().parent_path().filename();
-		assert(filename.size()/2 == key_type::hash_len - db_traits_type::num_prefix_characters);
-		assert(parent_dir.size()/2 == db_traits_type::num_prefix_characters);
-		
-		// try to be more efficient regarding allocation by reserving the pre-determined
-		// mount of bytes. Could be static buffer.
-		string_type tmp;
-		tmp.reserve(key_type::hash_len*2);
-		tmp.insert(tmp.end(), parent_dir.begin(), parent_dir.end());
-		tmp.insert(tmp.end(), filename.begin(), filename.end());
-		
-		return key_type(tmp);
+		return m_obj.key();
 	}
 	
 };
@@ -640,6 +698,9 @@ protected:
 		// have to increment m_iter prior to looping as we broke out the previous loop,
 		// which fails to increment m_iter. This is good, as comparisons with end (from the user side)
 		// would be false-positive if we increment m_iter at the end of our iteration
+		if (m_iter == end) {
+			return;		// the database is empty
+		}
 		for (++m_iter; m_iter != end; ++m_iter){
 			if (fs::is_regular_file(m_iter->status())) {
 				const path_type& path = m_iter->path();
@@ -717,6 +778,7 @@ public:
 	
 	typedef odb_loose_output_object<traits_type, db_traits_type>	output_object_type;
 	typedef odb_ref_input_object<traits_type>						input_object_type;
+	typedef typename output_object_type::raw_object_type			raw_object_type;
 	typedef typename output_object_type::stream_type				input_stream_type;
 	typedef loose_object_output_stream<traits_type, db_traits_type> output_stream_type;
 	
@@ -812,27 +874,95 @@ public:
 		return _count(start, end());
 	}
 	
+	//! Remove the file of the object with the given key, and its directory if it became empty
+	//! \return true if the object existed
+	//! \throw boost::filesystem::filesystem_error if the file exists but cannot be removed
+	bool remove(const key_type& k) {
+		path_type path;
+		path_from_key(k, path);
+		if (!fs::remove(path)) {
+			return false;
+		}
+		// fails if other objects remain in the directory
+		boost::system::error_code ec;
+		fs::remove(path.parent_path(), ec);
+		return true;
+	}
+	
 	//! Insert the given object into the database
 	//! \tparam InputObject input object compatible type
 	template <class InputObject>
 	accessor insert(InputObject& object);
 	accessor insert_object(typename traits_type::input_reference_type object);
+	
+	//! Insert compressed object data as obtained from the raw() method of an output object.
+	//! Data in loose format is written as is, after it was inflated and verified against its key. Non-delta
+	//! pack entries are verified against their crc32, inflated and stored using insert().
+	//! \return accessor to the new object, or to the existing one if the key was present already
+	//! \throw odb_checksum_error if the data doesn't match its crc32 or its key, or cannot be inflated
+	//! \throw odb_raw_format_error if the data is a delta, which cannot be stored in loose format
+	accessor insert_raw(const raw_object_type& raw);
 };
 
+template <class ObjectTraits, class Traits>
+typename odb_loose<ObjectTraits, Traits>::accessor odb_loose<ObjectTraits, Traits>::insert_raw(const raw_object_type& raw)
+{
+	path_type final_path;
+	this->path_from_key(raw.key, final_path);
+	if (fs::is_regular_file(final_path)) {
+		return accessor(final_path);
+	}
+	if (raw.is_delta) {
+		odb_raw_format_error err;
+		err.stream() << "cannot store delta of object " << raw.key << " as loose object";
+		throw err;
+	}
+	raw.verify();
+	
+	if (raw.format == raw_format::pack_entry) {
+		io::filtering_stream<io::input, char_type> stream;
+		stream.push(io::zlib_decompressor());
+		stream.push(io::basic_array_source<char_type>(raw.data, raw.data + raw.data_size));
+		input_object_type obj(raw.type, raw.size, stream, &raw.key);
+		return insert(obj);
+	}
+	
+	// the crc of loose data was computed from the very bytes we got, only the key can reveal corruption
+	{
+		io::filtering_stream<io::input, char_type> stream;
+		stream.push(io::zlib_decompressor());
+		stream.push(io::basic_array_source<char_type>(raw.data, raw.data + raw.data_size));
+		std::vector<char_type> buf(raw.inflated_size);
+		stream.read(buf.data(), buf.size());
+		if ((size_t)stream.gcount() != buf.size()) {
+			odb_checksum_error err;
+			err.stream() << "failed to inflate raw data of object " << raw.key;
+			throw err;
+		}
+		raw.template verify_key<typename traits_type::hash_generator_type>(buf.data(), buf.size());
+	}
+	
+	path_type tmp_path = this->temppath();
+	{
+		std::ofstream file;
+		file.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+		file.open(tmp_path.string().c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+		file.write(raw.data, raw.data_size);
+	}
+	move_tmp_to_final(tmp_path, final_path);
+	return accessor(final_path);
+}
+
 template <class ObjectTraits, class Traits>
 typename odb_loose<ObjectTraits, Traits>::accessor odb_loose<ObjectTraits, Traits>::insert_object(typename ObjectTraits::input_reference_type object)
 {
 	auto policy = typename traits_type::policy_type();
-	std::basic_stringstream<char_type> tmp_stream;
+	std::vector<char_type> data;
+	policy.serialize_buffer(object, data);
 	path_type tmp_path = this->temppath();
 	
-	output_stream_type ostream(tmp_path, policy.type(object), policy.compute_size(object, &tmp_stream), true);
-	
-	if (tmp_stream.tellp()) {
-		io::copy(tmp_stream, ostream);
-	} else {
-		policy.serialize(object, ostream);
-	}
+	output_stream_type ostream(tmp_path, policy.type(object), data.size(), true);
+	ostream.write(data.data(), data.size());
 	ostream.flush();
 	// YES ! Have to do that to actually flush everything ... WTF ??
 	// Also causes file to be closed
@@ -92,6 +92,11 @@ public:
 		return m_data;
 	}
 	
+	//! \return our actual data
+	const data_type& data() const noexcept {
+		return m_data;
+	}
+	
 	void deserialize(typename traits_type::output_reference_type out) const {
 		typename traits_type::policy_type().deserialize(out, *this);
 	}
@@ -258,13 +263,11 @@ template <class ObjectTraits>
 typename odb_mem<ObjectTraits>::accessor odb_mem<ObjectTraits>::insert_object(const typename ObjectTraits::input_reference_type inobj)
 {
 	auto policy = typename traits_type::policy_type();
-	output_object_type oobj(policy.type(inobj), policy.compute_size(inobj));
+	typename output_object_type::data_type data;
+	policy.serialize_buffer(inobj, data);
+	output_object_type oobj(policy.type(inobj), data.size());
 	auto& odata = oobj.data();
-	odata.reserve(oobj.size());
-	
-	io::stream<io::back_insert_device<typename output_object_type::data_type> > dest(odata);
-	policy.serialize(inobj, dest);
-	dest << std::flush;
+	odata = std::move(data);
 	
 	assert(odata.size() == oobj.size());
 	typename traits_type::hash_generator_type hashgen;
@@ -6,6 +6,7 @@
 #include <exception>
 #include <iostream>
 #include <type_traits>
+#include <vector>
 
 GTL_HEADER_BEGIN
 GTL_NAMESPACE_BEGIN
@@ -83,6 +84,12 @@ struct odb_object_policy
 	template <class StreamType>
 	void serialize(const typename TraitsType::input_reference_type object, StreamType& stream);
 	
+	//! Serialize the given object by appending it to the given buffer. This is preferred over the stream based 
+	//! serialization if the size is needed in advance, as it serializes just once.
+	//! \throw odb_serialization_error
+	void serialize_buffer(const typename TraitsType::input_reference_type object, 
+						  std::vector<typename TraitsType::char_type>& buffer);
+	
 	//! deserialize the data contained in object to recreate the object it represents
 	//! \param output variable to keep the deserialized object
 	//! \param object database object containing all information, like type, size, stream
@@ -0,0 +1,550 @@
+#ifndef GTL_ODB_PACK_HPP
+#define GTL_ODB_PACK_HPP
+
+#include <gtl/config.h>
+#include <gtl/db/odb.hpp>
+#include <gtl/db/odb_object.hpp>
+#include <gtl/db/pack_file.hpp>
+#include <gtl/db/pack_midx.hpp>
+#include <gtl/db/odb_raw.hpp>
+#include <gtl/util.hpp>
+
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <string>
+
+GTL_HEADER_BEGIN
+GTL_NAMESPACE_BEGIN
+
+namespace io = boost::iostreams;
+namespace fs = boost::filesystem;
+
+
+/** Default traits for the pack database
+  * \ingroup ODB
+  */
+template <class ObjectTraits>
+struct odb_pack_traits
+{
+	typedef ObjectTraits traits_type;
+
+	//! type compatible to the boost filtering framework to decompress pack entries
+	typedef io::zlib_decompressor decompression_filter_type;
+
+	//! type to be used as path. The interface must comply to the boost filesystem path
+	typedef boost::filesystem::path path_type;
+
+	//! Represents a policy type which maps pack entry types to object types
+	typedef odb_pack_policy policy_type;
+};
+
+
+/** \brief object providing access to an object stored in a pack.
+  * Type and size are obtained by parsing entry headers only. Streams of non-delta entries inflate
+  * directly from the memory mapped pack, deltified entries are resolved into memory once, and are
+  * streamed from there.
+  * \ingroup ODBObject
+  */
+template <class ObjectTraits, class Traits>
+class odb_pack_output_object
+{
+public:
+	typedef ObjectTraits										traits_type;
+	typedef Traits												db_traits_type;
+	typedef pack_file<traits_type, db_traits_type>				pack_type;
+	typedef typename traits_type::char_type						char_type;
+	typedef typename traits_type::size_type						size_type;
+	typedef typename traits_type::object_type					object_type;
+	typedef typename pack_type::data_type						data_type;
+	typedef typename pack_type::cache_type						cache_type;
+	typedef odb_raw_object<traits_type>							raw_object_type;
+	typedef io::filtering_stream<io::input, char>				stream_type;
+
+protected:
+	const pack_type*					m_pack;
+	uint64_t							m_offset;
+	mutable object_type					m_type;
+	mutable size_type					m_size;
+	mutable std::shared_ptr<data_type>	m_data;		//!< resolved data of deltified entries
+	std::shared_ptr<cache_type>			m_cache;	//!< delta base cache shared with other objects, may be 0
+
+	void init() const {
+		if (m_type == traits_type::null_object_type) {
+			m_pack->info(m_offset, m_type, m_size);
+		}
+	}
+
+	void init_stream(stream_type& stream) const {
+		typename pack_type::entry_info info;
+		m_pack->entry(m_offset, info);
+		if (pack_type::is_delta(info.type)) {
+			if (!m_data) {
+				m_data.reset(new data_type);
+				m_pack->decompress(m_offset, m_type, *m_data, m_cache.get());
+				m_size = m_data->size();
+			}
+			stream.push(io::basic_array_source<char_type>(m_data->data(), m_data->size()));
+		} else {
+			stream.push(typename db_traits_type::decompression_filter_type());
+			stream.push(io::basic_array_source<char_type>(m_pack->data() + info.data_offset,
+														  m_pack->data() + m_pack->data_size()));
+		}
+	}
+
+public:
+	odb_pack_output_object(const pack_type* pack = nullptr, uint64_t offset = 0,
+						   const std::shared_ptr<cache_type>& cache = std::shared_ptr<cache_type>())
+		: m_pack(pack)
+		, m_offset(offset)
+		, m_type(traits_type::null_object_type)
+		, m_size(0)
+		, m_cache(cache)
+	{}
+
+	object_type type() const {
+		init();
+		return m_type;
+	}
+
+	size_type size() const {
+		init();
+		return m_size;
+	}
+
+	void stream(stream_type* out_stream) const {
+		new (out_stream) stream_type;
+		init_stream(*out_stream);
+	}
+
+	stream_type* new_stream() const {
+		std::unique_ptr<stream_type> stream(new stream_type);
+		init_stream(*stream);
+		return stream.release();
+	}
+
+	void destroy_stream(stream_type* stream) const {
+		stream->~filtering_stream();
+	}
+
+	void deserialize(typename traits_type::output_reference_type out) const {
+		typename traits_type::policy_type().deserialize(out, *this);
+	}
+
+	//! @{ \name Interface
+
+	//! Obtain the compressed data of our entry without inflating it. Deltas remain deltas, their base is
+	//! identified by key. The data is owned by the pack.
+	//! \throw odb_checksum_error if the entry doesn't match the crc32 stored in the index
+	void raw(raw_object_type& out) const {
+		typename pack_type::entry_info info;
+		m_pack->entry(m_offset, info);
+		const uint32 entry = m_pack->entry_at(m_offset);
+		const uint64_t end = m_pack->end_offset(entry);
+		
+		out.key = m_pack->index().key(entry);
+		if (raw_crc32(m_pack->bytes() + m_offset, end - m_offset) != m_pack->index().crc(entry)) {
+			odb_checksum_error err;
+			err.stream() << "entry of object " << out.key << " in pack " << m_pack->path() << " doesn't match its crc32";
+			throw err;
+		}
+		
+		out.type = type();
+		out.size = size();
+		out.format = raw_format::pack_entry;
+		out.inflated_size = info.size;
+		out.is_delta = pack_type::is_delta(info.type);
+		if (out.is_delta) {
+			out.base_key = m_pack->index().key(m_pack->entry_at(info.base_offset));
+		}
+		out.data = m_pack->data() + info.data_offset;
+		out.data_size = end - info.data_offset;
+		out.crc = raw_crc32(out.data, out.data_size);
+		out.buffer.reset();
+	}
+
+	//! \return pack containing our object
+	const pack_type& pack() const {
+		return *m_pack;
+	}
+
+	//! \return offset of our entry within the pack
+	uint64_t offset() const {
+		return m_offset;
+	}
+
+	//! @}
+};
+
+
+/** \brief accessor pointing to one object within a pack
+  * \ingroup ODBIter
+  */
+template <class ObjectTraits, class Traits>
+class pack_accessor : public odb_accessor<ObjectTraits>
+{
+public:
+	typedef ObjectTraits										traits_type;
+	typedef Traits												db_traits_type;
+	typedef odb_pack_output_object<traits_type, db_traits_type>	output_object_type;
+	typedef typename output_object_type::pack_type				pack_type;
+	typedef typename traits_type::key_type						key_type;
+	typedef pack_accessor<traits_type, db_traits_type>			this_type;
+
+protected:
+	output_object_type	m_obj;
+	key_type			m_key;
+
+	//! Default constructor, only for derived types
+	pack_accessor() {}
+
+public:
+	//! Initialize this instance to point to the entry at the given offset, which is identified by key
+	pack_accessor(const pack_type* pack, uint64_t offset, const key_type& key)
+		: m_obj(pack, offset)
+		, m_key(key)
+	{}
+
+	//! Equality comparison of compatible iterators
+	inline bool operator==(const this_type& rhs) const {
+		return m_key == rhs.m_key;
+	}
+
+	//! Inequality comparison
+	inline bool operator!=(const this_type& rhs) const {
+		return !(*this == rhs);
+	}
+
+	inline const output_object_type& operator*() const {
+		return m_obj;
+	}
+
+	inline const output_object_type* operator->() const {
+		return &m_obj;
+	}
+
+	//! \return key of the object we point to
+	const key_type& key() const {
+		return m_key;
+	}
+};
+
+
+/** \brief iteration order visiting the entries of a pack by offset.
+  * Reads stream through the pack sequentially, and delta bases are visited before their deltas.
+  * \ingroup ODBIter
+  */
+struct pack_offset_order
+{
+	//! \return index entry to visit at the given step
+	template <class PackType>
+	static uint32 entry(const PackType& pack, uint32 step) {
+		return pack.pack_order()[step];
+	}
+};
+
+/** \brief iteration order visiting the entries of a pack sorted by key.
+  * \ingroup ODBIter
+  */
+struct pack_hash_order
+{
+	template <class PackType>
+	static uint32 entry(const PackType&, uint32 step) {
+		return step;
+	}
+};
+
+
+/** \brief iterator over all entries of all packs of the database
+  * Packs are visited one after another, each pack is iterated in the given order.
+  * All objects produced by an iterator share a delta base cache.
+  * \tparam Order type providing the index entry to visit at each step, like pack_offset_order
+  * \note as packs may contain the same objects, iteration may yield duplicate keys
+  * \ingroup ODBIter
+  */
+template <class ObjectTraits, class Traits, class Order = pack_offset_order>
+class pack_forward_iterator : public pack_accessor<ObjectTraits, Traits>
+{
+public:
+	typedef pack_accessor<ObjectTraits, Traits>					parent_type;
+	typedef typename parent_type::pack_type						pack_type;
+	typedef typename parent_type::output_object_type			output_object_type;
+	typedef typename output_object_type::cache_type				cache_type;
+	typedef std::vector<std::unique_ptr<pack_type> >			pack_vector_type;
+	typedef pack_forward_iterator								this_type;
+
+protected:
+	const pack_vector_type*		m_packs;
+	size_t						m_pack;		//!< index of the current pack
+	uint32						m_step;		//!< amount of entries visited in the current pack
+	std::shared_ptr<cache_type>	m_cache;
+
+	//! skip empty packs and update the accessor
+	void update() {
+		for (; m_pack < m_packs->size() && m_step == (*m_packs)[m_pack]->num_entries(); ++m_pack) {
+			m_step = 0;
+		}
+		if (m_pack < m_packs->size()) {
+			const pack_type* pack = (*m_packs)[m_pack].get();
+			const uint32 entry = Order::entry(*pack, m_step);
+			this->m_obj = output_object_type(pack, pack->index().offset(entry), m_cache);
+			this->m_key = pack->index().key(entry);
+		}
+	}
+
+public:
+	//! Initialize the iterator to point to the first entry of the given pack
+	//! \param packs vector of packs to iterate
+	//! \param pack index of the pack to start at, if it equals the amount of packs, this is an end iterator
+	pack_forward_iterator(const pack_vector_type& packs, size_t pack)
+		: m_packs(&packs)
+		, m_pack(pack)
+		, m_step(0)
+	{
+		if (m_pack < m_packs->size()) {
+			m_cache.reset(new cache_type);
+		}
+		update();
+	}
+
+	inline bool operator==(const this_type& rhs) const {
+		return m_pack == rhs.m_pack && m_step == rhs.m_step;
+	}
+
+	inline bool operator!=(const this_type& rhs) const {
+		return !(*this == rhs);
+	}
+
+	this_type& operator++() {
+		++m_step;
+		update();
+		return *this;
+	}
+
+	this_type operator++(int) {
+		this_type cpy(*this); ++(*this); return cpy;
+	}
+};
+
+
+/** \brief Model a read-only database which provides access to objects stored in packs.
+  *
+  * All packs within the root directory are opened on construction, which requires each pack to be accompanied
+  * by an index. If a multi-pack-index is present, it is consulted first when looking up objects. Packs not
+  * covered by it are searched using their own index.
+  * \ingroup ODB
+  */
+template <class ObjectTraits, class Traits>
+class odb_pack : public odb_base<ObjectTraits>
+{
+public:
+	typedef ObjectTraits											traits_type;
+	typedef Traits													db_traits_type;
+	typedef typename traits_type::key_type							key_type;
+	typedef typename traits_type::char_type							char_type;
+	typedef odb_hash_error<key_type>								hash_error_type;
+	typedef typename db_traits_type::path_type						path_type;
+
+	typedef pack_file<traits_type, db_traits_type>					pack_type;
+	typedef std::vector<std::unique_ptr<pack_type> >				pack_vector_type;
+	typedef gtl::multi_pack_index<traits_type>						midx_type;
+	typedef odb_pack_output_object<traits_type, db_traits_type>		output_object_type;
+
+	typedef pack_accessor<traits_type, db_traits_type>				accessor;
+	typedef pack_forward_iterator<traits_type, db_traits_type>		forward_iterator;
+	typedef pack_forward_iterator<traits_type, db_traits_type, pack_hash_order>	hash_order_iterator;
+
+protected:
+	path_type							m_root;			//!< directory containing the packs
+	pack_vector_type					m_packs;		//!< all packs, sorted by path
+	std::unique_ptr<midx_type>			m_midx;			//!< multi-pack-index or 0
+	std::vector<const pack_type*>		m_midx_packs;	//!< packs by pack-id of the multi-pack-index
+	std::vector<const pack_type*>		m_uncovered;	//!< packs not covered by the multi-pack-index
+
+protected:
+	//! Find the pack and offset of the given key
+	//! \return true if the object was found
+	bool find(const key_type& k, const pack_type*& pack, uint64_t& offset) const {
+		uint32 pack_id;
+		if (m_midx && m_midx->lookup(k, pack_id, offset)) {
+			pack = m_midx_packs[pack_id];
+			return true;
+		}
+		for (auto i = m_uncovered.begin(); i != m_uncovered.end(); ++i) {
+			const uint32 entry = (*i)->index().lookup(k);
+			if (entry != (*i)->num_entries()) {
+				pack = *i;
+				offset = pack->index().offset(entry);
+				return true;
+			}
+		}
+		return false;
+	}
+
+public:
+	//! Initialize the database to use all packs found in the given root directory
+	//! \throw pack_error if a pack or an index is corrupted
+	odb_pack(const path_type& root)
+		: m_root(root)
+	{
+		update_cache();
+	}
+
+public:
+	//! @{ \name Interface
+
+	//! \return directory containing all our packs
+	const path_type& root() const {
+		return m_root;
+	}
+
+	//! \return path at which the multi-pack-index is expected
+	path_type multi_pack_index_path() const {
+		return m_root / "multi-pack-index";
+	}
+
+	//! \return all packs we currently use
+	const pack_vector_type& packs() const {
+		return m_packs;
+	}
+
+	//! \return multi-pack-index currently used, or 0 if there is none
+	const midx_type* multi_pack_index() const {
+		return m_midx.get();
+	}
+
+	//! Rescan the root directory for packs and reload the multi-pack-index.
+	//! A multi-pack-index which refers to packs that don't exist anymore is ignored.
+	//! \throw pack_error if a pack, an index or the multi-pack-index is corrupted, in which case we keep
+	//! using the packs we used before
+	void update_cache() {
+		std::vector<path_type> paths;
+		if (fs::is_directory(m_root)) {
+			const fs::directory_iterator end;
+			for (fs::directory_iterator it(m_root); it != end; ++it) {
+				const path_type& p = it->path();
+				if (p.extension() == ".pack" && fs::is_regular_file(path_type(p).replace_extension(".idx"))) {
+					paths.push_back(p);
+				}
+			}
+		}
+		std::sort(paths.begin(), paths.end());
+		pack_vector_type packs;
+		for (auto i = paths.begin(); i != paths.end(); ++i) {
+			packs.push_back(std::unique_ptr<pack_type>(new pack_type(*i)));
+		}
+
+		std::unique_ptr<midx_type> midx;
+		std::vector<const pack_type*> midx_packs;
+		const path_type midx_path(multi_pack_index_path());
+		if (fs::is_regular_file(midx_path)) {
+			midx.reset(new midx_type(midx_path));
+			for (auto n = midx->pack_names().begin(); n != midx->pack_names().end(); ++n) {
+				auto p = std::find_if(packs.begin(), packs.end(), [&n](const std::unique_ptr<pack_type>& pack) {
+					return pack->index().path().filename().string() == *n;
+				});
+				if (p == packs.end()) {
+					break;
+				}
+				midx_packs.push_back(p->get());
+			}// for each pack name
+			if (midx_packs.size() != midx->num_packs()) {
+				midx.reset();
+				midx_packs.clear();
+			}
+		}
+
+		std::vector<const pack_type*> uncovered;
+		for (auto i = packs.begin(); i != packs.end(); ++i) {
+			if (std::find(midx_packs.begin(), midx_packs.end(), i->get()) == midx_packs.end()) {
+				uncovered.push_back(i->get());
+			}
+		}
+
+		// nothing throws from here on
+		m_packs.swap(packs);
+		m_midx.swap(midx);
+		m_midx_packs.swap(midx_packs);
+		m_uncovered.swap(uncovered);
+	}
+
+	//! Write a multi-pack-index covering all our packs, and start using it right away
+	//! \throw std::ios_base::failure or fs::filesystem_error if the file could not be written, in which case
+	//! we keep using the previous multi-pack-index
+	void write_multi_pack_index() {
+		typename midx_type::name_vector_type names;
+		std::vector<const typename midx_type::index_type*> indices;
+		for (auto i = m_packs.begin(); i != m_packs.end(); ++i) {
+			names.push_back((*i)->index().path().filename().string());
+			indices.push_back(&(*i)->index());
+		}
+
+		path_type tmp_path;
+		gtl::temppath(tmp_path, "tmpmidx");
+		tmp_path = m_root / tmp_path.filename();
+		try {
+			midx_type::write(tmp_path, names, indices);
+			// our mapping of the previous file remains valid until we reload, as it is only unlinked
+			fs::rename(tmp_path, multi_pack_index_path());
+		} catch (...) {
+			boost::system::error_code ec;
+			fs::remove(tmp_path, ec);
+			throw;
+		}
+		update_cache();
+	}
+
+	//! @}
+
+public:
+	bool has_object(const key_type& k) const {
+		const pack_type* pack;
+		uint64_t offset;
+		return find(k, pack, offset);
+	}
+
+	accessor object(const key_type& k) const {
+		const pack_type* pack;
+		uint64_t offset;
+		if (!find(k, pack, offset)) {
+			throw hash_error_type(k);
+		}
+		return accessor(pack, offset, k);
+	}
+
+	forward_iterator begin() const {
+		return forward_iterator(m_packs, 0);
+	}
+
+	forward_iterator end() const {
+		return forward_iterator(m_packs, m_packs.size());
+	}
+
+	//! \return iterator visiting the objects of each pack sorted by key, instead of sequentially
+	//! \note as packs are visited one after another, keys are only sorted per pack
+	hash_order_iterator hash_order_begin() const {
+		return hash_order_iterator(m_packs, 0);
+	}
+
+	hash_order_iterator hash_order_end() const {
+		return hash_order_iterator(m_packs, m_packs.size());
+	}
+
+	size_t count() const {
+		size_t out = 0;
+		for (auto i = m_packs.begin(); i != m_packs.end(); ++i) {
+			out += (*i)->num_entries();
+		}
+		return out;
+	}
+};
+
+GTL_NAMESPACE_END
+GTL_HEADER_END
+
+#endif // GTL_ODB_PACK_HPP
@@ -0,0 +1,144 @@
+#ifndef GTL_ODB_RAW_HPP
+#define GTL_ODB_RAW_HPP
+
+#include <gtl/config.h>
+#include <gtl/db/odb.hpp>
+#include <gtl/util.hpp>
+
+#include <zlib.h>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+GTL_HEADER_BEGIN
+GTL_NAMESPACE_BEGIN
+
+/** \brief thrown if the checksum of raw object data doesn't match the expected one
+  * \ingroup ODBException
+  */
+class odb_checksum_error :	public odb_error,
+							public streaming_exception
+{
+public:
+	virtual const char* what() const throw() {
+		return streaming_exception::what();
+	}
+};
+
+
+/** \brief thrown if a database cannot store raw data of the given format
+  * \ingroup ODBException
+  */
+class odb_raw_format_error :	public odb_error,
+								public streaming_exception
+{
+public:
+	virtual const char* what() const throw() {
+		return streaming_exception::what();
+	}
+};
+
+
+/** \brief layout of the compressed bytes of a raw object
+  */
+enum class raw_format : uchar
+{
+	loose,			//!< header and data are compressed into one stream, as in loose object files
+	pack_entry		//!< only the data is compressed, the header is stored separately, as in packs
+};
+
+
+/** Compute the crc32 of the given bytes, as used to verify raw object data
+  * \ingroup ODBUtil
+  */
+inline uint32 raw_crc32(const void* data, size_t len, uint32 crc = 0)
+{
+	const Bytef* d = static_cast<const Bytef*>(data);
+	const size_t max_chunk = std::numeric_limits<uInt>::max();
+	while (len) {
+		const uInt nb = (uInt)std::min(len, max_chunk);
+		crc = crc32(crc, d, nb);
+		d += nb;
+		len -= nb;
+	}
+	return crc;
+}
+
+
+/** \brief compressed bytes of an object as stored in a database, along with the information required to
+  * store them in another database without inflating and deflating them.
+  *
+  * Raw objects are obtained from the raw() method of output objects, and inserted using the insert_raw() method
+  * of databases. If a database cannot store the given format as is, it falls back to a conversion.
+  * Pack entries are verified against the crc32 stored in their pack index when inserting. Data in loose format
+  * has no stored checksum, its crc32 is computed when it is read, hence it is inflated and verified against
+  * its key instead.
+  * \ingroup ODBObject
+  */
+template <class ObjectTraits>
+struct odb_raw_object
+{
+	typedef ObjectTraits										traits_type;
+	typedef typename traits_type::key_type						key_type;
+	typedef typename traits_type::object_type					object_type;
+	typedef typename traits_type::size_type						size_type;
+	typedef typename traits_type::char_type						char_type;
+	typedef std::vector<char_type>								buffer_type;
+
+	key_type		key;			//!< key of the object
+	object_type		type;			//!< type of the object, even if the data is a delta
+	size_type		size;			//!< inflated size of the object
+	raw_format		format;			//!< layout of the data
+	size_type		inflated_size;	//!< inflated size of data, which includes the header or is the delta size
+	bool			is_delta;		//!< if true, data is a delta against the object identified by base_key
+	key_type		base_key;		//!< base of the delta, only valid if is_delta is true
+	const char_type* data;			//!< compressed bytes
+	size_t			data_size;		//!< amount of compressed bytes
+	uint32			crc;			//!< crc32 of the compressed bytes
+
+	//! keeps data alive if it isn't owned by the database it came from
+	std::shared_ptr<const buffer_type>	buffer;
+
+	odb_raw_object()
+		: type(traits_type::null_object_type)
+		, size(0)
+		, format(raw_format::loose)
+		, inflated_size(0)
+		, is_delta(false)
+		, data(nullptr)
+		, data_size(0)
+		, crc(0)
+	{}
+
+	//! Verify our data matches our crc
+	//! \throw odb_checksum_error
+	void verify() const {
+		const uint32 actual = raw_crc32(data, data_size);
+		if (actual != crc) {
+			odb_checksum_error err;
+			err.stream() << "raw data of object " << key << " has crc32 " << actual << ", expected " << crc;
+			throw err;
+		}
+	}
+
+	//! Verify the given inflated data, which includes the header for data in loose format, hashes to our key
+	//! \tparam HashGenerator generator of the hash our key was computed with
+	//! \throw odb_checksum_error
+	template <class HashGenerator>
+	void verify_key(const char_type* inflated, size_t len) const {
+		HashGenerator gen;
+		gen.update(inflated, len);
+		const key_type actual(gen.hash());
+		if (actual != key) {
+			odb_checksum_error err;
+			err.stream() << "raw data of object " << key << " hashes to " << actual;
+			throw err;
+		}
+	}
+};
+
+GTL_NAMESPACE_END
+GTL_HEADER_END
+
+#endif // GTL_ODB_RAW_HPP
@@ -0,0 +1,289 @@
+#ifndef GTL_PACK_BITMAP_HPP
+#define GTL_PACK_BITMAP_HPP
+
+#include <gtl/config.h>
+#include <gtl/db/pack_file.hpp>
+#include <gtl/db/ewah_bitmap.hpp>
+#include <gtl/util.hpp>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+GTL_HEADER_BEGIN
+GTL_NAMESPACE_BEGIN
+
+namespace io = boost::iostreams;
+namespace fs = boost::filesystem;
+
+/** \brief read-only access to the reachability bitmaps of a pack.
+  *
+  * The bitmap file is stored next to its pack, using the .bitmap extension. For a selection of commits, it contains
+  * a bitmap of all objects reachable from the commit. Bits are indexed by pack position, see pack_file::pack_order().
+  * Additionally there is one bitmap per object type, marking all objects of that type.
+  * As a bitmap may be stored as xor against a previous one, bitmaps are resolved on demand.
+  *
+  * The file format is compatible to version 1 of git's bitmap index, and is memory mapped.
+  * \tparam ObjectTraits traits for general git settings
+  * \tparam Traits pack database traits, providing the policy to map object types to pack types
+  * \ingroup ODB
+  */
+template <class ObjectTraits, class Traits>
+class pack_bitmap_index
+{
+public:
+	typedef ObjectTraits										traits_type;
+	typedef Traits												db_traits_type;
+	typedef typename traits_type::key_type						key_type;
+	typedef typename traits_type::object_type					object_type;
+	typedef typename traits_type::hash_generator_type			hash_generator_type;
+	typedef pack_file<traits_type, db_traits_type>				pack_type;
+	typedef typename pack_type::path_type						path_type;
+	typedef ewah_bitmap											bitmap_type;
+	typedef std::vector<key_type>								key_vector_type;
+	typedef std::vector<bitmap_type>							bitmap_vector_type;
+
+	static const uint32		version = 1;
+	static const uint32		option_full_dag = 1;		//!< bitmaps are closed under reachability
+	static const uint32		max_xor_offset = 160;
+	static const uint32		num_type_bitmaps = 4;		//!< one bitmap per non-delta pack type
+
+protected:
+	/** Location of a serialized commit bitmap
+	  */
+	struct entry
+	{
+		uint32			index_entry;	//!< entry of the commit in the pack index
+		uint32			xor_base;		//!< index of the entry we are xor'ed with, or our own index
+		const uchar*	data;			//!< serialized ewah bitmap
+	};
+
+	const pack_type*		m_pack;
+	path_type				m_path;
+	io::mapped_file_source	m_file;
+	bitmap_type				m_types[num_type_bitmaps];
+	std::vector<entry>		m_entries;		//!< in file order
+	std::vector<uint32>		m_lookup;		//!< indices into m_entries, sorted by index entry
+
+	void throw_corrupt(const char* msg) const {
+		pack_error err;
+		err.stream() << "bitmap index at " << m_path << ": " << msg;
+		throw err;
+	}
+
+	void resolve(uint32 e, bitmap_type& out) const {
+		const uchar* end = reinterpret_cast<const uchar*>(m_file.data()) + m_file.size();
+		out.read(m_entries[e].data, end - m_entries[e].data);
+		if (m_entries[e].xor_base != e) {
+			bitmap_type base;
+			resolve(m_entries[e].xor_base, base);
+			bitmap_type res(out ^ base);
+			out.swap(res);
+		}
+	}
+
+	//! \return index into m_entries for the given index entry, or the amount of entries
+	uint32 find(uint32 index_entry) const {
+		auto it = std::lower_bound(m_lookup.begin(), m_lookup.end(), index_entry, [this](uint32 l, uint32 r) {
+			return m_entries[l].index_entry < r;
+		});
+		return it != m_lookup.end() && m_entries[*it].index_entry == index_entry ? *it : (uint32)m_entries.size();
+	}
+
+public:
+	//! \return path at which the bitmap index of the given pack is stored
+	static path_type bitmap_path(const pack_type& pack) {
+		return path_type(pack.path()).replace_extension(".bitmap");
+	}
+
+	//! Open the bitmap index of the given pack, which must remain valid while we exist
+	//! \throw pack_error if the file doesn't exist, is corrupted or doesn't belong to the pack
+	explicit pack_bitmap_index(const pack_type& pack)
+		: m_pack(&pack)
+		, m_path(bitmap_path(pack))
+	{
+		const size_t hl = key_type::hash_len;
+		if (!fs::is_regular_file(m_path)) {
+			throw_corrupt("file does not exist");
+		}
+		m_file.open(m_path.string());
+
+		const uchar* d = reinterpret_cast<const uchar*>(m_file.data());
+		if (m_file.size() < 12 + 2*hl || std::memcmp(d, "BITM", 4) != 0) {
+			throw_corrupt("invalid signature");
+		}
+		const uchar* const end = d + m_file.size() - hl;
+		if ((uint32)((d[4] << 8) | d[5]) != version || !(((d[6] << 8) | d[7]) & option_full_dag)) {
+			throw_corrupt("unsupported version or options");
+		}
+		const uint32 num_entries = ntoh32(d+8);
+		if (std::memcmp(d+12, pack.index().pack_checksum().bytes(), hl) != 0) {
+			throw_corrupt("checksum does not match the pack");
+		}
+
+		const uchar* p = d + 12 + hl;
+		for (uint32 t = 0; t < num_type_bitmaps; ++t) {
+			p += m_types[t].read(p, end - p);
+		}
+
+		m_entries.reserve(num_entries);
+		bitmap_type tmp;
+		for (uint32 e = 0; e < num_entries; ++e) {
+			if (end - p < 6) {
+				throw_corrupt("truncated bitmap entry");
+			}
+			const entry ent = {ntoh32(p), e - p[4], p + 6};
+			if (ent.index_entry >= pack.num_entries() || p[4] > max_xor_offset || p[4] > e) {
+				throw_corrupt("invalid bitmap entry");
+			}
+			p += 6;
+			p += tmp.read(p, end - p);
+			m_entries.push_back(ent);
+		}// for each entry
+
+		m_lookup.resize(m_entries.size());
+		for (uint32 e = 0; e < m_lookup.size(); ++e) {
+			m_lookup[e] = e;
+		}
+		std::sort(m_lookup.begin(), m_lookup.end(), [this](uint32 l, uint32 r) {
+			return m_entries[l].index_entry < m_entries[r].index_entry;
+		});
+	}
+
+public:
+	//! @{ \name Interface
+
+	//! \return path to our file
+	const path_type& path() const {
+		return m_path;
+	}
+
+	//! \return pack we belong to
+	const pack_type& pack() const {
+		return *m_pack;
+	}
+
+	//! \return amount of commits with a bitmap
+	uint32 num_bitmaps() const {
+		return m_entries.size();
+	}
+
+	//! \return key of the commit of the given bitmap, in the range of [0, num_bitmaps())
+	key_type key(uint32 bitmap) const {
+		return m_pack->index().key(m_entries[bitmap].index_entry);
+	}
+
+	//! \return true if there is a bitmap for the commit with the given index entry
+	bool has_bitmap(uint32 index_entry) const {
+		return find(index_entry) != m_entries.size();
+	}
+
+	//! Obtain the bitmap of all objects reachable from the commit with the given index entry
+	//! \return true if there is a bitmap for the commit, in which case out is set
+	bool bitmap(uint32 index_entry, bitmap_type& out) const {
+		const uint32 e = find(index_entry);
+		if (e == m_entries.size()) {
+			return false;
+		}
+		resolve(e, out);
+		return true;
+	}
+
+	//! Same as above, but identifies the commit by key
+	bool bitmap(const key_type& key, bitmap_type& out) const {
+		const uint32 entry = m_pack->index().lookup(key);
+		return entry != m_pack->num_entries() && bitmap(entry, out);
+	}
+
+	//! \return bitmap marking all objects of the given type
+	//! \throw pack_error if the type cannot be stored in packs
+	const bitmap_type& type_bitmap(object_type type) const {
+		const uchar pt = typename db_traits_type::policy_type().to_pack_type(type);
+		if (pt == 0 || pt > num_type_bitmaps) {
+			throw_corrupt("no bitmap for the given object type");
+		}
+		return m_types[pt - 1];
+	}
+
+	//! @}
+
+public:
+	/** Write a bitmap index for the given pack.
+	  * The bitmaps of the given commits are stored as they are, without xor compression.
+	  * \param path location of the file to write, see bitmap_path()
+	  * \param pack pack the bitmaps refer to. All objects reachable from the commits must be contained in it.
+	  * \param commits keys of commits to store bitmaps for
+	  * \param bitmaps bitmaps of all objects reachable from the respective commit
+	  * \throw pack_error if a commit is not contained in the pack, or if the amount of commits and bitmaps differs
+	  * \throw std::ios_base::failure if the file could not be written
+	  */
+	static void write(const path_type& path, const pack_type& pack, const key_vector_type& commits,
+					  const bitmap_vector_type& bitmaps)
+	{
+		const size_t hl = key_type::hash_len;
+		if (commits.size() != bitmaps.size()) {
+			pack_error err;
+			err.stream() << "need one bitmap per commit, got " << bitmaps.size() << " bitmaps for " << commits.size() << " commits";
+			throw err;
+		}
+
+		// type bitmaps
+		bitmap_type types[num_type_bitmaps];
+		const std::vector<uint32>& order = pack.pack_order();
+		typename db_traits_type::policy_type policy;
+		for (uint32 pos = 0; pos < order.size(); ++pos) {
+			object_type type;
+			typename traits_type::size_type size;
+			pack.info(pack.index().offset(order[pos]), type, size);
+			const uchar pt = policy.to_pack_type(type);
+			if (pt && pt <= num_type_bitmaps) {
+				types[pt - 1].set(pos);
+			}
+		}// for each object in pack order
+
+		std::ostringstream buf(std::ios_base::out | std::ios_base::binary);
+		uchar header[12] = {'B', 'I', 'T', 'M', 0, (uchar)version, 0, (uchar)option_full_dag};
+		hton32((uint32)commits.size(), header + 8);
+		buf.write(reinterpret_cast<const char*>(header), sizeof(header));
+		buf.write(pack.index().pack_checksum().bytes(), hl);
+		for (uint32 t = 0; t < num_type_bitmaps; ++t) {
+			types[t].resize(order.size());
+			types[t].write(buf);
+		}
+
+		for (size_t i = 0; i < commits.size(); ++i) {
+			const uint32 entry = pack.index().lookup(commits[i]);
+			if (entry == pack.num_entries()) {
+				pack_error err;
+				err.stream() << "commit " << commits[i] << " is not contained in pack " << pack.path();
+				throw err;
+			}
+			uchar ehdr[6] = {0, 0, 0, 0, 0, 0};
+			hton32(entry, ehdr);
+			buf.write(reinterpret_cast<const char*>(ehdr), sizeof(ehdr));
+			bitmaps[i].write(buf);
+		}// for each commit
+
+		const std::string data(buf.str());
+		hash_generator_type gen;
+		gen.update(data.data(), data.size());
+		const key_type checksum(gen.hash());
+
+		std::ofstream out;
+		out.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+		out.open(path.string().c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+		out.write(data.data(), data.size());
+		out.write(checksum.bytes(), hl);
+		out.close();
+	}
+};
+
+GTL_NAMESPACE_END
+GTL_HEADER_END
+
+#endif // GTL_PACK_BITMAP_HPP
@@ -0,0 +1,764 @@
+#ifndef GTL_PACK_FILE_HPP
+#define GTL_PACK_FILE_HPP
+
+#include <gtl/config.h>
+#include <gtl/db/odb.hpp>
+#include <gtl/util.hpp>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/filesystem.hpp>
+
+#include <zlib.h>
+#include <mutex>
+#include <limits>
+#include <vector>
+#include <list>
+#include <map>
+#include <memory>
+#include <cstring>
+#include <algorithm>
+
+GTL_HEADER_BEGIN
+GTL_NAMESPACE_BEGIN
+
+namespace io = boost::iostreams;
+namespace fs = boost::filesystem;
+
+/** \brief thrown if a pack, an index or any other file associated with packs is corrupted or has an unsupported format
+  * \ingroup ODBException
+  */
+class pack_error :	public odb_error,
+					public streaming_exception
+{
+public:
+	virtual const char* what() const throw() {
+		return streaming_exception::what();
+	}
+};
+
+
+/** Find a key in a table of sorted keys, which is accompanied by a fanout table as used in all git index formats.
+  * \param fanout 256 big-endian 32 bit integers, each one representing the amount of keys whose first byte
+  * is smaller or equal to the integer's index
+  * \param keys sorted array of keys
+  * \param key_len length of a single key in bytes
+  * \param key bytes of the key to find
+  * \return index of the key within the keys array, or the total amount of keys if it could not be found
+  * \ingroup ODBUtil
+  */
+inline uint32 fanout_lookup(const uchar* fanout, const uchar* keys, size_t key_len, const uchar* key)
+{
+	uint32 lo = key[0] ? ntoh32(fanout + (key[0]-1)*4) : 0;
+	uint32 hi = ntoh32(fanout + key[0]*4);
+	const uint32 num_keys = ntoh32(fanout + 255*4);
+
+	while (lo < hi) {
+		const uint32 mid = lo + (hi - lo) / 2;
+		const int res = std::memcmp(keys + (size_t)mid * key_len, key, key_len);
+		if (res == 0) {
+			return mid;
+		} else if (res < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return num_keys;
+}
+
+/** \return true if the given fanout table never decreases, which is required for fanout_lookup() to stay
+  * within the keys array
+  * \ingroup ODBUtil
+  */
+inline bool fanout_is_valid(const uchar* fanout)
+{
+	for (uint32 i = 1; i < 256; ++i) {
+		if (ntoh32(fanout + (i-1)*4) > ntoh32(fanout + i*4)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/** Inflate a zlib compressed stream into the given buffer.
+  * \param src start of the compressed stream
+  * \param src_len amount of bytes available at src, which may be more than the actual compressed stream
+  * \param dest buffer to receive the inflated bytes
+  * \param dest_len size of the destination buffer. Unless partial is true, it must match the inflated size exactly.
+  * \param partial if true, inflation stops as soon as the destination buffer is full, without requiring
+  * the end of the stream to be reached.
+  * \return amount of bytes written into dest
+  * \throw pack_error if the stream is corrupted or doesn't match the destination buffer size
+  * \ingroup ODBUtil
+  */
+inline size_t inflate_buffer(const uchar* src, size_t src_len, char* dest, size_t dest_len, bool partial = false)
+{
+	if (partial && !dest_len) {
+		return 0;
+	}
+	const size_t max_chunk = std::numeric_limits<uInt>::max();
+	z_stream zs;
+	std::memset(&zs, 0, sizeof(zs));
+	if (inflateInit(&zs) != Z_OK) {
+		pack_error err;
+		err.stream() << "failed to initialize zlib stream";
+		throw err;
+	}
+
+	// zlib rejects a null output buffer, as passed for empty objects. These inflate into a dummy byte instead,
+	// which must remain unused
+	char dummy;
+	const size_t out_len = dest_len ? dest_len : 1;
+	zs.next_in = const_cast<Bytef*>(src);
+	zs.next_out = reinterpret_cast<Bytef*>(dest_len ? dest : &dummy);
+	size_t in_left = src_len;
+	size_t out_left = out_len;
+	int res = Z_OK;
+
+	while (res == Z_OK && (out_left || !partial)) {
+		const uInt avail_in = (uInt)std::min(in_left, max_chunk);
+		const uInt avail_out = (uInt)std::min(out_left, max_chunk);
+		zs.avail_in = avail_in;
+		zs.avail_out = avail_out;
+		res = inflate(&zs, partial ? Z_SYNC_FLUSH : Z_NO_FLUSH);
+		in_left -= avail_in - zs.avail_in;
+		out_left -= avail_out - zs.avail_out;
+		if (res == Z_OK && avail_in == zs.avail_in && avail_out == zs.avail_out) {
+			res = Z_BUF_ERROR;	// no progress
+		}
+	}// while inflating
+	inflateEnd(&zs);
+
+	const size_t written = out_len - out_left;
+	if (partial ? (res != Z_OK && res != Z_STREAM_END) : (res != Z_STREAM_END || written != dest_len)) {
+		pack_error err;
+		err.stream() << "failed to inflate compressed stream: zlib error " << res << ", inflated " << written << " of " << dest_len << " bytes";
+		throw err;
+	}
+
+	return written;
+}
+
+
+/** \brief read-only access to a pack index file in version 2.
+  *
+  * The index maps keys to offsets of entries within the associated pack. Keys are sorted, and can be
+  * accessed by entry index in the range of [0, num_entries()). The file is memory mapped, all returned
+  * pointers are valid as long as the instance exists.
+  * \tparam KeyType basic_hash compatible key type
+  * \ingroup ODB
+  */
+template <class KeyType>
+class pack_index
+{
+public:
+	typedef KeyType						key_type;
+	typedef fs::path					path_type;
+
+	static const uint32					version = 2;
+
+protected:
+	path_type				m_path;
+	io::mapped_file_source	m_file;
+	const uchar*			m_fanout;		//!< 256 entries fanout table
+	const uchar*			m_keys;			//!< sorted keys
+	const uchar*			m_crcs;			//!< crc32 of compressed entry data
+	const uchar*			m_offsets;		//!< 32 bit offsets, or indices into the large offset table
+	const uchar*			m_large_offsets;//!< 64 bit offsets
+	uint32					m_num_entries;
+	size_t					m_num_large_offsets;
+
+	void throw_corrupt(const char* msg) const {
+		pack_error err;
+		err.stream() << "pack index at " << m_path << " is corrupt: " << msg;
+		throw err;
+	}
+
+public:
+	//! Open the index at the given path
+	//! \throw pack_error if the file does not exist or has an unsupported format
+	explicit pack_index(const path_type& path)
+		: m_path(path)
+	{
+		static const uchar magic[] = {0xff, 't', 'O', 'c'};
+		const size_t hl = key_type::hash_len;
+		if (!fs::is_regular_file(path)) {
+			pack_error err;
+			err.stream() << "pack index at " << path << " does not exist";
+			throw err;
+		}
+		m_file.open(path.string());
+
+		const uchar* d = reinterpret_cast<const uchar*>(m_file.data());
+		if (m_file.size() < 8 + 256*4 + 2*hl || std::memcmp(d, magic, 4) != 0 || ntoh32(d+4) != version) {
+			pack_error err;
+			err.stream() << "pack index at " << path << " is not a version " << version << " index";
+			throw err;
+		}
+		m_fanout = d + 8;
+		m_num_entries = ntoh32(m_fanout + 255*4);
+		m_keys = m_fanout + 256*4;
+		m_crcs = m_keys + (size_t)m_num_entries * hl;
+		m_offsets = m_crcs + (size_t)m_num_entries * 4;
+		m_large_offsets = m_offsets + (size_t)m_num_entries * 4;
+
+		if ((size_t)(m_large_offsets - d) + 2*hl > m_file.size()) {
+			pack_error err;
+			err.stream() << "pack index at " << path << " is truncated";
+			throw err;
+		}
+		m_num_large_offsets = (m_file.size() - 2*hl - (size_t)(m_large_offsets - d)) / 8;
+		if (!fanout_is_valid(m_fanout)) {
+			throw_corrupt("fanout table is not sorted");
+		}
+	}
+
+public:
+	//! \return path to our index file
+	const path_type& path() const {
+		return m_path;
+	}
+
+	//! \return amount of entries in the index
+	uint32 num_entries() const {
+		return m_num_entries;
+	}
+
+	//! \return raw bytes of the key at the given entry index
+	const uchar* key_bytes(uint32 entry) const {
+		return m_keys + (size_t)entry * key_type::hash_len;
+	}
+
+	//! \return key at the given entry index
+	key_type key(uint32 entry) const {
+		return key_type(reinterpret_cast<const typename key_type::char_type*>(key_bytes(entry)));
+	}
+
+	//! \return crc32 of the compressed entry data within the pack
+	uint32 crc(uint32 entry) const {
+		return ntoh32(m_crcs + (size_t)entry * 4);
+	}
+
+	//! \return offset of the entry within the pack
+	//! \throw pack_error if the entry refers to a large offset which doesn't exist
+	uint64_t offset(uint32 entry) const {
+		const uint32 ofs = ntoh32(m_offsets + (size_t)entry * 4);
+		if (ofs & 0x80000000) {
+			if ((ofs & 0x7fffffff) >= m_num_large_offsets) {
+				throw_corrupt("large offset out of bounds");
+			}
+			return ntoh64(m_large_offsets + (size_t)(ofs & 0x7fffffff) * 8);
+		}
+		return ofs;
+	}
+
+	//! \return index of the entry identified by the given key, or num_entries() if the key does not exist
+	uint32 lookup(const key_type& key) const {
+		return lookup(reinterpret_cast<const uchar*>(key.bytes()));
+	}
+
+	//! Same as above, but uses the raw bytes of a key
+	uint32 lookup(const uchar* key) const {
+		return fanout_lookup(m_fanout, m_keys, key_type::hash_len, key);
+	}
+
+	//! \return checksum of the pack this index belongs to
+	key_type pack_checksum() const {
+		const char* end = m_file.data() + m_file.size();
+		return key_type(reinterpret_cast<const typename key_type::char_type*>(end - 2*key_type::hash_len));
+	}
+};
+
+
+/** \brief policy providing the mapping between pack entry type ids and object types
+  * \note this struct just defines the interface, the actual implementation needs
+  * to be provided by the derived type.
+  * \ingroup ODBPolicy
+  */
+struct odb_pack_policy
+{
+	//! Convert a non-delta pack entry type id into the matching object type
+	//! \param pack_type raw type id as stored in the pack
+	//! \param type receives the object type
+	//! \throw pack_error if the id is unknown
+	template <class ObjectType>
+	void to_object_type(uchar pack_type, ObjectType& type);
+
+	//! \return pack entry type id to be used for the given object type
+	template <class ObjectType>
+	uchar to_pack_type(const ObjectType type);
+
+	//! Update the hash generator with the header which is hashed along with object data to obtain its key
+	template <class HashGeneratorType, class ObjectType, class SizeType>
+	void header_hash(HashGeneratorType& gen, const ObjectType type, const SizeType size);
+};
+
+
+/** \brief cache keeping fully resolved objects of a pack, which are likely to be used as delta bases.
+  *
+  * Objects are identified by their offset in the pack. If the cache exceeds its memory limit, the least recently
+  * used objects are dropped. When objects are read in pack order, bases precede their deltas, hence even a small
+  * cache saves most of the repeated inflation of delta chains.
+  * \note the cache is not thread-safe
+  * \tparam DataType vector-like type keeping object data
+  * \tparam ObjectType type identifying the kind of object
+  * \ingroup ODBUtil
+  */
+template <class DataType, class ObjectType>
+class pack_delta_cache
+{
+public:
+	typedef DataType										data_type;
+	typedef ObjectType										object_type;
+
+	/** A single cached object
+	  */
+	struct entry
+	{
+		object_type							type;
+		std::shared_ptr<const data_type>	data;
+	};
+
+protected:
+	typedef std::list<std::pair<uint64_t, entry> >			list_type;
+
+	list_type								m_lru;		//!< most recently used first
+	std::map<uint64_t, typename list_type::iterator>	m_map;
+	size_t									m_max_bytes;
+	size_t									m_bytes;
+
+public:
+	//! Initialize an empty cache which keeps at most max_bytes worth of object data
+	explicit pack_delta_cache(size_t max_bytes = 16 * 1024 * 1024)
+		: m_max_bytes(max_bytes)
+		, m_bytes(0)
+	{}
+
+	//! \return cached object at the given offset, or 0 if it is not cached
+	const entry* get(uint64_t offset) {
+		auto it = m_map.find(offset);
+		if (it == m_map.end()) {
+			return nullptr;
+		}
+		m_lru.splice(m_lru.begin(), m_lru, it->second);
+		return &it->second->second;
+	}
+
+	//! Add the given object, possibly dropping other objects. Objects larger than the cache are ignored.
+	void put(uint64_t offset, object_type type, const std::shared_ptr<const data_type>& data) {
+		if (data->size() > m_max_bytes || m_map.find(offset) != m_map.end()) {
+			return;
+		}
+		while (m_bytes + data->size() > m_max_bytes) {
+			m_bytes -= m_lru.back().second.data->size();
+			m_map.erase(m_lru.back().first);
+			m_lru.pop_back();
+		}
+		const entry e = {type, data};
+		m_lru.push_front(std::make_pair(offset, e));
+		m_map[offset] = m_lru.begin();
+		m_bytes += data->size();
+	}
+
+	//! \return amount of cached objects
+	size_t size() const {
+		return m_map.size();
+	}
+
+	//! \return amount of bytes of all cached objects
+	size_t bytes() const {
+		return m_bytes;
+	}
+};
+
+
+/** \brief read-only access to a pack and its index.
+  *
+  * A pack is a single file containing many zlib compressed entries. Entries are either complete objects, or deltas
+  * against a base entry, which is referred to by offset or by key. Deltas are resolved transparently.
+  * Both the pack and its index are memory mapped.
+  * \tparam ObjectTraits traits for general git settings
+  * \tparam Traits pack database traits, providing the policy to map entry types to object types
+  * \ingroup ODB
+  */
+template <class ObjectTraits, class Traits>
+class pack_file
+{
+public:
+	typedef ObjectTraits										traits_type;
+	typedef Traits												db_traits_type;
+	typedef typename traits_type::key_type						key_type;
+	typedef typename traits_type::char_type						char_type;
+	typedef typename traits_type::size_type						size_type;
+	typedef typename traits_type::object_type					object_type;
+	typedef typename db_traits_type::path_type					path_type;
+	typedef pack_index<key_type>								index_type;
+	typedef std::vector<char_type>								data_type;
+	typedef pack_delta_cache<data_type, object_type>			cache_type;
+
+	static const uchar		ofs_delta_type = 6;		//!< delta whose base is identified by relative offset
+	static const uchar		ref_delta_type = 7;		//!< delta whose base is identified by its key
+
+	/** Information about a single entry, as parsed from its header
+	  */
+	struct entry_info
+	{
+		uchar		type;			//!< raw pack type id
+		size_type	size;			//!< inflated size of the entry data, which is the delta size in case of deltas
+		uint64_t	offset;			//!< offset of the entry header
+		uint64_t	data_offset;	//!< offset of the compressed entry data
+		uint64_t	base_offset;	//!< offset of the base entry, only valid for deltas
+	};
+
+protected:
+	path_type				m_path;
+	index_type				m_index;
+	io::mapped_file_source	m_pack;
+
+	mutable std::once_flag			m_order_once;
+	mutable std::vector<uint32>		m_pack_order;		//!< index entries sorted by offset
+	mutable std::vector<uint32>		m_pack_positions;	//!< position in pack order per index entry
+
+protected:
+	void init_pack_order() const {
+		const uint32 n = num_entries();
+		std::vector<std::pair<uint64_t, uint32> > offsets(n);
+		for (uint32 i = 0; i < n; ++i) {
+			offsets[i] = std::make_pair(m_index.offset(i), i);
+		}
+		std::sort(offsets.begin(), offsets.end());
+		m_pack_order.resize(n);
+		m_pack_positions.resize(n);
+		for (uint32 p = 0; p < n; ++p) {
+			m_pack_order[p] = offsets[p].second;
+			m_pack_positions[offsets[p].second] = p;
+		}
+	}
+
+	static size_type delta_header_size(const uchar*& d, const uchar* end) {
+		size_type size = 0;
+		uint shift = 0;
+		uchar c = 0x80;
+		while ((c & 0x80) && d < end) {
+			c = *d++;
+			size |= (size_type)(c & 0x7f) << shift;
+			shift += 7;
+		}
+		return size;
+	}
+
+	//! Inflate the data of the given entry into the destination buffer, which must have the entry's size
+	void inflate_entry(const entry_info& info, char_type* dest) const {
+		inflate_buffer(bytes() + info.data_offset, data_size() - info.data_offset, dest, info.size);
+	}
+
+	void throw_corrupt(uint64_t ofs, const char* msg) const {
+		pack_error err;
+		err.stream() << "entry at offset " << ofs << " in pack " << m_path << ": " << msg;
+		throw err;
+	}
+
+public:
+	//! Open the pack at the given path, as well as its index, which is expected to have the same name,
+	//! but the .idx extension
+	//! \throw pack_error
+	explicit pack_file(const path_type& pack_path)
+		: m_path(pack_path)
+		, m_index(path_type(pack_path).replace_extension(".idx"))
+	{
+		if (!fs::is_regular_file(pack_path)) {
+			pack_error err;
+			err.stream() << "pack at " << pack_path << " does not exist";
+			throw err;
+		}
+		m_pack.open(pack_path.string());
+		const uchar* d = bytes();
+		if (m_pack.size() < 12 + key_type::hash_len || std::memcmp(d, "PACK", 4) != 0 ||
+			(ntoh32(d+4) != 2 && ntoh32(d+4) != 3))
+		{
+			pack_error err;
+			err.stream() << "file at " << pack_path << " is no pack of version 2 or 3";
+			throw err;
+		}
+		if (ntoh32(d+8) != m_index.num_entries()) {
+			pack_error err;
+			err.stream() << "pack at " << pack_path << " has " << ntoh32(d+8) << " entries, its index has " << m_index.num_entries();
+			throw err;
+		}
+	}
+
+public:
+	//! \return true if the given raw pack type id identifies a delta
+	static bool is_delta(uchar type) {
+		return type == ofs_delta_type || type == ref_delta_type;
+	}
+
+	/** Apply a delta to its base buffer
+	  * \param base buffer the delta is based on
+	  * \param delta data of a delta entry
+	  * \param out buffer to receive the target data
+	  * \throw pack_error if the delta does not match the base or is corrupted
+	  */
+	static void apply_delta(const data_type& base, const data_type& delta, data_type& out) {
+		const uchar* d = reinterpret_cast<const uchar*>(delta.data());
+		const uchar* dend = d + delta.size();
+		const size_type base_size = delta_header_size(d, dend);
+		const size_type target_size = delta_header_size(d, dend);
+		pack_error err;
+		if (base_size != base.size()) {
+			err.stream() << "delta base has size " << base.size() << ", expected " << base_size;
+			throw err;
+		}
+
+		out.resize(target_size);
+		char_type* o = out.data();
+		char_type* const oend = o + target_size;
+		while (d < dend) {
+			const uchar cmd = *d++;
+			if (cmd & 0x80) {
+				uint64_t cofs = 0;
+				size_type csize = 0;
+				for (uint i = 0; i < 7; ++i) {
+					if (!(cmd & (1 << i))) {
+						continue;
+					}
+					if (d == dend) {
+						err.stream() << "truncated delta copy instruction";
+						throw err;
+					}
+					if (i < 4) {
+						cofs |= (uint64_t)*d++ << (i*8);
+					} else {
+						csize |= (size_type)*d++ << ((i-4)*8);
+					}
+				}// for each argument byte
+				if (csize == 0) {
+					csize = 0x10000;
+				}
+				if (cofs + csize > base.size() || csize > (size_type)(oend - o)) {
+					err.stream() << "delta copy instruction out of bounds";
+					throw err;
+				}
+				std::memcpy(o, base.data() + cofs, csize);
+				o += csize;
+			} else if (cmd) {
+				if (cmd > dend - d || cmd > oend - o) {
+					err.stream() << "delta insert instruction out of bounds";
+					throw err;
+				}
+				std::memcpy(o, d, cmd);
+				d += cmd;
+				o += cmd;
+			} else {
+				err.stream() << "invalid delta instruction";
+				throw err;
+			}
+		}// for each instruction
+
+		if (o != oend) {
+			err.stream() << "delta produced " << (o - out.data()) << " bytes, expected " << target_size;
+			throw err;
+		}
+	}
+
+public:
+	//! \return path to the pack file
+	const path_type& path() const {
+		return m_path;
+	}
+
+	//! \return our index
+	const index_type& index() const {
+		return m_index;
+	}
+
+	//! \return amount of entries in this pack
+	uint32 num_entries() const {
+		return m_index.num_entries();
+	}
+
+	//! \return index entries in the order in which they are stored in the pack, i.e. sorted by offset.
+	//! The position of an entry within this vector is its pack position.
+	//! \note computed on first use, which is thread-safe
+	const std::vector<uint32>& pack_order() const {
+		std::call_once(m_order_once, &pack_file::init_pack_order, this);
+		return m_pack_order;
+	}
+
+	//! \return pack position of the given index entry
+	uint32 pack_position(uint32 entry) const {
+		pack_order();
+		return m_pack_positions[entry];
+	}
+
+	//! \return index entry of the object whose entry starts at the given offset
+	//! \throw pack_error if there is no entry at the offset
+	uint32 entry_at(uint64_t ofs) const {
+		const std::vector<uint32>& order = pack_order();
+		auto it = std::lower_bound(order.begin(), order.end(), ofs, [this](uint32 entry, uint64_t o) {
+			return m_index.offset(entry) < o;
+		});
+		if (it == order.end() || m_index.offset(*it) != ofs) {
+			throw_corrupt(ofs, "no entry starts at offset");
+		}
+		return *it;
+	}
+
+	//! \return offset one past the last byte of the given index entry, which is where the next entry starts
+	uint64_t end_offset(uint32 entry) const {
+		const uint32 pos = pack_position(entry) + 1;
+		return pos < num_entries() ? m_index.offset(pack_order()[pos]) : data_size();
+	}
+
+	//! \return pointer to the first byte of the memory mapped pack
+	const char_type* data() const {
+		return m_pack.data();
+	}
+
+	//! \return amount of bytes of pack data, excluding the trailing checksum
+	size_t data_size() const {
+		return m_pack.size() - key_type::hash_len;
+	}
+
+	//! \return unsigned version of data()
+	const uchar* bytes() const {
+		return reinterpret_cast<const uchar*>(m_pack.data());
+	}
+
+	//! Parse the header of the entry at the given offset
+	//! \throw pack_error if the header is corrupted
+	void entry(uint64_t ofs, entry_info& info) const {
+		const uchar* p = bytes() + ofs;
+		const uchar* const end = bytes() + data_size();
+		if (ofs < 12 || p >= end) {
+			throw_corrupt(ofs, "offset out of bounds");
+		}
+
+		uchar c = *p++;
+		info.offset = ofs;
+		info.type = (c >> 4) & 7;
+		info.size = c & 15;
+		for (uint shift = 4; c & 0x80; shift += 7) {
+			if (p == end) {
+				throw_corrupt(ofs, "truncated header");
+			}
+			c = *p++;
+			info.size += (size_type)(c & 0x7f) << shift;
+		}
+
+		if (info.type == ofs_delta_type) {
+			if (p == end) {
+				throw_corrupt(ofs, "truncated delta offset");
+			}
+			c = *p++;
+			uint64_t base = c & 0x7f;
+			while (c & 0x80) {
+				if (p == end) {
+					throw_corrupt(ofs, "truncated delta offset");
+				}
+				c = *p++;
+				base = ((base + 1) << 7) | (c & 0x7f);
+			}
+			if (base == 0 || base > ofs) {
+				throw_corrupt(ofs, "delta base offset out of bounds");
+			}
+			info.base_offset = ofs - base;
+		} else if (info.type == ref_delta_type) {
+			if ((size_t)(end - p) < key_type::hash_len) {
+				throw_corrupt(ofs, "truncated delta base key");
+			}
+			const uint32 base_entry = m_index.lookup(p);
+			if (base_entry == m_index.num_entries()) {
+				throw_corrupt(ofs, "delta base is not contained in pack");
+			}
+			info.base_offset = m_index.offset(base_entry);
+			p += key_type::hash_len;
+		} else if (info.type == 0 || info.type == 5) {
+			throw_corrupt(ofs, "invalid entry type");
+		}
+
+		info.data_offset = p - bytes();
+	}
+
+	//! Obtain the final type and size of the object at the given offset. In case of deltas, only
+	//! the headers of the delta chain are parsed, which is considerably faster than a full decompression.
+	//! \throw pack_error
+	void info(uint64_t ofs, object_type& type, size_type& size) const {
+		entry_info info;
+		entry(ofs, info);
+		if (!is_delta(info.type)) {
+			typename db_traits_type::policy_type().to_object_type(info.type, type);
+			size = info.size;
+			return;
+		}
+
+		// target size is the second size in the delta header
+		char_type hdr[32];
+		const size_t nb = inflate_buffer(bytes() + info.data_offset, data_size() - info.data_offset,
+										 hdr, std::min(sizeof(hdr), (size_t)info.size), true);
+		const uchar* d = reinterpret_cast<const uchar*>(hdr);
+		delta_header_size(d, d + nb);
+		size = delta_header_size(d, d + nb);
+
+		for (uint32 depth = 0; is_delta(info.type); ++depth) {
+			if (depth > num_entries()) {
+				throw_corrupt(ofs, "delta chain contains a cycle");
+			}
+			entry(info.base_offset, info);
+		}
+		typename db_traits_type::policy_type().to_object_type(info.type, type);
+	}
+
+	//! Fully decompress the object at the given offset, resolving its delta chain if required
+	//! \param ofs offset of the entry
+	//! \param type receives the object's type
+	//! \param out buffer to receive the object data, it will be resized as required.
+	//! \param cache if set, delta bases are looked up in the cache, and all objects resolved on the way are added to it
+	//! \throw pack_error
+	void decompress(uint64_t ofs, object_type& type, data_type& out, cache_type* cache = nullptr) const {
+		entry_info info;
+		entry(ofs, info);
+
+		std::vector<uint64_t> chain;
+		const typename cache_type::entry* cached = nullptr;
+		while (is_delta(info.type)) {
+			if (chain.size() > num_entries()) {
+				throw_corrupt(ofs, "delta chain contains a cycle");
+			}
+			chain.push_back(info.offset);
+			if (cache && (cached = cache->get(info.base_offset)) != nullptr) {
+				break;
+			}
+			entry(info.base_offset, info);
+		}// for each delta in the chain
+
+		if (cached) {
+			type = cached->type;
+			out = *cached->data;
+		} else {
+			typename db_traits_type::policy_type().to_object_type(info.type, type);
+			out.resize(info.size);
+			inflate_entry(info, out.data());
+			if (cache && !chain.empty()) {
+				cache->put(info.offset, type, std::make_shared<data_type>(out));
+			}
+		}
+
+		data_type delta, target;
+		for (auto i = chain.rbegin(); i != chain.rend(); ++i) {
+			entry(*i, info);
+			delta.resize(info.size);
+			inflate_entry(info, delta.data());
+			apply_delta(out, delta, target);
+			out.swap(target);
+			if (cache) {
+				cache->put(*i, type, std::make_shared<data_type>(out));
+			}
+		}// for each delta to apply, starting at the base
+	}
+};
+
+GTL_NAMESPACE_END
+GTL_HEADER_END
+
+#endif // GTL_PACK_FILE_HPP
@@ -0,0 +1,362 @@
+#ifndef GTL_PACK_MIDX_HPP
+#define GTL_PACK_MIDX_HPP
+
+#include <gtl/config.h>
+#include <gtl/db/pack_file.hpp>
+#include <gtl/util.hpp>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+GTL_HEADER_BEGIN
+GTL_NAMESPACE_BEGIN
+
+namespace io = boost::iostreams;
+namespace fs = boost::filesystem;
+
+/** \brief read-only access to a multi-pack-index, which merges the indices of many packs into a single sorted table.
+  *
+  * Instead of probing the index of each pack in turn, a single binary search yields the pack-id and the offset
+  * of an object. Pack-ids refer to the pack names stored in the file, which are sorted lexicographically.
+  * The file format is compatible to version 1 of git's multi-pack-index, and is memory mapped.
+  * \tparam ObjectTraits traits providing the key type as well as the hash generator to produce the trailing checksum
+  * \ingroup ODB
+  */
+template <class ObjectTraits>
+class multi_pack_index
+{
+public:
+	typedef ObjectTraits										traits_type;
+	typedef typename traits_type::key_type						key_type;
+	typedef typename traits_type::hash_generator_type			hash_generator_type;
+	typedef pack_index<key_type>								index_type;
+	typedef fs::path											path_type;
+	typedef std::vector<std::string>							name_vector_type;
+
+	static const uchar		version = 1;
+	static const uchar		hash_version = 1;		//!< identifies SHA1 keys
+
+protected:
+	//! \return integer representation of the given 4 character chunk id
+	static uint32 chunk_id(const char* id) {
+		return ntoh32(reinterpret_cast<const uchar*>(id));
+	}
+
+	path_type				m_path;
+	io::mapped_file_source	m_file;
+	name_vector_type		m_names;			//!< sorted pack names, the index is the pack-id
+	const uchar*			m_fanout;
+	const uchar*			m_keys;
+	const uchar*			m_offsets;			//!< pairs of pack-id and 32 bit offset
+	const uchar*			m_large_offsets;	//!< may be 0 if there is no object at a large offset
+	size_t					m_num_large_offsets;
+	uint32					m_num_entries;
+
+	void throw_corrupt(const char* msg) const {
+		pack_error err;
+		err.stream() << "multi-pack-index at " << m_path << ": " << msg;
+		throw err;
+	}
+
+	//! Write data to the stream and update the hash
+	static void write_hashed(std::ofstream& out, hash_generator_type& gen, const void* data, size_t len) {
+		out.write(reinterpret_cast<const char*>(data), len);
+		gen.update(reinterpret_cast<const typename hash_generator_type::char_type*>(data), len);
+	}
+
+public:
+	//! Open the multi-pack-index at the given path
+	//! \throw pack_error if the file doesn't exist or is corrupted
+	explicit multi_pack_index(const path_type& path)
+		: m_path(path)
+		, m_fanout(nullptr)
+		, m_keys(nullptr)
+		, m_offsets(nullptr)
+		, m_large_offsets(nullptr)
+		, m_num_large_offsets(0)
+		, m_num_entries(0)
+	{
+		if (!fs::is_regular_file(path)) {
+			throw_corrupt("file does not exist");
+		}
+		m_file.open(path.string());
+
+		const uchar* d = reinterpret_cast<const uchar*>(m_file.data());
+		const size_t size = m_file.size();
+		if (size < 12 + 12 + key_type::hash_len || std::memcmp(d, "MIDX", 4) != 0) {
+			throw_corrupt("invalid signature");
+		}
+		if (d[4] != version || d[5] != hash_version || d[7] != 0) {
+			throw_corrupt("unsupported version");
+		}
+		const uint32 num_chunks = d[6];
+		const uint32 num_packs = ntoh32(d+8);
+		if (12 + (num_chunks+1) * 12 > size) {
+			throw_corrupt("truncated chunk table");
+		}
+
+		const uchar* names = nullptr;
+		const uchar* names_end = nullptr;
+		uint64_t fanout_size = 0, keys_size = 0, offsets_size = 0;
+		for (uint32 i = 0; i < num_chunks; ++i) {
+			const uchar* c = d + 12 + i*12;
+			const uint64_t ofs = ntoh64(c+4);
+			const uint64_t next_ofs = ntoh64(c+16);
+			if (ofs > next_ofs || next_ofs > size - key_type::hash_len) {
+				throw_corrupt("chunk out of bounds");
+			}
+			const uint32 id = ntoh32(c);
+			if (id == chunk_id("PNAM")) {
+				names = d + ofs;
+				names_end = d + next_ofs;
+			} else if (id == chunk_id("OIDF")) {
+				m_fanout = d + ofs;
+				fanout_size = next_ofs - ofs;
+			} else if (id == chunk_id("OIDL")) {
+				m_keys = d + ofs;
+				keys_size = next_ofs - ofs;
+			} else if (id == chunk_id("OOFF")) {
+				m_offsets = d + ofs;
+				offsets_size = next_ofs - ofs;
+			} else if (id == chunk_id("LOFF")) {
+				m_large_offsets = d + ofs;
+				m_num_large_offsets = (size_t)((next_ofs - ofs) / 8);
+			}
+		}// for each chunk
+
+		if (!names || !m_fanout || !m_keys || !m_offsets) {
+			throw_corrupt("missing required chunk");
+		}
+		if (fanout_size != 256*4) {
+			throw_corrupt("invalid fanout chunk size");
+		}
+		if (!fanout_is_valid(m_fanout)) {
+			throw_corrupt("fanout table is not sorted");
+		}
+		m_num_entries = ntoh32(m_fanout + 255*4);
+		if (keys_size != (uint64_t)m_num_entries * key_type::hash_len) {
+			throw_corrupt("invalid object id chunk size");
+		}
+		if (offsets_size != (uint64_t)m_num_entries * 8) {
+			throw_corrupt("invalid object offset chunk size");
+		}
+
+		m_names.reserve(num_packs);
+		for (const uchar* n = names; m_names.size() < num_packs; ) {
+			const uchar* e = static_cast<const uchar*>(std::memchr(n, 0, names_end - n));
+			if (!e) {
+				throw_corrupt("truncated pack names");
+			}
+			m_names.push_back(std::string(reinterpret_cast<const char*>(n), e - n));
+			n = e + 1;
+		}
+	}
+
+public:
+	//! @{ \name Interface
+
+	//! \return path to our file
+	const path_type& path() const {
+		return m_path;
+	}
+
+	//! \return amount of packs covered by this index
+	uint32 num_packs() const {
+		return m_names.size();
+	}
+
+	//! \return sorted names of the pack indices covered by this index. The position of a name is its pack-id
+	const name_vector_type& pack_names() const {
+		return m_names;
+	}
+
+	//! \return amount of unique objects in all covered packs
+	uint32 num_entries() const {
+		return m_num_entries;
+	}
+
+	//! \return key at the given entry index
+	key_type key(uint32 entry) const {
+		return key_type(reinterpret_cast<const typename key_type::char_type*>(m_keys + (size_t)entry * key_type::hash_len));
+	}
+
+	//! \return pack-id of the pack containing the entry, which is smaller than num_packs()
+	//! \throw pack_error if the pack-id is out of bounds
+	uint32 pack_id(uint32 entry) const {
+		const uint32 id = ntoh32(m_offsets + (size_t)entry * 8);
+		if (id >= m_names.size()) {
+			throw_corrupt("pack-id out of bounds");
+		}
+		return id;
+	}
+
+	//! \return offset of the entry within the pack identified by pack_id()
+	//! \throw pack_error if the entry refers to a large offset which doesn't exist
+	uint64_t offset(uint32 entry) const {
+		const uint32 ofs = ntoh32(m_offsets + (size_t)entry * 8 + 4);
+		if (ofs & 0x80000000) {
+			if ((ofs & 0x7fffffff) >= m_num_large_offsets) {
+				throw_corrupt("large offset out of bounds");
+			}
+			return ntoh64(m_large_offsets + (size_t)(ofs & 0x7fffffff) * 8);
+		}
+		return ofs;
+	}
+
+	//! \return entry index of the given key, or num_entries() if it is not contained in this index
+	uint32 lookup(const key_type& key) const {
+		return fanout_lookup(m_fanout, m_keys, key_type::hash_len, reinterpret_cast<const uchar*>(key.bytes()));
+	}
+
+	//! Find the pack and the offset of the object identified by key
+	//! \return true if the object was found, in which case pack_id and offset are set
+	bool lookup(const key_type& key, uint32& pack_id, uint64_t& offset) const {
+		const uint32 entry = lookup(key);
+		if (entry == m_num_entries) {
+			return false;
+		}
+		pack_id = this->pack_id(entry);
+		offset = this->offset(entry);
+		return true;
+	}
+
+	//! @}
+
+public:
+	/** Write a multi-pack-index covering the given pack indices.
+	  * All keys are merged into one sorted table. If a key is contained in multiple packs, the entry of
+	  * the pack with the smallest pack-id is used.
+	  * \param path location of the file to write, an existing file will be overwritten
+	  * \param names names of the index files, like pack-<hash>.idx, as used to identify packs when reading
+	  * \param indices indices to merge, matching the order of names
+	  * \throw pack_error if there is a mismatch between names and indices or if too many objects are provided
+	  * \throw std::ios_base::failure if the file could not be written
+	  */
+	static void write(const path_type& path, const name_vector_type& names, const std::vector<const index_type*>& indices)
+	{
+		if (names.size() != indices.size()) {
+			pack_error err;
+			err.stream() << "need one name per pack index, got " << names.size() << " names for " << indices.size() << " indices";
+			throw err;
+		}
+
+		// pack-ids are assigned by sorted name
+		std::vector<uint32> order(names.size());
+		for (uint32 i = 0; i < order.size(); ++i) {
+			order[i] = i;
+		}
+		std::sort(order.begin(), order.end(), [&names](uint32 l, uint32 r) { return names[l] < names[r]; });
+
+		struct entry {
+			const uchar*	key;
+			uint32			pack_id;
+			uint64_t		offset;
+		};
+		size_t total = 0;
+		for (auto i = indices.begin(); i != indices.end(); ++i) {
+			total += (*i)->num_entries();
+		}
+		if (total >= 0x7fffffff) {
+			pack_error err;
+			err.stream() << "cannot write multi-pack-index with " << total << " entries";
+			throw err;
+		}
+		std::vector<entry> entries;
+		entries.reserve(total);
+		for (uint32 pid = 0; pid < order.size(); ++pid) {
+			const index_type& idx = *indices[order[pid]];
+			for (uint32 e = 0; e < idx.num_entries(); ++e) {
+				const entry ent = {idx.key_bytes(e), pid, idx.offset(e)};
+				entries.push_back(ent);
+			}
+		}// for each pack
+
+		const size_t hl = key_type::hash_len;
+		std::stable_sort(entries.begin(), entries.end(), [hl](const entry& l, const entry& r) {
+			return std::memcmp(l.key, r.key, hl) < 0;
+		});
+		entries.erase(std::unique(entries.begin(), entries.end(), [hl](const entry& l, const entry& r) {
+			return std::memcmp(l.key, r.key, hl) == 0;
+		}), entries.end());
+
+		// prepare chunks
+		std::string pnam;
+		for (auto i = order.begin(); i != order.end(); ++i) {
+			pnam += names[*i];
+			pnam += '\0';
+		}
+		pnam.resize((pnam.size() + 3) & ~3, '\0');
+
+		uchar fanout[256*4];
+		{
+			uint32 count = 0;
+			auto it = entries.begin();
+			for (uint32 b = 0; b < 256; ++b) {
+				for (; it != entries.end() && it->key[0] == b; ++it, ++count);
+				hton32(count, fanout + b*4);
+			}
+		}
+
+		std::vector<uchar> ooff(entries.size() * 8);
+		std::vector<uchar> loff;
+		for (size_t i = 0; i < entries.size(); ++i) {
+			hton32(entries[i].pack_id, &ooff[i*8]);
+			if (entries[i].offset >= 0x80000000) {
+				hton32(0x80000000 | (uint32)(loff.size() / 8), &ooff[i*8+4]);
+				loff.resize(loff.size() + 8);
+				hton64(entries[i].offset, &loff[loff.size()-8]);
+			} else {
+				hton32((uint32)entries[i].offset, &ooff[i*8+4]);
+			}
+		}
+
+		const uchar num_chunks = loff.empty() ? 4 : 5;
+		const char* const ids[] = {"PNAM", "OIDF", "OIDL", "OOFF", "LOFF"};
+		const uint64_t sizes[] = {pnam.size(), sizeof(fanout), entries.size() * hl, ooff.size(), loff.size()};
+
+		uchar header[12] = {'M', 'I', 'D', 'X', version, hash_version, num_chunks, 0};
+		hton32((uint32)names.size(), header + 8);
+
+		std::vector<uchar> table((num_chunks + 1) * 12);
+		uint64_t ofs = sizeof(header) + table.size();
+		for (uint32 c = 0; c <= num_chunks; ++c) {
+			if (c < num_chunks) {
+				std::memcpy(&table[c*12], ids[c], 4);
+			}
+			hton64(ofs, &table[c*12+4]);
+			if (c < num_chunks) {
+				ofs += sizes[c];
+			}
+		}
+
+		std::ofstream out;
+		out.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+		out.open(path.string().c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+		hash_generator_type gen;
+		write_hashed(out, gen, header, sizeof(header));
+		write_hashed(out, gen, table.data(), table.size());
+		write_hashed(out, gen, pnam.data(), pnam.size());
+		write_hashed(out, gen, fanout, sizeof(fanout));
+		for (auto i = entries.begin(); i != entries.end(); ++i) {
+			write_hashed(out, gen, i->key, hl);
+		}
+		write_hashed(out, gen, ooff.data(), ooff.size());
+		if (!loff.empty()) {
+			write_hashed(out, gen, loff.data(), loff.size());
+		}
+		const key_type checksum(gen.hash());
+		out.write(checksum.bytes(), hl);
+		out.close();
+	}
+};
+
+GTL_NAMESPACE_END
+GTL_HEADER_END
+
+#endif // GTL_PACK_MIDX_HPP
@@ -0,0 +1,397 @@
+#ifndef GTL_PACK_WRITER_HPP
+#define GTL_PACK_WRITER_HPP
+
+#include <gtl/config.h>
+#include <gtl/db/pack_file.hpp>
+#include <gtl/db/odb_raw.hpp>
+#include <gtl/util.hpp>
+
+#include <boost/filesystem.hpp>
+#include <zlib.h>
+
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <set>
+#include <cstring>
+#include <cctype>
+#include <algorithm>
+
+GTL_HEADER_BEGIN
+GTL_NAMESPACE_BEGIN
+
+namespace fs = boost::filesystem;
+
+/** \brief writes a new pack along with its version 2 index.
+  *
+  * Objects are appended one by one, either from input objects, which are deflated, or from raw objects, whose
+  * compressed data is copied as is after its crc32 was verified. Raw deltas are stored as deltas against their base
+  * key, which must be part of the same pack once it is finished, as thin packs are not supported.
+  * Raw data in loose format is inflated and deflated again, as its header is compressed along with the data.
+  *
+  * The pack is written into a temporary file within the destination directory, and moved into place by finish().
+  * If the writer is destroyed before, the temporary file is removed.
+  * \tparam ObjectTraits traits for general git settings
+  * \tparam Traits pack database traits, providing the policy to map object types to pack types
+  * \ingroup ODB
+  */
+template <class ObjectTraits, class Traits>
+class pack_writer
+{
+public:
+	typedef ObjectTraits										traits_type;
+	typedef Traits												db_traits_type;
+	typedef typename traits_type::key_type						key_type;
+	typedef typename traits_type::char_type						char_type;
+	typedef typename traits_type::size_type						size_type;
+	typedef typename traits_type::object_type					object_type;
+	typedef typename traits_type::hash_generator_type			hash_generator_type;
+	typedef typename db_traits_type::path_type					path_type;
+	typedef pack_file<traits_type, db_traits_type>				pack_type;
+	typedef odb_raw_object<traits_type>							raw_object_type;
+
+	static const size_t		buffer_size = 64 * 1024;
+
+protected:
+	/** Information required to write the index entry of an object
+	  */
+	struct entry
+	{
+		key_type	key;
+		uint64_t	offset;
+		uint32		crc;		//!< crc32 of the entry including its header
+	};
+
+	path_type				m_dir;
+	path_type				m_tmp_path;
+	std::fstream			m_file;
+	uint64_t				m_offset;		//!< offset at which the next entry will be written
+	std::vector<entry>		m_entries;
+	std::set<key_type>		m_keys;
+	std::vector<key_type>	m_delta_bases;	//!< bases of ref deltas, which must be contained once we finish
+	bool					m_finished;
+
+protected:
+	void write(const void* data, size_t len, uint32& crc) {
+		m_file.write(reinterpret_cast<const char*>(data), len);
+		crc = raw_crc32(data, len, crc);
+		m_offset += len;
+	}
+
+	//! write a pack entry header and return the crc32 of its bytes
+	uint32 write_header(uchar type, size_type size) {
+		uchar hdr[16];
+		uchar* p = hdr;
+		*p = (type << 4) | (size & 15);
+		size >>= 4;
+		while (size) {
+			*p++ |= 0x80;
+			*p = size & 0x7f;
+			size >>= 7;
+		}
+		uint32 crc = 0;
+		write(hdr, ++p - hdr, crc);
+		return crc;
+	}
+
+	void add_entry(const key_type& key, uint64_t offset, uint32 crc) {
+		const entry e = {key, offset, crc};
+		m_entries.push_back(e);
+		m_keys.insert(key);
+	}
+
+	void throw_zlib(int res) const {
+		pack_error err;
+		err.stream() << "failed to deflate entry into " << m_tmp_path << ": zlib error " << res;
+		throw err;
+	}
+
+	/** Deflate the given chunk and write the result into our file
+	  * \param zs initialized deflate stream
+	  * \param flush Z_FINISH for the last chunk
+	  */
+	void deflate_chunk(z_stream& zs, const char_type* data, size_t len, int flush, uint32& crc) {
+		uchar out[buffer_size];
+		zs.next_in = reinterpret_cast<Bytef*>(const_cast<char_type*>(data));
+		zs.avail_in = (uInt)len;
+		int res = Z_OK;
+		do {
+			zs.next_out = out;
+			zs.avail_out = sizeof(out);
+			res = deflate(&zs, flush);
+			if (res == Z_STREAM_ERROR) {
+				throw_zlib(res);
+			}
+			write(out, sizeof(out) - zs.avail_out, crc);
+		} while (zs.avail_out == 0 || (flush == Z_FINISH && res != Z_STREAM_END));
+	}
+
+	void init_deflate(z_stream& zs) const {
+		std::memset(&zs, 0, sizeof(zs));
+		if (deflateInit(&zs, Z_DEFAULT_COMPRESSION) != Z_OK) {
+			throw_zlib(Z_STREAM_ERROR);
+		}
+	}
+
+	//! Write the given object data as non-delta entry
+	void write_deflated(const key_type& key, object_type type, const char_type* data, size_type size) {
+		const uint64_t offset = m_offset;
+		uint32 crc = write_header(typename db_traits_type::policy_type().to_pack_type(type), size);
+
+		z_stream zs;
+		init_deflate(zs);
+		try {
+			do {
+				const size_t nb = (size_t)std::min(size, (size_type)buffer_size);
+				deflate_chunk(zs, data, nb, nb == size ? Z_FINISH : Z_NO_FLUSH, crc);
+				data += nb;
+				size -= nb;
+			} while (size);
+		} catch (...) {
+			deflateEnd(&zs);
+			throw;
+		}
+		deflateEnd(&zs);
+		add_entry(key, offset, crc);
+	}
+
+public:
+	//! Prepare writing a new pack into the given directory, which must exist
+	//! \throw std::ios_base::failure if the temporary file cannot be created
+	explicit pack_writer(const path_type& dir)
+		: m_dir(dir)
+		, m_offset(0)
+		, m_finished(false)
+	{
+		gtl::temppath(m_tmp_path, "tmp_pack");
+		m_tmp_path = m_dir / *(--m_tmp_path.end());
+
+		m_file.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+		m_file.open(m_tmp_path.string().c_str(), std::ios_base::in | std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+		uchar header[12] = {'P', 'A', 'C', 'K', 0, 0, 0, 2, 0, 0, 0, 0};
+		uint32 crc = 0;
+		write(header, sizeof(header), crc);
+	}
+
+	~pack_writer() {
+		if (!m_finished) {
+			try {
+				m_file.close();
+			} catch (...) {
+			}
+			boost::system::error_code ec;
+			fs::remove(m_tmp_path, ec);
+		}
+	}
+
+public:
+	//! @{ \name Interface
+
+	//! \return amount of objects written so far
+	uint32 count() const {
+		return m_entries.size();
+	}
+
+	//! \return true if the object with the given key was written already
+	bool has_object(const key_type& key) const {
+		return m_keys.find(key) != m_keys.end();
+	}
+
+	/** Deflate the given object and write it into the pack. Objects which were written already are skipped.
+	  * \tparam InputObject input object compatible type. If it provides no key, it will be computed
+	  * \throw pack_error if the object type cannot be stored in packs, or if compression fails
+	  */
+	template <class InputObject>
+	void insert(InputObject& object) {
+		if (object.key_pointer() && has_object(*object.key_pointer())) {
+			return;
+		}
+		const uint64_t offset = m_offset;
+		uint32 crc = write_header(typename db_traits_type::policy_type().to_pack_type(object.type()), object.size());
+		hash_generator_type gen;
+		if (!object.key_pointer()) {
+			typename db_traits_type::policy_type().header_hash(gen, object.type(), object.size());
+		}
+
+		z_stream zs;
+		init_deflate(zs);
+		try {
+			char_type buf[buffer_size];
+			size_type left = object.size();
+			do {
+				const size_t nb = (size_t)std::min(left, (size_type)buffer_size);
+				object.stream().read(buf, nb);
+				if ((size_t)object.stream().gcount() != nb) {
+					pack_error err;
+					err.stream() << "stream of object ended early, expected " << object.size() << " bytes";
+					throw err;
+				}
+				if (!object.key_pointer()) {
+					gen.update(buf, nb);
+				}
+				deflate_chunk(zs, buf, nb, nb == left ? Z_FINISH : Z_NO_FLUSH, crc);
+				left -= nb;
+			} while (left);
+		} catch (...) {
+			deflateEnd(&zs);
+			throw;
+		}
+		deflateEnd(&zs);
+
+		const key_type key(object.key_pointer() ? *object.key_pointer() : key_type(gen.hash()));
+		if (has_object(key)) {
+			// we only know the key now, drop the duplicate again
+			m_file.seekp(offset);
+			m_offset = offset;
+			return;
+		}
+		add_entry(key, offset, crc);
+	}
+
+	/** Write raw object data into the pack. Pack entries, including deltas, are copied without recompression,
+	  * data in loose format is inflated, verified against its key and deflated again. Objects which were written
+	  * already are skipped.
+	  * \throw odb_checksum_error if the data doesn't match its crc32, or loose data doesn't match its key
+	  * \throw pack_error if the loose data cannot be inflated
+	  */
+	void insert_raw(const raw_object_type& raw) {
+		if (has_object(raw.key)) {
+			return;
+		}
+		raw.verify();
+
+		if (raw.format == raw_format::loose) {
+			// the header is compressed with the data and precedes it
+			std::vector<char_type> buf(raw.inflated_size);
+			inflate_buffer(reinterpret_cast<const uchar*>(raw.data), raw.data_size, buf.data(), buf.size());
+			raw.template verify_key<hash_generator_type>(buf.data(), buf.size());
+			write_deflated(raw.key, raw.type, buf.data() + (raw.inflated_size - raw.size), raw.size);
+			return;
+		}
+
+		const uint64_t offset = m_offset;
+		uint32 crc = 0;
+		if (raw.is_delta) {
+			crc = write_header(pack_type::ref_delta_type, raw.inflated_size);
+			write(raw.base_key.bytes(), key_type::hash_len, crc);
+			m_delta_bases.push_back(raw.base_key);
+		} else {
+			crc = write_header(typename db_traits_type::policy_type().to_pack_type(raw.type), raw.inflated_size);
+		}
+		write(raw.data, raw.data_size, crc);
+		add_entry(raw.key, offset, crc);
+	}
+
+	/** Complete the pack and write its index. The pack and index are named after the pack's checksum.
+	  * The writer cannot be used afterwards.
+	  * \return path to the new pack
+	  * \throw pack_error if the base of a delta was not written into the pack
+	  * \throw std::ios_base::failure if the files could not be written
+	  */
+	path_type finish() {
+		const size_t hl = key_type::hash_len;
+		for (auto i = m_delta_bases.begin(); i != m_delta_bases.end(); ++i) {
+			if (!has_object(*i)) {
+				pack_error err;
+				err.stream() << "base " << *i << " of a delta is not contained in pack " << m_tmp_path;
+				throw err;
+			}
+		}
+
+		// fix up the entry count, then compute the trailing checksum of the whole file
+		uchar num[4];
+		hton32(count(), num);
+		m_file.seekp(8);
+		m_file.write(reinterpret_cast<const char*>(num), sizeof(num));
+		m_file.flush();
+		m_file.seekg(0);
+		hash_generator_type gen;
+		{
+			char_type buf[buffer_size];
+			for (uint64_t left = m_offset; left; ) {
+				const size_t nb = (size_t)std::min(left, (uint64_t)buffer_size);
+				m_file.read(buf, nb);
+				gen.update(buf, nb);
+				left -= nb;
+			}
+		}
+		const key_type checksum(gen.hash());
+		m_file.seekp(m_offset);
+		m_file.write(checksum.bytes(), hl);
+		m_file.close();
+		// dropped duplicates may have left bytes behind the checksum
+		fs::resize_file(m_tmp_path, m_offset + hl);
+
+		// index
+		std::sort(m_entries.begin(), m_entries.end(), [](const entry& l, const entry& r) { return l.key < r.key; });
+		std::ostringstream buf(std::ios_base::out | std::ios_base::binary);
+		const uchar magic[8] = {0xff, 't', 'O', 'c', 0, 0, 0, (uchar)pack_index<key_type>::version};
+		buf.write(reinterpret_cast<const char*>(magic), sizeof(magic));
+		{
+			uchar fanout[256*4];
+			uint32 cnt = 0;
+			auto it = m_entries.begin();
+			for (uint32 b = 0; b < 256; ++b) {
+				for (; it != m_entries.end() && (uchar)it->key.bytes()[0] == b; ++it, ++cnt);
+				hton32(cnt, fanout + b*4);
+			}
+			buf.write(reinterpret_cast<const char*>(fanout), sizeof(fanout));
+		}
+		for (auto i = m_entries.begin(); i != m_entries.end(); ++i) {
+			buf.write(i->key.bytes(), hl);
+		}
+		for (auto i = m_entries.begin(); i != m_entries.end(); ++i) {
+			hton32(i->crc, num);
+			buf.write(reinterpret_cast<const char*>(num), sizeof(num));
+		}
+		std::vector<uchar> loff;
+		for (auto i = m_entries.begin(); i != m_entries.end(); ++i) {
+			if (i->offset >= 0x80000000) {
+				hton32(0x80000000 | (uint32)(loff.size() / 8), num);
+				loff.resize(loff.size() + 8);
+				hton64(i->offset, &loff[loff.size()-8]);
+			} else {
+				hton32((uint32)i->offset, num);
+			}
+			buf.write(reinterpret_cast<const char*>(num), sizeof(num));
+		}
+		buf.write(reinterpret_cast<const char*>(loff.data()), loff.size());
+		buf.write(checksum.bytes(), hl);
+
+		const std::string data(buf.str());
+		hash_generator_type igen;
+		igen.update(data.data(), data.size());
+		const key_type idx_checksum(igen.hash());
+
+		std::ostringstream name;
+		name << "pack-" << checksum;
+		std::string sname(name.str());
+		std::transform(sname.begin(), sname.end(), sname.begin(), ::tolower);
+
+		// the pack is moved first, so the index never refers to a missing pack
+		const path_type pack_path(m_dir / (sname + ".pack"));
+		const path_type idx_path(m_dir / (sname + ".idx"));
+		fs::rename(m_tmp_path, pack_path);
+		m_finished = true;
+
+		path_type tmp_idx;
+		gtl::temppath(tmp_idx, "tmp_idx");
+		tmp_idx = m_dir / *(--tmp_idx.end());
+		std::ofstream out;
+		out.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+		out.open(tmp_idx.string().c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+		out.write(data.data(), data.size());
+		out.write(idx_checksum.bytes(), hl);
+		out.close();
+		fs::rename(tmp_idx, idx_path);
+
+		return pack_path;
+	}
+
+	//! @}
+};
+
+GTL_NAMESPACE_END
+GTL_HEADER_END
+
+#endif // GTL_PACK_WRITER_HPP
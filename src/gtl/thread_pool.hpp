@@ -0,0 +1,143 @@
+#ifndef GTL_THREAD_POOL_HPP
+#define GTL_THREAD_POOL_HPP
+
+#include <gtl/config.h>
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <deque>
+#include <vector>
+
+GTL_HEADER_BEGIN
+GTL_NAMESPACE_BEGIN
+
+/** \brief fixed set of worker threads processing tasks in submission order.
+  *
+  * The amount of queued tasks is bounded, submit() blocks if the queue is full, which keeps memory usage
+  * constant if tasks are produced faster than they are processed.
+  * If a task throws, the first exception is kept and rethrown by wait(), remaining tasks are still processed.
+  * \ingroup ODBUtil
+  */
+class thread_pool
+{
+public:
+	typedef std::function<void()>		task_type;
+
+protected:
+	std::vector<std::thread>	m_threads;
+	std::deque<task_type>		m_queue;
+	std::mutex					m_mutex;
+	std::condition_variable		m_work_available;	//!< signalled if a task was queued, or if we shut down
+	std::condition_variable		m_work_done;		//!< signalled if a task was taken or completed
+	size_t						m_max_queued;
+	size_t						m_active;			//!< amount of tasks being processed
+	bool						m_shutdown;
+	std::exception_ptr			m_error;
+
+	void run() {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		for (;;) {
+			while (m_queue.empty() && !m_shutdown) {
+				m_work_available.wait(lock);
+			}
+			if (m_queue.empty()) {
+				return;
+			}
+			task_type task(std::move(m_queue.front()));
+			m_queue.pop_front();
+			++m_active;
+			m_work_done.notify_all();
+
+			lock.unlock();
+			try {
+				task();
+			} catch (...) {
+				lock.lock();
+				if (!m_error) {
+					m_error = std::current_exception();
+				}
+				lock.unlock();
+			}
+			lock.lock();
+			--m_active;
+			m_work_done.notify_all();
+		}// for each task
+	}
+
+public:
+	//! \return amount of threads to use by default, which is the amount of hardware threads, or 1 if unknown
+	static size_t default_concurrency() {
+		const size_t n = std::thread::hardware_concurrency();
+		return n ? n : 1;
+	}
+
+	//! Start the given amount of threads
+	//! \param max_queued amount of tasks which may be queued before submit() blocks, 0 uses twice the thread count
+	explicit thread_pool(size_t num_threads = default_concurrency(), size_t max_queued = 0)
+		: m_max_queued(max_queued ? max_queued : 2 * (num_threads ? num_threads : 1))
+		, m_active(0)
+		, m_shutdown(false)
+	{
+		if (num_threads == 0) {
+			num_threads = 1;
+		}
+		m_threads.reserve(num_threads);
+		for (size_t i = 0; i < num_threads; ++i) {
+			m_threads.push_back(std::thread(&thread_pool::run, this));
+		}
+	}
+
+	//! Process all remaining tasks and stop the threads
+	~thread_pool() {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_shutdown = true;
+		}
+		m_work_available.notify_all();
+		for (auto i = m_threads.begin(); i != m_threads.end(); ++i) {
+			i->join();
+		}
+	}
+
+	thread_pool(const thread_pool&) = delete;
+	thread_pool& operator=(const thread_pool&) = delete;
+
+public:
+	//! \return amount of worker threads
+	size_t size() const {
+		return m_threads.size();
+	}
+
+	//! Queue the given task, blocking while the queue is full
+	void submit(task_type task) {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (m_queue.size() >= m_max_queued) {
+			m_work_done.wait(lock);
+		}
+		m_queue.push_back(std::move(task));
+		lock.unlock();
+		m_work_available.notify_one();
+	}
+
+	//! Block until all submitted tasks were processed
+	//! \throw the first exception thrown by a task since the last call
+	void wait() {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (!m_queue.empty() || m_active) {
+			m_work_done.wait(lock);
+		}
+		if (m_error) {
+			std::exception_ptr error(m_error);
+			m_error = std::exception_ptr();
+			std::rethrow_exception(error);
+		}
+	}
+};
+
+GTL_NAMESPACE_END
+GTL_HEADER_END
+
+#endif // GTL_THREAD_POOL_HPP
@@ -175,6 +175,71 @@ CharType fromhex(const CharType* c2)
 	return out;
 }
 
+//! \return value of the given hexadecimal digit in either case, or -1 if it is no hexadecimal digit
+inline int hexval(uchar c)
+{
+	if ((uchar)(c - '0') < 10) {
+		return c - '0';
+	}
+	c |= 0x20;	// lower case
+	if ((uchar)(c - 'a') < 6) {
+		return c - 'a' + 10;
+	}
+	return -1;
+}
+
+/** Convert the given amount of bytes from their hexadecimal representation, which is validated.
+  * \param hex array of 2 * num_bytes hexadecimal characters of any case
+  * \param out array of at least num_bytes characters
+  * \return true on success, or false if a character was no hexadecimal digit, in which case out is undefined
+  */
+template <class CharType>
+inline
+bool decode_hex(const CharType* hex, size_t num_bytes, CharType* out)
+{
+	static_assert(sizeof(CharType) == 1, "need 1 byte character");
+
+	for (const CharType* end = out + num_bytes; out < end; ++out, hex += 2) {
+		const int hi = hexval((uchar)hex[0]);
+		const int lo = hexval((uchar)hex[1]);
+		if ((hi | lo) < 0) {
+			return false;
+		}
+		*out = (CharType)((hi << 4) | lo);
+	}
+	return true;
+}
+
+//! @{ \name Byte Order Conversion
+//! Read and write unsigned integers stored in network byte order (big endian), as used by all
+//! binary on-disk formats. The byte pointers are not required to be aligned.
+
+inline uint32 ntoh32(const uchar* p)
+{
+	return ((uint32)p[0] << 24) | ((uint32)p[1] << 16) | ((uint32)p[2] << 8) | (uint32)p[3];
+}
+
+inline uint64_t ntoh64(const uchar* p)
+{
+	return ((uint64_t)ntoh32(p) << 32) | (uint64_t)ntoh32(p+4);
+}
+
+inline void hton32(uint32 v, uchar* p)
+{
+	p[0] = (uchar)(v >> 24);
+	p[1] = (uchar)(v >> 16);
+	p[2] = (uchar)(v >> 8);
+	p[3] = (uchar)v;
+}
+
+inline void hton64(uint64_t v, uchar* p)
+{
+	hton32((uint32)(v >> 32), p);
+	hton32((uint32)v, p+4);
+}
+
+//! @}
+
 
 GTL_NAMESPACE_END
 GTL_HEADER_END
@@ -0,0 +1,208 @@
+#ifndef GTL_WORK_STEALING_POOL_HPP
+#define GTL_WORK_STEALING_POOL_HPP
+
+#include <gtl/config.h>
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+GTL_HEADER_BEGIN
+GTL_NAMESPACE_BEGIN
+
+/** \brief fixed set of worker threads processing tasks which may submit further tasks.
+  *
+  * Each worker keeps its own queue of tasks. Tasks submitted by a worker are put into its own queue, which it
+  * processes last-in first-out, walking recursive workloads depth-first which keeps the amount of queued tasks
+  * small. Idle workers steal from the other end of the queues of busy workers, hence they obtain the oldest
+  * tasks, which tend to be the largest ones. Tasks submitted by other threads are distributed round-robin.
+  *
+  * Unlike the thread_pool, the amount of queued tasks is unbounded, as workers must never block when submitting.
+  * If a task throws, the first exception is kept and rethrown by wait(), remaining tasks are still processed.
+  * \ingroup ODBUtil
+  */
+class work_stealing_pool
+{
+public:
+	typedef std::function<void()>		task_type;
+
+protected:
+	struct worker_queue
+	{
+		std::mutex				mutex;
+		std::deque<task_type>	tasks;
+	};
+
+	std::vector<std::unique_ptr<worker_queue> >	m_queues;		//!< one queue per worker
+	std::vector<std::thread>					m_threads;
+	std::mutex									m_mutex;
+	std::condition_variable						m_work_available;	//!< signalled if a task was queued, or if we shut down
+	std::condition_variable						m_work_done;		//!< signalled if all tasks were processed
+	std::atomic<size_t>							m_num_queued;		//!< amount of tasks in all queues
+	std::atomic<size_t>							m_num_pending;		//!< amount of tasks submitted, but not completed
+	std::atomic<size_t>							m_num_idle;			//!< amount of workers waiting for work
+	std::atomic<size_t>							m_next_queue;		//!< queue for the next external submission
+	bool										m_shutdown;
+	std::exception_ptr							m_error;
+
+	//! \return pool and index of the worker running in the calling thread, if any
+	static std::pair<const work_stealing_pool*, size_t>& current_worker_slot() {
+		static thread_local std::pair<const work_stealing_pool*, size_t> slot(nullptr, 0);
+		return slot;
+	}
+
+	//! Take a task from the back of our own queue, or from the front of another one
+	bool take(size_t index, task_type& task) {
+		{
+			worker_queue& q = *m_queues[index];
+			std::lock_guard<std::mutex> lock(q.mutex);
+			if (!q.tasks.empty()) {
+				task = std::move(q.tasks.back());
+				q.tasks.pop_back();
+				--m_num_queued;
+				return true;
+			}
+		}
+		for (size_t i = 1; i < m_queues.size(); ++i) {
+			worker_queue& q = *m_queues[(index + i) % m_queues.size()];
+			std::lock_guard<std::mutex> lock(q.mutex);
+			if (!q.tasks.empty()) {
+				task = std::move(q.tasks.front());
+				q.tasks.pop_front();
+				--m_num_queued;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void run(size_t index) {
+		current_worker_slot() = std::make_pair(this, index);
+		task_type task;
+		for (;;) {
+			if (take(index, task)) {
+				try {
+					task();
+				} catch (...) {
+					std::lock_guard<std::mutex> lock(m_mutex);
+					if (!m_error) {
+						m_error = std::current_exception();
+					}
+				}
+				task = task_type();
+				if (--m_num_pending == 0) {
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_work_done.notify_all();
+				}
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(m_mutex);
+			++m_num_idle;
+			while (m_num_queued == 0 && !m_shutdown) {
+				m_work_available.wait(lock);
+			}
+			--m_num_idle;
+			if (m_num_queued == 0) {
+				return;
+			}
+		}// for each task
+	}
+
+public:
+	//! \return amount of threads to use by default, which is the amount of hardware threads, or 1 if unknown
+	static size_t default_concurrency() {
+		const size_t n = std::thread::hardware_concurrency();
+		return n ? n : 1;
+	}
+
+	//! Start the given amount of threads
+	explicit work_stealing_pool(size_t num_threads = default_concurrency())
+		: m_num_queued(0)
+		, m_num_pending(0)
+		, m_num_idle(0)
+		, m_next_queue(0)
+		, m_shutdown(false)
+	{
+		if (num_threads == 0) {
+			num_threads = 1;
+		}
+		for (size_t i = 0; i < num_threads; ++i) {
+			m_queues.push_back(std::unique_ptr<worker_queue>(new worker_queue));
+		}
+		m_threads.reserve(num_threads);
+		for (size_t i = 0; i < num_threads; ++i) {
+			m_threads.push_back(std::thread(&work_stealing_pool::run, this, i));
+		}
+	}
+
+	//! Process all remaining tasks and stop the threads
+	~work_stealing_pool() {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_shutdown = true;
+		}
+		m_work_available.notify_all();
+		for (auto i = m_threads.begin(); i != m_threads.end(); ++i) {
+			i->join();
+		}
+	}
+
+	work_stealing_pool(const work_stealing_pool&) = delete;
+	work_stealing_pool& operator=(const work_stealing_pool&) = delete;
+
+public:
+	//! \return amount of worker threads
+	size_t size() const {
+		return m_threads.size();
+	}
+
+	//! Queue the given task. If called by one of our tasks, it is queued for the calling worker, which will
+	//! process it before any older task of its own. Never blocks
+	void submit(task_type task) {
+		const std::pair<const work_stealing_pool*, size_t>& cur = current_worker_slot();
+		const size_t index = cur.first == this ? cur.second : m_next_queue++ % m_queues.size();
+
+		// count first, the amount of queued tasks must never drop below 0
+		++m_num_pending;
+		++m_num_queued;
+		{
+			worker_queue& q = *m_queues[index];
+			std::lock_guard<std::mutex> lock(q.mutex);
+			q.tasks.push_back(std::move(task));
+		}
+
+		// idle workers check the amount of queued tasks under the lock before waiting
+		if (m_num_idle) {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_work_available.notify_one();
+		}
+	}
+
+	//! Block until all submitted tasks were processed, including the ones they submitted.
+	//! Must not be called by one of our tasks
+	//! \throw the first exception thrown by a task since the last call
+	void wait() {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (m_num_pending) {
+			m_work_done.wait(lock);
+		}
+		if (m_error) {
+			std::exception_ptr error(m_error);
+			m_error = std::exception_ptr();
+			std::rethrow_exception(error);
+		}
+	}
+};
+
+GTL_NAMESPACE_END
+GTL_HEADER_END
+
+#endif // GTL_WORK_STEALING_POOL_HPP
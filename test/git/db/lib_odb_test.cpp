@@ -5,12 +5,36 @@
 #include <git/fixture.hpp>
 #include <git/db/odb_loose.h>
 #include <git/db/odb_mem.h>
+#include <git/db/odb_pack.h>
+#include <git/db/pack_bitmap.h>
+#include <git/db/fsck.h>
+#include <git/db/commit_table.h>
+#include <git/db/commit_graph.h>
+#include <git/db/key_index.h>
+#include <git/db/rev_walk.h>
+#include <git/db/merge_base.h>
+#include <git/db/tree_diff.h>
+#include <git/db/tree_walk.h>
+#include <git/db/rename_detect.h>
+#include <git/db/changed_paths.h>
+#include <git/db/loose_gc.h>
+#include <git/db/connectivity.h>
+#include <git/db/reachability_cache.h>
 
 #include <git/db/sha1.h>
 #include <git/db/sha1_gen.h>
 #include <git/obj/blob.h>
+#include <git/obj/flat_tree.h>
+#include <git/obj/commit_header.h>
+#include <git/obj/serializer.h>
+#include <git/obj/streaming_blob.h>
+#include <git/obj/object_pool.h>
 #include <boost/iostreams/filtering_stream.hpp>
 #include <utility>
+#include <set>
+#include <thread>
+#include <mutex>
+#include <atomic>
 
 #include <iostream>
 #include <sstream>
@@ -40,7 +64,61 @@ BOOST_AUTO_TEST_CASE(object_type_conversion)
 		s << *i;
 		s >> t;
 		BOOST_CHECK(t == *i);
+		BOOST_CHECK(parse_type_token(type_token(*i), type_token_len(*i)) == *i);
 	}
+	
+	// tokens are not required to be null-terminated, prefixes don't match
+	BOOST_CHECK(parse_type_token("commits", 6) == Object::Type::Commit);
+	BOOST_CHECK(parse_type_token("commit", 5) == Object::Type::None);
+	BOOST_CHECK(parse_type_token("tags", 4) == Object::Type::None);
+	BOOST_CHECK(parse_type_token("", 0) == Object::Type::None);
+	BOOST_CHECK(std::strcmp(type_token((Object::Type)42), "unknown_object_type") == 0);
+	
+	// unknown and overlong tokens yield no type
+	stringstream s("  tags\tcommitcommit tree");
+	s >> t;
+	BOOST_CHECK(t == Object::Type::None);
+	s >> t;
+	BOOST_CHECK(t == Object::Type::None);
+	s >> t;
+	BOOST_CHECK(t == Object::Type::Tree && s.eof());
+	
+	// loose headers
+	char hdr[32];
+	const uint64_t sizes[] = { 0, 7, 10, 12345, ~(uint64_t)0 };
+	for (const Object::Type* i = vals + 1; i < vals + num_vals; ++i) {
+		for (size_t si = 0; si < sizeof(sizes) / sizeof(sizes[0]); ++si) {
+			const uchar len = loose_object_header(hdr, *i, sizes[si]);
+			stringstream ref;
+			ref << *i << ' ' << sizes[si] << '\0';
+			BOOST_REQUIRE(ref.str() == string(hdr, len));
+			
+			Object::Type ptype;
+			uint64_t psize;
+			BOOST_REQUIRE(parse_loose_object_header(hdr, len, ptype, psize) == len);
+			BOOST_CHECK(ptype == *i && psize == sizes[si]);
+			// incomplete headers are rejected
+			BOOST_CHECK(parse_loose_object_header(hdr, len - 1, ptype, psize) == 0);
+			BOOST_CHECK(ptype == Object::Type::None);
+		}
+	}
+	
+	const char* const malformed[] = { "blob 5", "blob  5", "blob +5", "blob 05", "blob 5x", "blobs 5", "none 5",
+									  "blob 18446744073709551616", "blob" };
+	for (size_t i = 0; i < sizeof(malformed) / sizeof(malformed[0]); ++i) {
+		Object::Type ptype;
+		uint64_t psize;
+		const string h = string(malformed[i]) + (i ? string(1, '\0') : string()) + "data";
+		BOOST_CHECK(parse_loose_object_header(h.data(), h.size(), ptype, psize) == 0);
+		BOOST_CHECK(ptype == Object::Type::None);
+	}
+	Object::Type ptype;
+	uint64_t psize;
+	BOOST_CHECK(parse_loose_object_header(nullptr, 0, ptype, psize) == 0);
+	BOOST_CHECK(ptype == Object::Type::None);
+	const string h("tree 0\0data", 11);
+	BOOST_CHECK(parse_loose_object_header(h.data(), h.size(), ptype, psize) == 7);
+	BOOST_CHECK(ptype == Object::Type::Tree && psize == 0);
 }
 
 BOOST_AUTO_TEST_CASE(lib_actor)
@@ -98,6 +176,281 @@ BOOST_AUTO_TEST_CASE(lib_commit)
 	}// end encoding loop
 }
 
+BOOST_AUTO_TEST_CASE(lib_commit_parse)
+{
+	const string raw(
+		"tree aaf4c61ddcc5e8a2dabede0f3b482cd9aea9434d\n"
+		"parent 0000000000000000000000000000000000000000\n"
+		"parent AAF4C61DDCC5E8A2DABEDE0F3B482CD9AEA9434D\n"
+		"author A U Thor <author@example.com> 1112911993 -0700\n"
+		"committer C O Mitter <committer@example.com> 1112912053 +0130\n"
+		"mergetag object aaf4c61ddcc5e8a2dabede0f3b482cd9aea9434d\n"
+		" type commit\n"
+		" tag v1.0\n"
+		" \n"
+		" tag message\n"
+		"gpgsig -----BEGIN PGP SIGNATURE-----\n"
+		" \n"
+		" iQEcBAABAgAGBQJV\n"
+		" -----END PGP SIGNATURE-----\n"
+		"\n"
+		"subject\n\nbody\n");
+
+	Commit c;
+	c.parse(raw.data(), raw.size());
+	BOOST_REQUIRE(c.tree_key() == SHA1(hello_hex_sha));
+	BOOST_REQUIRE(c.parent_keys().size() == 2);
+	BOOST_REQUIRE(c.parent_keys()[0] == SHA1::null && c.parent_keys()[1] == SHA1(hello_hex_sha));
+	BOOST_REQUIRE(c.author().name == "A U Thor" && c.author().email == "author@example.com");
+	BOOST_REQUIRE(c.author().time == 1112911993 && c.author().tz_offset == -700);
+	BOOST_REQUIRE(c.committer().name == "C O Mitter" && c.committer().tz_offset == 130);
+	BOOST_REQUIRE(c.encoding() == Commit::default_encoding);
+	BOOST_REQUIRE(c.extra_headers().size() == 2);
+	BOOST_REQUIRE(c.extra_headers()[0].name == "mergetag");
+	BOOST_REQUIRE(c.extra_headers()[0].value == "object aaf4c61ddcc5e8a2dabede0f3b482cd9aea9434d\ntype commit\ntag v1.0\n\ntag message");
+	BOOST_REQUIRE(c.extra_headers()[1].name == "gpgsig");
+	BOOST_REQUIRE(c.message() == "subject\n\nbody\n");
+
+	// serialization reproduces the original, except for the case of keys
+	std::stringstream s;
+	s << c;
+	string lraw(raw);
+	lraw.replace(lraw.find(hello_hex_sha), hello_hex_sha.size(), hello_hex_sha_lc);
+	BOOST_REQUIRE(s.str() == lraw);
+
+	// stream based parsing yields the same
+	Commit oc;
+	s >> oc;
+	BOOST_REQUIRE(oc == c);
+
+	// parsing replaces previous contents
+	c.parse(raw.data(), raw.size());
+	BOOST_REQUIRE(oc == c);
+
+	// commits without message
+	const string nomsg(raw.substr(0, raw.find("mergetag")));
+	c.parse(nomsg.data(), nomsg.size());
+	BOOST_REQUIRE(c.message().empty() && c.extra_headers().empty());
+
+	// malformed commits
+	const string bad[] = {
+		raw.substr(raw.find("parent")),
+		"tree aaf4c61ddcc5e8a2dabede0f3b482cd9aea9434\n" + raw.substr(raw.find("author")),
+		"tree aaf4c61ddcc5e8a2dabede0f3b482cd9aea9434x\n" + raw.substr(raw.find("author")),
+		raw.substr(0, raw.find("author")) + raw.substr(raw.find("committer")),
+		raw.substr(0, raw.find("author")) + "author nobody 1 +0000\n" + raw.substr(raw.find("committer")),
+		raw.substr(0, raw.find("author")) + "author A <a> +0000\n" + raw.substr(raw.find("committer")),
+		raw.substr(0, raw.find("author")) + "noheadervalue\n" + raw.substr(raw.find("author"))
+	};
+	for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i) {
+		BOOST_REQUIRE_THROW(c.parse(bad[i].data(), bad[i].size()), DeserializationError);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(lib_commit_header)
+{
+	Commit c;
+	c.tree_key() = SHA1(hello_hex_sha);
+	c.parent_keys().push_back(SHA1::null);
+	c.parent_keys().push_back(SHA1(hello_hex_sha));
+	c.author().name = "author";
+	c.committer().name = "committer";
+	c.committer().time = 1112912053;
+	c.committer().tz_offset = -130;
+	c.message() = "message";
+	Commit::Header sig;
+	sig.name = "gpgsig";
+	sig.value = "line\nline";
+	c.extra_headers().push_back(sig);
+	
+	std::stringstream s;
+	s << c;
+	const string raw(s.str());
+	
+	CommitHeader header;
+	const size_t consumed = header.parse(raw.data(), raw.size());
+	BOOST_REQUIRE(header.tree_key == c.tree_key());
+	BOOST_REQUIRE(header.parent_keys == c.parent_keys());
+	BOOST_REQUIRE(header.time == c.committer().time && header.tz_offset == c.committer().tz_offset);
+	BOOST_REQUIRE(raw.compare(consumed, 7, "gpgsig ") == 0);
+	
+	// reuse clears previous parents
+	const string root(raw.substr(0, raw.find("parent")) + raw.substr(raw.find("author")));
+	header.parse(root.data(), root.size());
+	BOOST_REQUIRE(header.parent_keys.empty());
+	
+	// the remainder is decoded on demand
+	LazyCommit lazy(raw.data(), raw.size());
+	BOOST_REQUIRE(lazy.tree_key() == c.tree_key() && lazy.parent_keys() == c.parent_keys());
+	BOOST_REQUIRE(lazy.time() == c.committer().time);
+	BOOST_REQUIRE(!lazy.is_decoded());
+	BOOST_REQUIRE(lazy.commit() == c);
+	BOOST_REQUIRE(lazy.is_decoded());
+	
+	// headers must be complete and in order
+	const string bad[] = {
+		raw.substr(raw.find("parent")),
+		raw.substr(0, raw.find("author")),
+		raw.substr(0, raw.find("author")) + raw.substr(raw.find("committer")),
+		raw.substr(0, raw.find("committer") + 20),
+		"tree " + raw.substr(6)
+	};
+	for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i) {
+		BOOST_REQUIRE_THROW(header.parse(bad[i].data(), bad[i].size()), DeserializationError);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(lib_actor_table)
+{
+	ActorTable table;
+	const ActorTable::handle_type a = table.intern("ab", 2, "c", 1);
+	BOOST_REQUIRE(table.intern("ab", 2, "c", 1) == a);
+	BOOST_REQUIRE(table.intern("a", 1, "bc", 2) != a);
+	BOOST_REQUIRE(table.actor(a).name == "ab" && table.actor(a).email == "c");
+	BOOST_REQUIRE(table.size() == 2);
+	
+	// handles remain stable while the table grows, even if multiple threads intern concurrently
+	const size_t num_actors = 1000;
+	std::vector<Actor> actors(num_actors);
+	for (size_t i = 0; i < num_actors; ++i) {
+		std::stringstream s;
+		s << "name " << i;
+		actors[i].name = s.str();
+		actors[i].email = s.str() + "@example.com";
+	}
+	std::vector<std::vector<ActorTable::handle_type> > handles(4, std::vector<ActorTable::handle_type>(num_actors));
+	std::vector<std::thread> threads;
+	for (size_t t = 0; t < handles.size(); ++t) {
+		threads.push_back(std::thread([&actors, &handles, &table, t]() {
+			for (size_t i = 0; i < actors.size(); ++i) {
+				handles[t][i] = table.intern(actors[(i + t * 250) % actors.size()]);
+			}
+		}));
+	}
+	for (auto i = threads.begin(); i != threads.end(); ++i) {
+		i->join();
+	}
+	BOOST_REQUIRE(table.size() == num_actors + 2);
+	for (size_t t = 0; t < handles.size(); ++t) {
+		for (size_t i = 0; i < num_actors; ++i) {
+			const size_t ai = (i + t * 250) % num_actors;
+			BOOST_REQUIRE(handles[t][i] == handles[0][ai]);
+			BOOST_REQUIRE(table.actor(handles[t][i]) == actors[ai]);
+		}
+	}
+	
+	// commit headers may intern their actors
+	Commit c;
+	c.tree_key() = SHA1(hello_hex_sha);
+	c.author().name = "A U Thor";
+	c.author().email = "author@example.com";
+	c.author().time = 1112911993;
+	c.author().tz_offset = -700;
+	c.committer() = c.author();
+	c.committer().time += 60;
+	c.message() = "message";
+	std::stringstream s;
+	s << c;
+	const string raw(s.str());
+	
+	CommitHeader header;
+	header.parse(raw.data(), raw.size());
+	BOOST_REQUIRE(header.author == ActorTable::null_handle && header.committer == ActorTable::null_handle);
+	header.parse(raw.data(), raw.size(), &table);
+	BOOST_REQUIRE(header.author == header.committer);
+	BOOST_REQUIRE(table.actor(header.author) == c.author());
+	BOOST_REQUIRE(header.time == c.committer().time && header.tz_offset == c.committer().tz_offset);
+	BOOST_REQUIRE(table.size() == num_actors + 3);
+	
+	const string line("A U Thor <author@example.com> 1112911993 -0700");
+	InternedActorDate date;
+	parse_actor_date(line.data(), line.data() + line.size(), table, date);
+	BOOST_REQUIRE(date.actor == header.author);
+	BOOST_REQUIRE(date.resolve(table) == c.author());
+	BOOST_REQUIRE_THROW(parse_actor_date(line.data(), line.data() + 10, table, date), DeserializationError);
+}
+
+BOOST_AUTO_TEST_CASE(lib_serializer)
+{
+	Serializer::buffer_type buf;
+	Serializer ser(buf);
+	
+	const short offsets[] = {0, 130, -130, 1400, -1200, 12345};
+	const char* const formatted[] = {"+0000", "+0130", "-0130", "+1400", "-1200", "+12345"};
+	for (size_t i = 0; i < sizeof(offsets) / sizeof(offsets[0]); ++i) {
+		buf.clear();
+		ser.serialize(TimezoneOffset(offsets[i]));
+		BOOST_REQUIRE(string(buf.begin(), buf.end()) == formatted[i]);
+	}
+	
+	buf.clear();
+	ser.write_uint(0);
+	ser.put(' ');
+	ser.write_uint(18446744073709551615ULL);
+	ser.put(' ');
+	ser.write_mode(0100644);
+	ser.put(' ');
+	ser.write_mode(040000);
+	BOOST_REQUIRE(string(buf.begin(), buf.end()) == "0 18446744073709551615 100644 40000");
+	
+	ActorDate actor;
+	actor.name = "A U Thor";
+	actor.email = "author@example.com";
+	actor.time = 1112911993;
+	actor.tz_offset = -700;
+	buf.clear();
+	ser.serialize(actor);
+	BOOST_REQUIRE(string(buf.begin(), buf.end()) == "A U Thor <author@example.com> 1112911993 -0700");
+	
+	// dates round-trip, including those before the epoch
+	const time_t times[] = {0, 1112911993, -1, -1112911993};
+	for (size_t i = 0; i < sizeof(times) / sizeof(times[0]); ++i) {
+		actor.time = times[i];
+		buf.clear();
+		ser.serialize(actor);
+		ActorDate parsed;
+		parse_actor_date(buf.data(), buf.data() + buf.size(), parsed);
+		BOOST_REQUIRE(parsed.name == actor.name && parsed.email == actor.email);
+		BOOST_REQUIRE(parsed.time == actor.time && parsed.tz_offset == actor.tz_offset);
+	}
+	ActorDate truncated;
+	BOOST_REQUIRE_THROW(parse_actor_date(buf.data(), buf.data() + buf.size() - 12, truncated), DeserializationError);
+	actor.time = 1112911993;
+	
+	// empty names are not allowed
+	BOOST_REQUIRE_THROW(ser.serialize(ActorDate()), DeserializationError);
+	
+	// objects are serialized as git does, and appended
+	const string raw(
+		"tree aaf4c61ddcc5e8a2dabede0f3b482cd9aea9434d\n"
+		"parent 0000000000000000000000000000000000000000\n"
+		"author A U Thor <author@example.com> 1112911993 -0700\n"
+		"committer C O Mitter <committer@example.com> 1112912053 +0130\n"
+		"encoding ISO-8859-1\n"
+		"gpgsig line\n"
+		" \n"
+		" line\n"
+		"\n"
+		"message\n");
+	Commit c;
+	c.parse(raw.data(), raw.size());
+	buf.assign(1, 'x');
+	ser.serialize(static_cast<const Object&>(c));
+	BOOST_REQUIRE(string(buf.begin(), buf.end()) == "x" + raw);
+	BOOST_REQUIRE(c.size() == raw.size());
+	
+	Tag tag;
+	tag.name() = "v1.0";
+	tag.object_key() = SHA1(hello_hex_sha);
+	tag.object_type() = Object::Type::Commit;
+	tag.actor() = actor;
+	tag.message() = "message";
+	buf.clear();
+	ser.serialize(tag);
+	BOOST_REQUIRE(string(buf.begin(), buf.end()) == 
+		"object " + hello_hex_sha_lc + "\ntype commit\ntag v1.0\ntagger A U Thor <author@example.com> 1112911993 -0700\n\nmessage");
+}
+
 BOOST_AUTO_TEST_CASE(lib_tag)
 {
 	Tag tag;
@@ -135,7 +488,51 @@ BOOST_AUTO_TEST_CASE(lib_tag)
 	}// verify exception handling
 	
 	
-	//! \todo maybe, add some fuzzing to be sure we don't unconditionally read garbage
+	// buffer parsing
+	const string raw(
+		"object " + hello_hex_sha_lc + "\n"
+		"type commit\n"
+		"tag v1.0\n"
+		"tagger A U Thor <author@example.com> 1112911993 -0700\n"
+		"\n"
+		"message\n");
+	otag.parse(raw.data(), raw.size());
+	BOOST_REQUIRE(otag.object_key() == SHA1(hello_hex_sha) && otag.object_type() == Object::Type::Commit);
+	BOOST_REQUIRE(otag.name() == "v1.0" && otag.actor().name == "A U Thor" && otag.message() == "message\n");
+	
+	const string bad[] = {
+		raw.substr(raw.find("type")),
+		"object " + hello_hex_sha_lc.substr(1) + "\n" + raw.substr(raw.find("type")),
+		raw.substr(0, raw.find("type")) + "type unknown\n" + raw.substr(raw.find("tag ")),
+		raw.substr(0, raw.find("tagger")),
+		raw.substr(0, raw.find("tagger")) + "tagger nobody\n"
+	};
+	for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i) {
+		BOOST_REQUIRE_THROW(otag.parse(bad[i].data(), bad[i].size()), DeserializationError);
+	}
+	
+	// truncated tags are rejected without reading beyond the input, which is copied to have exact bounds
+	const string truncated[] = {
+		"object " + hello_hex_sha_lc,
+		"object " + hello_hex_sha_lc + "\n",
+		raw.substr(0, raw.find("tag ")) + "tag v1.0",
+		raw.substr(0, raw.find("tagger") - 1),
+	};
+	for (size_t i = 0; i < sizeof(truncated) / sizeof(truncated[0]); ++i) {
+		const std::vector<char> buf(truncated[i].begin(), truncated[i].end());
+		BOOST_REQUIRE_THROW(otag.parse(buf.data(), buf.size()), TagDeserializationError);
+	}
+	
+	// the message may follow the tagger without an empty line, or be missing along with the last newline
+	{
+		const string no_blank(raw.substr(0, raw.find("\n\n") + 1) + "message");
+		std::vector<char> buf(no_blank.begin(), no_blank.end());
+		otag.parse(buf.data(), buf.size());
+		BOOST_REQUIRE(otag.actor().name == "A U Thor" && otag.message() == "message");
+		buf.resize(raw.find("\n\n"));
+		otag.parse(buf.data(), buf.size());
+		BOOST_REQUIRE(otag.actor().tz_offset == -700 && otag.message().empty());
+	}
 }
 
 BOOST_AUTO_TEST_CASE(lib_tree)
@@ -159,6 +556,141 @@ BOOST_AUTO_TEST_CASE(lib_tree)
 	}// for each exception state
 }
 
+BOOST_AUTO_TEST_CASE(lib_tree_view)
+{
+	Tree tree;
+	Tree::map_type& elms = tree.elements();
+	elms.insert(Tree::map_type::value_type("file", Tree::Element(0100644, SHA1(string("b45ef6fec89518d314f546fd6c3025367b721684")))));
+	elms.insert(Tree::map_type::value_type("dir", Tree::Element(0040000, SHA1(string("1111111111111111111111111111111111111111")))));
+	elms.insert(Tree::map_type::value_type("module", Tree::Element(0160000, SHA1(string("2222222222222222222222222222222222222222")))));
+	
+	std::stringstream s;
+	s << tree;
+	const string data(s.str());
+	
+	// entries come in serialization order, and refer to the buffer
+	const TreeView view(data.data(), data.size());
+	BOOST_REQUIRE(!view.empty());
+	auto ei = elms.begin();
+	uint count = 0;
+	for (auto it = view.begin(); it != view.end(); ++it, ++ei, ++count) {
+		BOOST_REQUIRE(it->name_string() == ei->first);
+		BOOST_REQUIRE(it->mode == ei->second.mode);
+		BOOST_REQUIRE(it->key() == ei->second.key);
+		BOOST_REQUIRE(it->name >= data.data() && it->key_bytes < data.data() + data.size());
+	}
+	BOOST_REQUIRE(count == elms.size());
+	
+	BOOST_REQUIRE(view.find("dir")->is_tree());
+	BOOST_REQUIRE(view.find("module")->is_commit());
+	BOOST_REQUIRE(!view.find("file")->is_tree() && !view.find("file")->is_commit());
+	BOOST_REQUIRE(view.find("fil") == view.end());
+	BOOST_REQUIRE(TreeView(data.data(), 0).begin() == TreeView(data.data(), 0).end());
+	
+	// trees are only created if needed
+	BOOST_REQUIRE(Tree(view) == tree);
+	
+	// corruption is detected
+	BOOST_REQUIRE_THROW(TreeView(data.data(), data.size() - 1).find("zzz"), DeserializationError);
+	const string bad_mode("10x644 file"), no_name("100644 "), no_key(data.substr(0, data.find('\0') + 1));
+	BOOST_REQUIRE_THROW(TreeView(bad_mode.data(), bad_mode.size()).begin(), DeserializationError);
+	BOOST_REQUIRE_THROW(TreeView(no_name.data(), no_name.size()).begin(), DeserializationError);
+	BOOST_REQUIRE_THROW(TreeView(no_key.data(), no_key.size()).begin(), DeserializationError);
+}
+
+BOOST_AUTO_TEST_CASE(lib_flat_tree)
+{
+	const SHA1 k1(string("1111111111111111111111111111111111111111"));
+	const SHA1 k2(string("2222222222222222222222222222222222222222"));
+	
+	// directories sort as if they had a trailing slash
+	FlatTree tree;
+	const char* names[] = {"foo.c", "foo", "foo-bar", "a", "foo"};
+	const FlatTree::mode_type modes[] = {0100644, 0040000, 0100755, 0120000, 0040000};
+	for (uint i = 0; i < 5; ++i) {
+		tree.push_back(modes[i], names[i], std::strlen(names[i]), i == 4 ? k2 : k1);
+	}
+	tree.sort();
+	BOOST_REQUIRE(tree.num_entries() == 4);
+	const char* sorted[] = {"a", "foo-bar", "foo.c", "foo"};
+	uint i = 0;
+	for (auto it = tree.begin(); it != tree.end(); ++it, ++i) {
+		BOOST_REQUIRE(tree.name_string(*it) == sorted[i]);
+	}
+	// the last duplicate wins
+	BOOST_REQUIRE(tree.find("foo")->key == k2);
+	BOOST_REQUIRE(tree.find("foo")->is_tree());
+	BOOST_REQUIRE(tree.find("fo") == tree.end());
+	BOOST_REQUIRE(tree.find("foo.c")->mode == 0100644);
+	
+	// duplicates are removed even if entries are in order
+	{
+		FlatTree dups;
+		dups.push_back(0100644, "foo", 3, k1);
+		dups.push_back(0100644, "foo.c", 5, k1);
+		dups.push_back(0040000, "foo", 3, k2);
+		dups.sort();
+		BOOST_REQUIRE(dups.num_entries() == 2);
+		BOOST_REQUIRE(dups.find("foo")->key == k2);
+	}
+	{
+		FlatTree nested;
+		const char* nnames[] = {"foo", "foo-a", "foo-a.c", "foo-a", "foo"};
+		for (uint n = 0; n < 5; ++n) {
+			nested.push_back(n < 3 ? 0100644 : 0040000, nnames[n], std::strlen(nnames[n]), k1);
+		}
+		nested.sort();
+		BOOST_REQUIRE(nested.num_entries() == 3);
+		BOOST_REQUIRE(nested.find("foo")->is_tree());
+		BOOST_REQUIRE(nested.find("foo-a")->is_tree());
+	}
+	
+	// a file of the same name as a directory sorts before '.'
+	tree.insert(0100644, "foo", k1);
+	BOOST_REQUIRE(tree.num_entries() == 4);
+	BOOST_REQUIRE(tree.name_string(tree.begin()[1]) == "foo");
+	BOOST_REQUIRE(!tree.find("foo")->is_tree());
+	tree.insert(0040000, "foo", k2);
+	BOOST_REQUIRE(tree.name_string(tree.begin()[3]) == "foo");
+	// replacing an entry reuses its name
+	const uint32 name_offset = tree.find("foo.c")->name_offset;
+	tree.insert(0100755, "foo.c", k2);
+	BOOST_REQUIRE(tree.find("foo.c")->name_offset == name_offset);
+	tree.insert(0100644, "foo.c", k1);
+	tree.insert(0100644, "b", k1);
+	BOOST_REQUIRE(tree.name_string(tree.begin()[1]) == "b");
+	BOOST_REQUIRE(tree.erase("b"));
+	BOOST_REQUIRE(!tree.erase("b"));
+	BOOST_REQUIRE(tree.num_entries() == 4);
+	
+	// serialization matches git, and round-trips through views and trees
+	std::stringstream s;
+	s << tree;
+	const string data(s.str());
+	BOOST_REQUIRE(data.size() == tree.size());
+	BOOST_REQUIRE(data.compare(0, 9, string("120000 a\0", 9)) == 0);
+	const TreeView view(data.data(), data.size());
+	BOOST_REQUIRE(FlatTree(view) == tree);
+	i = 0;
+	for (auto it = view.begin(); it != view.end(); ++it, ++i) {
+		BOOST_REQUIRE(it->name_string() == sorted[i]);
+	}
+	BOOST_REQUIRE(FlatTree(Tree(view)) == tree);
+	
+	FlatTree otree;
+	s >> otree;
+	BOOST_REQUIRE(otree == tree);
+	
+	// hashes match those of git
+	SHA1Generator gen;
+	char hdr[32];
+	gen.update(hdr, loose_object_header(hdr, Object::Type::Tree, data.size()));
+	gen.update(data.data(), data.size());
+	BOOST_REQUIRE(gen.hash() == SHA1(string("342c046a9d35eb8906feda8bce40798373481422")));
+	const FlatTree empty;
+	BOOST_REQUIRE(empty.size() == 0);
+}
+
 BOOST_AUTO_TEST_CASE(lib_sha1_facility)
 {
 	// Test SHA1 itself
@@ -477,7 +1009,1566 @@ BOOST_FIXTURE_TEST_CASE(loose_db_test, GitLooseODBFixture)
 
 BOOST_FIXTURE_TEST_CASE(packed_db_test_db_test, GitPackedODBFixture)
 {
+	typedef typename git_object_traits::char_type char_type;
+	const uint num_packs = 3;
+	const uint num_objects = 50;
+	
+	PackODB podb(rw_dir());
+	BOOST_REQUIRE(podb.packs().size() == num_packs);
+	BOOST_REQUIRE(podb.multi_pack_index() == nullptr);
+	BOOST_REQUIRE(podb.count() == num_objects);
+	
+	std::vector<char_type> buf;
+	uint count = 0;
+	auto end = podb.end();
+	for (auto it = podb.begin(); it != end; ++it, ++count) {
+		BOOST_REQUIRE(podb.has_object(it.key()));
+		{
+			PackODB::accessor acc = podb.object(it.key());
+			BOOST_REQUIRE(acc->size() == it->size());
+			BOOST_REQUIRE(acc->type() == it->type());
+		}// end accessor lifetime
+		
+		// the data we stream must hash to the key of the object, which verifies delta resolution
+		std::unique_ptr<PackODB::output_object_type::stream_type> stream(it->new_stream());
+		buf.resize(it->size() + 1);
+		stream->read(buf.data(), buf.size());
+		BOOST_REQUIRE((size_t)stream->gcount() == it->size());
+		
+		char_type hdr[32];
+		SHA1Generator sgen;
+		sgen.update(hdr, loose_object_header(hdr, it->type(), it->size()));
+		sgen.update(buf.data(), it->size());
+		BOOST_REQUIRE(sgen.hash() == it.key());
+		
+		MultiObject mobj;
+		it->deserialize(mobj);
+		BOOST_REQUIRE(it->type() == mobj.type);
+	}// for each object in packodb
+	BOOST_REQUIRE(count == num_objects);
+	BOOST_REQUIRE(!podb.has_object(PackODB::key_type::null));
+	BOOST_REQUIRE_THROW(podb.object(PackODB::key_type::null), gtl::odb_error);
+	
+	// ITERATION ORDER
+	//////////////////
+	// default iteration is sequential within each pack, the alternative is sorted by key
+	{
+		std::set<PackODB::key_type> keys;
+		const PackODB::pack_type* last_pack = nullptr;
+		uint64_t last_offset = 0;
+		for (auto it = podb.begin(); it != end; ++it) {
+			BOOST_REQUIRE(&it->pack() != last_pack || it->offset() > last_offset);
+			last_pack = &it->pack();
+			last_offset = it->offset();
+			keys.insert(it.key());
+		}
+		
+		count = 0;
+		last_pack = nullptr;
+		PackODB::key_type last_key;
+		const auto hend = podb.hash_order_end();
+		for (auto it = podb.hash_order_begin(); it != hend; ++it, ++count) {
+			BOOST_REQUIRE(&it->pack() != last_pack || last_key < it.key());
+			last_pack = &it->pack();
+			last_key = it.key();
+			BOOST_REQUIRE(keys.count(it.key()) == 1);
+			
+			MultiObject mobj;
+			it->deserialize(mobj);
+			BOOST_REQUIRE(it->type() == mobj.type);
+		}
+		BOOST_REQUIRE(count == num_objects);
+	}
+	
+	// MULTI PACK INDEX
+	///////////////////
+	podb.write_multi_pack_index();
+	const PackODB::midx_type* midx = podb.multi_pack_index();
+	BOOST_REQUIRE(midx != nullptr);
+	BOOST_REQUIRE(midx->num_packs() == num_packs);
+	BOOST_REQUIRE(midx->num_entries() == num_objects);
+	for (uint32 i = 1; i < midx->num_entries(); ++i) {
+		BOOST_REQUIRE(midx->key(i-1) < midx->key(i));
+	}
+	
+	// a new database picks up the index, and all lookups go through it
+	PackODB midx_db(rw_dir());
+	BOOST_REQUIRE(midx_db.multi_pack_index() != nullptr);
+	for (auto it = podb.begin(); it != end; ++it) {
+		uint32 pack_id;
+		uint64_t offset;
+		BOOST_REQUIRE(midx_db.multi_pack_index()->lookup(it.key(), pack_id, offset));
+		BOOST_REQUIRE(offset == it->offset());
+		BOOST_REQUIRE(midx_db.multi_pack_index()->pack_names()[pack_id] == 
+		              it->pack().index().path().filename().string());
+		
+		PackODB::accessor acc = midx_db.object(it.key());
+		BOOST_REQUIRE(acc->type() == it->type());
+		BOOST_REQUIRE(acc->size() == it->size());
+	}
+	BOOST_REQUIRE(!midx_db.has_object(PackODB::key_type::null));
+	
+	// an index referring to a missing pack is ignored
+	const fs::path idx_path(podb.packs().front()->index().path());
+	fs::rename(idx_path, rw_dir() / "moved.idx");
+	PackODB partial_db(rw_dir());
+	BOOST_REQUIRE(partial_db.multi_pack_index() == nullptr);
+	BOOST_REQUIRE(partial_db.packs().size() == num_packs - 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(empty_objects_pack_test, GitEmptyObjectsPackFixture)
+{
+	// empty objects inflate into nothing, which must not be confused with a failure
+	const SHA1 empty_blob(string("e69de29bb2d1d6434b8b29ae775ad8c2e48c5391"));
+	const SHA1 empty_tree(string("4b825dc642cb6eb9a060e54bf8d69288fbee4904"));
+	PackODB podb(rw_dir());
+	BOOST_REQUIRE(podb.count() == 2);
+	BOOST_REQUIRE(podb.has_object(empty_blob) && podb.has_object(empty_tree));
+	for (auto it = podb.begin(); it != podb.end(); ++it) {
+		BOOST_REQUIRE(it->size() == 0);
+		std::unique_ptr<PackODB::output_object_type::stream_type> stream(it->new_stream());
+		char c;
+		stream->read(&c, 1);
+		BOOST_REQUIRE(stream->gcount() == 0);
+		BOOST_REQUIRE(it->type() == (it.key() == empty_blob ? Object::Type::Blob : Object::Type::Tree));
+	}
+	MultiObject mobj;
+	podb.object(empty_blob)->deserialize(mobj);
+	BOOST_REQUIRE(mobj.type == Object::Type::Blob && mobj.blob.data().empty());
+	
+	// copying them into a new pack inflates them as well
+	const fs::path dir(rw_dir() / "copy");
+	fs::create_directory(dir);
+	LooseODB lodb(dir);
+	for (auto it = podb.begin(); it != podb.end(); ++it) {
+		PackODB::output_object_type::raw_object_type raw;
+		it->raw(raw);
+		BOOST_REQUIRE(lodb.insert_raw(raw).key() == it.key());
+	}
+	BOOST_REQUIRE(lodb.count() == 2);
+}
+
+BOOST_FIXTURE_TEST_CASE(pack_bitmap_test, GitPackedODBFixture)
+{
+	typedef PackReachability::bitmap_type bitmap_type;
+	typedef PackReachability::key_vector_type key_vector_type;
+	
+	PackODB podb(rw_dir());
+	// linear history of 6 commits, oldest last
+	const PackODB::pack_type& pack = *podb.packs().front();
+	const key_vector_type history = {
+		SHA1(string("69add70421751bdcaa6c0d7def9aa52d56f779b6")), SHA1(string("ba6e3b6f6181162f06b0dbb61dcf0e17d508f9d8")),
+		SHA1(string("ad27e329b5cffb5c02e01a2d8b6e440628f20e4d")), SHA1(string("d311bcfd5a4f1f0a379429aaae8990f5394a2693")),
+		SHA1(string("6f5f451f2f8525f5f6a64453116418933547c569")), SHA1(string("d440a83d441cb636ac3a015418f3573600a40b4f"))
+	};
+	BOOST_REQUIRE(pack.index().lookup(history.front()) != pack.num_entries());
+	
+	// without bitmaps, reachability is computed by walking
+	std::vector<bitmap_type> walked(history.size());
+	{
+		PackReachability reach(pack);
+		BOOST_REQUIRE(reach.bitmap_index() == nullptr);
+		for (size_t i = 0; i < history.size(); ++i) {
+			reach.reachable(key_vector_type(1, history[i]), walked[i]);
+		}
+		BOOST_REQUIRE(walked.front().count() == pack.num_entries());
+		BOOST_REQUIRE(walked[3].count() == 16);
+		BOOST_REQUIRE(reach.count(walked.front(), Object::Type::Commit) == history.size());
+		
+		// each object is its own ancestor
+		BOOST_REQUIRE(walked[3].test(pack.pack_position(pack.index().lookup(history[3]))));
+		BOOST_REQUIRE(reach.key(pack.pack_position(pack.index().lookup(history[3]))) == history[3]);
+		BOOST_REQUIRE(!walked[4].test(pack.pack_position(pack.index().lookup(history[3]))));
+	}
+	
+	// bitmaps for the root and a commit in the middle
+	PackReachability::write_bitmaps(pack, key_vector_type({history[5], history[2]}));
+	PackReachability reach(pack);
+	BOOST_REQUIRE(reach.bitmap_index() != nullptr);
+	BOOST_REQUIRE(reach.bitmap_index()->num_bitmaps() == 2);
+	BOOST_REQUIRE(reach.bitmap_index()->key(1) == history[2]);
 	
+	bitmap_type bm;
+	BOOST_REQUIRE(reach.bitmap_index()->bitmap(history[2], bm));
+	BOOST_REQUIRE(bm == walked[2]);
+	BOOST_REQUIRE(!reach.bitmap_index()->bitmap(history[0], bm));
 	
+	// commits with and without bitmap yield the same result as walking
+	for (size_t i = 0; i < history.size(); ++i) {
+		reach.reachable(key_vector_type(1, history[i]), bm);
+		BOOST_REQUIRE(bm == walked[i]);
+		BOOST_REQUIRE(bm.count() == walked[i].count());
+	}
+	
+	uint64_t num_types = 0;
+	const Object::Type types[] = {Object::Type::Commit, Object::Type::Tree, Object::Type::Blob, Object::Type::Tag};
+	for (auto t = types; t < types + 4; ++t) {
+		num_types += reach.count(walked.front(), *t);
+	}
+	BOOST_REQUIRE(num_types == pack.num_entries());
+	BOOST_REQUIRE(reach.count(walked.front(), Object::Type::Commit) == history.size());
+	
+	// objects to send if the other side has an older commit
+	reach.difference(key_vector_type(1, history[0]), key_vector_type(1, history[3]), bm);
+	BOOST_REQUIRE(bm.count() == walked[0].count() - walked[3].count());
+	BOOST_REQUIRE(reach.count(bm, Object::Type::Commit) == 3);
+	
+	// objects of other packs cannot be handled
+	BOOST_REQUIRE_THROW(reach.reachable(key_vector_type(1, PackODB::key_type::null), bm), gtl::pack_error);
+}
+
+BOOST_FIXTURE_TEST_CASE(raw_copy_test, GitPackedODBFixture)
+{
+	typedef typename git_object_traits::char_type char_type;
+	typedef PackODB::output_object_type::raw_object_type raw_object_type;
+	const uint num_objects = 50;
+	
+	// every object read from the database must hash to its key
+	auto verify_packs = [](const fs::path& dir) -> uint {
+		PackODB db(dir);
+		std::vector<char_type> buf;
+		uint count = 0;
+		for (auto it = db.begin(); it != db.end(); ++it, ++count) {
+			std::unique_ptr<PackODB::output_object_type::stream_type> stream(it->new_stream());
+			buf.resize(it->size() + 1);
+			stream->read(buf.data(), buf.size());
+			BOOST_REQUIRE((size_t)stream->gcount() == it->size());
+			
+			char_type hdr[32];
+			SHA1Generator sgen;
+			sgen.update(hdr, loose_object_header(hdr, it->type(), it->size()));
+			sgen.update(buf.data(), it->size());
+			BOOST_REQUIRE(sgen.hash() == it.key());
+		}
+		return count;
+	};
 	
+	const fs::path loose_dir(rw_dir() / "loose");
+	const fs::path loose_copy_dir(rw_dir() / "loose_copy");
+	const fs::path pack_dir(rw_dir() / "pack_copy");
+	const fs::path converted_dir(rw_dir() / "converted");
+	fs::create_directory(loose_dir);
+	fs::create_directory(loose_copy_dir);
+	fs::create_directory(pack_dir);
+	fs::create_directory(converted_dir);
+	
+	// PACK TO PACK AND LOOSE
+	/////////////////////////
+	PackODB podb(rw_dir());
+	LooseODB lodb(loose_dir);
+	uint num_deltas = 0;
+	{
+		PackWriter writer(pack_dir);
+		for (auto it = podb.begin(); it != podb.end(); ++it) {
+			raw_object_type raw;
+			it->raw(raw);
+			BOOST_REQUIRE(raw.key == it.key());
+			BOOST_REQUIRE(raw.type == it->type());
+			BOOST_REQUIRE(raw.size == it->size());
+			BOOST_REQUIRE(raw.format == gtl::raw_format::pack_entry);
+			BOOST_REQUIRE(!raw.is_delta || podb.has_object(raw.base_key));
+			
+			writer.insert_raw(raw);
+			writer.insert_raw(raw);		// duplicates are skipped
+			if (raw.is_delta) {
+				++num_deltas;
+				BOOST_REQUIRE_THROW(lodb.insert_raw(raw), gtl::odb_raw_format_error);
+			} else {
+				BOOST_REQUIRE(lodb.insert_raw(raw).key() == raw.key);
+			}
+		}// for each packed object
+		BOOST_REQUIRE(num_deltas > 0);
+		BOOST_REQUIRE(writer.count() == num_objects);
+		
+		const fs::path pack_path(writer.finish());
+		BOOST_REQUIRE(fs::is_regular_file(pack_path));
+		BOOST_REQUIRE(fs::is_regular_file(fs::path(pack_path).replace_extension(".idx")));
+	}
+	BOOST_REQUIRE(verify_packs(pack_dir) == num_objects);
+	BOOST_REQUIRE(lodb.count() == num_objects - num_deltas);
+	
+	// deltas are copied as they are
+	{
+		PackODB copy(pack_dir);
+		BOOST_REQUIRE(copy.packs().size() == 1);
+		for (auto it = podb.begin(); it != podb.end(); ++it) {
+			raw_object_type raw, copied;
+			it->raw(raw);
+			copy.object(it.key())->raw(copied);
+			BOOST_REQUIRE(copied.is_delta == raw.is_delta);
+			BOOST_REQUIRE(copied.base_key == raw.base_key || !raw.is_delta);
+			BOOST_REQUIRE(copied.crc == raw.crc);
+		}
+	}
+	
+	// LOOSE TO LOOSE AND PACK
+	//////////////////////////
+	{
+		LooseODB lcopy(loose_copy_dir);
+		PackWriter writer(converted_dir);
+		for (auto it = lodb.begin(); it != lodb.end(); ++it) {
+			raw_object_type raw;
+			it->raw(raw);
+			BOOST_REQUIRE(raw.key == it.key());
+			BOOST_REQUIRE(raw.format == gtl::raw_format::loose);
+			BOOST_REQUIRE(raw.buffer);
+			
+			auto acc = lcopy.insert_raw(raw);
+			BOOST_REQUIRE(acc.key() == raw.key);
+			BOOST_REQUIRE(acc->type() == it->type());
+			BOOST_REQUIRE(acc->size() == it->size());
+			raw_object_type copied;
+			acc->raw(copied);
+			BOOST_REQUIRE(copied.crc == raw.crc);
+			
+			writer.insert_raw(raw);
+		}// for each loose object
+		BOOST_REQUIRE(lcopy.count() == lodb.count());
+		writer.finish();
+	}
+	BOOST_REQUIRE(verify_packs(converted_dir) == num_objects - num_deltas);
+	
+	// OBJECT INSERTION
+	///////////////////
+	{
+		fs::path dir(rw_dir() / "inserted");
+		fs::create_directory(dir);
+		PackWriter writer(dir);
+		io::stream<io::basic_array_source<char_type> > istream(phello, lenphello);
+		LooseODB::input_object_type iobj(Object::Type::Blob, lenphello, istream);
+		writer.insert(iobj);
+		BOOST_REQUIRE(writer.count() == 1);
+		
+		istream.seekg(0, std::ios::beg);
+		BOOST_REQUIRE(writer.has_object(lodb.insert(iobj).key()));
+		istream.seekg(0, std::ios::beg);
+		writer.insert(iobj);
+		BOOST_REQUIRE(writer.count() == 1);
+		writer.finish();
+		BOOST_REQUIRE(verify_packs(dir) == 1);
+	}
+	
+	// ERROR HANDLING
+	/////////////////
+	{
+		fs::path dir(rw_dir() / "failed");
+		fs::create_directory(dir);
+		PackWriter writer(dir);
+		for (auto it = podb.begin(); it != podb.end(); ++it) {
+			raw_object_type raw;
+			it->raw(raw);
+			if (!raw.is_delta) {
+				continue;
+			}
+			// corrupted data is detected
+			std::shared_ptr<raw_object_type::buffer_type> buf(new raw_object_type::buffer_type(raw.data, raw.data + raw.data_size));
+			(*buf)[buf->size() / 2] ^= 1;
+			raw_object_type corrupted(raw);
+			corrupted.data = buf->data();
+			corrupted.buffer = buf;
+			BOOST_REQUIRE_THROW(writer.insert_raw(corrupted), gtl::odb_checksum_error);
+			corrupted.is_delta = false;
+			BOOST_REQUIRE_THROW(lodb.insert_raw(corrupted), gtl::odb_checksum_error);
+			
+			// thin packs are not supported
+			writer.insert_raw(raw);
+			break;
+		}
+		BOOST_REQUIRE(writer.count() == 1);
+
+		// loose data carries no checksum of its own, it is verified against its key
+		auto lit = lodb.begin();
+		raw_object_type raw;
+		lit->raw(raw);
+		raw.key = (++lit).key();
+		BOOST_REQUIRE_THROW(writer.insert_raw(raw), gtl::odb_checksum_error);
+		{
+			fs::create_directory(rw_dir() / "failed_loose");
+			LooseODB lcopy(rw_dir() / "failed_loose");
+			BOOST_REQUIRE_THROW(lcopy.insert_raw(raw), gtl::odb_checksum_error);
+			BOOST_REQUIRE(lcopy.count() == 0);
+		}
+		BOOST_REQUIRE(writer.count() == 1);
+		BOOST_REQUIRE_THROW(writer.finish(), gtl::pack_error);
+	}
+	// the temporary pack was removed
+	BOOST_REQUIRE(fs::directory_iterator(rw_dir() / "failed") == fs::directory_iterator());
+}
+
+BOOST_FIXTURE_TEST_CASE(streaming_blob_test, GitPackedODBFixture)
+{
+	typedef StreamingBlob::char_type char_type;
+	const fs::path loose_dir(rw_dir() / "loose");
+	const fs::path copy_dir(rw_dir() / "loose_copy");
+	const fs::path pack_dir(rw_dir() / "pack_copy");
+	fs::create_directory(loose_dir);
+	fs::create_directory(copy_dir);
+	fs::create_directory(pack_dir);
+	
+	// a blob larger than any chunk
+	Blob blob;
+	for (size_t i = 0; i < 1024 * 1024 + 17; ++i) {
+		blob.data().push_back((char_type)(i * 7 + (i >> 10)));
+	}
+	LooseODB lodb(loose_dir);
+	const SHA1 key(lodb.insert_object(blob).key());
+	
+	// chunked reads
+	{
+		StreamingBlob sblob(*lodb.object(key), &key);
+		BOOST_REQUIRE(sblob.size() == blob.size() && !sblob.eof());
+		std::vector<char_type> chunk(4096);
+		size_t ofs = 0;
+		for (size_t nread; (nread = sblob.read(chunk.data(), chunk.size())) != 0; ofs += nread) {
+			BOOST_REQUIRE(std::memcmp(chunk.data(), blob.data().data() + ofs, nread) == 0);
+		}
+		BOOST_REQUIRE(ofs == blob.size() && sblob.eof());
+		
+		// can't insert what was read already
+		LooseODB copy(copy_dir);
+		BOOST_REQUIRE_THROW(sblob.insert_into(copy), ObjectError);
+	}
+	
+	// copy into other databases, with and without known key
+	LooseODB copy(copy_dir);
+	BOOST_REQUIRE(StreamingBlob(*lodb.object(key)).insert_into(copy).key() == key);
+	BOOST_REQUIRE(copy.has_object(key));
+	{
+		PackWriter writer(pack_dir);
+		StreamingBlob(*lodb.object(key), &key).insert_into(writer);
+		writer.finish();
+	}
+	PackODB pcopy(pack_dir);
+	BOOST_REQUIRE(pcopy.count() == 1 && pcopy.has_object(key));
+	
+	// stream all packed blobs, and compare to their deserialized version
+	PackODB podb(rw_dir());
+	uint num_blobs = 0;
+	for (auto it = podb.begin(); it != podb.end(); ++it) {
+		if (it->type() != Object::Type::Blob) {
+			BOOST_REQUIRE_THROW(StreamingBlob sblob(*it), ObjectError);
+			continue;
+		}
+		MultiObject mobj;
+		it->deserialize(mobj);
+		StreamingBlob sblob(*it);
+		std::vector<char_type> data(sblob.size());
+		BOOST_REQUIRE(sblob.read(data.data(), data.size() + 10) == data.size());
+		BOOST_REQUIRE(data == mobj.blob.data());
+		++num_blobs;
+	}
+	BOOST_REQUIRE(num_blobs);
+	
+	// streams which end too early
+	std::unique_ptr<StreamingBlob::stream_type> stream(new std::istringstream("short"));
+	StreamingBlob sblob(std::move(stream), 10);
+	char_type buf[10];
+	BOOST_REQUIRE_THROW(sblob.read(buf, sizeof(buf)), DeserializationError);
+}
+
+BOOST_FIXTURE_TEST_CASE(object_pool_test, GitPackedODBFixture)
+{
+	PackODB podb(rw_dir());
+	ObjectPool pool;
+	std::set<Object::Type> types;
+	
+	// twice, to overwrite objects of the same type
+	for (uint r = 0; r < 2; ++r) {
+		for (auto it = podb.begin(); it != podb.end(); ++it) {
+			MultiObject mobj;
+			it->deserialize(mobj);
+			const Object::Type type = pool.deserialize(*it);
+			BOOST_REQUIRE(type == it->type());
+			types.insert(type);
+			
+			switch (type)
+			{
+			case Object::Type::Blob: { BOOST_REQUIRE(pool.blob().data() == mobj.blob.data()); break; }
+			case Object::Type::Commit: { BOOST_REQUIRE(pool.commit() == mobj.commit); break; }
+			case Object::Type::Tree: { BOOST_REQUIRE(pool.tree() == FlatTree(mobj.tree)); break; }
+			case Object::Type::Tag: { BOOST_REQUIRE(pool.tag() == mobj.tag); break; }
+			default: BOOST_FAIL("unexpected type");
+			}
+		}// for each object
+	}
+	BOOST_REQUIRE(types.size() >= 3);
+	
+	const string raw("data");
+	BOOST_REQUIRE_THROW(pool.deserialize(Object::Type::None, raw.data(), raw.size()), DeserializationError);
+	BOOST_REQUIRE(pool.deserialize(Object::Type::Blob, raw.data(), raw.size()) == Object::Type::Blob);
+	BOOST_REQUIRE(string(pool.blob().data().begin(), pool.blob().data().end()) == raw);
+}
+
+BOOST_FIXTURE_TEST_CASE(fsck_test, GitLooseODBFixture)
+{
+	typedef LooseODB::key_type key_type;
+	const uint num_objects = 10;
+	LooseODB lodb(rw_dir());
+	
+	// INTACT DATABASES
+	///////////////////
+	uint64_t last_progress = 0;
+	LooseFsck fsck(lodb, 4);
+	fsck.set_batch_size(3);
+	fsck.set_progress([&last_progress](uint64_t done, uint64_t total) {
+		BOOST_REQUIRE(done > last_progress);
+		BOOST_REQUIRE(done <= total);
+		last_progress = done;
+	});
+	LooseFsck::report_type report(fsck.verify());
+	BOOST_REQUIRE(report.ok());
+	BOOST_REQUIRE(report.num_objects == num_objects);
+	BOOST_REQUIRE(report.num_links > 0);
+	BOOST_REQUIRE(last_progress == num_objects);
+	
+	// CORRUPTION
+	/////////////
+	// remove the tree of a commit
+	key_type commit_key, tree_key;
+	for (auto it = lodb.begin(); it != lodb.end(); ++it) {
+		if (it->type() == Object::Type::Commit) {
+			MultiObject mobj;
+			it->deserialize(mobj);
+			commit_key = it.key();
+			tree_key = mobj.commit.tree_key();
+			break;
+		}
+	}
+	BOOST_REQUIRE(lodb.has_object(tree_key));
+	const fs::path tree_path(lodb.object(tree_key)->path());
+	
+	// store the tree's data under another key, and put garbage into another object
+	const fs::path moved_path(tree_path.parent_path().parent_path() / "ff" / "00000000000000000000000000000000000000");
+	fs::create_directory(moved_path.parent_path());
+	fs::rename(tree_path, moved_path);
+	const fs::path garbage_path(tree_path.parent_path().parent_path() / "ff" / "11111111111111111111111111111111111111");
+	{
+		std::ofstream garbage(garbage_path.string().c_str());
+		garbage << "garbage";
+	}
+	
+	report = LooseFsck(lodb, 1).verify();
+	BOOST_REQUIRE(report.num_objects == num_objects + 1);
+	BOOST_REQUIRE(report.problems.size() == 3);
+	BOOST_REQUIRE(report.count(gtl::fsck_problem_kind::hash_mismatch) == 1);
+	BOOST_REQUIRE(report.count(gtl::fsck_problem_kind::corrupt) == 1);
+	BOOST_REQUIRE(report.count(gtl::fsck_problem_kind::missing_link) == 1);
+	for (auto p = report.problems.begin(); p != report.problems.end(); ++p) {
+		switch(p->kind)
+		{
+		case gtl::fsck_problem_kind::hash_mismatch: BOOST_REQUIRE(p->key == SHA1(string("ff00000000000000000000000000000000000000"))); break;
+		case gtl::fsck_problem_kind::corrupt: BOOST_REQUIRE(p->key == SHA1(string("ff11111111111111111111111111111111111111"))); break;
+		case gtl::fsck_problem_kind::missing_link:
+		{
+			BOOST_REQUIRE(p->key == commit_key);
+			BOOST_REQUIRE(p->link == tree_key);
+			break;
+		}
+		}
+		BOOST_REQUIRE(p->kind == gtl::fsck_problem_kind::missing_link || !p->message.empty());
+	}
+	
+	// links may be resolved elsewhere
+	LooseFsck linked(lodb);
+	linked.set_link_lookup([&lodb, &tree_key](const key_type& key) { return key == tree_key || lodb.has_object(key); });
+	BOOST_REQUIRE(linked.verify().count(gtl::fsck_problem_kind::missing_link) == 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(pack_fsck_test, GitPackedODBFixture)
+{
+	PackODB podb(rw_dir());
+	PackFsck::report_type report(PackFsck(podb).verify());
+	BOOST_REQUIRE(report.ok());
+	BOOST_REQUIRE(report.num_objects == podb.count());
+	BOOST_REQUIRE(report.num_links > 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(commit_table_test, GitPackedODBFixture)
+{
+	PackODB podb(rw_dir());
+	CommitTable table;
+	table.insert_all(podb);
+	BOOST_REQUIRE(!table.is_finalized());
+	table.finalize();
+	BOOST_REQUIRE(table.is_finalized());
+	BOOST_REQUIRE(table.size() > 0);
+	BOOST_REQUIRE(table.memory_usage() > 0);
+	
+	size_t num_commits = 0;
+	ObjectPool pool;
+	for (auto it = podb.begin(); it != podb.end(); ++it) {
+		if (it->type() != Object::Type::Commit) {
+			BOOST_REQUIRE(table.lookup(it.key()) == CommitTable::npos);
+			continue;
+		}
+		++num_commits;
+		pool.deserialize(*it);
+		const Commit& c = pool.commit();
+		const CommitTable::index_type index = table.lookup(it.key());
+		BOOST_REQUIRE(index != CommitTable::npos);
+		BOOST_REQUIRE(table.key(index) == it.key());
+		BOOST_REQUIRE(table.tree_key(index) == c.tree_key());
+		BOOST_REQUIRE(table.time(index) == c.committer().time);
+		BOOST_REQUIRE(table.actors().actor(table.author(index)) == c.author());
+		
+		const CommitTable::parent_range parents = table.parents(index);
+		BOOST_REQUIRE(parents.size() == c.parent_keys().size());
+		auto pkey = c.parent_keys().begin();
+		for (auto p = parents.begin(); p != parents.end(); ++p, ++pkey) {
+			BOOST_REQUIRE(*p != CommitTable::npos && table.key(*p) == *pkey);
+		}
+	}
+	BOOST_REQUIRE(num_commits == table.size());
+	
+	// duplicates are dropped, parents which were not inserted are marked
+	Commit c;
+	c.tree_key() = SHA1(hello_hex_sha);
+	c.parent_keys().push_back(SHA1(hello_hex_sha_lc));
+	c.parent_keys().push_back(table.key(0));
+	c.author().name = "author";
+	c.committer().name = "committer";
+	c.committer().time = 42;
+	std::stringstream s;
+	s << c;
+	const string raw(s.str());
+	
+	CommitTable partial;
+	partial.insert(table.key(0), raw.data(), raw.size());
+	partial.insert(table.key(0), raw.data(), raw.size());
+	partial.insert(SHA1(null_hex_sha), raw.data(), raw.size());
+	partial.finalize();
+	BOOST_REQUIRE(partial.size() == 2);
+	BOOST_REQUIRE(partial.actors().size() == 2);
+	const CommitTable::index_type index = partial.lookup(table.key(0));
+	BOOST_REQUIRE(index != CommitTable::npos && partial.time(index) == 42);
+	BOOST_REQUIRE(partial.parents(index).size() == 2);
+	BOOST_REQUIRE(partial.parents(index).begin()[0] == CommitTable::npos);
+	BOOST_REQUIRE(partial.parents(index).begin()[1] == index);
+	BOOST_REQUIRE(partial.lookup(SHA1(hello_hex_sha)) == CommitTable::npos);
+}
+
+BOOST_AUTO_TEST_CASE(key_index_test)
+{
+	KeyIndex index;
+	std::vector<SHA1> keys;
+	SHA1Generator gen;
+	for (uint i = 0; i < 1000; ++i) {
+		gen.update(reinterpret_cast<const char*>(&i), sizeof(i));
+		gen.finalize();
+		keys.push_back(gen.hash());
+		gen.reset();
+	}
+	
+	bool inserted;
+	for (uint i = 0; i < keys.size(); ++i) {
+		BOOST_REQUIRE(index.insert(keys[i], inserted) == i && inserted);
+	}
+	for (uint i = 0; i < keys.size(); ++i) {
+		BOOST_REQUIRE(index.insert(keys[i], inserted) == i && !inserted);
+		BOOST_REQUIRE(index.find(keys[i]) == i && index.key(i) == keys[i]);
+	}
+	BOOST_REQUIRE(index.size() == keys.size());
+	BOOST_REQUIRE(!index.contains(SHA1(null_hex_sha)));
+	
+	index.clear();
+	BOOST_REQUIRE(index.size() == 0 && !index.contains(keys[0]));
+	index.reserve(10);
+	BOOST_REQUIRE(index.insert(keys[1]) == 0);
+}
+
+//! Insert a commit with the given parents and committer time into the database
+//! \param tree key of the commit's tree, which doesn't need to exist unless the tree is traversed
+//! \return key of the commit
+template <class ODB>
+static SHA1 insert_commit(ODB& db, const std::vector<SHA1>& parents, time_t time,
+                          const SHA1& tree = SHA1(hello_hex_sha))
+{
+	Commit c;
+	c.tree_key() = tree;
+	c.parent_keys() = parents;
+	c.author().name = "author";
+	c.author().time = time;
+	c.committer() = c.author();
+	c.message() = "message";
+	return db.insert_object(c).key();
+}
+
+BOOST_AUTO_TEST_CASE(rev_walk_test)
+{
+	// c0 - c1 - c2 - m - c3
+	//        \      /
+	//         - b1 -          where b1 is older than its parent
+	MemoryODB db;
+	typedef std::vector<SHA1> key_vector;
+	const SHA1 c0 = insert_commit(db, key_vector(), 100);
+	const SHA1 c1 = insert_commit(db, key_vector(1, c0), 110);
+	const SHA1 c2 = insert_commit(db, key_vector(1, c1), 120);
+	const SHA1 b1 = insert_commit(db, key_vector(1, c1), 90);
+	key_vector merge_parents;
+	merge_parents.push_back(c2);
+	merge_parents.push_back(b1);
+	const SHA1 m = insert_commit(db, merge_parents, 130);
+	const SHA1 c3 = insert_commit(db, key_vector(1, m), 140);
+	
+	typedef RevWalk<MemoryODB> walk_type;
+	auto walk = [&db](const key_vector& tips, const key_vector& hidden, std::function<void(walk_type&)> configure) {
+		walk_type w(db);
+		configure(w);
+		for (auto i = tips.begin(); i != tips.end(); ++i) {
+			w.push(*i);
+		}
+		for (auto i = hidden.begin(); i != hidden.end(); ++i) {
+			w.hide(*i);
+		}
+		return key_vector(w.begin(), w.end());
+	};
+	auto expect = [](std::initializer_list<SHA1> keys) {
+		return key_vector(keys);
+	};
+	auto none = [](walk_type&) {};
+	
+	BOOST_REQUIRE(walk(key_vector(1, c3), key_vector(), none) == expect({c3, m, c2, c1, c0, b1}));
+	BOOST_REQUIRE(walk(key_vector(1, c3), key_vector(), [](walk_type& w) { w.set_sort(walk_type::Sort::Topological); })
+	              == expect({c3, m, c2, b1, c1, c0}));
+	BOOST_REQUIRE(walk(key_vector(1, c3), key_vector(), [](walk_type& w) { w.set_first_parent(true); })
+	              == expect({c3, m, c2, c1, c0}));
+	BOOST_REQUIRE(walk(key_vector(1, c3), key_vector(1, c2), none) == expect({c3, m, b1}));
+	BOOST_REQUIRE(walk(key_vector(1, c3), key_vector(1, b1), none) == expect({c3, m, c2}));
+	BOOST_REQUIRE(walk(key_vector(1, c3), key_vector(1, c3), none).empty());
+	BOOST_REQUIRE(walk(key_vector(1, c3), key_vector(), [](walk_type& w) { w.set_max_count(2); }) == expect({c3, m}));
+	BOOST_REQUIRE(walk(key_vector(1, c3), key_vector(), [](walk_type& w) { w.set_min_time(105); })
+	              == expect({c3, m, c2, c1}));
+	BOOST_REQUIRE(walk(expect({b1, c2}), key_vector(), none) == expect({c2, c1, c0, b1}));
+	
+	// walks can be reused, and only decode what they need
+	walk_type w(db);
+	w.push(c3);
+	SHA1 key;
+	BOOST_REQUIRE(w.next(key) && key == c3);
+	BOOST_REQUIRE(w.num_parsed() == 2);
+	w.reset();
+	w.push(c1);
+	BOOST_REQUIRE(key_vector(w.begin(), w.end()) == expect({c1, c0}));
+	BOOST_REQUIRE(!w.next(key));
+	
+	// tips must be commits
+	Blob blob;
+	blob.data().assign(phello, phello + lenphello);
+	const SHA1 blob_key = db.insert_object(blob).key();
+	w.reset();
+	BOOST_REQUIRE_THROW(w.push(blob_key), ObjectError);
+}
+
+BOOST_FIXTURE_TEST_CASE(commit_graph_test, GitPackedODBFixture)
+{
+	PackODB podb(rw_dir());
+	CommitTable table;
+	table.insert_all(podb);
+	table.finalize();
+	
+	const fs::path graph_path(rw_dir() / "commit-graph");
+	CommitGraph::write(graph_path, table);
+	const CommitGraph graph(graph_path);
+	BOOST_REQUIRE(graph.num_commits() == table.size());
+	
+	std::vector<uint32> gens;
+	CommitGraph::generations(table, gens);
+	std::vector<CommitGraph::position_type> parents;
+	for (CommitTable::index_type c = 0; c < table.size(); ++c) {
+		BOOST_REQUIRE(graph.lookup(table.key(c)) == c);
+		BOOST_REQUIRE(graph.key(c) == table.key(c));
+		BOOST_REQUIRE(graph.tree_key(c) == table.tree_key(c));
+		BOOST_REQUIRE(graph.time(c) == table.time(c));
+		BOOST_REQUIRE(graph.generation(c) == gens[c] && gens[c] > 0);
+		graph.parents(c, parents);
+		const CommitTable::parent_range tparents = table.parents(c);
+		BOOST_REQUIRE(parents.size() == tparents.size());
+		BOOST_REQUIRE(std::equal(parents.begin(), parents.end(), tparents.begin()));
+		for (auto p = parents.begin(); p != parents.end(); ++p) {
+			BOOST_REQUIRE(graph.generation(*p) < graph.generation(c));
+		}
+	}
+	BOOST_REQUIRE(graph.lookup(SHA1(null_hex_sha)) == CommitGraph::npos);
+	
+	// walks don't read commits in the graph from the database
+	RevWalk<PackODB> walk(podb);
+	RevWalk<PackODB> graph_walk(podb);
+	graph_walk.set_commit_graph(&graph);
+	for (CommitTable::index_type c = 0; c < table.size(); c += 7) {
+		walk.push(table.key(c));
+		graph_walk.push(table.key(c));
+	}
+	walk.hide(table.key(3));
+	graph_walk.hide(table.key(3));
+	const std::vector<SHA1> expected(walk.begin(), walk.end());
+	BOOST_REQUIRE(std::vector<SHA1>(graph_walk.begin(), graph_walk.end()) == expected);
+	BOOST_REQUIRE(graph_walk.num_parsed() == 0);
+	
+	// octopus merges store additional parents separately
+	// r1 - r2 - o
+	//  \ r3 ---/|
+	//  \ r4 ----
+	MemoryODB db;
+	typedef std::vector<SHA1> key_vector;
+	const SHA1 r1 = insert_commit(db, key_vector(), 100);
+	const SHA1 r2 = insert_commit(db, key_vector(1, r1), 110);
+	const SHA1 r3 = insert_commit(db, key_vector(1, r1), 120);
+	const SHA1 r4 = insert_commit(db, key_vector(), (time_t)1 << 33);
+	key_vector octopus_parents;
+	octopus_parents.push_back(r2);
+	octopus_parents.push_back(r3);
+	octopus_parents.push_back(r4);
+	const SHA1 o = insert_commit(db, octopus_parents, 130);
+	
+	CommitTable otable;
+	otable.insert_all(db);
+	otable.finalize();
+	const fs::path ograph_path(rw_dir() / "octopus-graph");
+	CommitGraph::write(ograph_path, otable);
+	const CommitGraph ograph(ograph_path);
+	const CommitGraph::position_type opos = ograph.lookup(o);
+	ograph.parents(opos, parents);
+	BOOST_REQUIRE(parents.size() == 3);
+	BOOST_REQUIRE(ograph.key(parents[0]) == r2 && ograph.key(parents[1]) == r3 && ograph.key(parents[2]) == r4);
+	BOOST_REQUIRE(ograph.generation(opos) == 3);
+	BOOST_REQUIRE(ograph.generation(ograph.lookup(r4)) == 1);
+	BOOST_REQUIRE(ograph.time(ograph.lookup(r4)) == (time_t)1 << 33);
+	
+	RevWalk<MemoryODB> owalk(db);
+	owalk.set_commit_graph(&ograph);
+	owalk.push(o);
+	owalk.hide(r2);
+	BOOST_REQUIRE(key_vector(owalk.begin(), owalk.end()) == key_vector({o, r4, r3}));
+	BOOST_REQUIRE(owalk.num_parsed() == 0);
+	
+	// all parents must be contained
+	CommitTable partial;
+	std::vector<char> data;
+	{
+		auto acc = db.object(o);
+		std::unique_ptr<MemoryODB::output_object_type::stream_type> stream(acc->new_stream());
+		data.resize(acc->size());
+		stream->read(data.data(), data.size());
+	}
+	partial.insert(o, data.data(), data.size());
+	partial.finalize();
+	BOOST_REQUIRE_THROW(CommitGraph::write(rw_dir() / "partial-graph", partial), CommitGraphError);
+	
+	// corrupted files are detected
+	{
+		std::ofstream out((rw_dir() / "bad-graph").string().c_str(), std::ios_base::binary);
+		out << "CGPH";
+	}
+	BOOST_REQUIRE_THROW(CommitGraph(rw_dir() / "bad-graph"), CommitGraphError);
+	BOOST_REQUIRE_THROW(CommitGraph(rw_dir() / "missing-graph"), CommitGraphError);
+}
+
+BOOST_FIXTURE_TEST_CASE(merge_base_test, GitPackedODBFixture)
+{
+	//        a1 -- a2     a2 and b2 both merge a1 and b1
+	//       /   \ /
+	// base       X
+	//    |  \   / \      x and y are children of base
+	//    |   b1 -- b2
+	//    +-- x
+	//    y        r has no parents
+	MemoryODB db;
+	typedef std::vector<SHA1> key_vector;
+	const SHA1 base = insert_commit(db, key_vector(), 100);
+	const SHA1 a1 = insert_commit(db, key_vector(1, base), 110);
+	const SHA1 b1 = insert_commit(db, key_vector(1, base), 120);
+	const SHA1 a2 = insert_commit(db, key_vector({a1, b1}), 130);
+	const SHA1 b2 = insert_commit(db, key_vector({b1, a1}), 140);
+	const SHA1 x = insert_commit(db, key_vector(1, base), 150);
+	const SHA1 y = insert_commit(db, key_vector(1, base), 90);
+	const SHA1 r = insert_commit(db, key_vector(), 160);
+	
+	CommitTable table;
+	table.insert_all(db);
+	table.finalize();
+	const fs::path graph_path(rw_dir() / "commit-graph");
+	CommitGraph::write(graph_path, table);
+	const CommitGraph graph(graph_path);
+	
+	for (int use_graph = 0; use_graph < 2; ++use_graph) {
+		MergeBase<MemoryODB> mb(db);
+		if (use_graph) {
+			mb.set_commit_graph(&graph);
+		}
+		key_vector out;
+		mb.merge_bases(a2, b2, out);
+		BOOST_REQUIRE(std::set<SHA1>(out.begin(), out.end()) == std::set<SHA1>({a1, b1}));
+		mb.merge_bases(x, y, out);
+		BOOST_REQUIRE(out == key_vector(1, base));
+		mb.merge_bases(a2, a1, out);
+		BOOST_REQUIRE(out == key_vector(1, a1));
+		mb.merge_bases(x, x, out);
+		BOOST_REQUIRE(out == key_vector(1, x));
+		mb.merge_bases(a2, r, out);
+		BOOST_REQUIRE(out.empty());
+		mb.merge_bases(x, key_vector({a2, y}), out);
+		BOOST_REQUIRE(out == key_vector(1, base));
+		
+		std::vector<std::vector<SHA1> > batch;
+		mb.merge_bases(std::vector<MergeBase<MemoryODB>::key_pair_type>({std::make_pair(a2, x), std::make_pair(b1, a1)}), 
+		               batch);
+		BOOST_REQUIRE(batch.size() == 2);
+		BOOST_REQUIRE(batch[0] == key_vector(1, base) && batch[1] == key_vector(1, base));
+		
+		BOOST_REQUIRE(mb.is_ancestor(base, a2));
+		BOOST_REQUIRE(mb.is_ancestor(b1, a2));
+		BOOST_REQUIRE(mb.is_ancestor(a2, a2));
+		BOOST_REQUIRE(!mb.is_ancestor(a2, base));
+		BOOST_REQUIRE(!mb.is_ancestor(a2, b2));
+		BOOST_REQUIRE(!mb.is_ancestor(x, y));
+		BOOST_REQUIRE(!mb.is_ancestor(r, b2));
+		
+		mb.independent(key_vector({a1, a2, x, b1, a2, base}), out);
+		BOOST_REQUIRE(out == key_vector({a2, x}));
+		mb.independent(key_vector({a2, b2, r}), out);
+		BOOST_REQUIRE(out == key_vector({a2, b2, r}));
+		
+		BOOST_REQUIRE(mb.num_parsed() == (use_graph ? 0 : table.size()));
+	}
+	
+	// queries must involve commits
+	Blob blob;
+	blob.data().assign(phello, phello + lenphello);
+	const SHA1 blob_key = db.insert_object(blob).key();
+	MergeBase<MemoryODB> mb(db);
+	BOOST_REQUIRE_THROW(mb.is_ancestor(blob_key, a2), ObjectError);
+}
+
+//! Insert an object of the given type and serialized data into the database
+//! \return key of the object
+template <class ODB>
+static SHA1 insert_object(ODB& db, Object::Type type, const string& data)
+{
+	std::stringstream stream(data);
+	typename ODB::input_object_type object(type, data.size(), stream);
+	return db.insert(object).key();
+}
+
+//! Insert the given tree into the database
+//! \return key of the tree
+template <class ODB>
+static SHA1 insert_tree(ODB& db, const FlatTree& tree)
+{
+	std::stringstream stream;
+	stream << tree;
+	return insert_object(db, Object::Type::Tree, stream.str());
+}
+
+//! Insert a tree with the given entries, which may be in any order
+//! \return key of the tree
+template <class ODB>
+static SHA1 insert_tree(ODB& db, std::initializer_list<std::pair<const char*, std::pair<FlatTree::mode_type, SHA1> > > entries)
+{
+	FlatTree tree;
+	for (auto i = entries.begin(); i != entries.end(); ++i) {
+		tree.push_back(i->second.first, i->first, std::strlen(i->first), i->second.second);
+	}
+	tree.sort();
+	return insert_tree(db, tree);
+}
+
+BOOST_AUTO_TEST_CASE(tree_diff_test)
+{
+	const SHA1 k1(string("1111111111111111111111111111111111111111"));
+	const SHA1 k2(string("2222222222222222222222222222222222222222"));
+	MemoryODB db;
+	typedef std::pair<FlatTree::mode_type, SHA1> entry;
+	const FlatTree::mode_type file = 0100644, exe = 0100755, dir = 0040000, module = 0160000;
+	
+	const SHA1 lib = insert_tree(db, {{"x.h", entry(file, k1)}});
+	const SHA1 old_root = insert_tree(db, {
+		{"README", entry(file, k1)},
+		{"src", entry(dir, insert_tree(db, {{"a.c", entry(file, k1)}, {"b.c", entry(file, k2)}, {"lib", entry(dir, lib)}}))},
+		{"docs", entry(dir, insert_tree(db, {{"guide", entry(file, k1)}}))},
+		{"foo", entry(file, k1)},
+		{"foo.c", entry(file, k1)}
+	});
+	const SHA1 new_root = insert_tree(db, {
+		{"README", entry(file, k1)},
+		{"src", entry(dir, insert_tree(db, {{"a.c", entry(file, k2)}, {"b.c", entry(file, k2)}, {"lib", entry(dir, lib)},
+		                                    {"new.c", entry(file, k1)}}))},
+		{"foo", entry(dir, insert_tree(db, {{"bar", entry(file, k1)}}))},
+		{"foo.c", entry(exe, k1)},
+		{"tool", entry(module, k2)}
+	});
+	
+	typedef TreeDiff<MemoryODB> diff_type;
+	auto paths = [](const diff_type::change_vector_type& changes) {
+		std::vector<string> out;
+		for (auto i = changes.begin(); i != changes.end(); ++i) {
+			out.push_back(i->path);
+		}
+		return out;
+	};
+	typedef std::vector<string> path_vector;
+	
+	diff_type diff(db, 1);
+	diff_type::change_vector_type changes;
+	diff.diff(old_root, new_root, changes);
+	BOOST_REQUIRE(paths(changes) == path_vector({"docs/guide", "foo", "foo.c", "foo/bar", "src/a.c", "src/new.c", "tool"}));
+	// unchanged subtrees are not read
+	BOOST_REQUIRE(diff.num_trees_read() == 6);
+	BOOST_REQUIRE(changes[0].kind == TreeChange::Kind::Deleted && changes[0].new_key == SHA1::null);
+	BOOST_REQUIRE(changes[1].kind == TreeChange::Kind::Deleted && changes[1].old_mode == file);
+	BOOST_REQUIRE(changes[2].kind == TreeChange::Kind::Modified && changes[2].old_mode == file && changes[2].new_mode == exe);
+	BOOST_REQUIRE(changes[3].kind == TreeChange::Kind::Added && changes[3].new_key == k1 && changes[3].old_mode == 0);
+	BOOST_REQUIRE(changes[4].kind == TreeChange::Kind::Modified && changes[4].old_key == k1 && changes[4].new_key == k2);
+	BOOST_REQUIRE(changes[6].kind == TreeChange::Kind::Added && changes[6].new_mode == module);
+	
+	diff.diff(new_root, new_root, changes);
+	BOOST_REQUIRE(changes.empty() && diff.num_trees_read() == 0);
+	diff.diff(SHA1::null, old_root, changes);
+	BOOST_REQUIRE(paths(changes) == path_vector({"README", "docs/guide", "foo", "foo.c", "src/a.c", "src/b.c", "src/lib/x.h"}));
+	
+	// pathspecs limit the reported changes, and the trees which are read
+	diff.set_paths(path_vector({"src/lib"}));
+	diff.diff(old_root, new_root, changes);
+	BOOST_REQUIRE(changes.empty() && diff.num_trees_read() == 4);
+	diff.set_paths(path_vector({"src", "docs/guide"}));
+	diff.diff(old_root, new_root, changes);
+	BOOST_REQUIRE(paths(changes) == path_vector({"docs/guide", "src/a.c", "src/new.c"}));
+	diff.set_paths(path_vector({"foo"}));
+	diff.diff(old_root, new_root, changes);
+	BOOST_REQUIRE(paths(changes) == path_vector({"foo", "foo/bar"}));
+	
+	// parallel diffs yield the same result
+	diff_type pdiff(db, 4);
+	pdiff.set_parallel_depth(1);
+	diff_type::change_vector_type pchanges;
+	diff.set_paths(path_vector());
+	diff.diff(old_root, new_root, changes);
+	pdiff.diff(old_root, new_root, pchanges);
+	BOOST_REQUIRE(paths(pchanges) == paths(changes));
+	BOOST_REQUIRE(pdiff.num_trees_read() == diff.num_trees_read());
+	
+	// only trees can be compared
+	Blob blob;
+	blob.data().assign(phello, phello + lenphello);
+	const SHA1 blob_key = db.insert_object(blob).key();
+	BOOST_REQUIRE_THROW(diff.diff(old_root, blob_key, changes), ObjectError);
+	BOOST_REQUIRE_THROW(pdiff.diff(old_root, blob_key, changes), ObjectError);
+}
+
+BOOST_FIXTURE_TEST_CASE(tree_walk_test, GitPackedODBFixture)
+{
+	const SHA1 k1(string("1111111111111111111111111111111111111111"));
+	MemoryODB db;
+	FlatTree leaf;
+	leaf.push_back(0100644, "x.h", 3, k1);
+	leaf.push_back(0160000, "module", 6, k1);
+	leaf.sort();
+	const SHA1 leaf_key = insert_tree(db, leaf);
+	
+	// the same tree is contained twice
+	FlatTree root;
+	root.push_back(0100644, "README", 6, k1);
+	root.push_back(0040000, "a", 1, leaf_key);
+	root.push_back(0040000, "b", 1, leaf_key);
+	root.sort();
+	const SHA1 root_key = insert_tree(db, root);
+	
+	typedef TreeWalker<MemoryODB> walker_type;
+	std::mutex mutex;
+	std::multiset<string> paths;
+	const walker_type::callback_type collect = [&](const string& path, walker_type::mode_type, const SHA1&) {
+		std::lock_guard<std::mutex> lock(mutex);
+		paths.insert(path);
+	};
+	
+	for (size_t num_threads = 1; num_threads < 5; num_threads += 3) {
+		walker_type walker(db, num_threads);
+		paths.clear();
+		walker.walk(root_key, collect);
+		BOOST_REQUIRE(paths == std::multiset<string>({"README", "a", "a/module", "a/x.h", "b"}) || 
+		              paths == std::multiset<string>({"README", "a", "b", "b/module", "b/x.h"}));
+		BOOST_REQUIRE(walker.num_trees_read() == 2 && walker.num_entries() == 5);
+		
+		walker.set_unique_trees(false);
+		paths.clear();
+		walker.walk(walker_type::key_vector_type({root_key, root_key}), collect);
+		BOOST_REQUIRE(paths.size() == 14 && paths.count("b/x.h") == 2);
+		BOOST_REQUIRE(walker.num_trees_read() == 6);
+		
+		// errors are reported once the walk is done
+		BOOST_REQUIRE_THROW(walker.walk(walker_type::key_vector_type({root_key, k1}), collect), gtl::odb_error);
+	}
+	
+	// every tree of a pack is expanded once, even though most are reachable from others
+	PackODB podb(rw_dir());
+	TreeWalker<PackODB>::key_vector_type trees;
+	for (auto i = podb.begin(); i != podb.end(); ++i) {
+		if (i->type() == Object::Type::Tree) {
+			trees.push_back(i.key());
+		}
+	}
+	BOOST_REQUIRE(!trees.empty());
+	TreeWalker<PackODB> pwalker(podb, 4);
+	std::atomic<size_t> num_entries(0);
+	pwalker.walk(trees, [&num_entries](const string&, TreeWalker<PackODB>::mode_type, const SHA1&) { ++num_entries; });
+	BOOST_REQUIRE(pwalker.num_trees_read() == trees.size());
+	BOOST_REQUIRE(num_entries == pwalker.num_entries());
+}
+
+BOOST_AUTO_TEST_CASE(rename_detect_test)
+{
+	MemoryODB db;
+	auto insert_blob = [&db](const string& data) {
+		Blob blob;
+		blob.data().assign(data.begin(), data.end());
+		return db.insert_object(blob).key();
+	};
+	auto lines = [](const char* prefix, int first, int last) {
+		std::ostringstream s;
+		for (int i = first; i < last; ++i) {
+			s << prefix << " line " << i << "\n";
+		}
+		return s.str();
+	};
+	
+	// signatures measure the amount of common bytes
+	const string data(lines("b", 0, 20));
+	const SimilaritySignature sig(data.data(), data.size());
+	const string changed(lines("b", 0, 19) + "changed\n");
+	BOOST_REQUIRE(SimilaritySignature::score(sig, sig) == SimilaritySignature::max_score);
+	BOOST_REQUIRE(SimilaritySignature::score(sig, SimilaritySignature(changed.data(), changed.size())) == 94);
+	BOOST_REQUIRE(SimilaritySignature::score(sig, SimilaritySignature()) == 0);
+	BOOST_REQUIRE(SimilaritySignature::score(SimilaritySignature(), SimilaritySignature()) == SimilaritySignature::max_score);
+	BOOST_REQUIRE(SimilaritySignature::max_score_of(10, 40) == 25);
+	
+	const SHA1 a = insert_blob(lines("a", 0, 20));
+	const SHA1 b = insert_blob(data);
+	const SHA1 b_changed = insert_blob(changed);
+	const SHA1 c = insert_blob(lines("c", 0, 20));
+	const SHA1 m = insert_blob(lines("m", 0, 20));
+	const SHA1 m_changed = insert_blob(lines("m", 0, 10));
+	const SHA1 other = insert_blob(lines("other", 0, 20));
+	
+	typedef std::pair<FlatTree::mode_type, SHA1> entry;
+	const FlatTree::mode_type file = 0100644, link = 0120000;
+	const SHA1 old_root = insert_tree(db, {
+		{"a.txt", entry(file, a)}, {"b.txt", entry(file, b)}, {"c.txt", entry(file, c)},
+		{"link", entry(link, other)}, {"mod.txt", entry(file, m)}
+	});
+	const SHA1 new_root = insert_tree(db, {
+		{"a_moved.txt", entry(file, a)}, {"b2.txt", entry(file, b_changed)}, {"copy.txt", entry(file, m)},
+		{"link2", entry(file, other)}, {"mod.txt", entry(file, m_changed)}, {"new.txt", entry(file, insert_blob("new\n"))}
+	});
+	
+	typedef TreeDiff<MemoryODB> diff_type;
+	typedef std::pair<string, TreeChange::Kind> result;
+	auto results = [](const diff_type::change_vector_type& changes) {
+		std::vector<result> out;
+		for (auto i = changes.begin(); i != changes.end(); ++i) {
+			out.push_back(result(i->old_path.empty() ? i->path : i->old_path + " -> " + i->path, i->kind));
+		}
+		return out;
+	};
+	diff_type diff(db, 1);
+	diff_type::change_vector_type changes;
+	
+	for (size_t num_threads = 1; num_threads < 5; num_threads += 3) {
+		RenameDetector<MemoryODB> detector(db, num_threads);
+		diff.diff(old_root, new_root, changes);
+		detector.detect(changes);
+		BOOST_REQUIRE(results(changes) == std::vector<result>({
+			result("a.txt -> a_moved.txt", TreeChange::Kind::Renamed), result("b.txt -> b2.txt", TreeChange::Kind::Renamed),
+			result("c.txt", TreeChange::Kind::Deleted), result("copy.txt", TreeChange::Kind::Added),
+			result("link", TreeChange::Kind::Deleted), result("link2", TreeChange::Kind::Added),
+			result("mod.txt", TreeChange::Kind::Modified), result("new.txt", TreeChange::Kind::Added)
+		}));
+		BOOST_REQUIRE(changes[0].score == 100 && changes[0].old_key == a && changes[0].new_key == a);
+		BOOST_REQUIRE(changes[1].score == 94 && changes[1].old_key == b && changes[1].old_mode == file);
+		BOOST_REQUIRE(detector.num_exact() == 1 && detector.num_inexact() == 1 && !detector.limit_exceeded());
+		
+		// copies of modified files
+		detector.set_copies(true);
+		diff.diff(old_root, new_root, changes);
+		detector.detect(changes);
+		BOOST_REQUIRE(changes[3].kind == TreeChange::Kind::Copied && changes[3].old_path == "mod.txt");
+		BOOST_REQUIRE(changes[3].old_key == m && changes[3].score == 100);
+		BOOST_REQUIRE(changes[6].kind == TreeChange::Kind::Modified);
+		
+		// pairing by similarity is limited
+		detector.set_copies(false);
+		detector.set_max_candidates(1);
+		diff.diff(old_root, new_root, changes);
+		detector.detect(changes);
+		BOOST_REQUIRE(changes[0].kind == TreeChange::Kind::Renamed);
+		BOOST_REQUIRE(changes[1].kind == TreeChange::Kind::Deleted && changes[2].kind == TreeChange::Kind::Added);
+		BOOST_REQUIRE(detector.limit_exceeded() && detector.num_inexact() == 0);
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE(changed_path_filter_test, GitPackedODBFixture)
+{
+	// hashes match the ones of git
+	BOOST_REQUIRE(BloomKey::murmur3(0, "", 0) == 0);
+	BOOST_REQUIRE(BloomKey::murmur3(0, "Hello world!", 12) == 0x627b0c2c);
+	BOOST_REQUIRE(BloomKey::murmur3(0, "The quick brown fox jumps over the lazy dog", 43) == 0x2e4ff723);
+	const BloomKey empty_key(string(""));
+	BOOST_REQUIRE(empty_key.hashes[0] == 0x5615800c && empty_key.hashes[6] == 0x771ae004);
+	
+	ChangedPathFilters filters;
+	filters.push_back(ChangedPathFilters::path_vector_type());
+	filters.push_back(ChangedPathFilters::path_vector_type({"src/lib/x.h", "README"}));
+	ChangedPathFilters::path_vector_type many;
+	for (size_t i = 0; i <= ChangedPathFilters::max_changed_paths; ++i) {
+		many.push_back("file" + std::to_string(i));
+	}
+	filters.push_back(many);
+	BOOST_REQUIRE(filters.size() == 3);
+	BOOST_REQUIRE(filters.filter(0).size() == 1 && filters.filter(0).data()[0] == 0);
+	BOOST_REQUIRE(!filters.filter(0).maybe_contains(BloomKey(string("README"))));
+	// 4 paths including directories take 40 bits
+	BOOST_REQUIRE(filters.filter(1).size() == 5);
+	for (const char* path : {"src", "src/lib", "src/lib/x.h", "README"}) {
+		BOOST_REQUIRE(filters.filter(1).maybe_contains(BloomKey(string(path))));
+	}
+	BOOST_REQUIRE(filters.filter(2).size() == 1 && filters.filter(2).data()[0] == 0xff);
+	BOOST_REQUIRE(filters.filter(2).maybe_contains(BloomKey(string("anything"))));
+	BOOST_REQUIRE(BloomFilter().maybe_contains(empty_key));
+	ChangedPathFilters::key_vector_type keys;
+	ChangedPathFilters::keys("src/lib/x.h", keys);
+	BOOST_REQUIRE(keys.size() == 3 && keys[0].hashes[0] == BloomKey(string("src")).hashes[0]);
+	
+	// c0 - c1 - c2 - c3, where c1 changes a/x, c2 changes b and c3 changes nothing
+	const SHA1 k1(string("1111111111111111111111111111111111111111"));
+	const SHA1 k2(string("2222222222222222222222222222222222222222"));
+	const FlatTree::mode_type file = 0100644, dir = 0040000;
+	MemoryODB db;
+	auto make_root = [&](const SHA1& x, const SHA1& b) {
+		FlatTree a_tree;
+		a_tree.push_back(file, "x", 1, x);
+		FlatTree root;
+		root.push_back(dir, "a", 1, insert_tree(db, a_tree));
+		root.push_back(file, "b", 1, b);
+		root.sort();
+		return insert_tree(db, root);
+	};
+	typedef std::vector<SHA1> key_vector;
+	const SHA1 c0 = insert_commit(db, key_vector(), 100, make_root(k1, k1));
+	const SHA1 c1 = insert_commit(db, key_vector(1, c0), 110, make_root(k2, k1));
+	const SHA1 c2 = insert_commit(db, key_vector(1, c1), 120, make_root(k2, k2));
+	const SHA1 c3 = insert_commit(db, key_vector(1, c2), 130, make_root(k2, k2));
+	
+	CommitTable table;
+	table.insert_all(db);
+	table.finalize();
+	filters.compute(db, table, 2);
+	BOOST_REQUIRE(filters.size() == table.size());
+	const CommitTable::index_type i3 = table.lookup(c3);
+	BOOST_REQUIRE(filters.filter(i3).size() == 1 && filters.filter(i3).data()[0] == 0);
+	BOOST_REQUIRE(filters.filter(table.lookup(c1)).maybe_contains(BloomKey(string("a/x"))));
+	
+	const fs::path graph_path(rw_dir() / "commit-graph");
+	CommitGraph::write(graph_path, table);
+	BOOST_REQUIRE(!CommitGraph(graph_path).has_bloom_filters());
+	BOOST_REQUIRE(CommitGraph(graph_path).bloom_filter(0).size() == 0);
+	CommitGraph::write(graph_path, table, &filters);
+	const CommitGraph graph(graph_path);
+	BOOST_REQUIRE(graph.has_bloom_filters());
+	for (CommitTable::index_type c = 0; c < table.size(); ++c) {
+		const BloomFilter filter(graph.bloom_filter(c));
+		BOOST_REQUIRE(filter.size() == filters.filter(c).size());
+		BOOST_REQUIRE(std::memcmp(filter.data(), filters.filter(c).data(), filter.size()) == 0);
+	}
+	filters.push_back(many);
+	BOOST_REQUIRE_THROW(CommitGraph::write(graph_path, table, &filters), CommitGraphError);
+	
+	// path-limited walks yield the same commits with and without filters, in both orders
+	typedef RevWalk<MemoryODB> walk_type;
+	for (const walk_type::Sort sort : {walk_type::Sort::Date, walk_type::Sort::Topological}) {
+		auto walk_paths = [&](const ChangedPathFilters::path_vector_type& paths, const CommitGraph* graph) {
+			walk_type walk(db);
+			walk.set_sort(sort);
+			walk.set_commit_graph(graph);
+			walk.set_paths(paths);
+			walk.push(c3);
+			const key_vector out(walk.begin(), walk.end());
+			BOOST_REQUIRE(walk.num_diffs() + walk.num_bloom_skipped() == 4);
+			if (graph) {
+				// c3 changed nothing, hence its filter is empty
+				BOOST_REQUIRE(walk.num_bloom_skipped() >= 1);
+			}
+			return out;
+		};
+		for (const CommitGraph* g : {(const CommitGraph*)nullptr, &graph}) {
+			BOOST_REQUIRE(walk_paths({"a"}, g) == key_vector({c1, c0}));
+			BOOST_REQUIRE(walk_paths({"a/x/"}, g) == key_vector({c1, c0}));
+			BOOST_REQUIRE(walk_paths({"b"}, g) == key_vector({c2, c0}));
+			BOOST_REQUIRE(walk_paths({"a", "b"}, g) == key_vector({c2, c1, c0}));
+			BOOST_REQUIRE(walk_paths({"c"}, g).empty());
+			BOOST_REQUIRE(walk_paths({"a/y"}, g).empty());
+		}
+	}
+	
+	// unlimited walks don't compare trees
+	walk_type walk(db);
+	walk.push(c3);
+	BOOST_REQUIRE(key_vector(walk.begin(), walk.end()).size() == 4 && walk.num_diffs() == 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(loose_gc_test, GitLooseODBFixture)
+{
+	const fs::path db_path(rw_dir() / "gc");
+	const fs::path pack_dir(rw_dir() / "gc_pack");
+	fs::create_directory(db_path);
+	fs::create_directory(pack_dir);
+	LooseODB db(db_path);
+	
+	typedef std::pair<FlatTree::mode_type, SHA1> entry;
+	typedef std::vector<SHA1> key_vector;
+	const FlatTree::mode_type file = 0100644, dir = 0040000, module = 0160000;
+	
+	// c1 - c2 <- tag, with a submodule which doesn't exist
+	const SHA1 b1 = insert_object(db, Object::Type::Blob, "one");
+	const SHA1 b2 = insert_object(db, Object::Type::Blob, "two");
+	const SHA1 t2 = insert_tree(db, {{"b", entry(file, b2)}});
+	const SHA1 t1 = insert_tree(db, {{"a", entry(file, b1)}, {"sub", entry(dir, t2)},
+	                                 {"module", entry(module, SHA1(string("1111111111111111111111111111111111111111")))}});
+	const SHA1 c1 = insert_commit(db, key_vector(), 0, t1);
+	const SHA1 c2 = insert_commit(db, key_vector(1, c1), 0, insert_tree(db, {{"a", entry(file, b1)}}));
+	Tag tag;
+	tag.object_type() = Object::Type::Commit;
+	tag.object_key() = c2;
+	tag.name() = "v1";
+	tag.actor().name = "tagger";
+	tag.message() = "message";
+	const SHA1 tag_key = db.insert_object(tag).key();
+	const size_t num_reachable = db.count();
+	
+	// unreachable history, and an unreachable commit referring to an unreachable tree
+	const SHA1 b3 = insert_object(db, Object::Type::Blob, "three");
+	const SHA1 o1 = insert_commit(db, key_vector(1, c1), 0, insert_tree(db, {{"c", entry(file, b3)}}));
+	const SHA1 b4 = insert_object(db, Object::Type::Blob, "four");
+	const SHA1 t4 = insert_tree(db, {{"d", entry(file, b4)}});
+	const SHA1 r1 = insert_commit(db, key_vector(), 0, t4);
+	BOOST_REQUIRE(db.count() == num_reachable + 6);
+	
+	// only r1 is recent, but it keeps its tree and blob
+	const time_t now = std::time(nullptr);
+	for (auto it = db.begin(); it != db.end(); ++it) {
+		fs::last_write_time(it->path(), it.key() == r1 ? now : now - 3600);
+	}
+	
+	LooseGC gc(db, 4);
+	gc.set_expiry(now - 60);
+	gc.set_dry_run(true);
+	LooseGCStats stats = gc.collect(key_vector(1, tag_key));
+	BOOST_REQUIRE(stats.num_loose == num_reachable + 6);
+	BOOST_REQUIRE(stats.num_reachable == num_reachable);
+	BOOST_REQUIRE(stats.num_recent == 3);
+	BOOST_REQUIRE(stats.num_pruned == 3 && stats.bytes_pruned > 0);
+	BOOST_REQUIRE(stats.num_marked == num_reachable + 3);
+	BOOST_REQUIRE(db.count() == num_reachable + 6);
+	
+	gc.set_dry_run(false);
+	stats = gc.collect(key_vector(1, tag_key));
+	BOOST_REQUIRE(stats.num_pruned == 3);
+	BOOST_REQUIRE(db.count() == num_reachable + 3);
+	BOOST_REQUIRE(!db.has_object(o1) && !db.has_object(b3));
+	BOOST_REQUIRE(db.has_object(r1) && db.has_object(t4) && db.has_object(b4) && db.has_object(b2));
+	BOOST_REQUIRE(!LooseODB(rw_dir() / "gc").remove(o1));
+	
+	// nothing is removed if a reachable tree is missing
+	gc.set_expiry(now + 60);
+	BOOST_REQUIRE(db.remove(t2));
+	BOOST_REQUIRE_THROW(gc.collect(key_vector(1, c2)), gtl::odb_error);
+	BOOST_REQUIRE(db.count() == num_reachable + 2);
+	
+	// repack moves all reachable objects into a pack, and drops the recent ones now
+	BOOST_REQUIRE(insert_tree(db, {{"b", entry(file, b2)}}) == t2);
+	gc.set_repack(pack_dir);
+	gc.set_dry_run(true);
+	stats = gc.collect(key_vector(1, tag_key));
+	BOOST_REQUIRE(stats.num_packed == num_reachable && stats.num_pruned == 3 && stats.pack_path.empty());
+	BOOST_REQUIRE(db.count() == num_reachable + 3);
+	gc.set_dry_run(false);
+	stats = gc.collect(key_vector(1, tag_key));
+	BOOST_REQUIRE(stats.num_packed == num_reachable && fs::is_regular_file(stats.pack_path));
+	BOOST_REQUIRE(db.count() == 0);
+	PackODB packs(pack_dir);
+	BOOST_REQUIRE(packs.count() == num_reachable);
+	BOOST_REQUIRE(packs.has_object(tag_key) && packs.has_object(b2));
+	
+	// loose objects referred to by packed ones are reachable through the alternate database
+	const SHA1 b1_again = insert_object(db, Object::Type::Blob, "one");
+	insert_object(db, Object::Type::Blob, "garbage");
+	gc.set_repack(fs::path());
+	BOOST_REQUIRE_THROW(gc.collect(key_vector(1, tag_key)), gtl::odb_error);
+	gc.set_alternate(&packs);
+	stats = gc.collect(key_vector(1, tag_key));
+	BOOST_REQUIRE(stats.num_reachable == 1 && stats.num_pruned == 1);
+	BOOST_REQUIRE(db.count() == 1 && db.has_object(b1_again));
+}
+
+BOOST_FIXTURE_TEST_CASE(connectivity_test, GitLooseODBFixture)
+{
+	const fs::path db_path(rw_dir() / "target");
+	fs::create_directory(db_path);
+	LooseODB target(db_path);
+	MemoryODB staging;
+	
+	typedef std::pair<FlatTree::mode_type, SHA1> entry;
+	typedef std::vector<SHA1> key_vector;
+	const FlatTree::mode_type file = 0100644, module = 0160000;
+	
+	// c1 exists, c2 and a tag on it are new, with a submodule which exists nowhere
+	const SHA1 b1 = insert_object(target, Object::Type::Blob, "one");
+	const SHA1 c1 = insert_commit(target, key_vector(), 0, insert_tree(target, {{"a", entry(file, b1)}}));
+	const SHA1 b2 = insert_object(staging, Object::Type::Blob, "two");
+	const SHA1 t2 = insert_tree(staging, {{"a", entry(file, b1)}, {"b", entry(file, b2)},
+	                                      {"module", entry(module, SHA1(string("1111111111111111111111111111111111111111")))}});
+	const SHA1 c2 = insert_commit(staging, key_vector(1, c1), 0, t2);
+	Tag tag;
+	tag.object_type() = Object::Type::Commit;
+	tag.object_key() = c2;
+	tag.name() = "v1";
+	tag.actor().name = "tagger";
+	tag.message() = "message";
+	const SHA1 tag_key = staging.insert_object(tag).key();
+	
+	ConnectivityCheck<LooseODB> check(staging, target, 1);
+	key_vector missing;
+	BOOST_REQUIRE(check.check(key_vector(1, tag_key), missing));
+	BOOST_REQUIRE(missing.empty());
+	BOOST_REQUIRE(check.num_parsed() == 3);
+	BOOST_REQUIRE(check.num_lookups() == 2);
+	BOOST_REQUIRE(check.check(missing) && missing.empty());
+	
+	// a root which exists nowhere is missing, one in the target is not parsed
+	const SHA1 unknown(string("2222222222222222222222222222222222222222"));
+	key_vector roots;
+	roots.push_back(c1);
+	roots.push_back(unknown);
+	BOOST_REQUIRE(!check.check(roots, missing));
+	BOOST_REQUIRE(missing == key_vector(1, unknown));
+	BOOST_REQUIRE(check.num_parsed() == 0 && check.num_lookups() == 2);
+	
+	// unreachable staged objects are only verified when checking all of them. Missing objects are reported once
+	const SHA1 b3(string("3333333333333333333333333333333333333333"));
+	const SHA1 t3 = insert_tree(staging, {{"c", entry(file, b3)}});
+	const SHA1 t4 = insert_tree(staging, {{"c", entry(file, b3)}, {"d", entry(file, b1)}});
+	const SHA1 c3 = insert_commit(staging, key_vector(1, unknown), 0, t3);
+	missing.clear();
+	BOOST_REQUIRE(check.check(key_vector(1, tag_key), missing) && missing.empty());
+	key_vector expected;
+	expected.push_back(unknown);
+	expected.push_back(b3);
+	std::sort(expected.begin(), expected.end());
+	BOOST_REQUIRE(!check.check(missing));
+	BOOST_REQUIRE(missing == expected);
+	BOOST_REQUIRE(check.num_parsed() == 6);
+	
+	// missing keys are appended, and all threads find the same
+	ConnectivityCheck<LooseODB> mt_check(staging, target, 4);
+	BOOST_REQUIRE(!mt_check.check(key_vector(1, t4), missing));
+	BOOST_REQUIRE(missing.size() == 3 && missing.back() == b3);
+	missing.clear();
+	BOOST_REQUIRE(!mt_check.check(key_vector(1, c3), missing));
+	BOOST_REQUIRE(missing == expected);
+}
+
+BOOST_AUTO_TEST_CASE(reachability_cache_test)
+{
+	// c0 - c1 - c2 - c3 - m
+	//        \          /
+	//         f1 - f2 -
+	MemoryODB db;
+	typedef std::vector<SHA1> key_vector;
+	const SHA1 c0 = insert_commit(db, key_vector(), 100);
+	const SHA1 c1 = insert_commit(db, key_vector(1, c0), 110);
+	const SHA1 c2 = insert_commit(db, key_vector(1, c1), 120);
+	const SHA1 c3 = insert_commit(db, key_vector(1, c2), 130);
+	const SHA1 f1 = insert_commit(db, key_vector(1, c1), 115);
+	const SHA1 f2 = insert_commit(db, key_vector(1, f1), 125);
+	key_vector merge_parents;
+	merge_parents.push_back(c3);
+	merge_parents.push_back(f2);
+	const SHA1 m = insert_commit(db, merge_parents, 140);
+	
+	ReachabilityCache<MemoryODB> cache(db);
+	ReachabilityCache<MemoryODB>::Reader reader(cache);
+	BOOST_REQUIRE(!reader.is_reachable(c0, "master"));
+	
+	cache.set_tip("master", c2);
+	BOOST_REQUIRE(cache.num_walked() == 3);
+	BOOST_REQUIRE(reader.is_reachable(c2, "master") && reader.is_reachable(c0, "master"));
+	BOOST_REQUIRE(!reader.is_reachable(c3, "master") && !reader.is_reachable(c0, "feature"));
+	BOOST_REQUIRE(reader.is_ancestor(c0, c2) && !reader.is_ancestor(f1, c2));
+	BOOST_REQUIRE(reader.num_fallbacks() == 0);
+	BOOST_REQUIRE(reader.is_ancestor(c0, c1) && !reader.is_ancestor(c2, c1));
+	BOOST_REQUIRE(reader.num_fallbacks() == 2);
+	
+	// moving forward only walks the new commits, a new tip walks until it reaches a tip
+	cache.set_tip("master", c3);
+	BOOST_REQUIRE(cache.num_walked() == 4);
+	BOOST_REQUIRE(reader.is_reachable(c3, "master"));
+	cache.set_tip("feature", f2);
+	BOOST_REQUIRE(cache.num_walked() == 8);
+	BOOST_REQUIRE(reader.is_reachable(c0, "feature") && !reader.is_reachable(c2, "feature"));
+	cache.set_tip("master", m);
+	BOOST_REQUIRE(cache.num_walked() == 9);
+	BOOST_REQUIRE(reader.is_reachable(f1, "master") && reader.is_ancestor(f2, m) && reader.is_ancestor(c3, m));
+	
+	// tips of the same commit share their bitmap
+	cache.set_tip("master", m);
+	cache.set_tip("release", m);
+	BOOST_REQUIRE(cache.num_walked() == 9);
+	BOOST_REQUIRE(reader.is_reachable(f1, "release"));
+	
+	// moving backwards drops commits
+	cache.set_tip("master", c1);
+	BOOST_REQUIRE(cache.num_walked() == 11);
+	BOOST_REQUIRE(!reader.is_reachable(c2, "master") && reader.is_reachable(c2, "release"));
+	BOOST_REQUIRE(!reader.is_ancestor(c2, c1) && reader.is_ancestor(c2, m));
+	
+	BOOST_REQUIRE(cache.remove_tip("feature"));
+	BOOST_REQUIRE(!cache.remove_tip("feature"));
+	BOOST_REQUIRE(!reader.is_reachable(f1, "feature") && reader.is_reachable(f1, "release"));
+	BOOST_REQUIRE(!reader.is_reachable(SHA1(hello_hex_sha), "release"));
+	BOOST_REQUIRE(reader.num_fallbacks() == 2);
+	
+	// a missing commit leaves all tips unchanged
+	BOOST_REQUIRE_THROW(cache.set_tip("master", SHA1(hello_hex_sha)), gtl::odb_error);
+	BOOST_REQUIRE(reader.is_reachable(c1, "master") && !reader.is_reachable(c2, "master"));
+	
+	// readers query concurrently while a tip moves along a long history, and never see it go backwards
+	key_vector chain(1, m);
+	for (size_t i = 0; i < 500; ++i) {
+		chain.push_back(insert_commit(db, key_vector(1, chain.back()), 200 + i));
+	}
+	cache.set_tip("main", chain[0]);
+	std::atomic<bool> done(false);
+	std::atomic<size_t> num_errors(0);
+	std::vector<std::thread> threads;
+	for (size_t t = 0; t < 4; ++t) {
+		threads.push_back(std::thread([&cache, &chain, &done, &num_errors, c0]() {
+			ReachabilityCache<MemoryODB>::Reader reader(cache);
+			size_t seen = 0;
+			while (!done) {
+				while (seen + 1 < chain.size() && reader.is_reachable(chain[seen + 1], "main")) {
+					++seen;
+				}
+				if (!reader.is_reachable(chain[seen], "main") || !reader.is_reachable(c0, "main")) {
+					++num_errors;
+				}
+			}
+		}));
+	}
+	for (size_t i = 1; i < chain.size(); ++i) {
+		cache.set_tip("main", chain[i]);
+	}
+	done = true;
+	for (auto i = threads.begin(); i != threads.end(); ++i) {
+		i->join();
+	}
+	BOOST_REQUIRE(num_errors == 0);
+	BOOST_REQUIRE(cache.num_walked() == 11 + chain.size() - 1);
+	BOOST_REQUIRE(reader.is_reachable(c0, "main") && reader.is_reachable(chain.back(), "main"));
 }
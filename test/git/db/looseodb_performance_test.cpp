@@ -2,6 +2,10 @@
 #include <gtl/testutil.hpp>
 #include <git/fixture.hpp>
 #include <git/db/odb_loose.h>
+#include <git/db/loose_gc.h>
+#include <git/db/connectivity.h>
+#include <git/obj/commit.h>
+#include <git/obj/flat_tree.h>
 
 #include <boost/timer.hpp>
 #include <boost/shared_array.hpp>
@@ -9,7 +13,10 @@
 #include <boost/iostreams/device/null.hpp>
 #include <boost/iostreams/copy.hpp>
 
+#include <chrono>
 #include <cstring>
+#include <sstream>
+#include <vector>
 
 using namespace std;
 using namespace git;
@@ -105,3 +112,203 @@ BOOST_FIXTURE_TEST_CASE(read_and_write, GitLooseODBFixture)
 	 }
 }
 
+BOOST_FIXTURE_TEST_CASE(garbage_collection, GitLooseODBFixture)
+{
+	// A linear history in which each commit changes one file of one directory, and unreachable blobs
+	static const size_t num_commits = 1000;
+	static const size_t num_dirs = 16;
+	static const size_t num_garbage = 1000;
+	
+	const fs::path db_path(rw_dir() / "gc");
+	const fs::path pack_dir(rw_dir() / "gc_pack");
+	fs::create_directory(db_path);
+	fs::create_directory(pack_dir);
+	LooseODB lodb(db_path);
+	
+	auto insert = [&lodb](Object::Type type, const std::string& data) {
+		std::stringstream stream(data);
+		LooseODB::input_object_type object(type, data.size(), stream);
+		return lodb.insert(object).key();
+	};
+	auto insert_tree = [&insert](const FlatTree& tree) {
+		std::stringstream stream;
+		stream << tree;
+		return insert(Object::Type::Tree, stream.str());
+	};
+	
+	// each directory starts out with one file, as empty trees cannot be stored loose
+	std::vector<LooseODB::key_type> dir_keys(num_dirs);
+	std::vector<std::vector<LooseODB::key_type> > files(num_dirs);
+	char name[32];
+	auto update_dir = [&](size_t d) {
+		FlatTree dir;
+		for (size_t f = 0; f < files[d].size(); ++f) {
+			const int len = sprintf(name, "file%u", (uint)f);
+			dir.push_back(0100644, name, len, files[d][f]);
+		}
+		dir.sort();
+		dir_keys[d] = insert_tree(dir);
+	};
+	for (size_t d = 0; d < num_dirs; ++d) {
+		files[d].push_back(insert(Object::Type::Blob, "directory " + std::to_string(d)));
+		update_dir(d);
+	}
+	
+	LooseODB::key_type tip(LooseODB::key_type::null);
+	boost::timer t;
+	for (size_t c = 0; c < num_commits; ++c) {
+		// the first commit has the initial directories
+		if (c) {
+			const size_t d = c % num_dirs;
+			files[d].push_back(insert(Object::Type::Blob, "content " + std::to_string(c)));
+			update_dir(d);
+		}
+		
+		FlatTree root;
+		for (size_t i = 0; i < num_dirs; ++i) {
+			const int len = sprintf(name, "dir%u", (uint)i);
+			root.push_back(0040000, name, len, dir_keys[i]);
+		}
+		root.sort();
+		
+		Commit commit;
+		commit.tree_key() = insert_tree(root);
+		if (c) {
+			commit.parent_keys().push_back(tip);
+		}
+		commit.author().name = "author";
+		commit.committer() = commit.author();
+		commit.message() = "message";
+		tip = lodb.insert_object(commit).key();
+	}
+	for (size_t g = 0; g < num_garbage; ++g) {
+		insert(Object::Type::Blob, "garbage " + std::to_string(g));
+	}
+	const size_t num_objects = lodb.count();
+	cerr << "Wrote " << num_objects << " loose objects in " << t.elapsed() << " s" << endl;
+	
+	const size_t thread_counts[] = { 1, gtl::work_stealing_pool::default_concurrency() };
+	for (size_t i = 0; i < 2; ++i) {
+		LooseGC gc(lodb, thread_counts[i]);
+		gc.set_expiry(std::time(nullptr) + 60);
+		gc.set_dry_run(true);
+		const auto start = std::chrono::steady_clock::now();
+		const LooseGCStats stats = gc.collect(std::vector<LooseODB::key_type>(1, tip));
+		const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		cerr << "Found " << stats.num_reachable << " of " << stats.num_loose << " loose objects reachable using "
+		     << thread_counts[i] << " threads in " << elapsed << " s (" << stats.num_loose / elapsed
+		     << " objects/s, " << stats.num_pruned << " to prune)" << endl;
+		BOOST_REQUIRE(stats.num_loose == num_objects && stats.num_pruned == num_garbage);
+	}
+	
+	LooseGC gc(lodb);
+	gc.set_expiry(std::time(nullptr) + 60);
+	gc.set_repack(pack_dir);
+	auto start = std::chrono::steady_clock::now();
+	const LooseGCStats stats = gc.collect(std::vector<LooseODB::key_type>(1, tip));
+	const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	cerr << "Pruned " << stats.num_pruned << " objects (" << stats.bytes_pruned << " bytes) and packed "
+	     << stats.num_packed << " objects in " << elapsed << " s" << endl;
+	BOOST_REQUIRE(stats.num_packed == num_objects - num_garbage && lodb.count() == 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(connectivity_check, GitLooseODBFixture)
+{
+	// A push of a linear history onto a base commit, where each commit adds one file to one directory.
+	// Every other file exists in the target database already
+	static const size_t num_commits = 5000;
+	static const size_t num_dirs = 16;
+	
+	const fs::path db_path(rw_dir() / "target");
+	fs::create_directory(db_path);
+	LooseODB target(db_path);
+	MemoryODB staging;
+	
+	auto insert = [&target](Object::Type type, const std::string& data) {
+		std::stringstream stream(data);
+		LooseODB::input_object_type object(type, data.size(), stream);
+		return target.insert(object).key();
+	};
+	auto stage = [&staging](Object::Type type, const std::string& data) {
+		std::stringstream stream(data);
+		MemoryODB::input_object_type object(type, data.size(), stream);
+		return staging.insert(object).key();
+	};
+	auto serialize = [](const FlatTree& tree) {
+		std::stringstream stream;
+		stream << tree;
+		return stream.str();
+	};
+	auto make_commit = [](Commit& commit, const LooseODB::key_type& tree, const LooseODB::key_type& parent) {
+		commit.tree_key() = tree;
+		commit.parent_keys().clear();
+		if (parent != LooseODB::key_type::null) {
+			commit.parent_keys().push_back(parent);
+		}
+		commit.author().name = "author";
+		commit.committer() = commit.author();
+		commit.message() = "message";
+	};
+	
+	std::vector<std::vector<LooseODB::key_type> > files(num_dirs);
+	std::vector<LooseODB::key_type> dir_keys(num_dirs);
+	char name[32];
+	auto dir_tree = [&](size_t d) {
+		FlatTree dir;
+		for (size_t f = 0; f < files[d].size(); ++f) {
+			const int len = sprintf(name, "file%u", (uint)f);
+			dir.push_back(0100644, name, len, files[d][f]);
+		}
+		dir.sort();
+		return serialize(dir);
+	};
+	auto root_tree = [&]() {
+		FlatTree root;
+		for (size_t d = 0; d < num_dirs; ++d) {
+			const int len = sprintf(name, "dir%u", (uint)d);
+			root.push_back(0040000, name, len, dir_keys[d]);
+		}
+		root.sort();
+		return serialize(root);
+	};
+	
+	for (size_t d = 0; d < num_dirs; ++d) {
+		files[d].push_back(insert(Object::Type::Blob, "directory " + std::to_string(d)));
+		dir_keys[d] = insert(Object::Type::Tree, dir_tree(d));
+	}
+	Commit commit;
+	make_commit(commit, insert(Object::Type::Tree, root_tree()), LooseODB::key_type::null);
+	LooseODB::key_type tip = target.insert_object(commit).key();
+	
+	boost::timer t;
+	for (size_t c = 0; c < num_commits; ++c) {
+		const size_t d = c % num_dirs;
+		const std::string content("content " + std::to_string(c));
+		files[d].push_back(c % 2 ? stage(Object::Type::Blob, content) : insert(Object::Type::Blob, content));
+		dir_keys[d] = stage(Object::Type::Tree, dir_tree(d));
+		make_commit(commit, stage(Object::Type::Tree, root_tree()), tip);
+		tip = staging.insert_object(commit).key();
+	}
+	cerr << "Staged " << staging.count() << " objects onto " << target.count() << " loose objects in "
+	     << t.elapsed() << " s" << endl;
+	
+	const size_t thread_counts[] = { 1, gtl::thread_pool::default_concurrency() };
+	for (size_t i = 0; i < 2; ++i) {
+		ConnectivityCheck<LooseODB> check(staging, target, thread_counts[i]);
+		std::vector<LooseODB::key_type> missing;
+		
+		auto start = std::chrono::steady_clock::now();
+		BOOST_REQUIRE(check.check(std::vector<LooseODB::key_type>(1, tip), missing));
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		cerr << "Checked " << num_commits << " new commits using " << thread_counts[i] << " threads in "
+		     << elapsed << " s, parsing " << check.num_parsed() << " objects and looking up "
+		     << check.num_lookups() << " (" << check.num_parsed() / elapsed << " objects/s)" << endl;
+		BOOST_REQUIRE(check.num_parsed() == num_commits * 3);
+		
+		start = std::chrono::steady_clock::now();
+		BOOST_REQUIRE(check.check(missing));
+		elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		cerr << "Checked all " << staging.count() << " staged objects using " << thread_counts[i] << " threads in "
+		     << elapsed << " s" << endl;
+	}
+}
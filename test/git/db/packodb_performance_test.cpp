@@ -0,0 +1,959 @@
+#define BOOST_TEST_MODULE GitPackODBPerformanceTests
+#include <gtl/testutil.hpp>
+#include <git/fixture.hpp>
+#include <git/db/odb_pack.h>
+#include <git/db/odb_mem.h>
+#include <git/db/commit_table.h>
+#include <git/db/rev_walk.h>
+#include <git/db/commit_graph.h>
+#include <git/db/merge_base.h>
+#include <git/db/tree_diff.h>
+#include <git/db/tree_walk.h>
+#include <git/db/rename_detect.h>
+#include <git/db/changed_paths.h>
+#include <git/db/reachability_cache.h>
+#include <git/obj/tree.h>
+#include <git/obj/flat_tree.h>
+#include <git/obj/commit_header.h>
+#include <git/obj/serializer.h>
+#include <git/obj/object_pool.h>
+#include <git/obj/multiobj.h>
+
+#include <boost/timer.hpp>
+#include <boost/iostreams/device/null.hpp>
+#include <boost/iostreams/copy.hpp>
+#include <boost/iostreams/stream.hpp>
+#include <boost/iostreams/device/array.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace git;
+namespace io = boost::iostreams;
+
+const size_t mb = 1024*1024;
+
+//! amount of calls to operator new, to measure allocations. Other test cases allocate on multiple threads
+static std::atomic<size_t> num_allocations(0);
+
+void* operator new(size_t size)
+{
+	num_allocations.fetch_add(1, std::memory_order_relaxed);
+	void* p = std::malloc(size ? size : 1);
+	if (!p) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+//! Read all objects in the given iteration range, and report the throughput
+//! \return amount of bytes read
+template <class Iterator>
+size_t read_all(const Iterator& begin, const Iterator& end, const char* order)
+{
+	typedef PackODB::output_object_type::stream_type ostream_type;
+	io::basic_null_sink<PackODB::char_type> null;
+	char streammem[sizeof(ostream_type)];
+	ostream_type* stream = reinterpret_cast<ostream_type*>(streammem);
+	
+	boost::timer t;
+	size_t count = 0;
+	size_t total = 0;
+	for (Iterator i = begin; i != end; ++i, ++count) {
+		total += i->size();
+		i->stream(stream);
+		io::copy(*stream, null);
+		i->destroy_stream(stream);
+	}
+	double elapsed = t.elapsed();
+	cerr << "Read " << count << " objects with total size of " << (double)total / mb << " MiB in " << order << " order in " 
+	     << elapsed << " s (" << (double)count / elapsed << " objects/s, " << (double)total / mb / elapsed << " MiB/s)" << endl;
+	return total;
+}
+
+// Set GITPP_PERF_PACK_DIR to a directory with packs of a big repository to get meaningful results,
+// e.g. .git/objects/pack
+BOOST_FIXTURE_TEST_CASE(read_pack_order, GitPackedODBFixture)
+{
+	const char* pack_dir = getenv("GITPP_PERF_PACK_DIR");
+	PackODB podb(pack_dir ? fs::path(pack_dir) : rw_dir());
+	cerr << "Reading " << podb.count() << " objects from " << podb.packs().size() << " packs in " << podb.root() << endl;
+	
+	const size_t offset_bytes = read_all(podb.begin(), podb.end(), "offset");
+	const size_t hash_bytes = read_all(podb.hash_order_begin(), podb.hash_order_end(), "hash");
+	BOOST_REQUIRE(offset_bytes == hash_bytes);
+}
+
+BOOST_FIXTURE_TEST_CASE(parse_trees, GitPackedODBFixture)
+{
+	const char* pack_dir = getenv("GITPP_PERF_PACK_DIR");
+	PackODB podb(pack_dir ? fs::path(pack_dir) : rw_dir());
+	
+	std::vector<PackODB::pack_type::data_type> trees;
+	size_t total = 0;
+	for (auto i = podb.begin(); i != podb.end(); ++i) {
+		if (i->type() == Object::Type::Tree) {
+			trees.push_back(PackODB::pack_type::data_type());
+			Object::Type type;
+			i->pack().decompress(i->offset(), type, trees.back());
+			total += trees.back().size();
+		}
+	}
+	const uint iterations = 10;
+	
+	boost::timer t;
+	size_t num_entries = 0;
+	for (uint r = 0; r < iterations; ++r) {
+		for (auto i = trees.begin(); i != trees.end(); ++i) {
+			io::stream<io::basic_array_source<PackODB::char_type> > stream(i->data(), i->size());
+			Tree tree;
+			stream >> tree;
+			num_entries += tree.elements().size();
+		}
+	}
+	double elapsed = t.elapsed();
+	cerr << "Parsed " << trees.size() * iterations << " trees with " << num_entries << " entries into Tree in "
+	     << elapsed << " s (" << (double)total * iterations / mb / elapsed << " MiB/s)" << endl;
+	
+	t.restart();
+	size_t view_entries = 0;
+	for (uint r = 0; r < iterations; ++r) {
+		for (auto i = trees.begin(); i != trees.end(); ++i) {
+			const TreeView view(i->data(), i->size());
+			for (auto e = view.begin(); e != view.end(); ++e) {
+				++view_entries;
+			}
+		}
+	}
+	elapsed = t.elapsed();
+	cerr << "Parsed " << trees.size() * iterations << " trees with " << view_entries << " entries using TreeView in "
+	     << elapsed << " s (" << (double)total * iterations / mb / elapsed << " MiB/s)" << endl;
+	BOOST_REQUIRE(num_entries == view_entries);
+	
+	t.restart();
+	size_t flat_entries = 0;
+	for (uint r = 0; r < iterations; ++r) {
+		for (auto i = trees.begin(); i != trees.end(); ++i) {
+			flat_entries += FlatTree(TreeView(i->data(), i->size())).num_entries();
+		}
+	}
+	elapsed = t.elapsed();
+	cerr << "Parsed " << trees.size() * iterations << " trees with " << flat_entries << " entries into FlatTree in "
+	     << elapsed << " s (" << (double)total * iterations / mb / elapsed << " MiB/s)" << endl;
+	BOOST_REQUIRE(num_entries == flat_entries);
+	
+	// serialization
+	std::vector<Tree> map_trees;
+	std::vector<FlatTree> flat_trees;
+	for (auto i = trees.begin(); i != trees.end(); ++i) {
+		const TreeView view(i->data(), i->size());
+		map_trees.push_back(Tree(view));
+		flat_trees.push_back(FlatTree(view));
+	}
+	
+	t.restart();
+	size_t map_bytes = 0;
+	for (uint r = 0; r < iterations; ++r) {
+		for (auto i = map_trees.begin(); i != map_trees.end(); ++i) {
+			std::ostringstream out;
+			out << *i;
+			map_bytes += out.tellp();
+		}
+	}
+	elapsed = t.elapsed();
+	cerr << "Serialized " << map_trees.size() * iterations << " trees from Tree in " << elapsed << " s ("
+	     << (double)map_bytes / mb / elapsed << " MiB/s)" << endl;
+	
+	t.restart();
+	size_t flat_bytes = 0;
+	for (uint r = 0; r < iterations; ++r) {
+		for (auto i = flat_trees.begin(); i != flat_trees.end(); ++i) {
+			std::ostringstream out;
+			out << *i;
+			flat_bytes += out.tellp();
+		}
+	}
+	elapsed = t.elapsed();
+	cerr << "Serialized " << flat_trees.size() * iterations << " trees from FlatTree in " << elapsed << " s ("
+	     << (double)flat_bytes / mb / elapsed << " MiB/s)" << endl;
+	BOOST_REQUIRE(flat_bytes == total * iterations);
+}
+
+BOOST_FIXTURE_TEST_CASE(parse_commits, GitPackedODBFixture)
+{
+	const char* pack_dir = getenv("GITPP_PERF_PACK_DIR");
+	PackODB podb(pack_dir ? fs::path(pack_dir) : rw_dir());
+	
+	std::vector<PackODB::pack_type::data_type> commits;
+	size_t total = 0;
+	for (auto i = podb.begin(); i != podb.end(); ++i) {
+		if (i->type() == Object::Type::Commit) {
+			commits.push_back(PackODB::pack_type::data_type());
+			Object::Type type;
+			i->pack().decompress(i->offset(), type, commits.back());
+			total += commits.back().size();
+		}
+	}
+	const uint iterations = 50;
+	
+	boost::timer t;
+	size_t num_parents = 0;
+	for (uint r = 0; r < iterations; ++r) {
+		for (auto i = commits.begin(); i != commits.end(); ++i) {
+			Commit commit;
+			commit.parse(i->data(), i->size());
+			num_parents += commit.parent_keys().size();
+		}
+	}
+	double elapsed = t.elapsed();
+	cerr << "Parsed " << commits.size() * iterations << " commits into Commit in "
+	     << elapsed << " s (" << (double)total * iterations / mb / elapsed << " MiB/s)" << endl;
+	
+	t.restart();
+	size_t header_parents = 0;
+	CommitHeader header;
+	for (uint r = 0; r < iterations; ++r) {
+		for (auto i = commits.begin(); i != commits.end(); ++i) {
+			header.parse(i->data(), i->size());
+			header_parents += header.parent_keys.size();
+		}
+	}
+	elapsed = t.elapsed();
+	cerr << "Parsed " << commits.size() * iterations << " commits into CommitHeader in "
+	     << elapsed << " s (" << (double)total * iterations / mb / elapsed << " MiB/s)" << endl;
+	BOOST_REQUIRE(num_parents == header_parents);
+	
+	t.restart();
+	ActorTable actors;
+	size_t num_self_committed = 0;
+	for (uint r = 0; r < iterations; ++r) {
+		for (auto i = commits.begin(); i != commits.end(); ++i) {
+			header.parse(i->data(), i->size(), &actors);
+			num_self_committed += header.author == header.committer;
+		}
+	}
+	elapsed = t.elapsed();
+	cerr << "Parsed " << commits.size() * iterations << " commits into CommitHeader with interned actors in "
+	     << elapsed << " s (" << (double)total * iterations / mb / elapsed << " MiB/s), "
+	     << actors.size() << " distinct actors, " << num_self_committed / iterations << " commits by their author" << endl;
+}
+
+BOOST_FIXTURE_TEST_CASE(serialize_objects, GitPackedODBFixture)
+{
+	const char* pack_dir = getenv("GITPP_PERF_PACK_DIR");
+	PackODB podb(pack_dir ? fs::path(pack_dir) : rw_dir());
+	
+	std::vector<Commit> commits;
+	std::vector<Tree> trees;
+	PackODB::pack_type::data_type data;
+	for (auto i = podb.begin(); i != podb.end(); ++i) {
+		Object::Type type;
+		if (i->type() == Object::Type::Commit) {
+			i->pack().decompress(i->offset(), type, data);
+			commits.push_back(Commit());
+			commits.back().parse(data.data(), data.size());
+		} else if (i->type() == Object::Type::Tree) {
+			i->pack().decompress(i->offset(), type, data);
+			trees.push_back(Tree(TreeView(data.data(), data.size())));
+		}
+	}
+	const uint iterations = 10;
+	
+	// Serialize all objects with the given functor, returning the amount of bytes produced
+	auto measure = [&](const char* name, const std::function<size_t(const Object&)>& serialize) -> size_t {
+		boost::timer t;
+		size_t bytes = 0;
+		for (uint r = 0; r < iterations; ++r) {
+			for (auto i = commits.begin(); i != commits.end(); ++i) {
+				bytes += serialize(*i);
+			}
+			for (auto i = trees.begin(); i != trees.end(); ++i) {
+				bytes += serialize(*i);
+			}
+		}
+		const double elapsed = t.elapsed();
+		cerr << "Serialized " << (commits.size() + trees.size()) * iterations << " commits and trees using " << name 
+		     << " in " << elapsed << " s (" << (double)bytes / mb / elapsed << " MiB/s)" << endl;
+		return bytes;
+	};
+	
+	const size_t stream_bytes = measure("iostreams", [](const Object& obj) -> size_t {
+		std::ostringstream out;
+		switch (obj.type())
+		{
+		case Object::Type::Commit: { out << static_cast<const Commit&>(obj); break; }
+		case Object::Type::Tree: { out << static_cast<const Tree&>(obj); break; }
+		default: break;
+		}
+		return out.tellp();
+	});
+	
+	Serializer::buffer_type buf;
+	const size_t buffer_bytes = measure("Serializer", [&buf](const Object& obj) -> size_t {
+		buf.clear();
+		Serializer(buf).serialize(obj);
+		return buf.size();
+	});
+	BOOST_REQUIRE(stream_bytes == buffer_bytes);
+}
+
+BOOST_FIXTURE_TEST_CASE(pooled_deserialization, GitPackedODBFixture)
+{
+	typedef MemoryODB::output_object_type mem_object_type;
+	const char* pack_dir = getenv("GITPP_PERF_PACK_DIR");
+	PackODB podb(pack_dir ? fs::path(pack_dir) : rw_dir());
+	
+	// decompress everything upfront, to measure deserialization only
+	std::vector<mem_object_type> objects;
+	for (auto i = podb.begin(); i != podb.end(); ++i) {
+		Object::Type type;
+		PackODB::pack_type::data_type data;
+		i->pack().decompress(i->offset(), type, data);
+		objects.push_back(mem_object_type(type, data.size()));
+		objects.back().data().swap(data);
+	}
+	const uint iterations = 10;
+	const size_t num_objects = objects.size() * iterations;
+	
+	auto report = [num_objects](const char* name, double elapsed, size_t allocations) {
+		cerr << "Deserialized " << num_objects << " objects " << name << " in " << elapsed << " s ("
+		     << num_objects / elapsed << " objects/s, " << (double)allocations / num_objects << " allocations per object)" << endl;
+	};
+	
+	size_t allocations = num_allocations;
+	boost::timer t;
+	for (uint r = 0; r < iterations; ++r) {
+		for (auto i = objects.begin(); i != objects.end(); ++i) {
+			MultiObject mobj;
+			i->deserialize(mobj);
+		}
+	}
+	report("into MultiObject", t.elapsed(), num_allocations - allocations);
+	
+	// the first iteration warms up the pool, subsequent ones are the steady state
+	ObjectPool pool;
+	for (uint r = 0; r < iterations + 1; ++r) {
+		if (r == 1) {
+			allocations = num_allocations;
+			t.restart();
+		}
+		for (auto i = objects.begin(); i != objects.end(); ++i) {
+			pool.deserialize(i->type(), i->data().data(), i->size());
+		}
+	}
+	report("into ObjectPool", t.elapsed(), num_allocations - allocations);
+}
+
+BOOST_FIXTURE_TEST_CASE(commit_table, GitPackedODBFixture)
+{
+	const char* pack_dir = getenv("GITPP_PERF_PACK_DIR");
+	PackODB podb(pack_dir ? fs::path(pack_dir) : rw_dir());
+	
+	boost::timer t;
+	CommitTable table;
+	PackODB::pack_type::data_type data;
+	for (auto i = podb.begin(); i != podb.end(); ++i) {
+		if (i->type() == Object::Type::Commit) {
+			Object::Type type;
+			i->pack().decompress(i->offset(), type, data);
+			table.insert(i.key(), data.data(), data.size());
+		}
+	}
+	table.finalize();
+	double elapsed = t.elapsed();
+	cerr << "Built commit table of " << table.size() << " commits in " << elapsed << " s ("
+	     << table.size() / elapsed << " commits/s), using " << (double)table.memory_usage() / table.size() 
+	     << " bytes per commit for " << table.actors().size() << " distinct authors" << endl;
+	
+	// visit all parents, as graph algorithms would
+	t.restart();
+	const uint iterations = 100;
+	uint64_t num_parents = 0;
+	time_t latest = 0;
+	for (uint r = 0; r < iterations; ++r) {
+		for (CommitTable::index_type c = 0; c < table.size(); ++c) {
+			const CommitTable::parent_range parents = table.parents(c);
+			for (auto p = parents.begin(); p != parents.end(); ++p) {
+				if (*p != CommitTable::npos) {
+					++num_parents;
+					latest = std::max(latest, table.time(*p));
+				}
+			}
+		}
+	}
+	elapsed = t.elapsed();
+	cerr << "Visited " << num_parents << " parent links in " << elapsed << " s ("
+	     << num_parents / elapsed << " links/s), latest parent commit at " << latest << endl;
+}
+
+BOOST_FIXTURE_TEST_CASE(rev_walk, GitPackedODBFixture)
+{
+	const char* pack_dir = getenv("GITPP_PERF_PACK_DIR");
+	PackODB podb(pack_dir ? fs::path(pack_dir) : rw_dir());
+	
+	// every commit is a tip, as we don't know the branches
+	std::vector<PackODB::key_type> tips;
+	for (auto i = podb.begin(); i != podb.end(); ++i) {
+		if (i->type() == Object::Type::Commit) {
+			tips.push_back(i.key());
+		}
+	}
+	
+	const RevWalk<PackODB>::Sort sorts[] = { RevWalk<PackODB>::Sort::Date, RevWalk<PackODB>::Sort::Topological };
+	const char* const names[] = { "date", "topological" };
+	for (size_t s = 0; s < 2; ++s) {
+		boost::timer t;
+		RevWalk<PackODB> walk(podb);
+		walk.set_sort(sorts[s]);
+		for (auto i = tips.begin(); i != tips.end(); ++i) {
+			walk.push(*i);
+		}
+		size_t num_commits = 0;
+		for (auto i = walk.begin(); i != walk.end(); ++i) {
+			++num_commits;
+		}
+		const double elapsed = t.elapsed();
+		cerr << "Walked " << num_commits << " commits in " << names[s] << " order in " << elapsed << " s ("
+		     << num_commits / elapsed << " commits/s)" << endl;
+		BOOST_REQUIRE(num_commits == tips.size());
+	}
+	
+	// the same walk, using a commit graph
+	CommitTable table;
+	table.insert_all(podb);
+	table.finalize();
+	const fs::path graph_path(rw_dir() / "commit-graph");
+	CommitGraph::write(graph_path, table);
+	const CommitGraph graph(graph_path);
+	
+	boost::timer t;
+	RevWalk<PackODB> walk(podb);
+	walk.set_commit_graph(&graph);
+	for (auto i = tips.begin(); i != tips.end(); ++i) {
+		walk.push(*i);
+	}
+	size_t num_commits = 0;
+	for (auto i = walk.begin(); i != walk.end(); ++i) {
+		++num_commits;
+	}
+	const double elapsed = t.elapsed();
+	cerr << "Walked " << num_commits << " commits in date order using a commit graph in " << elapsed << " s ("
+	     << num_commits / elapsed << " commits/s)" << endl;
+	BOOST_REQUIRE(num_commits == tips.size() && walk.num_parsed() == 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(merge_base, GitPackedODBFixture)
+{
+	// A synthetic history of many branches forking off one root. Every few commits, each branch merges the 
+	// previous tip of its neighbour, so histories of different branches are interwoven and have many merge bases
+	static const size_t num_branches = 64;
+	static const size_t num_steps = 100;
+	static const size_t merge_interval = 5;
+	
+	MemoryODB db;
+	typedef std::vector<SHA1> key_vector;
+	auto insert_commit = [&db](const key_vector& parents, time_t time) {
+		Commit c;
+		c.tree_key() = SHA1::null;
+		c.parent_keys() = parents;
+		c.author().name = "author";
+		c.author().time = time;
+		c.committer() = c.author();
+		c.message() = "message";
+		return db.insert_object(c).key();
+	};
+	
+	time_t time = 1000;
+	key_vector tips(num_branches, insert_commit(key_vector(), time));
+	std::vector<key_vector> history(num_branches);
+	for (size_t step = 0; step < num_steps; ++step) {
+		const key_vector prev_tips(tips);
+		for (size_t b = 0; b < num_branches; ++b) {
+			key_vector parents(1, prev_tips[b]);
+			if (step % merge_interval == merge_interval - 1) {
+				parents.push_back(prev_tips[(b + 1) % num_branches]);
+			}
+			tips[b] = insert_commit(parents, ++time);
+			history[b].push_back(tips[b]);
+		}
+	}
+	
+	// pairs of commits of different branches and ages
+	std::vector<MergeBase<MemoryODB>::key_pair_type> pairs;
+	std::vector<std::pair<SHA1, SHA1> > ancestry;
+	for (size_t i = 0; i < 1000; ++i) {
+		const size_t b1 = (i * 7) % num_branches;
+		const size_t b2 = (i * 13 + 1) % num_branches;
+		const size_t s1 = num_steps - 1 - (i % 10);
+		const size_t s2 = num_steps - 1 - (i * 3) % 40;
+		pairs.push_back(std::make_pair(history[b1][s1], history[b2][s2]));
+		ancestry.push_back(std::make_pair(history[b1][s1 - 40], history[b2][s2]));
+	}
+	
+	CommitTable table;
+	table.insert_all(db);
+	table.finalize();
+	const fs::path graph_path(rw_dir() / "commit-graph");
+	CommitGraph::write(graph_path, table);
+	const CommitGraph graph(graph_path);
+	
+	std::vector<key_vector> expected;
+	for (int use_graph = 0; use_graph < 2; ++use_graph) {
+		const char* const how = use_graph ? " using a commit graph" : "";
+		MergeBase<MemoryODB> mb(db);
+		if (use_graph) {
+			mb.set_commit_graph(&graph);
+		}
+		
+		boost::timer t;
+		std::vector<key_vector> bases;
+		mb.merge_bases(pairs, bases);
+		double elapsed = t.elapsed();
+		size_t num_bases = 0;
+		for (auto i = bases.begin(); i != bases.end(); ++i) {
+			num_bases += i->size();
+		}
+		cerr << "Found " << num_bases << " merge bases of " << pairs.size() << " pairs among " << table.size() 
+		     << " commits" << how << " in " << elapsed << " s (" << pairs.size() / elapsed << " queries/s, "
+		     << mb.num_parsed() << " commits decoded)" << endl;
+		for (auto i = bases.begin(); i != bases.end(); ++i) {
+			std::sort(i->begin(), i->end());
+		}
+		if (use_graph) {
+			BOOST_REQUIRE(bases == expected);
+			BOOST_REQUIRE(mb.num_parsed() == 0);
+		} else {
+			expected.swap(bases);
+		}
+		
+		t.restart();
+		size_t num_ancestors = 0;
+		for (auto i = ancestry.begin(); i != ancestry.end(); ++i) {
+			num_ancestors += mb.is_ancestor(i->first, i->second);
+		}
+		elapsed = t.elapsed();
+		cerr << "Answered " << ancestry.size() << " ancestry queries (" << num_ancestors << " ancestors)" << how 
+		     << " in " << elapsed << " s (" << ancestry.size() / elapsed << " queries/s)" << endl;
+		BOOST_REQUIRE(num_ancestors > 0);
+	}
+}
+
+//! Insert a synthetic snapshot of num_dirs * num_dirs directories with num_files files each. One file in 
+//! every change_interval-th directory is changed compared to the snapshot with a change_interval of 0.
+//! Blobs are not inserted.
+//! \return key of the root tree
+static SHA1 make_snapshot(MemoryODB& db, size_t num_dirs, size_t num_files, size_t change_interval)
+{
+	auto insert_tree = [&db](const FlatTree& tree) {
+		std::stringstream stream;
+		stream << tree;
+		MemoryODB::input_object_type object(Object::Type::Tree, tree.size(), stream);
+		return db.insert(object).key();
+	};
+	auto blob_key = [](size_t n) {
+		SHA1 key(SHA1::null);
+		std::memcpy(key.bytes(), &n, sizeof(n));
+		return key;
+	};
+	
+	FlatTree root, dir, leaf;
+	char name[32];
+	size_t n = 0;
+	for (size_t d = 0; d < num_dirs; ++d) {
+		dir.clear();
+		for (size_t l = 0; l < num_dirs; ++l, ++n) {
+			leaf.clear();
+			for (size_t f = 0; f < num_files; ++f) {
+				const int len = sprintf(name, "file%u.c", (uint)f);
+				const bool changed = change_interval && f == 0 && n % change_interval == 0;
+				leaf.push_back(0100644, name, len, blob_key(n * num_files + f + (changed ? 1 : 0) * 1000000000));
+			}
+			leaf.sort();
+			const int len = sprintf(name, "leaf%u", (uint)l);
+			dir.push_back(0040000, name, len, insert_tree(leaf));
+		}
+		dir.sort();
+		const int len = sprintf(name, "dir%u", (uint)d);
+		root.push_back(0040000, name, len, insert_tree(dir));
+	}
+	root.sort();
+	return insert_tree(root);
+}
+
+BOOST_FIXTURE_TEST_CASE(tree_diff, GitPackedODBFixture)
+{
+	// the changed snapshots modify one file in every change_interval-th leaf directory
+	static const size_t num_dirs = 100;
+	static const size_t num_files = 10;
+	static const size_t change_intervals[] = { 10000, 100, 1 };
+	
+	MemoryODB db;
+	const SHA1 base = make_snapshot(db, num_dirs, num_files, 0);
+	for (size_t c = 0; c < sizeof(change_intervals) / sizeof(change_intervals[0]); ++c) {
+		const SHA1 changed = make_snapshot(db, num_dirs, num_files, change_intervals[c]);
+		TreeDiff<MemoryODB>::change_vector_type expected;
+		for (int parallel = 0; parallel < 2; ++parallel) {
+			TreeDiff<MemoryODB> diff(db, parallel ? gtl::thread_pool::default_concurrency() : 1);
+			TreeDiff<MemoryODB>::change_vector_type changes;
+			// wall clock time, as the process time of all threads is of no interest
+			const auto start = std::chrono::steady_clock::now();
+			diff.diff(base, changed, changes);
+			const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			cerr << "Diffed snapshots of " << num_dirs * num_dirs * num_files << " files with " << changes.size() 
+			     << " changes " << (parallel ? "in parallel " : "") << "in " << elapsed * 1000.0 << " ms (" 
+			     << diff.num_trees_read() << " trees read)" << endl;
+			BOOST_REQUIRE(changes.size() == (num_dirs * num_dirs + change_intervals[c] - 1) / change_intervals[c]);
+			if (parallel) {
+				BOOST_REQUIRE(changes.size() == expected.size());
+				for (size_t i = 0; i < changes.size(); ++i) {
+					BOOST_REQUIRE(changes[i].path == expected[i].path && changes[i].new_key == expected[i].new_key);
+				}
+			} else {
+				expected.swap(changes);
+			}
+		}
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE(tree_walk, GitPackedODBFixture)
+{
+	// a snapshot of one million files
+	MemoryODB db;
+	const SHA1 root = make_snapshot(db, 100, 100, 0);
+	
+	const size_t num_threads[] = { 1, gtl::work_stealing_pool::default_concurrency() };
+	for (size_t t = 0; t < 2; ++t) {
+		TreeWalker<MemoryODB> walker(db, num_threads[t]);
+		walker.set_unique_trees(false);
+		std::atomic<size_t> num_files(0);
+		const auto start = std::chrono::steady_clock::now();
+		walker.walk(root, [&num_files](const std::string&, TreeWalker<MemoryODB>::mode_type mode, const SHA1&) {
+			num_files += mode == 0100644;
+		});
+		const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		cerr << "Enumerated " << walker.num_entries() << " entries of " << walker.num_trees_read() << " trees using " 
+		     << num_threads[t] << " threads in " << elapsed << " s (" << walker.num_entries() / elapsed << " entries/s)" << endl;
+		BOOST_REQUIRE(num_files == 1000000);
+	}
+	
+	// all trees of a pack
+	const char* pack_dir = getenv("GITPP_PERF_PACK_DIR");
+	PackODB podb(pack_dir ? fs::path(pack_dir) : rw_dir());
+	TreeWalker<PackODB>::key_vector_type trees;
+	for (auto i = podb.begin(); i != podb.end(); ++i) {
+		if (i->type() == Object::Type::Tree) {
+			trees.push_back(i.key());
+		}
+	}
+	for (size_t t = 0; t < 2; ++t) {
+		TreeWalker<PackODB> walker(podb, num_threads[t]);
+		const auto start = std::chrono::steady_clock::now();
+		walker.walk(trees, [](const std::string&, TreeWalker<PackODB>::mode_type, const SHA1&) {});
+		const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		cerr << "Enumerated " << walker.num_entries() << " entries of all " << walker.num_trees_read() << " trees of a pack using " 
+		     << num_threads[t] << " threads in " << elapsed << " s (" << walker.num_trees_read() / elapsed << " trees/s)" << endl;
+		BOOST_REQUIRE(walker.num_trees_read() == trees.size());
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE(rename_detect, GitPackedODBFixture)
+{
+	// all files of a directory are moved into another one, and some of them are edited
+	static const size_t num_files = 10000;
+	static const size_t num_edited = 1000;
+	
+	MemoryODB db;
+	FlatTree old_dir, new_dir;
+	char name[32];
+	std::ostringstream data;
+	for (size_t f = 0; f < num_files; ++f) {
+		data.str(std::string());
+		for (size_t l = 0; l < 40; ++l) {
+			data << "file " << f << " line " << l << "\n";
+		}
+		Blob blob;
+		std::string content(data.str());
+		blob.data().assign(content.begin(), content.end());
+		const SHA1 key = db.insert_object(blob).key();
+		const int len = sprintf(name, "file%u.c", (uint)f);
+		old_dir.push_back(0100644, name, len, key);
+		
+		if (f % (num_files / num_edited) == 0) {
+			content += "edited\n";
+			blob.data().assign(content.begin(), content.end());
+			new_dir.push_back(0100644, name, len, db.insert_object(blob).key());
+		} else {
+			new_dir.push_back(0100644, name, len, key);
+		}
+	}
+	old_dir.sort();
+	new_dir.sort();
+	auto insert_tree = [&db](const FlatTree& tree) {
+		std::stringstream stream;
+		stream << tree;
+		MemoryODB::input_object_type object(Object::Type::Tree, tree.size(), stream);
+		return db.insert(object).key();
+	};
+	FlatTree old_root, new_root;
+	old_root.push_back(0040000, "old", 3, insert_tree(old_dir));
+	new_root.push_back(0040000, "new", 3, insert_tree(new_dir));
+	
+	TreeDiff<MemoryODB> diff(db, 1);
+	TreeDiff<MemoryODB>::change_vector_type changes;
+	const size_t num_threads[] = { 1, gtl::thread_pool::default_concurrency() };
+	for (size_t t = 0; t < 2; ++t) {
+		diff.diff(insert_tree(old_root), insert_tree(new_root), changes);
+		BOOST_REQUIRE(changes.size() == 2 * num_files);
+		
+		RenameDetector<MemoryODB> detector(db, num_threads[t]);
+		const auto start = std::chrono::steady_clock::now();
+		detector.detect(changes);
+		const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		cerr << "Detected " << detector.num_exact() << " exact and " << detector.num_inexact() << " similar renames using "
+		     << num_threads[t] << " threads in " << elapsed << " s" << endl;
+		BOOST_REQUIRE(changes.size() == num_files);
+		BOOST_REQUIRE(detector.num_exact() == num_files - num_edited && detector.num_inexact() == num_edited);
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE(changed_path_filters, GitPackedODBFixture)
+{
+	// A linear history in which each commit changes one file of one directory
+	static const size_t num_commits = 5000;
+	static const size_t num_dirs = 32;
+	static const size_t num_files = 8;
+	
+	MemoryODB db;
+	auto insert_tree = [&db](const FlatTree& tree) {
+		std::stringstream stream;
+		stream << tree;
+		MemoryODB::input_object_type object(Object::Type::Tree, tree.size(), stream);
+		return db.insert(object).key();
+	};
+	auto blob_key = [](size_t n) {
+		SHA1 key(SHA1::null);
+		std::memcpy(key.bytes(), &n, sizeof(n));
+		return key;
+	};
+	
+	// blob keys of each file, indexed by directory and file
+	std::vector<std::vector<SHA1> > blobs(num_dirs, std::vector<SHA1>(num_files));
+	std::vector<SHA1> dir_keys(num_dirs);
+	char name[32];
+	auto insert_dir = [&](size_t d) {
+		FlatTree dir;
+		for (size_t f = 0; f < num_files; ++f) {
+			const int len = sprintf(name, "file%u.c", (uint)f);
+			dir.push_back(0100644, name, len, blobs[d][f]);
+		}
+		dir.sort();
+		dir_keys[d] = insert_tree(dir);
+	};
+	for (size_t d = 0; d < num_dirs; ++d) {
+		for (size_t f = 0; f < num_files; ++f) {
+			blobs[d][f] = blob_key(d * num_files + f);
+		}
+		insert_dir(d);
+	}
+	
+	SHA1 tip(SHA1::null);
+	for (size_t c = 0; c < num_commits; ++c) {
+		const size_t d = c % num_dirs;
+		blobs[d][(c / num_dirs) % num_files] = blob_key(1000000 + c);
+		insert_dir(d);
+		
+		FlatTree root;
+		for (size_t i = 0; i < num_dirs; ++i) {
+			const int dlen = sprintf(name, "dir%u", (uint)i);
+			root.push_back(0040000, name, dlen, dir_keys[i]);
+		}
+		root.sort();
+		
+		Commit commit;
+		commit.tree_key() = insert_tree(root);
+		if (c) {
+			commit.parent_keys().push_back(tip);
+		}
+		commit.author().name = "author";
+		commit.author().time = 1000 + c;
+		commit.committer() = commit.author();
+		commit.message() = "message";
+		tip = db.insert_object(commit).key();
+	}
+	
+	CommitTable table;
+	table.insert_all(db);
+	table.finalize();
+	
+	auto start = std::chrono::steady_clock::now();
+	ChangedPathFilters filters;
+	filters.compute(db, table);
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	cerr << "Computed changed path filters of " << filters.size() << " commits in " << elapsed << " s ("
+	     << filters.size() / elapsed << " commits/s, " << filters.data().size() << " bytes)" << endl;
+	
+	const fs::path graph_path(rw_dir() / "commit-graph");
+	const fs::path bloom_graph_path(rw_dir() / "commit-graph-bloom");
+	CommitGraph::write(graph_path, table);
+	CommitGraph::write(bloom_graph_path, table, &filters);
+	const CommitGraph graph(graph_path);
+	const CommitGraph bloom_graph(bloom_graph_path);
+	
+	const char* const paths[] = { "dir7/file3.c", "dir12", "dir40" };
+	for (size_t p = 0; p < sizeof(paths) / sizeof(paths[0]); ++p) {
+		std::vector<SHA1> expected;
+		for (int use_filters = 0; use_filters < 2; ++use_filters) {
+			RevWalk<MemoryODB> walk(db);
+			walk.set_commit_graph(use_filters ? &bloom_graph : &graph);
+			walk.set_paths(RevWalk<MemoryODB>::path_vector_type(1, paths[p]));
+			walk.push(tip);
+			
+			boost::timer t;
+			const std::vector<SHA1> commits(walk.begin(), walk.end());
+			elapsed = t.elapsed();
+			cerr << "Found " << commits.size() << " of " << num_commits << " commits changing " << paths[p]
+			     << (use_filters ? " using" : " without") << " changed path filters in " << elapsed << " s ("
+			     << walk.num_diffs() << " diffs, " << walk.num_bloom_skipped() << " skipped)" << endl;
+			if (use_filters) {
+				BOOST_REQUIRE(commits == expected);
+				BOOST_REQUIRE(walk.num_diffs() < num_commits / 10);
+			} else {
+				expected = commits;
+				BOOST_REQUIRE(walk.num_diffs() == num_commits);
+			}
+		}
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE(reachability_cache, GitPackedODBFixture)
+{
+	// A long mainline, where every few commits a short topic branch is merged. Queries ask whether mainline
+	// commits are reachable from a few long-lived branches
+	static const size_t num_commits = 20000;
+	static const size_t merge_interval = 10;
+	static const size_t num_queries = 200000;
+	
+	MemoryODB db;
+	typedef std::vector<SHA1> key_vector;
+	auto insert_commit = [&db](const key_vector& parents, time_t time) {
+		Commit c;
+		c.tree_key() = SHA1::null;
+		c.parent_keys() = parents;
+		c.author().name = "author";
+		c.author().time = time;
+		c.committer() = c.author();
+		c.message() = "message";
+		return db.insert_object(c).key();
+	};
+	
+	time_t time = 1000;
+	key_vector mainline(1, insert_commit(key_vector(), time));
+	while (mainline.size() < num_commits) {
+		key_vector parents(1, mainline.back());
+		if (mainline.size() % merge_interval == 0) {
+			parents.push_back(insert_commit(key_vector(1, mainline[mainline.size() - merge_interval / 2]), ++time));
+		}
+		mainline.push_back(insert_commit(parents, ++time));
+	}
+	
+	CommitTable table;
+	table.insert_all(db);
+	table.finalize();
+	const fs::path graph_path(rw_dir() / "commit-graph");
+	CommitGraph::write(graph_path, table);
+	const CommitGraph graph(graph_path);
+	
+	const char* const names[] = { "main", "release", "maintenance" };
+	const size_t tips[] = { num_commits - 1, num_commits * 3 / 4, num_commits / 4 };
+	ReachabilityCache<MemoryODB> cache(db);
+	cache.set_commit_graph(&graph);
+	auto start = std::chrono::steady_clock::now();
+	for (size_t t = 0; t < 3; ++t) {
+		cache.set_tip(names[t], mainline[tips[t]]);
+	}
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	cerr << "Cached " << table.size() << " commits reachable from 3 tips in " << elapsed << " s, walking "
+	     << cache.num_walked() << " commits" << endl;
+	
+	// the expected answers, as every mainline commit is reachable from the tips of younger mainline commits
+	size_t expected_reachable = 0;
+	for (size_t q = 0; q < num_queries; ++q) {
+		expected_reachable += (q * 7919) % num_commits <= tips[q % 3];
+	}
+	
+	const size_t num_threads_max = std::max((size_t)std::thread::hardware_concurrency(), (size_t)1);
+	for (size_t num_threads = 1; ; num_threads = std::min(num_threads * 2, num_threads_max)) {
+		std::atomic<size_t> num_reachable(0), num_ancestors(0), num_fallbacks(0);
+		std::vector<std::thread> threads;
+		start = std::chrono::steady_clock::now();
+		for (size_t t = 0; t < num_threads; ++t) {
+			threads.push_back(std::thread([&, t]() {
+				ReachabilityCache<MemoryODB>::Reader reader(cache);
+				size_t reachable = 0, ancestors = 0;
+				for (size_t q = t; q < num_queries; q += num_threads) {
+					const SHA1& commit = mainline[(q * 7919) % num_commits];
+					reachable += reader.is_reachable(commit, names[q % 3]);
+					ancestors += reader.is_ancestor(commit, mainline[tips[q % 3]]);
+				}
+				num_reachable += reachable;
+				num_ancestors += ancestors;
+				num_fallbacks += reader.num_fallbacks();
+			}));
+		}
+		for (auto i = threads.begin(); i != threads.end(); ++i) {
+			i->join();
+		}
+		elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		cerr << "Answered " << num_queries * 2 << " cached reachability queries using " << num_threads
+		     << " threads in " << elapsed << " s (" << num_queries * 2 / elapsed << " queries/s)" << endl;
+		BOOST_REQUIRE(num_reachable == expected_reachable && num_ancestors == expected_reachable);
+		BOOST_REQUIRE(num_fallbacks == 0);
+		if (num_threads == num_threads_max) {
+			break;
+		}
+	}
+	
+	// the same queries without the cache
+	{
+		MergeBase<MemoryODB> mb(db);
+		mb.set_commit_graph(&graph);
+		static const size_t num_uncached = 500;
+		size_t num_ancestors = 0;
+		start = std::chrono::steady_clock::now();
+		for (size_t q = 0; q < num_uncached; ++q) {
+			num_ancestors += mb.is_ancestor(mainline[(q * 7919) % num_commits], mainline[tips[q % 3]]);
+		}
+		elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		cerr << "Answered " << num_uncached << " uncached ancestry queries in " << elapsed << " s ("
+		     << num_uncached / elapsed << " queries/s)" << endl;
+		BOOST_REQUIRE(num_ancestors > 0);
+	}
+	
+	// moving a tip forward only walks the new commits
+	static const size_t num_updates = 100;
+	for (size_t u = 0; u < num_updates; ++u) {
+		mainline.push_back(insert_commit(key_vector(1, mainline.back()), ++time));
+	}
+	const size_t num_walked = cache.num_walked();
+	start = std::chrono::steady_clock::now();
+	for (size_t u = 0; u < num_updates; ++u) {
+		cache.set_tip("main", mainline[num_commits + u]);
+	}
+	elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	cerr << "Moved a tip forward " << num_updates << " times in " << elapsed << " s (" << elapsed / num_updates * 1000
+	     << " ms per update, " << cache.num_walked() - num_walked << " commits walked)" << endl;
+	BOOST_REQUIRE(cache.num_walked() - num_walked == num_updates);
+}
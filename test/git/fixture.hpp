@@ -125,4 +125,12 @@ struct GitPackedODBFixture: public BasicFixtureCopyer
 	{}
 };
 
+//! \brief pack written by git, containing only the empty blob and the empty tree
+struct GitEmptyObjectsPackFixture : public BasicFixtureCopyer
+{
+	GitEmptyObjectsPackFixture()
+	    : BasicFixtureCopyer("empty_objects")
+	{}
+};
+
 #endif // TEST_GIT_FIXTURE_HPP
@@ -4,9 +4,16 @@
 #include <gtl/db/odb.hpp>
 #include <gtl/db/odb_mem.hpp>
 #include <gtl/db/odb_object.hpp>
+#include <gtl/db/ewah_bitmap.hpp>
+#include <gtl/work_stealing_pool.hpp>
 
+#include <atomic>
+#include <functional>
+#include <stdexcept>
 #include <type_traits>
 #include <vector>
+#include <sstream>
+#include <cstdlib>
 #include <utility>
 
 using namespace gtl;
@@ -24,3 +31,114 @@ using namespace gtl;
 BOOST_AUTO_TEST_CASE(cpp0x)
 {
 }
+
+BOOST_AUTO_TEST_CASE(ewah_bitmap_model)
+{
+	typedef std::vector<bool> bits_type;
+	const uint64_t num_bits = 20000;
+	
+	// sparse bits, long runs of ones and random literals
+	bits_type lbits(num_bits, false), rbits(num_bits / 2, false);
+	std::srand(5);
+	for (uint64_t i = 0; i < lbits.size(); ++i) {
+		lbits[i] = (i > 3000 && i < 9000) || (i % 997 == 0) || (i > 15000 && std::rand() % 3 == 0);
+	}
+	for (uint64_t i = 0; i < rbits.size(); ++i) {
+		rbits[i] = (i > 5000 && i < 6400) || std::rand() % 7 == 0;
+	}
+	
+	auto make = [](const bits_type& bits) -> ewah_bitmap {
+		ewah_bitmap out;
+		for (uint64_t i = 0; i < bits.size(); ++i) {
+			if (bits[i]) {
+				out.set(i);
+			}
+		}
+		out.resize(bits.size());
+		return out;
+	};
+	auto verify = [](const ewah_bitmap& b, const bits_type& bits) {
+		BOOST_REQUIRE(b.size() == bits.size());
+		uint64_t count = 0;
+		for (uint64_t i = 0; i < bits.size(); ++i) {
+			count += bits[i];
+			BOOST_REQUIRE(b.test(i) == bits[i]);
+		}
+		BOOST_REQUIRE(b.count() == count);
+		uint64_t seen = 0;
+		b.each([&bits, &seen](uint64_t bit) {
+			BOOST_REQUIRE(bits[bit]);
+			++seen;
+		});
+		BOOST_REQUIRE(seen == count);
+	};
+	
+	const ewah_bitmap l(make(lbits)), r(make(rbits));
+	verify(l, lbits);
+	verify(r, rbits);
+	BOOST_CHECK(l.compressed_words() < num_bits / ewah_bitmap::word_bits);
+	
+	bits_type por(num_bits), pand(num_bits), pxor(num_bits), pandnot(num_bits);
+	for (uint64_t i = 0; i < num_bits; ++i) {
+		const bool rb = i < rbits.size() && rbits[i];
+		por[i] = lbits[i] || rb;
+		pand[i] = lbits[i] && rb;
+		pxor[i] = lbits[i] != rb;
+		pandnot[i] = lbits[i] && !rb;
+	}
+	verify(l | r, por);
+	verify(r | l, por);
+	verify(l & r, pand);
+	verify(l ^ r, pxor);
+	verify(l.and_not(r), pandnot);
+	
+	ewah_bitmap lor(l);
+	lor |= r;
+	BOOST_CHECK(lor == (l | r));
+	BOOST_CHECK(lor != l);
+	BOOST_CHECK((l ^ l).count() == 0);
+	
+	// serialization
+	std::stringstream s;
+	l.write(s);
+	const std::string data(s.str());
+	BOOST_REQUIRE(data.size() == l.serialized_size());
+	ewah_bitmap rl;
+	BOOST_REQUIRE(rl.read(reinterpret_cast<const uchar*>(data.data()), data.size()) == data.size());
+	verify(rl, lbits);
+	BOOST_REQUIRE_THROW(rl.read(reinterpret_cast<const uchar*>(data.data()), data.size() - 1), pack_error);
+}
+
+BOOST_AUTO_TEST_CASE(work_stealing_pool_model)
+{
+	// tasks spawn a binary tree of tasks, which are all processed before wait() returns
+	work_stealing_pool pool(4);
+	BOOST_REQUIRE(pool.size() == 4);
+	std::atomic<size_t> count(0);
+	std::function<void(int)> spawn = [&](int depth) {
+		++count;
+		if (depth) {
+			pool.submit([&spawn, depth]() { spawn(depth - 1); });
+			pool.submit([&spawn, depth]() { spawn(depth - 1); });
+		}
+	};
+	for (int i = 0; i < 3; ++i) {
+		pool.submit([&spawn]() { spawn(12); });
+	}
+	pool.wait();
+	BOOST_REQUIRE(count == 3 * ((1 << 13) - 1));
+	
+	// the first exception is rethrown once, all other tasks are still processed
+	count = 0;
+	for (int i = 0; i < 100; ++i) {
+		pool.submit([&count, i]() {
+			++count;
+			if (i % 10 == 0) {
+				throw std::runtime_error("failed");
+			}
+		});
+	}
+	BOOST_REQUIRE_THROW(pool.wait(), std::runtime_error);
+	BOOST_REQUIRE(count == 100);
+	pool.wait();
+}